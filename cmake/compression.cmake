@@ -0,0 +1,35 @@
+
+find_package(PkgConfig REQUIRED)
+
+# optional: compressed capture files are rejected at runtime if the matching library is missing
+
+pkg_check_modules(ZLIB zlib)
+pkg_check_modules(ZSTD libzstd)
+
+set(COMPRESSION_DEFINITIONS "")
+set(COMPRESSION_INCLUDE_DIRS "")
+set(COMPRESSION_LIBRARIES "")
+
+if (ZLIB_FOUND)
+    message(STATUS "Detecting zlib - done
+   ZLIB_INCLUDE_DIRS: ${ZLIB_INCLUDE_DIRS}
+   ZLIB_LIBRARIES: ${ZLIB_LIBRARIES}
+   ZLIB_VERSION: ${ZLIB_VERSION}")
+    list(APPEND COMPRESSION_DEFINITIONS ZOOM_ANALYSIS_HAVE_ZLIB)
+    list(APPEND COMPRESSION_INCLUDE_DIRS ${ZLIB_INCLUDE_DIRS})
+    list(APPEND COMPRESSION_LIBRARIES ${ZLIB_LIBRARIES})
+else ()
+    message(STATUS "Detecting zlib - not found, reading .gz files disabled")
+endif ()
+
+if (ZSTD_FOUND)
+    message(STATUS "Detecting libzstd - done
+   ZSTD_INCLUDE_DIRS: ${ZSTD_INCLUDE_DIRS}
+   ZSTD_LIBRARIES: ${ZSTD_LIBRARIES}
+   ZSTD_VERSION: ${ZSTD_VERSION}")
+    list(APPEND COMPRESSION_DEFINITIONS ZOOM_ANALYSIS_HAVE_ZSTD)
+    list(APPEND COMPRESSION_INCLUDE_DIRS ${ZSTD_INCLUDE_DIRS})
+    list(APPEND COMPRESSION_LIBRARIES ${ZSTD_LIBRARIES})
+else ()
+    message(STATUS "Detecting libzstd - not found, reading .zst files disabled")
+endif ()
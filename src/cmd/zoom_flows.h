@@ -1,5 +1,6 @@
 
 #include <chrono>
+#include <cstdint>
 #include <cxxopts/cxxopts.h>
 #include <filesystem>
 #include <optional>
@@ -9,10 +10,17 @@
 #include "../lib/pcap_file_reader.h"
 #include "../lib/pcap_file_writer.h"
 #include "../lib/util.h"
+#include "../lib/zoom_flow_exporter.h"
 #include "../lib/zoom_flow_tracker.h"
 
 namespace zoom_flows {
 
+    //! what the files of the demux output hold, see -d and -k
+    enum class demux_key {
+        flow,  // the packets of a flow
+        client // the packets of all flows of an address outside of Zoom's networks
+    };
+
     struct config {
         std::string input_path;
 
@@ -21,8 +29,29 @@ namespace zoom_flows {
         std::optional<std::string> types_out_file_name = std::nullopt;
         std::optional<std::string> rate_out_file_name  = std::nullopt;
         std::optional<std::string> zpkt_out_file_name  = std::nullopt;
+        std::optional<std::string> tunnels_out_file_name = std::nullopt;
+        std::optional<std::string> demux_out_dir = std::nullopt;
+        demux_key demux_by = demux_key::flow;
+
+        std::optional<ipfix_exporter::collector> ipfix_collector = std::nullopt; // see -x
+        zoom::flow_exporter::config ipfix;
+
+        pcap_file_reader::backend reader_backend = pcap_file_reader::backend::libpcap;
+
+        std::optional<std::int64_t> start_ts_s = std::nullopt; // packets at or after
+        std::optional<std::int64_t> end_ts_s   = std::nullopt; // packets before
 
-        bool p2p_only = false;
+        std::optional<double> progress_s = std::nullopt; // progress interval, see -P
+
+        bool p2p_only     = false;
+        bool merge_inputs = false;
+        unsigned jobs     = 1;
+        bool follow       = false;
+        bool manifest     = false;
+        bool direct_io    = false; // pcap output, see -D
+        bool headers_only = false; // pcap output, see -H
+
+        file_rotation rotation; // pcap and zpkt outputs, see -R and -I
     };
 
     void print_help(cxxopts::Options& opts, int exit_code = 0) {
@@ -50,7 +79,54 @@ namespace zoom_flows {
                  cxxopts::value<std::string>(),"OUT.pcap")
                 ("z,zpkt-out", "zoom packets binary output file (optional)",
                  cxxopts::value<std::string>(),"OUT.zpkt")
+                ("T,tunnels-out", "per-tunnel packet summary output file, for GRE, ERSPAN and "
+                 "VXLAN packets, which are decapsulated (optional)",
+                 cxxopts::value<std::string>(), "OUT.csv")
+                ("d,demux-out", "write the packets of each Zoom flow (or client, see -k) to a pcap "
+                 "file of its own in DIR (optional)",
+                 cxxopts::value<std::string>(), "DIR")
+                ("k,demux-key", "files of -d: flow (flow_ID.pcap, see the flow summary) or client "
+                 "(IP.pcap, all flows of an address outside of Zoom's networks) (default: flow)",
+                 cxxopts::value<std::string>(), "K")
+                ("x,ipfix-out", "export the Zoom flows as IPFIX records to a collector at "
+                 "[udp://|tcp://]HOST[:PORT] (default: UDP, port 4739) while reading the input "
+                 "(optional)",
+                 cxxopts::value<std::string>(), "COLLECTOR")
+                ("ipfix-active", "export the packets of flows seen by -x every S seconds of packet "
+                 "time (default: 60)",
+                 cxxopts::value<unsigned>(), "S")
+                ("ipfix-idle", "end the flows of -x once they saw no packets for S seconds of "
+                 "packet time (default: 30)",
+                 cxxopts::value<unsigned>(), "S")
                 ("2,p2p-only", "only process STUN and P2P packets")
+                ("b,backend", "input reader back end: libpcap, mmap, readahead, io_uring "
+                 "(default: libpcap)",
+                 cxxopts::value<std::string>(), "B")
+                ("m,merge", "merge input files by timestamp (concurrent capture taps) instead of "
+                 "reading them one after another")
+                ("j,jobs", "split a single uncompressed classic pcap input into N parts processed "
+                 "in parallel with the mmap back end (default: 1)",
+                 cxxopts::value<unsigned>(), "N")
+                ("F,follow", "keep reading files added to the input directory by a rotating "
+                 "capture as they are completed, until interrupted")
+                ("s,start", "only process packets captured at or after TS_S (seconds since the epoch)",
+                 cxxopts::value<std::int64_t>(), "TS_S")
+                ("e,end", "only process packets captured before TS_S (seconds since the epoch)",
+                 cxxopts::value<std::int64_t>(), "TS_S")
+                ("M,manifest", "keep a summary of the input files in a manifest in their directory "
+                 "(.pcap_manifest.csv) and skip files outside of -s/-e without opening them")
+                ("D,direct-io", "write the pcap output with O_DIRECT, bypassing the page cache")
+                ("H,headers-only", "cut off packets of the pcap outputs after their RTP/RTCP "
+                 "header and extension, keeping their original length")
+                ("R,rotate-size", "continue the pcap and zpkt outputs in a new file (OUT.pcap0, "
+                 "OUT.pcap1, ...) once a file would exceed MB megabytes (optional)",
+                 cxxopts::value<unsigned long long>(), "MB")
+                ("I,rotate-interval", "continue the pcap and zpkt outputs in a new file every S "
+                 "seconds of wall-clock time (optional)",
+                 cxxopts::value<unsigned>(), "S")
+                ("P,progress", "print input throughput and read/consumer time every S seconds "
+                 "instead of every 10M packets (optional)",
+                 cxxopts::value<double>(), "S")
                 ("h,help", "print this help message");
 
         return opts;
@@ -88,11 +164,90 @@ namespace zoom_flows {
             config.zpkt_out_file_name = parsed["z"].as<std::string>();
         }
 
+        if (parsed.count("T")) {
+            config.tunnels_out_file_name = parsed["T"].as<std::string>();
+        }
+
+        if (parsed.count("d")) {
+            config.demux_out_dir = parsed["d"].as<std::string>();
+        }
+
+        if (parsed.count("k")) {
+
+            auto key = parsed["k"].as<std::string>();
+
+            if (key == "flow") {
+                config.demux_by = demux_key::flow;
+            } else if (key == "client") {
+                config.demux_by = demux_key::client;
+            } else {
+                std::cerr << "error: unknown demux key " << key << std::endl;
+                print_help(opts, 1);
+            }
+        }
+
+        if (parsed.count("x")) {
+            try {
+                config.ipfix_collector =
+                    ipfix_exporter::collector::parse(parsed["x"].as<std::string>());
+            } catch (const std::invalid_argument& e) {
+                std::cerr << "error: " << e.what() << std::endl;
+                print_help(opts, 1);
+            }
+        }
+
+        if (parsed.count("ipfix-active")) {
+            config.ipfix.active_timeout_s = parsed["ipfix-active"].as<unsigned>();
+        }
+
+        if (parsed.count("ipfix-idle")) {
+            config.ipfix.idle_timeout_s = parsed["ipfix-idle"].as<unsigned>();
+        }
+
+        if (parsed.count("b")) {
+            try {
+                config.reader_backend =
+                    pcap_file_reader::backend_from_string(parsed["b"].as<std::string>());
+            } catch (const std::invalid_argument& e) {
+                std::cerr << "error: " << e.what() << std::endl;
+                print_help(opts, 1);
+            }
+        }
+
+        if (parsed.count("j")) {
+            config.jobs = std::max(parsed["j"].as<unsigned>(), 1u);
+        }
+
+        if (parsed.count("s")) {
+            config.start_ts_s = parsed["s"].as<std::int64_t>();
+        }
+
+        if (parsed.count("e")) {
+            config.end_ts_s = parsed["e"].as<std::int64_t>();
+        }
+
+        if (parsed.count("R")) {
+            config.rotation.max_bytes = parsed["R"].as<unsigned long long>() * 1000000;
+        }
+
+        if (parsed.count("I")) {
+            config.rotation.interval = std::chrono::seconds(parsed["I"].as<unsigned>());
+        }
+
+        if (parsed.count("P")) {
+            config.progress_s = parsed["P"].as<double>();
+        }
+
         if (parsed.count("h")) {
             print_help(opts);
         }
 
         config.p2p_only = parsed.count("2");
+        config.merge_inputs = parsed.count("m");
+        config.follow = parsed.count("F");
+        config.manifest = parsed.count("M");
+        config.direct_io = parsed.count("D");
+        config.headers_only = parsed.count("H");
 
         return config;
     }
@@ -1,23 +1,616 @@
 
 #include <array>
+#include <csignal>
+#include <exception>
+#include <limits>
+#include <map>
+#include <system_error>
+#include <thread>
 
 #include "zoom_flows.h"
+#include "../lib/directory_watcher.h"
+#include "../lib/file_decoder.h"
+#include "../lib/async_writer.h"
+#include "../lib/link_layer.h"
+#include "../lib/pcap_demux_writer.h"
+#include "../lib/pcap_manifest.h"
 #include "../lib/zoom.h"
+#include "../lib/simple_binary_reader.h"
 #include "../lib/simple_binary_writer.h"
 #include "../lib/mac_counter.h"
+#include "../lib/zoom_nets.h"
+
+// packets read, classified and tracked per iteration of the main loop
+static const std::size_t PKT_BATCH_LEN = 128;
+
+// longest wait for the next input file before checking whether to stop following, see -F
+static const int FOLLOW_POLL_MS = 500;
+
+// set by SIGINT and SIGTERM to stop following the input directory
+static volatile std::sig_atomic_t stop_following = 0;
+
+struct pkts_bytes {
+    unsigned long pkts = 0, bytes = 0;
+
+    void increment(unsigned long pkts_inc, unsigned long bytes_inc) {
+        pkts += pkts_inc;
+        bytes += bytes_inc;
+    }
+};
+
+//! packets and bytes of Zoom packets per type
+struct type_counts {
+    std::array<pkts_bytes, 256> p2p_inner, srv_inner, srv_outer;
+
+    // packets captured too short for their Zoom/RTP/RTCP headers or their RTP header extension,
+    // see zoom::headers::truncated
+    unsigned long truncated_pkts = 0, rtp_ext_truncated_pkts = 0;
+
+    void add(const type_counts& other) {
+        truncated_pkts += other.truncated_pkts;
+        rtp_ext_truncated_pkts += other.rtp_ext_truncated_pkts;
+
+        for (unsigned type = 0; type < 256; type++) {
+            p2p_inner[type].increment(other.p2p_inner[type].pkts, other.p2p_inner[type].bytes);
+            srv_inner[type].increment(other.srv_inner[type].pkts, other.srv_inner[type].bytes);
+            srv_outer[type].increment(other.srv_outer[type].pkts, other.srv_outer[type].bytes);
+        }
+    }
+};
+
+//! packets and bytes per tunnel, see link_layer::decapsulate
+struct tunnel_counts {
+    std::map<link_layer::tunnel_endpoints, pkts_bytes> endpoints;
+
+    void add(const tunnel_counts& other) {
+        for (const auto& [tunnel, counts] : other.endpoints) {
+            endpoints[tunnel].increment(counts.pkts, counts.bytes);
+        }
+    }
+};
+
+//! state of the packet rate time series, continued across input files when following
+struct rate_state {
+    mac_counter pkt_counter;
+    std::int64_t last_ts = 0; // seconds
+    std::uint64_t last_total_pkt_count = 0, last_zoom_pkt_count = 0, last_zoom_byte_count = 0;
+};
+
+//! totals over all readers of the input
+struct input_stats {
+    pcap_file_reader::backend backend = pcap_file_reader::backend::libpcap;
+    unsigned file_count = 0;
+    unsigned long long byte_count = 0;
+    double runtime = 0, stall_time = 0;
+    io_stats io;                              // not with -j, see process_shards()
+    std::optional<unsigned> retracked_shards; // with -j, see process_shards()
+    unsigned skipped_file_count = 0;          // with -M, see outside_window()
+
+    void add(const pcap_file_reader& pcap_in) {
+        backend = pcap_in.active_backend();
+        file_count += pcap_in.file_count();
+        byte_count += pcap_in.byte_count();
+        runtime += pcap_in.time_in_loop();
+        stall_time += pcap_in.stall_time();
+        io.add(pcap_in.io());
+    }
+};
+
+//! part of a single input file processed on its own thread, see -j
+struct shard {
+    pcap_file_reader::byte_range range;
+    zoom::flow_tracker flow_tracker { 300, true };
+    type_counts types;
+    tunnel_counts tunnels;
+    std::string zpkt_out_file_name, pcap_out_file_name;
+    pcap_link_type pcap_out_link_type = pcap_link_type::eth;
+    unsigned long long byte_count = 0;
+    std::exception_ptr error;
+};
+
+//! classifies and tracks all packets of pcap_in and writes the outputs enabled in config
+static void process_pkts(const zoom_flows::config& config, pcap_file_reader& pcap_in,
+                         zoom::flow_tracker& flow_tracker, type_counts& types,
+                         tunnel_counts& tunnels, simple_binary_writer<zoom::pkt>& zpkt_writer,
+                         pcap_file_writer& pcap_out, pcap_demux_writer* demux,
+                         zoom::flow_exporter* ipfix, std::ostream& rate_out, rate_state& rate,
+                         bool print_progress) {
+
+    std::array<pcap_pkt, PKT_BATCH_LEN> pkts;
+    std::array<link_layer::frame, PKT_BATCH_LEN> frames;
+    std::array<zoom::flow_tracker::pkt_info, PKT_BATCH_LEN> ipv4_pkts;
+    std::array<std::optional<zoom::flow_tracker::flow_stats>, PKT_BATCH_LEN> zoom_flows;
+    std::array<std::size_t, PKT_BATCH_LEN> ipv4_pkt_idx = {};
+
+    const auto start_ts = config.start_ts_s ? timestamp::from_sec(*config.start_ts_s)
+        : std::numeric_limits<timestamp_ns>::min();
+    const auto end_ts = config.end_ts_s ? timestamp::from_sec(*config.end_ts_s)
+        : std::numeric_limits<timestamp_ns>::max();
+
+    auto last_progress = std::chrono::high_resolution_clock::now();
+
+    while (auto batch_len = pcap_in.next_batch(pkts.data(), pkts.size())) {
+
+        link_layer::decode(pkts.data(), batch_len, frames.data());
+
+        std::size_t ipv4_count = 0, tracked_count = 0;
+
+        // tracks all IPv4 packets collected since the last call
+        auto track_pending = [&]() {
+            flow_tracker.track_batch(ipv4_pkts.data() + tracked_count,
+                                     zoom_flows.data() + tracked_count, ipv4_count - tracked_count);
+            tracked_count = ipv4_count;
+        };
+
+        for (std::size_t i = 0; i < batch_len; i++) {
+
+            const auto& pkt = pkts[i];
+            const auto& frame = frames[i];
+
+            if (pkt.ts < start_ts || pkt.ts >= end_ts) continue;
+
+            if (frame.tunnel.type != link_layer::tunnel_type::none) {
+                tunnels.endpoints[frame.tunnel].increment(1, pkt.frame_len);
+            }
+
+            if (config.rate_out_file_name) {
+
+                if (frame.src_addr) {
+                    rate.pkt_counter.add(*frame.src_addr);
+                }
+
+                if (rate.last_ts == 0) {
+                    rate.last_ts = timestamp::sec(pkt.ts);
+                    rate.last_total_pkt_count = rate.pkt_counter.count();
+
+                    rate_out << "#ts_s,total_pkts,zoom_pkts,zoom_bytes\n";
+                }
+
+                if (timestamp::sec(pkt.ts) > rate.last_ts) {
+
+                    // counters must reflect all packets before this one
+                    track_pending();
+
+                    std::uint64_t current_total_pkt_count = rate.pkt_counter.count();
+                    std::uint64_t current_zoom_pkt_count =
+                        flow_tracker.count_zoom_pkts_detected();
+                    std::uint64_t current_zoom_byte_count =
+                        flow_tracker.count_zoom_bytes_detected();
+
+                    rate_out << rate.last_ts << ","
+                             << (current_total_pkt_count - rate.last_total_pkt_count)
+                             << "," << (current_zoom_pkt_count - rate.last_zoom_pkt_count)
+                             << "," << (current_zoom_byte_count - rate.last_zoom_byte_count)
+                             << '\n';
+
+                    rate.last_ts = timestamp::sec(pkt.ts);
+                    rate.last_total_pkt_count = current_total_pkt_count;
+                    rate.last_zoom_pkt_count = current_zoom_pkt_count;
+                    rate.last_zoom_byte_count = current_zoom_byte_count;
+                }
+            }
+
+            // must be IPv4
+            if (!frame.ipv4) continue;
+
+            ipv4_pkts[ipv4_count] = {
+                .ip_5t = net::ipv4_5tuple::from_ipv4_pkt_data(pkt.buf + frame.ip_offset,
+                                                              pkt.cap_len - frame.ip_offset),
+                .ts    = pkt.ts,
+                .bytes = pkt.frame_len
+            };
+
+            ipv4_pkt_idx[ipv4_count++] = i;
+        }
+
+        track_pending();
+
+        for (std::size_t i = 0; i < ipv4_count; i++) {
+
+            const auto& zoom_flow = zoom_flows[i];
+            const auto& pkt = pkts[ipv4_pkt_idx[i]];
+            const auto& frame = frames[ipv4_pkt_idx[i]];
+
+            if (!zoom_flow) continue;
+
+            // p2p-only option:
+            if (config.p2p_only && !zoom_flow->is_p2p() && !zoom_flow->is_stun()) continue;
+
+            auto hdr = zoom::parse_zoom_pkt_buf(pkt.buf, frame.ip_offset, zoom_flow->is_p2p(),
+                                                pkt.cap_len);
+
+            types.truncated_pkts += hdr.truncated;
+            types.rtp_ext_truncated_pkts += hdr.rtp_ext_truncated;
+
+            // lengths are those of the UDP header, not of the bytes captured
+            if (zoom_flow->type == zoom::flow_tracker::flow_type::udp_p2p && hdr.zoom_inner) {
+                types.p2p_inner[hdr.zoom_inner[0]].increment(1, ntohs(hdr.udp->dgram_len));
+            } else if (zoom_flow->type == zoom::flow_tracker::flow_type::udp_srv
+                       && hdr.zoom_outer) {
+
+                types.srv_outer[hdr.zoom_outer[0]].increment(1, ntohs(hdr.udp->dgram_len));
+
+                if (hdr.zoom_outer[0] == zoom::SRV_MEDIA_TYPE && hdr.zoom_inner) {
+                    types.srv_inner[hdr.zoom_inner[0]].increment(1, ntohs(hdr.udp->dgram_len));
+                }
+            }
+
+            if (ipfix) {
+                ipfix->add(ipv4_pkts[i].ip_5t, *zoom_flow, pkt.ts, ipv4_pkts[i].bytes, hdr);
+            }
+
+            if (config.zpkt_out_file_name && zoom_flow->is_udp() && hdr.zoom_inner) {
+                zoom::pkt zpkt(hdr, pkt.ts, zoom_flow->is_p2p());
+                zpkt_writer.write(zpkt);
+            }
+
+            // packets without RTP/RTCP header are written in full
+            auto out_pkt = pkt;
+
+            if (config.headers_only && hdr.hdr_end) {
+                out_pkt.cap_len = (unsigned short) hdr.hdr_end;
+            }
+
+            // packets of other link types than the output's are left out (pcapng and -F only)
+            if (config.pcap_out_file_name && pkt.link_type == pcap_out.link_type()) {
+                pcap_out.write(out_pkt);
+            }
+
+            if (demux && pkt.link_type == demux->link_type()) {
+
+                const auto& ip_5t = ipv4_pkts[i].ip_5t;
+
+                if (config.demux_by == zoom_flows::demux_key::flow) {
+                    demux->write(zoom_flow->id, out_pkt);
+                } else {
+                    // P2P packets belong to both clients
+                    if (!zoom::nets::match(ip_5t.ip_src)) {
+                        demux->write(ip_5t.ip_src, out_pkt);
+                    }
+
+                    if (!zoom::nets::match(ip_5t.ip_dst) && ip_5t.ip_dst != ip_5t.ip_src) {
+                        demux->write(ip_5t.ip_dst, out_pkt);
+                    }
+                }
+            }
+        }
+
+        if (print_progress && config.progress_s) {
+
+            auto now = std::chrono::high_resolution_clock::now();
+
+            if (std::chrono::duration<double>(now - last_progress).count() >= *config.progress_s) {
+                std::cout << "- " << pcap_in.io().to_str() << std::endl;
+                last_progress = now;
+            }
+
+        } else if (print_progress
+            && (pcap_in.pkt_count() / 10000000) != ((pcap_in.pkt_count() - batch_len) / 10000000)) {
+            std::cout << "- " << (pcap_in.pkt_count() / 10000000) * 10000000 << std::endl;
+        }
+    }
+}
+
+//! returns the link type of the pcap output for the packets of pcap_in, see -p
+//! - Ethernet for inputs of multiple link types
+static pcap_link_type pcap_out_link_type(const pcap_file_reader& pcap_in) {
+
+    auto link_type = pcap_in.datalink_type();
+    return link_layer::is_supported(link_type) ? link_type : pcap_link_type::eth;
+}
+
+//! opens the demux output for the packets of pcap_in, see -d
+static void open_demux(const zoom_flows::config& config, std::optional<pcap_demux_writer>& demux,
+                       const pcap_file_reader& pcap_in) {
+
+    std::filesystem::create_directories(*config.demux_out_dir);
+
+    auto file_name = [dir = std::filesystem::path(*config.demux_out_dir),
+                      demux_by = config.demux_by](std::uint64_t key) {
+        return (dir / (demux_by == zoom_flows::demux_key::flow
+            ? "flow_" + std::to_string(key) + ".pcap"
+            : net::ipv4::addr_to_str((std::uint32_t) key) + ".pcap")).string();
+    };
+
+    demux.emplace(file_name, pcap_out_link_type(pcap_in));
+}
+
+//! returns the directory whose manifest covers the input, see -M
+static std::string manifest_directory(const std::string& input_path) {
+
+    if (std::filesystem::is_directory(input_path)) {
+        return input_path;
+    }
+
+    auto parent = std::filesystem::path(input_path).parent_path();
+    return parent.empty() ? "." : parent.string();
+}
+
+//! whether the manifest knows that a file has no packets within the time window of config
+static bool outside_window(const zoom_flows::config& config, const pcap_manifest& manifest,
+                           const std::string& in_file) {
+
+    if (!config.start_ts_s && !config.end_ts_s) {
+        return false;
+    }
+
+    const auto* entry = manifest.find(in_file);
+
+    return entry && !entry->overlaps(
+        config.start_ts_s.value_or(std::numeric_limits<std::int64_t>::min()),
+        config.end_ts_s.value_or(std::numeric_limits<std::int64_t>::max()));
+}
+
+//! adds the files read completely by pcap_in to the manifest and saves it
+static void update_manifest(pcap_manifest& manifest, const pcap_file_reader& pcap_in) {
+
+    for (const auto& summary : pcap_in.file_summaries()) {
+        if (summary.complete) {
+            manifest.update(summary.file_name, summary.entry);
+        }
+    }
+
+    try {
+        manifest.save();
+    } catch (const std::runtime_error& e) {
+        std::cerr << "warning: " << e.what() << std::endl;
+    }
+}
+
+//! processes the packets of a shard with flow_tracker, writing them to the shard's output files
+static void process_shard(const zoom_flows::config& config, const std::string& in_file,
+                          shard& shard, zoom::flow_tracker& flow_tracker) {
+
+    simple_binary_writer<zoom::pkt> zpkt_writer;
+    pcap_file_writer pcap_out;
+    std::ofstream rate_out; // not supported with shards
+    rate_state rate;
+
+    if (config.zpkt_out_file_name) {
+        zpkt_writer.open(shard.zpkt_out_file_name);
+    }
+
+    if (config.pcap_out_file_name) {
+        pcap_out.open(shard.pcap_out_file_name, shard.pcap_out_link_type, config.direct_io);
+    }
+
+    pcap_file_reader pcap_in(in_file, shard.range);
+    shard.types = {};
+    shard.tunnels = {};
+
+    process_pkts(config, pcap_in, flow_tracker, shard.types, shard.tunnels, zpkt_writer, pcap_out,
+                 nullptr, nullptr, rate_out, rate, false);
+
+    pcap_in.close();
+    shard.byte_count = pcap_in.byte_count();
+
+    if (config.zpkt_out_file_name) {
+        zpkt_writer.close();
+    }
+
+    if (config.pcap_out_file_name) {
+        pcap_out.close();
+    }
+}
+
+//! processes a single input file in parallel parts, whose flows are merged in order
+//! - a part is tracked once more, after all parts before it, if its flows cannot be merged (see
+//!   zoom::flow_tracker::can_merge), so that results are the same as when reading the file at once
+//! - returns the number of parts tracked once more
+static unsigned process_shards(const zoom_flows::config& config, const std::string& in_file,
+                               zoom::flow_tracker& flow_tracker, type_counts& types,
+                               tunnel_counts& tunnels, simple_binary_writer<zoom::pkt>& zpkt_writer,
+                               pcap_file_writer& pcap_out, input_stats& input) {
+
+    auto ranges = pcap_file_reader::split(in_file, config.jobs);
+    std::vector<shard> shards(ranges.size());
+    std::vector<std::thread> threads;
+
+    for (std::size_t i = 0; i < shards.size(); i++) {
+
+        shards[i].range = ranges[i];
+
+        if (config.zpkt_out_file_name) {
+            shards[i].zpkt_out_file_name = *config.zpkt_out_file_name + ".part" + std::to_string(i);
+        }
+
+        if (config.pcap_out_file_name) {
+            shards[i].pcap_out_file_name = *config.pcap_out_file_name + ".part" + std::to_string(i);
+            shards[i].pcap_out_link_type = pcap_out.link_type();
+        }
+
+        threads.emplace_back([&config, &in_file, &shard = shards[i]]() {
+            try {
+                process_shard(config, in_file, shard, shard.flow_tracker);
+            } catch (...) {
+                shard.error = std::current_exception();
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    unsigned retracked = 0;
+
+    for (auto& shard : shards) {
+
+        if (shard.error) {
+            std::rethrow_exception(shard.error);
+        }
+
+        if (flow_tracker.can_merge(shard.flow_tracker)) {
+            flow_tracker.merge(shard.flow_tracker);
+        } else {
+            process_shard(config, in_file, shard, flow_tracker);
+            retracked++;
+        }
+
+        // a part ending early was cut at a false record boundary (the last one may be truncated)
+        if (&shard != &shards.back() && shard.byte_count != shard.range.end - shard.range.begin) {
+            throw std::runtime_error("zoom_flows: part of " + in_file + " ending at byte "
+                + std::to_string(shard.range.end) + " does not end at a record boundary");
+        }
+
+        types.add(shard.types);
+        tunnels.add(shard.tunnels);
+        input.byte_count += shard.byte_count;
+
+        if (config.zpkt_out_file_name) {
+
+            simple_binary_reader<zoom::pkt> zpkt_reader(shard.zpkt_out_file_name);
+            zoom::pkt zpkt;
+
+            while (zpkt_reader.next(zpkt)) {
+                zpkt_writer.write(zpkt);
+            }
+
+            zpkt_reader.close();
+            std::filesystem::remove(shard.zpkt_out_file_name);
+        }
+
+        if (config.pcap_out_file_name) {
+
+            pcap_file_reader pcap_reader(shard.pcap_out_file_name, pcap_file_reader::backend::mmap);
+            pcap_pkt pkt;
+
+            while (pcap_reader.next(pkt)) {
+                pcap_out.write(pkt);
+            }
+
+            pcap_reader.close();
+            std::filesystem::remove(shard.pcap_out_file_name);
+        }
+    }
+
+    return retracked;
+}
+
+//! processes the files of the input directory one at a time as a rotating capture completes them,
+//! keeping flows and outputs open across files, until SIGINT or SIGTERM
+static void follow(const zoom_flows::config& config, zoom::flow_tracker& flow_tracker,
+                   type_counts& types, tunnel_counts& tunnels, rate_state& rate,
+                   simple_binary_writer<zoom::pkt>& zpkt_writer, pcap_file_writer& pcap_out,
+                   std::optional<pcap_demux_writer>& demux, zoom::flow_exporter* ipfix,
+                   std::ostream& rate_out, async_writer& out_writer, pcap_manifest* manifest,
+                   input_stats& input) {
+
+    std::signal(SIGINT, [](int) { stop_following = 1; });
+    std::signal(SIGTERM, [](int) { stop_following = 1; });
+
+    directory_watcher watcher(config.input_path, "pcap");
+
+    std::cout << "- following " << config.input_path << " (stop with Ctrl-C)" << std::endl;
+
+    while (!stop_following) {
+
+        auto in_file = watcher.next(FOLLOW_POLL_MS);
+
+        if (!in_file) continue;
+
+        if (manifest && outside_window(config, *manifest, *in_file)) {
+            input.skipped_file_count++;
+            continue;
+        }
+
+        try {
+
+            pcap_file_reader pcap_in({ *in_file }, config.reader_backend, false, manifest);
+
+            if (!link_layer::is_supported(pcap_in.datalink_type())
+                && pcap_in.datalink_type() != pcap_link_type::multiple_error) {
+                std::cerr << "warning: skipping file of unsupported link type "
+                          << (int) pcap_in.datalink_type() << " " << *in_file << std::endl;
+                continue;
+            }
+
+            // the pcap output takes the link type of the first file
+            if (config.pcap_out_file_name && !pcap_out.is_open()) {
+                pcap_out.open(*config.pcap_out_file_name, pcap_out_link_type(pcap_in),
+                              config.direct_io, config.rotation);
+            } else if (config.pcap_out_file_name
+                       && pcap_in.datalink_type() != pcap_out.link_type()) {
+                std::cerr << "warning: pcap output leaves out packets of other link types than "
+                          << (int) pcap_out.link_type() << " in " << *in_file << std::endl;
+            }
+
+            if (config.demux_out_dir && !demux) {
+                open_demux(config, demux, pcap_in);
+            }
+
+            process_pkts(config, pcap_in, flow_tracker, types, tunnels, zpkt_writer, pcap_out,
+                         demux ? &*demux : nullptr, ipfix, rate_out, rate, true);
+            pcap_in.close();
+            input.add(pcap_in);
+
+            if (manifest) {
+                update_manifest(*manifest, pcap_in);
+            }
+
+            std::cout << "- read " << *in_file << ": " << pcap_in.io().to_str() << std::endl;
+
+        } catch (const std::runtime_error& e) {
+            std::cerr << "warning: skipping rest of " << *in_file << ": " << e.what() << std::endl;
+        }
+
+        // outputs cover every file read so far
+        if (config.zpkt_out_file_name) {
+            zpkt_writer.flush();
+        }
+
+        if (pcap_out.is_open()) {
+            pcap_out.flush();
+        }
+
+        if (demux) {
+            demux->flush();
+        }
+
+        if (ipfix) {
+            ipfix->flush();
+        }
+
+        rate_out.flush();
+        out_writer.drain();
+    }
+
+    if (watcher.pending()) {
+        std::cout << "- skipped incomplete file " << *watcher.pending() << std::endl;
+    }
+}
 
 int main(int argc, char** argv) {
 
     auto config = zoom_flows::parse_options(zoom_flows::set_options(), argc, argv);
     pcap_file_writer pcap_out;
-    std::ofstream flows_out, types_out, rate_out;
+    std::optional<pcap_demux_writer> demux;
+    std::ofstream flows_out, types_out, tunnels_out;
+
+    // the rate and zpkt outputs, written throughout the run, are written on a thread of their own
+    async_writer out_writer;
+    async_writer::stream rate_out;
     simple_binary_writer<zoom::pkt> zpkt_writer;
 
     auto in_files = util::files_in_directory(config.input_path, "pcap");
     std::sort(in_files.begin(), in_files.end(), util::compare_file_ext_seq);
 
-    if (config.pcap_out_file_name) {
-        pcap_out.open(*config.pcap_out_file_name, pcap_link_type::eth);
+    // options are checked before any output file is opened
+    if (config.follow && (!std::filesystem::is_directory(config.input_path) || config.jobs > 1
+                          || config.merge_inputs)) {
+        std::cerr << "error: -F requires an input directory and does not support -j and -m, "
+                  << "exiting." << std::endl;
+        exit(1);
+    }
+
+    if (config.jobs > 1
+        && (in_files.size() != 1
+            || file_decoder::compression_from_name(in_files[0]) != file_decoder::compression::none
+            || config.merge_inputs || config.rate_out_file_name || config.demux_out_dir
+            || config.ipfix_collector)) {
+        std::cerr << "error: -j requires a single uncompressed input file and does not support "
+                  << "-m, -r, -d, and -x, exiting." << std::endl;
+        exit(1);
     }
 
     if (config.flows_out_file_name) {
@@ -40,10 +633,21 @@ int main(int argc, char** argv) {
         }
     }
 
+    if (config.tunnels_out_file_name) {
+        tunnels_out.open(*config.tunnels_out_file_name);
+
+        if (!tunnels_out.is_open()) {
+            std::cerr << "error: could not open tunnels output file "
+                      << *config.tunnels_out_file_name << ", exiting." << std::endl;
+            exit(1);
+        }
+    }
+
     if (config.rate_out_file_name) {
-        rate_out.open(*config.rate_out_file_name);
 
-        if (!rate_out.is_open()) {
+        try {
+            rate_out.open(out_writer, *config.rate_out_file_name);
+        } catch (const std::system_error&) {
             std::cerr << "error: could not open rate output file " << *config.rate_out_file_name
                       << ", exiting." << std::endl;
             exit(1);
@@ -51,109 +655,119 @@ int main(int argc, char** argv) {
     }
 
     if (config.zpkt_out_file_name) {
-        zpkt_writer.open(*config.zpkt_out_file_name);
+        zpkt_writer.open(*config.zpkt_out_file_name, config.rotation, &out_writer);
     }
 
-    pcap_pkt pkt;
-    zoom::flow_tracker flow_tracker;
-    mac_counter mac_counter;
+    std::optional<zoom::flow_exporter> ipfix;
 
-    struct pkts_bytes {
-        unsigned long pkts = 0, bytes = 0;
+    if (config.ipfix_collector) {
 
-        void increment(unsigned long pkts_inc, unsigned long bytes_inc) {
-            pkts += pkts_inc;
-            bytes += bytes_inc;
+        try {
+            ipfix.emplace(*config.ipfix_collector, config.ipfix);
+        } catch (const std::runtime_error& e) {
+            std::cerr << "error: " << e.what() << ", exiting." << std::endl;
+            exit(1);
         }
-    };
-
-    std::array<pkts_bytes, 256> p2p_inner_types, srv_inner_types, srv_outer_types;
-
-    pcap_file_reader pcap_in(in_files);
-
-    if (pcap_in.datalink_type() != pcap_link_type::eth) {
-        std::cerr << "error: only ethernet supported right now, exiting." << std::endl;
-        exit(1);
     }
 
-    unsigned last_ts = 0;
-    std::uint64_t last_total_pkt_count = 0, last_zoom_pkt_count = 0, last_zoom_byte_count = 0;
+    zoom::flow_tracker flow_tracker;
+    type_counts types;
+    tunnel_counts tunnels;
+    rate_state rate;
+    input_stats input;
+    std::optional<pcap_manifest> manifest;
+
+    if (config.manifest) {
+        manifest.emplace(manifest_directory(config.input_path));
+    }
 
+    if (config.follow) {
 
-    while (pcap_in.next(pkt)) {
+        follow(config, flow_tracker, types, tunnels, rate, zpkt_writer, pcap_out, demux,
+               ipfix ? &*ipfix : nullptr, rate_out, out_writer, manifest ? &*manifest : nullptr,
+               input);
 
-        if (config.rate_out_file_name) {
-            mac_counter.add(((net::eth::hdr*) pkt.buf)->src_addr);
+    } else {
 
-            if (last_ts == 0) {
-                last_ts = pkt.ts.tv_sec;
-                last_total_pkt_count = mac_counter.count();
+        if (manifest) {
 
-                rate_out << "#ts_s,total_pkts,zoom_pkts,zoom_bytes" << std::endl;
-            }
+            auto skipped = std::remove_if(in_files.begin(), in_files.end(),
+                [&](const auto& in_file) { return outside_window(config, *manifest, in_file); });
 
-            if (pkt.ts.tv_sec > last_ts) {
+            input.skipped_file_count = in_files.end() - skipped;
+            in_files.erase(skipped, in_files.end());
+        }
 
-                std::uint64_t current_total_pkt_count = mac_counter.count();
-                std::uint64_t current_zoom_pkt_count = flow_tracker.count_zoom_pkts_detected();
-                std::uint64_t current_zoom_byte_count = flow_tracker.count_zoom_bytes_detected();
+        if (in_files.empty()) {
+            std::cerr << "error: no input files to read, exiting." << std::endl;
+            exit(1);
+        }
 
-                rate_out << last_ts << ","
-                         << (current_total_pkt_count - last_total_pkt_count)
-                         << "," << (current_zoom_pkt_count - last_zoom_pkt_count)
-                         << "," << (current_zoom_byte_count - last_zoom_byte_count)
-                         << std::endl;
+        pcap_file_reader pcap_in(in_files, config.reader_backend, config.merge_inputs,
+                                 manifest ? &*manifest : nullptr);
 
-                last_ts = pkt.ts.tv_sec;
-                last_total_pkt_count = current_total_pkt_count;
-                last_zoom_pkt_count = current_zoom_pkt_count;
-                last_zoom_byte_count = current_zoom_byte_count;
-            }
+        // packets captured on interfaces of unsupported link types of pcapng files are skipped
+        if (!link_layer::is_supported(pcap_in.datalink_type())
+            && pcap_in.datalink_type() != pcap_link_type::multiple_error) {
+            std::cerr << "error: unsupported link type " << (int) pcap_in.datalink_type()
+                      << ", exiting." << std::endl;
+            exit(1);
         }
 
-        // must be IPv4
-        if (net::eth::type_from_buf(pkt.buf) != net::eth::type::ipv4) continue;
-
-        auto ip_5t = net::ipv4_5tuple::from_ipv4_pkt_data(pkt.buf + net::eth::HDR_LEN);
-        auto zoom_flow = flow_tracker.track(ip_5t, pkt.ts, pkt.frame_len);
+        if (config.pcap_out_file_name) {
+            pcap_out.open(*config.pcap_out_file_name, pcap_out_link_type(pcap_in),
+                          config.direct_io, config.rotation);
+        }
 
-        if (zoom_flow) {
+        if (config.demux_out_dir) {
+            open_demux(config, demux, pcap_in);
+        }
 
-            // p2p-only option:
-            if (config.p2p_only && !zoom_flow->is_p2p() && !zoom_flow->is_stun()) continue;
+        if (config.jobs > 1) {
 
-            auto hdr = zoom::parse_zoom_pkt_buf(pkt.buf, true, zoom_flow->is_p2p());
+            pcap_in.close();
 
-            if (zoom_flow->type == zoom::flow_tracker::flow_type::udp_p2p) {
-                p2p_inner_types[hdr.zoom_inner[0]].increment(1, ntohs(hdr.udp->dgram_len));
-            } else if (zoom_flow->type == zoom::flow_tracker::flow_type::udp_srv) {
+            auto start = std::chrono::high_resolution_clock::now();
+            input.retracked_shards = process_shards(config, in_files[0], flow_tracker, types,
+                                                    tunnels, zpkt_writer, pcap_out, input);
+            input.runtime = std::chrono::duration<double>(
+                std::chrono::high_resolution_clock::now() - start).count();
+            input.backend = pcap_file_reader::backend::mmap;
+            input.file_count = 1;
 
-                srv_outer_types[hdr.zoom_outer[0]].increment(1, ntohs(hdr.udp->dgram_len));
+        } else {
 
-                if (hdr.zoom_outer[0] == zoom::SRV_MEDIA_TYPE) {
-                    srv_inner_types[hdr.zoom_inner[0]].increment(1, ntohs(hdr.udp->dgram_len));
-                }
-            }
+            process_pkts(config, pcap_in, flow_tracker, types, tunnels, zpkt_writer, pcap_out,
+                         demux ? &*demux : nullptr, ipfix ? &*ipfix : nullptr, rate_out, rate,
+                         true);
+            pcap_in.close();
+            input.add(pcap_in);
 
-            if (config.zpkt_out_file_name && zoom_flow->is_udp()) {
-                zoom::pkt zpkt(hdr, pkt.ts, zoom_flow->is_p2p());
-                zpkt_writer.write(zpkt);
+            if (manifest) {
+                update_manifest(*manifest, pcap_in);
             }
 
-            if (config.pcap_out_file_name) {
-                pcap_out.write(pkt);
+            // per-file times are not measured when merging
+            if (in_files.size() > 1 && !config.merge_inputs) {
+                for (const auto& summary : pcap_in.file_summaries()) {
+                    std::cout << "- read " << summary.file_name << ": " << summary.io.to_str()
+                              << std::endl;
+                }
             }
         }
+    }
 
-        if ((pcap_in.pkt_count() % 10000000) == 0) {
-            std::cout << "- " << pcap_in.pkt_count() << std::endl;
-        }
+    if (pcap_out.is_open()) {
+        pcap_out.close();
     }
 
-    pcap_in.close();
+    if (demux) {
+        demux->close();
+    }
 
-    if (config.pcap_out_file_name) {
-        pcap_out.close();
+    // flows still seen at the end of the input are exported as forced to end
+    if (ipfix) {
+        ipfix->close();
     }
 
     if (config.flows_out_file_name) {
@@ -163,8 +777,9 @@ int main(int argc, char** argv) {
         for (const auto& [ip_5t, stats]: flow_tracker.flows()) {
             flows_out << stats.id << "," << ip_5t << ","
                       << zoom::flow_tracker::flow_type_string(stats.type) << "," << stats.pkts << ","
-                      << stats.bytes << "," << stats.start_ts.tv_sec << "," << stats.start_ts.tv_usec
-                      << "," << stats.last_ts.tv_sec << "," << stats.last_ts.tv_usec << std::endl;
+                      << stats.bytes << "," << timestamp::sec(stats.start_ts) << ","
+                      << timestamp::subsec_us(stats.start_ts) << "," << timestamp::sec(stats.last_ts)
+                      << "," << timestamp::subsec_us(stats.last_ts) << std::endl;
         }
 
         flows_out.close();
@@ -175,39 +790,93 @@ int main(int argc, char** argv) {
         types_out << "# mode,outer_type,inner_type,pkts,bytes" << std::endl;
 
         for (unsigned type = 0; type < 256; type++) {
-            if (p2p_inner_types[type].pkts > 0) {
-                types_out << "p2p,NA," << (unsigned) type << "," << p2p_inner_types[type].pkts
-                          << "," << p2p_inner_types[type].bytes << std::endl;
+            if (types.p2p_inner[type].pkts > 0) {
+                types_out << "p2p,NA," << (unsigned) type << "," << types.p2p_inner[type].pkts
+                          << "," << types.p2p_inner[type].bytes << std::endl;
             }
         }
 
         for (unsigned type = 0; type < 256; type++) {
-            if (srv_inner_types[type].pkts > 0) {
-                types_out << "srv,5," << (unsigned) type << "," << srv_inner_types[type].pkts
-                          << "," << srv_inner_types[type].bytes << std::endl;
+            if (types.srv_inner[type].pkts > 0) {
+                types_out << "srv,5," << (unsigned) type << "," << types.srv_inner[type].pkts
+                          << "," << types.srv_inner[type].bytes << std::endl;
             }
         }
 
         for (unsigned type = 0; type < 256; type++) {
-            if (type != 5 && srv_outer_types[type].pkts > 0) {
-                types_out << "srv," << (unsigned) type << ",NA," << srv_outer_types[type].pkts
-                          << "," << srv_outer_types[type].bytes << std::endl;
+            if (type != 5 && types.srv_outer[type].pkts > 0) {
+                types_out << "srv," << (unsigned) type << ",NA," << types.srv_outer[type].pkts
+                          << "," << types.srv_outer[type].bytes << std::endl;
             }
         }
 
         types_out.close();
     }
 
+    if (config.tunnels_out_file_name) {
+
+        tunnels_out << "# tunnel_type,ip_src,ip_dst,pkts,bytes" << std::endl;
+
+        for (const auto& [tunnel, counts] : tunnels.endpoints) {
+            tunnels_out << link_layer::tunnel_type_string(tunnel.type) << ","
+                        << net::ipv4::addr_to_str(tunnel.ip_src) << ","
+                        << net::ipv4::addr_to_str(tunnel.ip_dst) << "," << counts.pkts << ","
+                        << counts.bytes << std::endl;
+        }
+
+        tunnels_out.close();
+    }
+
     if (config.zpkt_out_file_name) {
         zpkt_writer.close();
     }
 
-    std::cout << "- input files: " << pcap_in.file_count() << std::endl;
+    rate_out.close();
+    out_writer.drain();
+
+    std::cout << "- input files: " << input.file_count << std::endl;
+
+    if (manifest) {
+        std::cout << "- input files skipped (manifest): " << input.skipped_file_count << std::endl;
+    }
+
     std::cout << "- total pkts: " << flow_tracker.count_total_pkts_processed() << std::endl;
     std::cout << "- zoom pkts: " << flow_tracker.count_zoom_pkts_detected() << std::endl;
     std::cout << "- zoom flows: " << flow_tracker.count_zoom_flows_detected() << std::endl;
-    std::cout << "- runtime [s]: " << std::fixed << std::setw(3) << pcap_in.time_in_loop()
-              << std::endl;
+
+    if (types.truncated_pkts || types.rtp_ext_truncated_pkts) {
+        std::cout << "- zoom pkts truncated (headers): " << types.truncated_pkts << std::endl;
+        std::cout << "- zoom pkts truncated (rtp extension): " << types.rtp_ext_truncated_pkts
+                  << std::endl;
+    }
+    std::cout << "- runtime [s]: " << std::fixed << std::setw(3) << input.runtime << std::endl;
+    std::cout << "- throughput [GB/s]: " << std::fixed << std::setprecision(3)
+              << (input.runtime > 0 ? ((double) input.byte_count / 1e9) / input.runtime : 0.0)
+              << " (" << pcap_file_reader::backend_string(input.backend);
+
+    if (input.retracked_shards) {
+        std::cout << ", " << config.jobs << " jobs)" << std::endl;
+        std::cout << "- parts tracked again: " << *input.retracked_shards << std::endl;
+    } else {
+        std::cout << ")" << std::endl;
+    }
+
+    // the parts of -j are read concurrently, their read and consumer times do not add up
+    if (!input.retracked_shards) {
+
+        std::cout << "- input read [s]: " << std::fixed << std::setprecision(3)
+                  << input.io.read_time << " (" << input.io.read_mbytes_per_sec() << " MB/s)"
+                  << std::endl;
+
+        if (input.backend == pcap_file_reader::backend::read_ahead
+            || input.backend == pcap_file_reader::backend::io_uring) {
+            std::cout << "- input stall [s]: " << std::fixed << std::setprecision(3)
+                      << input.stall_time << std::endl;
+        }
+
+        std::cout << "- consumer [s]: " << std::fixed << std::setprecision(3)
+                  << input.io.consumer_time() << std::endl;
+    }
 
     if (config.flows_out_file_name) {
         std::cout << "- wrote flow summary to " << *config.flows_out_file_name << std::endl;
@@ -221,14 +890,61 @@ int main(int argc, char** argv) {
         std::cout << "- wrote rate summary to " << *config.rate_out_file_name << std::endl;
     }
 
+    if (config.tunnels_out_file_name) {
+        std::cout << "- wrote tunnel summary to " << *config.tunnels_out_file_name << std::endl;
+    }
+
     if (config.pcap_out_file_name) {
         std::cout << "- wrote " << pcap_out.count() << " filtered packets to "
-                  << *config.pcap_out_file_name << std::endl;
+                  << *config.pcap_out_file_name;
+
+        if (config.rotation.enabled() && pcap_out.file_count() > 0) {
+            std::cout << "0.." << pcap_out.file_count() - 1;
+        }
+
+        std::cout << std::endl;
+        std::cout << "- pcap output [MB/s]: " << std::fixed << std::setprecision(3)
+                  << pcap_out.mbytes_per_sec() << " (" << (double) pcap_out.byte_count() / 1e6
+                  << " MB in " << pcap_out.write_time() << " s of writes"
+                  << (pcap_out.direct() ? ", O_DIRECT)" : ")") << std::endl;
     }
 
     if (config.zpkt_out_file_name) {
         std::cout << "- wrote " << zpkt_writer.count() << " filtered packets to "
-                  << *config.zpkt_out_file_name << std::endl;
+                  << *config.zpkt_out_file_name;
+
+        if (config.rotation.enabled()) {
+            std::cout << "0.." << zpkt_writer.file_count() - 1;
+        }
+
+        std::cout << std::endl;
+    }
+
+    if (ipfix) {
+        const auto& exporter = ipfix->exporter();
+        std::cout << "- exported " << exporter.record_count() << " IPFIX records in "
+                  << exporter.msg_count() << " messages to " << config.ipfix_collector->to_str();
+
+        if (exporter.error_count()) {
+            std::cout << " (" << exporter.error_count() << " messages dropped)";
+        }
+
+        std::cout << std::endl;
+    }
+
+    // stalls mean that processing waited for the writer thread, i.e., that the outputs gated it
+    if (config.rate_out_file_name || config.zpkt_out_file_name) {
+        std::cout << "- rate/zpkt output [s]: " << std::fixed << std::setprecision(3)
+                  << out_writer.write_time() << " of writes ("
+                  << (double) out_writer.byte_count() / 1e6 << " MB), stall "
+                  << out_writer.stall_time() << " (" << out_writer.max_queued() << "/"
+                  << out_writer.queue_len() << " buffers queued at most)" << std::endl;
+    }
+
+    if (demux) {
+        std::cout << "- wrote " << demux->count() << " packets to " << demux->file_count()
+                  << " files in " << *config.demux_out_dir << " (" << demux->reopen_count()
+                  << " reopened)" << std::endl;
     }
 
     return 0;
@@ -121,12 +121,14 @@ namespace zoom_meetings {
 
             if (pkt.flags.rtp) {
 
-                if (start_ts_s == 0 || pkt.ts.s < start_ts_s) {
-                    start_ts_s = pkt.ts.s;
+                auto ts_s = (std::uint32_t) timestamp::sec(pkt.ts);
+
+                if (start_ts_s == 0 || ts_s < start_ts_s) {
+                    start_ts_s = ts_s;
                 }
 
-                if (end_ts_s == 0 || pkt.ts.s > end_ts_s) {
-                    end_ts_s = pkt.ts.s;
+                if (end_ts_s == 0 || ts_s > end_ts_s) {
+                    end_ts_s = ts_s;
                 }
 
                 if (start_rtp_ts == 0 || pkt.proto.rtp.ts < start_rtp_ts) {
@@ -4,6 +4,7 @@
 #include <map>
 #include <set>
 
+#include "../lib/csv_writer.h"
 #include "../lib/simple_binary_reader.h"
 #include "../lib/util.h"
 #include "../lib/zoom.h"
@@ -103,33 +104,42 @@ struct streams {
 
     void print_csv_to_stream(std::ostream& os) const {
 
-        os  << "stream_id,conn_type,start_ts_s,end_ts_s,ip_src,tp_src,ip_dst,tp_dst,zoom_type,ssrc,"
-            << "start_rtp_ts,end_rtp_ts,pkts,bytes,audio_112_pkts,audio_99_pkts,audio_113_pkts"
-            << std::endl;
+        csv_writer csv(os);
+
+        csv.append("stream_id,conn_type,start_ts_s,end_ts_s,ip_src,tp_src,ip_dst,tp_dst,zoom_type,"
+                   "ssrc,start_rtp_ts,end_rtp_ts,pkts,bytes,audio_112_pkts,audio_99_pkts,"
+                   "audio_113_pkts").end_row();
 
         for (const auto& [ssrc, stream_map] : data) {
             for (const auto& [stream_key, stream_state] : stream_map) {
 
-                os  << (stream_state.stream_id ? std::to_string(*stream_state.stream_id) : "NA") << ","
-                    << (stream_key.p2p ? "udp_p2p" : "udp_srv") << ","
-                    << stream_state.start_ts_s << ","
-                    << stream_state.end_ts_s << ","
-                    << net::ipv4::addr_to_str(stream_key.ip_src) << ","
-                    << stream_key.tp_src << ","
-                    << net::ipv4::addr_to_str(stream_key.ip_dst) << ","
-                    << stream_key.tp_dst << ","
-                    << (unsigned) stream_key.zoom_type << ","
-                    << ssrc << ","
-                    << stream_state.start_rtp_ts << ","
-                    << stream_state.last_rtp_ts << ","
-                    << stream_state.pkts << ","
-                    << stream_state.bytes << ","
-                    << stream_state.audio_112_pkts << ","
-                    << stream_state.audio_99_pkts << ","
-                    << stream_state.audio_113_pkts
-                    << std::endl;
+                if (stream_state.stream_id) {
+                    csv.field(*stream_state.stream_id);
+                } else {
+                    csv.field("NA");
+                }
+
+                csv.field(stream_key.p2p ? "udp_p2p" : "udp_srv")
+                   .field(stream_state.start_ts_s)
+                   .field(stream_state.end_ts_s)
+                   .addr_field(stream_key.ip_src)
+                   .field(stream_key.tp_src)
+                   .addr_field(stream_key.ip_dst)
+                   .field(stream_key.tp_dst)
+                   .field((unsigned) stream_key.zoom_type)
+                   .field(ssrc)
+                   .field(stream_state.start_rtp_ts)
+                   .field(stream_state.last_rtp_ts)
+                   .field(stream_state.pkts)
+                   .field(stream_state.bytes)
+                   .field(stream_state.audio_112_pkts)
+                   .field(stream_state.audio_99_pkts)
+                   .field(stream_state.audio_113_pkts)
+                   .end_row();
             }
         }
+
+        csv.flush();
     }
 
     container_type data;
@@ -225,35 +235,44 @@ public:
 
     void print_meetings_csv_to_stream(std::ostream& os) {
 
-        os  << "meeting_id,stream_id,conn_type,start_ts_s,end_ts_s,ip_src,tp_src,ip_dst,tp_dst,"
-            << "zoom_type,ssrc,start_rtp_ts,end_rtp_ts,pkts,bytes,audio_112_pkts,audio_99_pkts,"
-            << "audio_113_pkts"
-            << std::endl;
+        csv_writer csv(os);
+
+        csv.append("meeting_id,stream_id,conn_type,start_ts_s,end_ts_s,ip_src,tp_src,ip_dst,tp_dst,"
+                   "zoom_type,ssrc,start_rtp_ts,end_rtp_ts,pkts,bytes,audio_112_pkts,audio_99_pkts,"
+                   "audio_113_pkts").end_row();
 
         for (const auto& [meeting_id, streams] : _meetings) {
             for (const auto& [stream_key, stream_state] : streams) {
 
-                os  << meeting_id << ","
-                    << (stream_state.stream_id ? std::to_string(*stream_state.stream_id) : "NA") << ","
-                    << (stream_key.p2p ? "udp_p2p" : "udp_srv") << ","
-                    << stream_state.start_ts_s << ","
-                    << stream_state.end_ts_s << ","
-                    << net::ipv4::addr_to_str(stream_key.ip_src) << ","
-                    << stream_key.tp_src << ","
-                    << net::ipv4::addr_to_str(stream_key.ip_dst) << ","
-                    << stream_key.tp_dst << ","
-                    << (unsigned) stream_key.zoom_type << ","
-                    << stream_key.ssrc << ","
-                    << stream_state.start_rtp_ts << ","
-                    << stream_state.last_rtp_ts << ","
-                    << stream_state.pkts << ","
-                    << stream_state.bytes << ","
-                    << stream_state.audio_112_pkts << ","
-                    << stream_state.audio_99_pkts << ","
-                    << stream_state.audio_113_pkts
-                    << std::endl;
+                csv.field(meeting_id);
+
+                if (stream_state.stream_id) {
+                    csv.field(*stream_state.stream_id);
+                } else {
+                    csv.field("NA");
+                }
+
+                csv.field(stream_key.p2p ? "udp_p2p" : "udp_srv")
+                   .field(stream_state.start_ts_s)
+                   .field(stream_state.end_ts_s)
+                   .addr_field(stream_key.ip_src)
+                   .field(stream_key.tp_src)
+                   .addr_field(stream_key.ip_dst)
+                   .field(stream_key.tp_dst)
+                   .field((unsigned) stream_key.zoom_type)
+                   .field(stream_key.ssrc)
+                   .field(stream_state.start_rtp_ts)
+                   .field(stream_state.last_rtp_ts)
+                   .field(stream_state.pkts)
+                   .field(stream_state.bytes)
+                   .field(stream_state.audio_112_pkts)
+                   .field(stream_state.audio_99_pkts)
+                   .field(stream_state.audio_113_pkts)
+                   .end_row();
             }
         }
+
+        csv.flush();
     }
 
 private:
@@ -0,0 +1,55 @@
+#include <cxxopts/cxxopts.h>
+#include <iostream>
+#include <optional>
+
+namespace zoom_pkt_log {
+
+    struct config {
+        std::string input_path;
+        std::optional<std::string> csv_out_path = std::nullopt; // standard output if not set
+    };
+
+    void print_help(cxxopts::Options& opts, int exit_code = 0) {
+
+        std::ostream& os = (exit_code ? std::cerr : std::cout);
+        os << opts.help({""}) << std::endl;
+        exit(exit_code);
+    }
+
+    cxxopts::Options set_options() {
+
+        cxxopts::Options opts("zoom_pkt_log",
+                              "Converts a binary packet log of zoom_rtp (-p OUT.zpl) to CSV");
+
+        opts.add_options()
+            ("i,in", "input file", cxxopts::value<std::string>(), "IN.zpl")
+            ("o,out", "output path for the packet log in CSV, as zoom_rtp writes it "
+                "(optional, standard output otherwise)", cxxopts::value<std::string>(), "OUT.csv")
+            ("h,help", "print this help message");
+
+        return opts;
+    }
+
+    config parse_options(cxxopts::Options opts, int argc, char** argv) {
+
+        config config{};
+
+        auto parsed = opts.parse(argc, argv);
+
+        if (parsed.count("i")) {
+            config.input_path = parsed["i"].as<std::string>();
+        } else {
+            print_help(opts, 1);
+        }
+
+        if (parsed.count("o")) {
+            config.csv_out_path = parsed["o"].as<std::string>();
+        }
+
+        if (parsed.count("h")) {
+            print_help(opts);
+        }
+
+        return config;
+    }
+}
@@ -0,0 +1,51 @@
+#include <fstream>
+#include <iostream>
+
+#include "../lib/csv_writer.h"
+#include "../lib/zoom_pkt_log.h"
+#include "zoom_pkt_log.h"
+
+int main(int argc, char** argv) {
+
+    auto config = zoom_pkt_log::parse_options(zoom_pkt_log::set_options(), argc, argv);
+
+    zoom::pkt_log_reader reader(config.input_path);
+    std::ofstream fs;
+
+    if (config.csv_out_path) {
+
+        fs.open(*config.csv_out_path);
+
+        if (!fs.is_open()) {
+            std::cerr << "could not open file for writing: " << *config.csv_out_path << std::endl;
+            return 1;
+        }
+    }
+
+    std::ostream& os = config.csv_out_path ? fs : std::cout;
+    csv_writer csv(os, 1 << 20);
+    zoom::pkt_log_pkt pkt;
+
+    csv.append(zoom::PKT_LOG_CSV_HEADER).end_row();
+
+    while (reader.next(pkt)) {
+        zoom::write_pkt_log_csv(csv, reader.stream(pkt), pkt);
+    }
+
+    csv.flush();
+    os.flush();
+
+    if (!os) {
+        std::cerr << "could not write the packet log" << std::endl;
+        return 1;
+    }
+
+    // the standard output is the packet log otherwise
+    if (config.csv_out_path) {
+        std::cout << "- " << reader.pkt_count() << " packets of " << reader.stream_count()
+                  << " streams" << std::endl;
+        std::cout << "- wrote packets to " << *config.csv_out_path << std::endl;
+    }
+
+    return 0;
+}
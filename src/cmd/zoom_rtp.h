@@ -22,6 +22,8 @@ namespace zoom_rtp {
         std::optional<std::string> frames_out_path = std::nullopt;
         std::optional<unsigned long> limit = std::nullopt;
         std::optional<std::string> stats_out_path = std::nullopt;
+        std::optional<double> progress_s = std::nullopt; // progress interval, see -P
+        std::optional<std::string> event_ring = std::nullopt; // shared-memory ring, see -r
     };
 
     void print_help(cxxopts::Options& opts, int exit_code = 0) {
@@ -38,16 +40,24 @@ namespace zoom_rtp {
 
         opts.add_options()
             ("i,in", "input file", cxxopts::value<std::string>(), "IN.zpkt")
-            ("p,pkts-out", "output path for packet log (optional)",
+            ("p,pkts-out", "output path for packet log, in the Arrow IPC file format if "
+                "it ends in .arrow or .feather, in binary records (see zoom_pkt_log) if it "
+                "ends in .zpl (optional)",
                 cxxopts::value<std::string>(),"OUT.csv")
             ("s,streams-out", "output path for stream summary (optional)",
                 cxxopts::value<std::string>(),"OUT.csv")
-            ("f,frames-out", "output path for frame log (optional)",
+            ("f,frames-out", "output path for frame log, in the Arrow IPC file format if "
+                "it ends in .arrow or .feather (optional)",
                 cxxopts::value<std::string>(),"OUT.csv")
-            ("t,stats-out", "output path for 1s statistics (optional)",
+            ("t,stats-out", "output path for 1s statistics, in the Arrow IPC file format "
+                "if it ends in .arrow or .feather (optional)",
                 cxxopts::value<std::string>(),"OUT.csv")
+            ("r,event-ring", "publish frames and 1s statistics to the shared-memory ring "
+                "/dev/shm/NAME (optional)", cxxopts::value<std::string>(), "NAME")
             ("l,limit", "limit to L packets (in millions)  (optional)",
                 cxxopts::value<unsigned long>(), "L")
+            ("P,progress", "print input throughput and read/consumer time every S seconds "
+                "instead of every 10M packets (optional)", cxxopts::value<double>(), "S")
             ("h,help", "print this help message");
 
         return opts;
@@ -81,10 +91,18 @@ namespace zoom_rtp {
             config.stats_out_path = parsed["t"].as<std::string>();
         }
 
+        if (parsed.count("r")) {
+            config.event_ring = parsed["r"].as<std::string>();
+        }
+
         if (parsed.count(("l"))) {
             config.limit = parsed["l"].as<unsigned long>() * 1000000;
         }
 
+        if (parsed.count("P")) {
+            config.progress_s = parsed["P"].as<double>();
+        }
+
         if (parsed.count("h")) {
             print_help(opts);
         }
@@ -1,3 +1,5 @@
+#include <iomanip>
+
 #include "../lib/simple_binary_reader.h"
 #include "../lib/zoom_offline_analyzer.h"
 #include "zoom_rtp.h"
@@ -10,6 +12,7 @@ int main(int argc, char** argv) {
     simple_binary_reader<zoom::pkt> pkt_reader(config.input_path);
     zoom::offline_analyzer analyzer;
     unsigned long pkt_count = 0;
+    auto last_progress = std::chrono::high_resolution_clock::now();
 
     if (config.pkts_out_path) {
         analyzer.enable_pkt_log(*config.pkts_out_path);
@@ -27,6 +30,10 @@ int main(int argc, char** argv) {
         analyzer.enable_stats_log(*config.stats_out_path);
     }
 
+    if (config.event_ring) {
+        analyzer.enable_event_ring(*config.event_ring);
+    }
+
     std::cout << "- " << pkt_reader.size() << " packets in trace" << std::endl;
 
     while(pkt_reader.next(pkt)) {
@@ -40,7 +47,18 @@ int main(int argc, char** argv) {
             }
         }
 
-        if ((++pkt_count % 10000000) == 0) { // every 10M packets
+        pkt_count++;
+
+        if (config.progress_s && (pkt_count % 65536) == 0) { // clock read every 64K packets
+
+            auto now = std::chrono::high_resolution_clock::now();
+
+            if (std::chrono::duration<double>(now - last_progress).count() >= *config.progress_s) {
+                std::cout << "- " << pkt_reader.io().to_str() << std::endl;
+                last_progress = now;
+            }
+
+        } else if (!config.progress_s && (pkt_count % 10000000) == 0) { // every 10M packets
             std::cout << "- " << pkt_count << '/' << pkt_reader.size() << ": "
                       << (unsigned) (((double) pkt_count / (double) pkt_reader.size()) * 100) << "%"
                       << std::endl;
@@ -51,14 +69,29 @@ int main(int argc, char** argv) {
         }
     }
 
+    auto io = pkt_reader.io();
+
     if (config.streams_out_path) {
         analyzer.write_streams_log();
     }
 
+    analyzer.close_logs();
+
     std::cout << "- pkts: " << pkt_reader.count() << " packets"
               << (config.limit ? " (limited)" : "") << std::endl;
 
     std::cout << "- runtime [s]: " << pkt_reader.time_in_loop() << std::endl;
+    std::cout << "- input read [s]: " << io.read_time << " (" << io.read_mbytes_per_sec()
+              << " MB/s)" << std::endl;
+    std::cout << "- consumer [s]: " << io.consumer_time() << std::endl;
+
+    // stalls mean that the analysis waited for the writer thread, i.e., that the logs gated it
+    if (const auto* writer = analyzer.log_writer()) {
+        std::cout << "- log output [s]: " << std::fixed << std::setprecision(3)
+                  << writer->write_time() << " of writes (" << (double) writer->byte_count() / 1e6
+                  << " MB), stall " << writer->stall_time() << " (" << writer->max_queued() << "/"
+                  << writer->queue_len() << " buffers queued at most)" << std::endl;
+    }
 
     if (config.pkts_out_path) {
         std::cout << "- wrote packets to " << *config.pkts_out_path << std::endl;
@@ -76,6 +109,11 @@ int main(int argc, char** argv) {
         std::cout << "- wrote stats to " << *config.stats_out_path << std::endl;
     }
 
+    if (const auto* ring = analyzer.event_ring()) {
+        std::cout << "- published " << ring->head() << " events to " << ring->name() << " ("
+                  << ring->slot_count() << " slots)" << std::endl;
+    }
+
     pkt_reader.close();
 
     return 0;
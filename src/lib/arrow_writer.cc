@@ -0,0 +1,487 @@
+#include "arrow_writer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+    // from the Arrow columnar format (format/Schema.fbs, Message.fbs, and File.fbs)
+    const char MAGIC[]                          = "ARROW1";
+    const std::uint32_t CONTINUATION            = 0xffffffff;
+    const std::int16_t METADATA_V5              = 4;
+    const std::int16_t ENDIANNESS_LITTLE        = 0;
+    const std::uint8_t MESSAGE_SCHEMA           = 1;
+    const std::uint8_t MESSAGE_RECORD_BATCH     = 3;
+    const std::uint8_t TYPE_INT                 = 2;
+    const std::uint8_t TYPE_FLOATING_POINT      = 3;
+    const std::uint8_t TYPE_UTF8                = 5;
+    const std::int16_t PRECISION_DOUBLE         = 2;
+    const std::size_t ALIGN                     = 8;
+    const std::size_t STRING_LEN_HINT           = 8; // bytes per string allocated up front
+
+    std::size_t padded(std::size_t len) {
+        return (len + ALIGN - 1) & ~(ALIGN - 1);
+    }
+
+    //! builds a FlatBuffer back to front as the FlatBuffers library does, with the subset of its
+    //! API the Arrow metadata needs
+    //! - objects are referred to by their offset from the end of the buffer, so that children are
+    //!   built before their parents, and tables one at a time
+    class flatbuffer_builder {
+    public:
+        using ref = std::uint32_t;
+
+        void start_table() {
+            _fields.clear();
+            _table_end = _size();
+        }
+
+        template <typename T>
+        void add_scalar(unsigned id, T value) {
+            _align(sizeof(T));
+            _push(value);
+            _fields.emplace_back(id, _size());
+        }
+
+        void add_ref(unsigned id, ref r) {
+            _align(sizeof(ref));
+            _push_ref(r);
+            _fields.emplace_back(id, _size());
+        }
+
+        //! adds the offset to the vtable and the vtable (in front of the table)
+        ref end_table() {
+
+            _align(sizeof(std::int32_t));
+            _push((std::int32_t) 0);
+            ref table = _size();
+
+            unsigned field_count = 0;
+
+            for (auto& f : _fields)
+                field_count = std::max(field_count, f.first + 1);
+
+            std::vector<std::uint16_t> vtable(field_count, 0);
+
+            for (auto& f : _fields)
+                vtable[f.first] = (std::uint16_t) (table - f.second);
+
+            for (auto it = vtable.rbegin(); it != vtable.rend(); it++)
+                _push(*it);
+
+            _push((std::uint16_t) (table - _table_end));
+            _push((std::uint16_t) ((field_count + 2) * sizeof(std::uint16_t)));
+
+            auto vtable_offset = (std::int32_t) (_size() - table);
+            std::memcpy(_buf.data() + _buf.size() - table, &vtable_offset, sizeof(vtable_offset));
+            return table;
+        }
+
+        ref create_string(std::string_view s) {
+
+            _align(s.size() + 1, sizeof(std::uint32_t));
+            _push((std::uint8_t) 0);
+            _prepend(s.data(), s.size());
+            _push((std::uint32_t) s.size());
+            return _size();
+        }
+
+        ref create_ref_vector(const std::vector<ref>& refs) {
+
+            _align(refs.size() * sizeof(ref), sizeof(std::uint32_t));
+
+            for (auto it = refs.rbegin(); it != refs.rend(); it++)
+                _push_ref(*it);
+
+            _push((std::uint32_t) refs.size());
+            return _size();
+        }
+
+        template <typename T>
+        ref create_struct_vector(const std::vector<T>& structs) {
+
+            _align(structs.size() * sizeof(T), std::max(alignof(T), sizeof(std::uint32_t)));
+            _prepend(structs.data(), structs.size() * sizeof(T));
+            _push((std::uint32_t) structs.size());
+            return _size();
+        }
+
+        //! returns the buffer with the root table, valid until the builder is destroyed
+        std::string_view finish(ref root) {
+
+            _align(sizeof(ref), _min_align);
+            _push_ref(root);
+            return { (const char*) _buf.data() + _head, _size() };
+        }
+
+    private:
+        [[nodiscard]] ref _size() const {
+            return (ref) (_buf.size() - _head);
+        }
+
+        //! pads the buffer so that it is aligned after prepending len bytes
+        void _align(std::size_t len, std::size_t alignment) {
+
+            _min_align = std::max(_min_align, alignment);
+            auto pad = (alignment - (_size() + len) % alignment) % alignment;
+
+            if (pad > 0)
+                std::memset(_reserve(pad), 0, pad);
+        }
+
+        void _align(std::size_t alignment) {
+            _align(0, alignment);
+        }
+
+        void _prepend(const void* data, std::size_t len) {
+
+            if (len > 0)
+                std::memcpy(_reserve(len), data, len);
+        }
+
+        template <typename T>
+        void _push(T value) {
+            _prepend(&value, sizeof(value));
+        }
+
+        //! offsets to objects are relative to where they are stored
+        void _push_ref(ref r) {
+            _push((std::uint32_t) (_size() + sizeof(ref) - r));
+        }
+
+        std::uint8_t* _reserve(std::size_t len) {
+
+            if (len > _head) {
+                std::vector<std::uint8_t> buf(std::max(_buf.size() * 2, _size() + len + 256));
+                std::copy(_buf.begin() + (std::ptrdiff_t) _head, _buf.end(),
+                          buf.end() - (std::ptrdiff_t) _size());
+                _head = buf.size() - _size();
+                _buf.swap(buf);
+            }
+
+            _head -= len;
+            return _buf.data() + _head;
+        }
+
+        std::vector<std::uint8_t> _buf;
+        std::size_t _head = 0; // start of the buffer built, which ends with _buf
+        std::size_t _min_align = 1;
+        ref _table_end = 0;
+        std::vector<std::pair<unsigned, ref>> _fields; // ids and positions of the table's fields
+    };
+
+    struct field_node {
+        std::int64_t length;
+        std::int64_t null_count;
+    };
+
+    struct buffer {
+        std::int64_t offset;
+        std::int64_t length;
+    };
+
+    unsigned width_of(arrow_writer::column_type type) {
+
+        switch (type) {
+            case arrow_writer::column_type::int8:
+            case arrow_writer::column_type::uint8:
+                return 1;
+            case arrow_writer::column_type::int16:
+            case arrow_writer::column_type::uint16:
+                return 2;
+            case arrow_writer::column_type::int32:
+            case arrow_writer::column_type::uint32:
+                return 4;
+            case arrow_writer::column_type::utf8:
+                return 0;
+            default:
+                return 8;
+        }
+    }
+
+    flatbuffer_builder::ref add_schema(flatbuffer_builder& fb,
+                                       const std::vector<arrow_writer::field>& schema) {
+
+        std::vector<flatbuffer_builder::ref> fields;
+
+        for (const auto& f : schema) {
+
+            auto name = fb.create_string(f.name);
+            auto children = fb.create_ref_vector({});
+            std::uint8_t type_id;
+
+            fb.start_table();
+
+            if (f.type == arrow_writer::column_type::float64) {
+                fb.add_scalar(0, PRECISION_DOUBLE);
+                type_id = TYPE_FLOATING_POINT;
+            } else if (f.type == arrow_writer::column_type::utf8) {
+                type_id = TYPE_UTF8;
+            } else {
+                fb.add_scalar(0, (std::int32_t) (width_of(f.type) * 8));
+                fb.add_scalar(1, (std::uint8_t) (f.type <= arrow_writer::column_type::int64));
+                type_id = TYPE_INT;
+            }
+
+            auto type = fb.end_table();
+
+            fb.start_table();
+            fb.add_ref(0, name);
+            fb.add_scalar(1, (std::uint8_t) f.nullable);
+            fb.add_scalar(2, type_id);
+            fb.add_ref(3, type);
+            fb.add_ref(5, children);
+            fields.push_back(fb.end_table());
+        }
+
+        auto fields_vector = fb.create_ref_vector(fields);
+
+        fb.start_table();
+        fb.add_scalar(0, ENDIANNESS_LITTLE);
+        fb.add_ref(1, fields_vector);
+        return fb.end_table();
+    }
+
+    std::string_view finish_message(flatbuffer_builder& fb, std::uint8_t header_type,
+                                    flatbuffer_builder::ref header, std::int64_t body_len) {
+
+        fb.start_table();
+        fb.add_scalar(0, METADATA_V5);
+        fb.add_scalar(1, header_type);
+        fb.add_ref(2, header);
+        fb.add_scalar(3, body_len);
+        return fb.finish(fb.end_table());
+    }
+}
+
+arrow_writer::arrow_writer(std::ostream& os, const std::vector<field>& schema,
+                           std::size_t batch_len)
+    : _os(os), _batch_len(std::max(batch_len, (std::size_t) 1)), _schema(schema) {
+
+    if (schema.empty())
+        throw std::logic_error("arrow_writer: schema without fields");
+
+    for (const auto& f : schema) {
+
+        _column c;
+        c.f = f;
+        c.width = width_of(f.type);
+
+        if (f.type == column_type::utf8) {
+            c.kind = _value_kind::string;
+            c.values.resize(_batch_len * STRING_LEN_HINT);
+            c.offsets.resize(_batch_len + 1, 0);
+        } else {
+            c.kind = f.type == column_type::float64 ? _value_kind::floating_point
+                                                     : _value_kind::integer;
+            c.values.resize(_batch_len * c.width);
+        }
+
+        if (f.nullable)
+            c.validity.resize((_batch_len + 7) / 8);
+
+        _columns.push_back(std::move(c));
+    }
+
+    _write(MAGIC, sizeof(MAGIC) - 1);
+    _pad(sizeof(MAGIC) - 1);
+
+    flatbuffer_builder fb;
+    _write_msg(finish_message(fb, MESSAGE_SCHEMA, add_schema(fb, _schema), 0));
+}
+
+void arrow_writer::flush() {
+
+    if (_col != 0)
+        throw std::logic_error("arrow_writer: row not ended");
+
+    if (_rows > 0)
+        _write_batch();
+}
+
+void arrow_writer::close() {
+
+    if (_closed)
+        return;
+
+    flush();
+    _write_footer();
+    _closed = true;
+}
+
+bool arrow_writer::is_closed() const {
+    return _closed;
+}
+
+unsigned long long arrow_writer::row_count() const {
+    return _row_count;
+}
+
+bool arrow_writer::is_arrow_file_name(std::string_view file_name) {
+
+    for (std::string_view ext : { ".arrow", ".feather" }) {
+        if (file_name.size() > ext.size()
+                && file_name.compare(file_name.size() - ext.size(), ext.size(), ext) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+arrow_writer::~arrow_writer() {
+
+    try {
+        close();
+    } catch (const std::exception&) {
+        // errors are only reported by an explicit close()
+    }
+}
+
+void arrow_writer::_grow(_column& c, std::size_t len) {
+
+    const auto max_len = (std::size_t) std::numeric_limits<std::int32_t>::max();
+
+    if (c.len + len > max_len)
+        throw std::length_error("arrow_writer: strings of a batch exceed 2 GiB in column "
+            + c.f.name);
+
+    c.values.resize(std::min(std::max(c.values.size() * 2, c.len + len), max_len));
+}
+
+void arrow_writer::_throw_mismatch(_value_kind kind) const {
+
+    if (_col >= _columns.size())
+        throw std::logic_error("arrow_writer: more values than the " + std::to_string(_col)
+            + " fields");
+
+    if (kind == _value_kind::null)
+        throw std::logic_error("arrow_writer: null in column " + _columns[_col].f.name
+            + ", which is not nullable");
+
+    throw std::logic_error("arrow_writer: value of the wrong type for column "
+        + _columns[_col].f.name);
+}
+
+void arrow_writer::_throw_row_len() const {
+
+    throw std::logic_error("arrow_writer: row of " + std::to_string(_col) + " values for "
+        + std::to_string(_columns.size()) + " fields");
+}
+
+void arrow_writer::_write_batch() {
+
+    std::vector<field_node> nodes;
+    std::vector<buffer> buffers;
+    std::int64_t body_len = 0;
+
+    auto add_buffer = [&buffers, &body_len](std::size_t len) {
+        buffers.push_back({ body_len, (std::int64_t) len });
+        body_len += (std::int64_t) padded(len);
+    };
+
+    auto validity_len = (_rows + 7) / 8;
+    auto offsets_len = (_rows + 1) * sizeof(std::int32_t);
+
+    // the validity bitmap is left empty without nulls
+    for (const auto& c : _columns) {
+
+        nodes.push_back({ (std::int64_t) _rows, (std::int64_t) c.null_count });
+        add_buffer(c.null_count ? validity_len : 0);
+
+        if (c.kind == _value_kind::string)
+            add_buffer(offsets_len);
+
+        add_buffer(_values_len(c));
+    }
+
+    flatbuffer_builder fb;
+    auto nodes_vector = fb.create_struct_vector(nodes);
+    auto buffers_vector = fb.create_struct_vector(buffers);
+
+    fb.start_table();
+    fb.add_scalar(0, (std::int64_t) _rows);
+    fb.add_ref(1, nodes_vector);
+    fb.add_ref(2, buffers_vector);
+    auto batch = fb.end_table();
+
+    auto offset = (std::int64_t) _pos;
+    auto metadata_len = _write_msg(finish_message(fb, MESSAGE_RECORD_BATCH, batch, body_len));
+
+    for (auto& c : _columns) {
+
+        if (c.null_count) {
+            _write(c.validity.data(), validity_len);
+            _pad(validity_len);
+        }
+
+        if (c.kind == _value_kind::string) {
+            _write(c.offsets.data(), offsets_len);
+            _pad(offsets_len);
+        }
+
+        _write(c.values.data(), _values_len(c));
+        _pad(_values_len(c));
+
+        c.len = 0;
+        c.null_count = 0;
+    }
+
+    _blocks.push_back({ offset, metadata_len, 0, body_len });
+    _rows = 0;
+}
+
+std::size_t arrow_writer::_values_len(const _column& c) const {
+    return c.kind == _value_kind::string ? c.len : _rows * c.width;
+}
+
+void arrow_writer::_write_footer() {
+
+    static_assert(sizeof(_block) == 24, "arrow_writer: Block is a struct of 24 bytes");
+
+    // the end-of-stream marker, for readers of the stream format
+    const std::uint32_t eos[2] = { CONTINUATION, 0 };
+    _write(eos, sizeof(eos));
+
+    flatbuffer_builder fb;
+    auto schema = add_schema(fb, _schema);
+    auto dictionaries = fb.create_struct_vector(std::vector<_block>{});
+    auto record_batches = fb.create_struct_vector(_blocks);
+
+    fb.start_table();
+    fb.add_scalar(0, METADATA_V5);
+    fb.add_ref(1, schema);
+    fb.add_ref(2, dictionaries);
+    fb.add_ref(3, record_batches);
+    auto footer = fb.finish(fb.end_table());
+
+    auto footer_len = (std::int32_t) footer.size();
+    _write(footer.data(), footer.size());
+    _write(&footer_len, sizeof(footer_len));
+    _write(MAGIC, sizeof(MAGIC) - 1);
+}
+
+std::int32_t arrow_writer::_write_msg(std::string_view metadata) {
+
+    // metadata padded so that the body is aligned
+    const std::uint32_t prefix[2] = { CONTINUATION, (std::uint32_t) padded(metadata.size()) };
+    _write(prefix, sizeof(prefix));
+    _write(metadata.data(), metadata.size());
+    _pad(metadata.size());
+
+    return (std::int32_t) (sizeof(prefix) + padded(metadata.size()));
+}
+
+void arrow_writer::_write(const void* data, std::size_t len) {
+
+    _os.write((const char*) data, (std::streamsize) len);
+    _pos += len;
+}
+
+void arrow_writer::_pad(std::size_t len) {
+
+    static const char zeros[ALIGN] = {};
+    _write(zeros, padded(len) - len);
+}
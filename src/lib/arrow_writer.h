@@ -0,0 +1,235 @@
+#ifndef ZOOM_ANALYSIS_ARROW_WRITER_H
+#define ZOOM_ANALYSIS_ARROW_WRITER_H
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "net.h"
+
+//! writes a table in the Apache Arrow IPC file format (Feather V2), so that readers (e.g., R's
+//! arrow::read_feather, pyarrow.feather) memory-map typed columns instead of parsing text
+//! - collects the values of batch_len rows column by column and writes them as a record batch
+//!   (little-endian, buffers aligned to 8 bytes, no compression, no dictionaries)
+//! - value() sets the next column of the row, end_row() ends the row: values must match the
+//!   type of their column, integers are truncated to its width, null() requires a nullable column
+//! - the stream must start with the file (block offsets are counted from the writer's first byte)
+//!   and outlive the writer
+class arrow_writer {
+public:
+    static constexpr std::size_t DEFAULT_BATCH_LEN = 64 << 10; // rows
+
+    enum class column_type : std::uint8_t {
+        int8, int16, int32, int64, uint8, uint16, uint32, uint64, float64, utf8
+    };
+
+    struct field {
+        std::string name;
+        column_type type;
+        bool nullable = false;
+    };
+
+    //! writes the file header and the schema to the stream
+    arrow_writer(std::ostream& os, const std::vector<field>& schema,
+                 std::size_t batch_len = DEFAULT_BATCH_LEN);
+
+    arrow_writer(const arrow_writer&) = delete;
+    arrow_writer& operator=(const arrow_writer&) = delete;
+
+    template <typename T, std::enable_if_t<std::is_integral_v<T>
+                                           && !std::is_same_v<T, char>
+                                           && !std::is_same_v<T, bool>, int> = 0>
+    arrow_writer& value(T value) {
+
+        // little-endian, as the schema declares, so that the low bytes are the value truncated
+        auto& c = _next(_value_kind::integer);
+        auto v = (std::int64_t) value;
+        auto* p = c.values.data() + _rows * c.width;
+
+        switch (c.width) {
+            case 1:
+                *p = (std::uint8_t) v;
+                break;
+            case 2:
+                std::memcpy(p, &v, 2);
+                break;
+            case 4:
+                std::memcpy(p, &v, 4);
+                break;
+            default:
+                std::memcpy(p, &v, 8);
+        }
+
+        return *this;
+    }
+
+    arrow_writer& value(double value) {
+
+        auto& c = _next(_value_kind::floating_point);
+        std::memcpy(c.values.data() + _rows * sizeof(value), &value, sizeof(value));
+        return *this;
+    }
+
+    arrow_writer& value(std::string_view value) {
+
+        auto& c = _next(_value_kind::string);
+        auto* p = _reserve(c, value.size());
+
+        if (!value.empty())
+            std::memcpy(p, value.data(), value.size());
+
+        _end_string(c, value.size());
+        return *this;
+    }
+
+    arrow_writer& value(const char* value) {
+        return this->value(std::string_view(value));
+    }
+
+    arrow_writer& value(char value) {
+        return this->value(std::string_view(&value, 1));
+    }
+
+    //! sets a string column to an address in dotted-decimal notation
+    arrow_writer& addr_value(std::uint32_t addr) {
+
+        auto& c = _next(_value_kind::string);
+        auto* p = (char*) _reserve(c, net::ipv4::ADDR_CHARS_LEN);
+        _end_string(c, (std::size_t) (net::ipv4::addr_to_chars(addr, p) - p));
+        return *this;
+    }
+
+    arrow_writer& null() {
+
+        auto& c = _next(_value_kind::null);
+
+        if (c.kind == _value_kind::string)
+            _end_string(c, 0);
+        else
+            std::memset(c.values.data() + _rows * c.width, 0, c.width);
+
+        return *this;
+    }
+
+    //! ends the row, writes a record batch once batch_len rows are collected
+    arrow_writer& end_row() {
+
+        if (_col != _columns.size())
+            _throw_row_len();
+
+        _col = 0;
+        _rows++;
+        _row_count++;
+
+        if (_rows == _batch_len)
+            _write_batch();
+
+        return *this;
+    }
+
+    //! writes the rows collected as a record batch
+    void flush();
+
+    //! writes the rows collected and the file footer, the writer is not to be used afterwards
+    void close();
+    [[nodiscard]] bool is_closed() const;
+
+    //! returns the rows ended so far
+    [[nodiscard]] unsigned long long row_count() const;
+
+    //! returns true if the file name ends in .arrow or .feather
+    static bool is_arrow_file_name(std::string_view file_name);
+
+    //! closes the file if it is not closed, ignoring errors
+    ~arrow_writer();
+
+private:
+    enum class _value_kind : std::uint8_t { integer, floating_point, string, null };
+
+    //! of a batch, the buffers are allocated for batch_len rows and reused
+    struct _column {
+        field f;
+        _value_kind kind = _value_kind::integer;
+        unsigned width = 0;                 // bytes per value, 0 for strings
+        std::vector<std::uint8_t> values;   // fixed-width values, or the bytes of the strings
+        std::size_t len = 0;                // bytes of the strings
+        std::vector<std::int32_t> offsets;  // of the strings in values, one more than rows
+        std::vector<std::uint8_t> validity; // bitmap of nullable columns
+        std::size_t null_count = 0;
+    };
+
+    struct _block {
+        std::int64_t offset;
+        std::int32_t metadata_len;
+        std::int32_t padding;
+        std::int64_t body_len;
+    };
+
+    //! returns the column of the next value, sets its validity bit
+    _column& _next(_value_kind kind) {
+
+        if (_col >= _columns.size()
+                || (kind != _columns[_col].kind
+                    && (kind != _value_kind::null || !_columns[_col].f.nullable)))
+            _throw_mismatch(kind);
+
+        auto& c = _columns[_col++];
+
+        if (c.f.nullable) {
+
+            auto& bits = c.validity[_rows / 8];
+
+            if (_rows % 8 == 0)
+                bits = 0;
+
+            if (kind == _value_kind::null)
+                c.null_count++;
+            else
+                bits |= (std::uint8_t) (1u << (_rows % 8));
+        }
+
+        return c;
+    }
+
+    //! returns where to write len bytes of a string
+    std::uint8_t* _reserve(_column& c, std::size_t len) {
+
+        if (c.len + len > c.values.size())
+            _grow(c, len);
+
+        return c.values.data() + c.len;
+    }
+
+    void _end_string(_column& c, std::size_t len) {
+        c.len += len;
+        c.offsets[_rows + 1] = (std::int32_t) c.len;
+    }
+
+    void _grow(_column& c, std::size_t len);
+    [[noreturn]] void _throw_mismatch(_value_kind kind) const;
+    [[noreturn]] void _throw_row_len() const;
+    [[nodiscard]] std::size_t _values_len(const _column& c) const;
+
+    void _write_batch();
+    void _write_footer();
+    std::int32_t _write_msg(std::string_view metadata);
+    void _write(const void* data, std::size_t len);
+    void _pad(std::size_t len);
+
+    std::ostream& _os;
+    std::size_t _batch_len;
+    std::vector<field> _schema;
+    std::vector<_column> _columns;
+    std::vector<_block> _blocks;
+    std::size_t _col = 0;      // of the next value
+    std::size_t _rows = 0;     // collected
+    unsigned long long _row_count = 0;
+    std::uint64_t _pos = 0;    // bytes written
+    bool _closed = false;
+};
+
+#endif
@@ -0,0 +1,335 @@
+#include "async_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <system_error>
+#include <unistd.h>
+
+async_writer::async_writer(std::size_t buf_len, unsigned queue_len)
+    : _buf_len(std::max(buf_len, (std::size_t) 1)), _queue_len(std::max(queue_len, 1u)) {
+
+    _thread = std::thread(&async_writer::_run, this);
+}
+
+unsigned async_writer::open(const std::string& file_name) {
+
+    int fd = ::open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0)
+        throw std::system_error(errno, std::system_category(), "async_writer: could not open "
+            + file_name);
+
+    _files.push_back(std::make_unique<file>(file{file_name, fd}));
+    return (unsigned) _files.size() - 1;
+}
+
+std::vector<char> async_writer::write(unsigned file, std::vector<char>&& buf, std::size_t len) {
+
+    if (file >= _files.size() || !_files[file])
+        throw std::logic_error("async_writer: file not open");
+
+    if (len == 0) {
+        buf.resize(_buf_len);
+        return std::move(buf);
+    }
+
+    _queue({ .f = _files[file].get(), .buf = std::move(buf), .len = len });
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (!_free.empty()) {
+            auto free_buf = std::move(_free.back());
+            _free.pop_back();
+            return free_buf;
+        }
+    }
+
+    return std::vector<char>(_buf_len);
+}
+
+void async_writer::close(unsigned file) {
+
+    if (file >= _files.size() || !_files[file])
+        throw std::logic_error("async_writer: file not open");
+
+    // the file is closed by the background thread, which owns it from now on
+    _queue({ .f = _files[file].release(), .close = true });
+}
+
+void async_writer::drain() {
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cv.wait(lock, [this]() { return _jobs.empty() && !_busy; });
+
+    if (_error)
+        std::rethrow_exception(_error);
+}
+
+std::size_t async_writer::buf_len() const {
+    return _buf_len;
+}
+
+unsigned async_writer::queue_len() const {
+    return _queue_len;
+}
+
+unsigned long long async_writer::byte_count() const {
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _byte_count;
+}
+
+double async_writer::write_time() const {
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    return std::chrono::duration<double>(_write_time).count();
+}
+
+double async_writer::stall_time() const {
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    return std::chrono::duration<double>(_stall_time).count();
+}
+
+unsigned async_writer::max_queued() const {
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _max_queued;
+}
+
+async_writer::~async_writer() {
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+
+    _cv.notify_all();
+
+    if (_thread.joinable())
+        _thread.join();
+
+    // files whose streams were not closed
+    for (auto& f : _files) {
+        if (f)
+            ::close(f->fd);
+    }
+}
+
+void async_writer::_queue(job&& j) {
+
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    if (_jobs.size() >= _queue_len && !_error) {
+
+        auto start = std::chrono::high_resolution_clock::now();
+        _cv.wait(lock, [this]() { return _jobs.size() < _queue_len || _error; });
+        _stall_time += std::chrono::high_resolution_clock::now() - start;
+    }
+
+    // closing is queued after an error, too, so that the file is closed
+    if (_error && !j.close)
+        std::rethrow_exception(_error);
+
+    _byte_count += j.len;
+    _jobs.push_back(std::move(j));
+    _max_queued = std::max(_max_queued, (unsigned) _jobs.size());
+    _cv.notify_all();
+}
+
+void async_writer::_run() {
+
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    while (true) {
+
+        _cv.wait(lock, [this]() { return !_jobs.empty() || _stop; });
+
+        if (_jobs.empty()) // stopped and all buffers written
+            return;
+
+        auto j = std::move(_jobs.front());
+        _jobs.pop_front();
+        _busy = true;
+        bool failed = _error != nullptr;
+        _cv.notify_all();
+        lock.unlock();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::exception_ptr error = nullptr;
+
+        try {
+            if (!failed)
+                _write(j);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        auto write_time = std::chrono::high_resolution_clock::now() - start;
+
+        if (j.close) {
+
+            if (::close(j.f->fd) < 0 && !failed && !error)
+                error = std::make_exception_ptr(std::system_error(errno, std::system_category(),
+                    "async_writer: could not close " + j.f->name));
+
+            delete j.f;
+        }
+
+        lock.lock();
+        _write_time += write_time;
+
+        if (error && !_error)
+            _error = error;
+
+        if (!j.buf.empty())
+            _free.push_back(std::move(j.buf));
+
+        _busy = false;
+        _cv.notify_all();
+    }
+}
+
+void async_writer::_write(const job& j) {
+
+    const char* data = j.buf.data();
+    std::size_t len = j.len;
+
+    while (len > 0) {
+
+        auto n = ::write(j.f->fd, data, len);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            throw std::system_error(n < 0 ? errno : EIO, std::system_category(),
+                "async_writer: could not write " + j.f->name);
+
+        data += n;
+        len -= (std::size_t) n;
+    }
+}
+
+async_writer::stream::stream()
+    : std::ostream(nullptr) {
+
+    rdbuf(&_buf);
+}
+
+async_writer::stream::stream(stream&& other) noexcept
+    : std::ostream(std::move(other)), _buf(std::move(other._buf)) {
+
+    set_rdbuf(&_buf);
+}
+
+async_writer::stream& async_writer::stream::operator=(stream&& other) {
+
+    if (this != &other) {
+        close();
+        std::ostream::swap(other);
+        _buf.swap(other._buf);
+    }
+
+    return *this;
+}
+
+void async_writer::stream::open(async_writer& writer, const std::string& file_name) {
+
+    if (is_open())
+        throw std::logic_error("async_writer::stream: already open");
+
+    _buf.open(writer, writer.open(file_name));
+    clear();
+    exceptions(std::ios::badbit);
+}
+
+bool async_writer::stream::is_open() const {
+    return _buf.writer != nullptr;
+}
+
+void async_writer::stream::close() {
+
+    if (is_open())
+        _buf.close();
+}
+
+async_writer::stream::~stream() {
+
+    try {
+        close();
+    } catch (const std::exception&) {
+        // errors are only reported by an explicit close()
+    }
+}
+
+async_writer::stream::buffer::buffer(buffer&& other) noexcept
+    : std::streambuf(other), writer(other.writer), file(other.file),
+      data(std::move(other.data)) {
+
+    other.writer = nullptr;
+    other.setp(nullptr, nullptr);
+}
+
+void async_writer::stream::buffer::swap(buffer& other) {
+
+    std::streambuf::swap(other);
+    std::swap(writer, other.writer);
+    std::swap(file, other.file);
+    data.swap(other.data);
+}
+
+void async_writer::stream::buffer::open(async_writer& w, unsigned f) {
+
+    writer = &w;
+    file = f;
+    data.resize(w.buf_len());
+    setp(data.data(), data.data() + data.size());
+}
+
+void async_writer::stream::buffer::close() {
+
+    // detached even if queueing fails
+    auto* w = writer;
+    auto len = (std::size_t) (pptr() - pbase());
+    writer = nullptr;
+    setp(nullptr, nullptr);
+
+    w->write(file, std::move(data), len);
+    data = {};
+    w->close(file);
+}
+
+async_writer::stream::buffer::int_type async_writer::stream::buffer::overflow(int_type c) {
+
+    if (!writer)
+        return traits_type::eof();
+
+    _queue();
+
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+
+    return traits_type::not_eof(c);
+}
+
+int async_writer::stream::buffer::sync() {
+
+    if (writer && pptr() > pbase())
+        _queue();
+
+    return 0;
+}
+
+void async_writer::stream::buffer::_queue() {
+
+    auto len = (std::size_t) (pptr() - pbase());
+    setp(nullptr, nullptr); // until the next buffer, if queueing fails
+
+    data = writer->write(file, std::move(data), len);
+    setp(data.data(), data.data() + data.size());
+}
@@ -0,0 +1,142 @@
+#ifndef ZOOM_ANALYSIS_ASYNC_WRITER_H
+#define ZOOM_ANALYSIS_ASYNC_WRITER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+//! writes the output files of a producer (e.g., CSV logs and binary outputs) on a background thread
+//! - the producer fills a buffer per file (see stream) and queues it once full, so that file I/O
+//!   no longer gates the producer
+//! - at most queue_len buffers are queued, a producer finding the queue full waits for the
+//!   background thread: stall_time() and max_queued() measure this backpressure
+//! - errors writing files are rethrown on the producer thread by the next call that queues
+class async_writer {
+public:
+    static const std::size_t DEFAULT_BUF_LEN   = 1 << 20;
+    static const unsigned    DEFAULT_QUEUE_LEN = 16;
+
+    class stream;
+
+    //! starts the background thread
+    explicit async_writer(std::size_t buf_len = DEFAULT_BUF_LEN,
+                          unsigned queue_len = DEFAULT_QUEUE_LEN);
+    async_writer(const async_writer&) = delete;
+    async_writer& operator=(const async_writer&) = delete;
+
+    //! creates or truncates the file, returns its id, throws std::system_error upon error
+    unsigned open(const std::string& file_name);
+
+    //! queues the first len bytes of buf to be written to the file, returns an empty buffer of
+    //! buf_len() bytes to fill next
+    std::vector<char> write(unsigned file, std::vector<char>&& buf, std::size_t len);
+
+    //! queues closing the file once the buffers queued before are written
+    void close(unsigned file);
+
+    //! waits until the buffers queued are written, e.g., before reporting the outputs
+    void drain();
+
+    [[nodiscard]] std::size_t buf_len() const;
+    [[nodiscard]] unsigned queue_len() const;
+
+    //! returns the bytes queued so far
+    [[nodiscard]] unsigned long long byte_count() const;
+
+    //! returns the time in seconds the background thread spent in write calls
+    [[nodiscard]] double write_time() const;
+
+    //! returns the time in seconds the producer waited for a full queue
+    [[nodiscard]] double stall_time() const;
+
+    //! returns the most buffers queued at once
+    [[nodiscard]] unsigned max_queued() const;
+
+    //! writes the buffers queued, closes the files, and joins the background thread, ignoring errors
+    ~async_writer();
+
+private:
+    struct file {
+        std::string name;
+        int fd = -1;
+    };
+
+    struct job {
+        file* f = nullptr;
+        std::vector<char> buf;
+        std::size_t len = 0;
+        bool close = false;
+    };
+
+    void _queue(job&& j);
+    void _run();
+    static void _write(const job& j);
+
+    std::size_t _buf_len;
+    unsigned _queue_len;
+    std::vector<std::unique_ptr<file>> _files;
+    std::deque<job> _jobs;
+    std::vector<std::vector<char>> _free; // buffers written, to be filled again
+    bool _busy = false, _stop = false;
+    std::exception_ptr _error = nullptr;
+    unsigned long long _byte_count = 0;
+    unsigned _max_queued = 0;
+    std::chrono::high_resolution_clock::duration _write_time = {}, _stall_time = {};
+    mutable std::mutex _mutex;
+    std::condition_variable _cv;
+    std::thread _thread;
+};
+
+//! an output stream to a file of an async_writer
+//! - collects the output in a buffer queued once full, or upon flush (as std::endl does, so that
+//!   lines are better ended with '\n')
+//! - the writer must outlive its streams
+class async_writer::stream : public std::ostream {
+public:
+    stream();
+    stream(stream&& other) noexcept;
+    stream& operator=(stream&& other);
+
+    //! creates or truncates the file, throws std::system_error upon error
+    //! - errors writing the file are rethrown by the output operations
+    void open(async_writer& writer, const std::string& file_name);
+    [[nodiscard]] bool is_open() const;
+
+    //! queues the buffer and closing the file
+    void close();
+
+    //! closes the file if it is open, ignoring errors
+    ~stream() override;
+
+private:
+    class buffer : public std::streambuf {
+    public:
+        buffer() = default;
+        buffer(buffer&& other) noexcept;
+        void swap(buffer& other);
+        void open(async_writer& w, unsigned f);
+        void close();
+
+        async_writer* writer = nullptr;
+        unsigned file = 0;
+        std::vector<char> data;
+
+    protected:
+        int_type overflow(int_type c) override;
+        int sync() override;
+
+    private:
+        void _queue();
+    };
+
+    buffer _buf;
+};
+
+#endif
@@ -0,0 +1,51 @@
+
+#include "chunk_source.h"
+
+#include <stdexcept>
+
+mmap_chunk_source::mmap_chunk_source(const std::vector<std::string>& file_names)
+    : _file_names(file_names) { }
+
+bool mmap_chunk_source::next(chunk& c) {
+
+    _mapped_file.close();
+
+    if (_next_file >= _file_names.size())
+        return false;
+
+    _mapped_file.open(_file_names[_next_file]);
+
+    c = { .buf = _mapped_file.data(), .len = _mapped_file.size(), .file = _next_file++,
+          .file_start = true };
+
+    return true;
+}
+
+mmap_range_chunk_source::mmap_range_chunk_source(const std::string& file_name,
+    std::size_t hdr_len, std::uint64_t begin, std::uint64_t end)
+    : _file_name(file_name), _hdr_len(hdr_len), _begin(begin), _end(end) { }
+
+bool mmap_range_chunk_source::next(chunk& c) {
+
+    switch (_next_chunk++) {
+
+        case 0:
+            _mapped_file.open(_file_name);
+
+            if (_end > _mapped_file.size() || _begin > _end || _hdr_len > _begin)
+                throw std::out_of_range("mmap_range_chunk_source: invalid range for "
+                    + _file_name);
+
+            c = { .buf = _mapped_file.data(), .len = _hdr_len, .file = 0, .file_start = true };
+            return true;
+
+        case 1:
+            c = { .buf = _mapped_file.data() + _begin, .len = (std::size_t) (_end - _begin),
+                  .file = 0, .file_start = false };
+            return true;
+
+        default:
+            _mapped_file.close();
+            return false;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef ZOOM_ANALYSIS_CHUNK_SOURCE_H
+#define ZOOM_ANALYSIS_CHUNK_SOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mmap_file.h"
+
+//! delivers the contents of a sequence of files in order, one chunk at a time
+class chunk_source {
+public:
+
+    struct chunk {
+        const unsigned char* buf = nullptr;
+        std::size_t len          = 0;
+        unsigned file            = 0;     // index into the list of files
+        bool file_start          = false; // first chunk of a file
+    };
+
+    chunk_source() = default;
+    chunk_source(const chunk_source&) = delete;
+    chunk_source& operator=(const chunk_source&) = delete;
+
+    //! returns the next chunk, false after the last chunk of the last file
+    //! - releases the chunk returned by the previous call
+    virtual bool next(chunk& c) = 0;
+
+    //! returns the time in seconds next() spent waiting for data
+    [[nodiscard]] virtual double stall_time() const {
+        return 0.0;
+    }
+
+    virtual ~chunk_source() = default;
+};
+
+//! maps one file at a time and delivers each file as a single chunk
+class mmap_chunk_source : public chunk_source {
+public:
+    explicit mmap_chunk_source(const std::vector<std::string>& file_names);
+    bool next(chunk& c) override;
+
+private:
+    std::vector<std::string> _file_names;
+    mmap_file _mapped_file;
+    unsigned _next_file = 0;
+};
+
+//! maps a file and delivers its header followed by a byte range of it as two chunks, e.g., the
+//! records of one part of a pcap file split for parallel processing
+class mmap_range_chunk_source : public chunk_source {
+public:
+    mmap_range_chunk_source(const std::string& file_name, std::size_t hdr_len,
+                            std::uint64_t begin, std::uint64_t end);
+    bool next(chunk& c) override;
+
+private:
+    std::string _file_name;
+    mmap_file _mapped_file;
+    std::size_t _hdr_len;
+    std::uint64_t _begin, _end;
+    unsigned _next_chunk = 0;
+};
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef ZOOM_ANALYSIS_CSV_WRITER_H
+#define ZOOM_ANALYSIS_CSV_WRITER_H
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <ostream>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "net.h"
+
+//! formats CSV rows into a buffer with std::to_chars and writes them to a stream in large blocks
+//! - field() starts a field (separated by ','), append() continues it, end_row() ends the row
+//! - writes the buffer to the stream only at the end of a row once it holds buf_len bytes, and
+//!   upon flush(), so that the stream is written whole rows, e.g., for readers following the file
+//! - numbers read as operator<< writes them with the default flags, floating-point numbers with
+//!   the precision given, so that the output does not change with the writer
+//! - the stream must outlive the writer
+class csv_writer {
+public:
+    static constexpr std::size_t DEFAULT_BUF_LEN = 64 << 10;
+
+    explicit csv_writer(std::ostream& os, std::size_t buf_len = DEFAULT_BUF_LEN)
+        : _os(os), _buf_len(std::max(buf_len, (std::size_t) 1)), _buf(_buf_len + ROW_SLACK) { }
+
+    csv_writer(const csv_writer&) = delete;
+    csv_writer& operator=(const csv_writer&) = delete;
+
+    //! starts a field with the value
+    template <typename T>
+    csv_writer& field(const T& value) {
+        _separate();
+        return append(value);
+    }
+
+    //! starts a field with a floating-point number of precision significant digits
+    csv_writer& field(double value, int precision) {
+        _separate();
+        return append(value, precision);
+    }
+
+    //! starts a field with an address in dotted-decimal notation
+    csv_writer& addr_field(std::uint32_t addr) {
+        _separate();
+        _pos = net::ipv4::addr_to_chars(addr, _reserve(net::ipv4::ADDR_CHARS_LEN)) - _buf.data();
+        return *this;
+    }
+
+    //! writes the protocol, addresses, and ports as the five fields operator<< writes
+    csv_writer& field(const net::ipv4_5tuple& ip_5t) {
+        field((unsigned) ip_5t.ip_proto);
+        addr_field(ip_5t.ip_src);
+        field(ip_5t.tp_src);
+        addr_field(ip_5t.ip_dst);
+        return field(ip_5t.tp_dst);
+    }
+
+    template <typename T, std::enable_if_t<std::is_integral_v<T>
+                                           && !std::is_same_v<T, char>
+                                           && !std::is_same_v<T, bool>, int> = 0>
+    csv_writer& append(T value) {
+        char* p = _reserve(MAX_NUMBER_LEN);
+        _pos = std::to_chars(p, p + MAX_NUMBER_LEN, value).ptr - _buf.data();
+        return *this;
+    }
+
+    csv_writer& append(double value, int precision = DEFAULT_PRECISION) {
+        char* p = _reserve(MAX_NUMBER_LEN);
+        _pos = std::to_chars(p, p + MAX_NUMBER_LEN, value, std::chars_format::general,
+                             std::min(precision, MAX_PRECISION)).ptr - _buf.data();
+        return *this;
+    }
+
+    //! appends the lower-case hexadecimal digits of value, padded with '0' to width digits
+    csv_writer& append_hex(unsigned value, unsigned width) {
+
+        char digits[MAX_NUMBER_LEN];
+        auto len = (unsigned) (std::to_chars(digits, digits + sizeof(digits), value, 16).ptr
+            - digits);
+        char* p = _reserve(std::max(len, width));
+
+        for (unsigned i = len; i < width; i++)
+            *p++ = '0';
+
+        std::memcpy(p, digits, len);
+        _pos = p + len - _buf.data();
+        return *this;
+    }
+
+    csv_writer& append(char c) {
+        *_reserve(1) = c;
+        _pos++;
+        return *this;
+    }
+
+    csv_writer& append(std::string_view s) {
+        std::memcpy(_reserve(s.size()), s.data(), s.size());
+        _pos += s.size();
+        return *this;
+    }
+
+    csv_writer& append(const char* s) {
+        return append(std::string_view(s));
+    }
+
+    //! ends the row, writes the buffer to the stream once it holds buf_len bytes
+    csv_writer& end_row() {
+
+        append('\n');
+        _row_start = true;
+
+        if (_pos >= _buf_len)
+            flush();
+
+        return *this;
+    }
+
+    //! writes the rows formatted to the stream (without flushing the stream)
+    void flush() {
+
+        if (_pos > 0)
+            _os.write(_buf.data(), (std::streamsize) _pos);
+
+        _pos = 0;
+    }
+
+    //! writes the rows formatted to the stream, ignoring errors
+    ~csv_writer() {
+        try {
+            flush();
+        } catch (const std::exception&) {
+            // errors are only reported by an explicit flush()
+        }
+    }
+
+private:
+    static constexpr std::size_t MAX_NUMBER_LEN = 32;   // of integers and floating-point numbers
+    static constexpr int DEFAULT_PRECISION      = 6;    // as std::ostream
+    static constexpr int MAX_PRECISION          = 24;   // that fits MAX_NUMBER_LEN
+    static constexpr std::size_t ROW_SLACK      = 4096; // so that rows rarely grow the buffer
+
+    void _separate() {
+        if (!_row_start)
+            append(',');
+
+        _row_start = false;
+    }
+
+    //! returns where to write len bytes, growing the buffer for long rows
+    char* _reserve(std::size_t len) {
+
+        if (_pos + len > _buf.size())
+            _buf.resize(std::max(_buf.size() * 2, _pos + len));
+
+        return _buf.data() + _pos;
+    }
+
+    std::ostream& _os;
+    std::size_t _buf_len;
+    std::vector<char> _buf;
+    std::size_t _pos = 0;
+    bool _row_start = true;
+};
+
+#endif
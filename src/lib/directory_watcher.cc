@@ -0,0 +1,132 @@
+
+#include "directory_watcher.h"
+
+#include <cerrno>
+#include <climits>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+
+#include "util.h"
+
+directory_watcher::directory_watcher(const std::string& directory,
+    const std::string& limit_ext_start) : _directory(directory), _limit_ext_start(limit_ext_start) {
+
+    _fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (_fd < 0)
+        throw std::system_error(errno, std::system_category(),
+            "directory_watcher: could not initialize inotify");
+
+    // watches before listing the directory, so that no file is missed in between
+    if (inotify_add_watch(_fd, directory.c_str(), IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        auto error = errno;
+        ::close(_fd);
+        throw std::system_error(error, std::system_category(),
+            "directory_watcher: could not watch " + directory);
+    }
+
+    auto files = util::files_in_directory(directory, limit_ext_start);
+    std::sort(files.begin(), files.end(), util::compare_file_ext_seq);
+
+    for (const auto& file : files)
+        _created(file);
+}
+
+std::optional<std::string> directory_watcher::next(int timeout_ms) {
+
+    _read_events();
+
+    if (_ready.empty()) {
+
+        pollfd pfd = { .fd = _fd, .events = POLLIN, .revents = 0 };
+
+        if (poll(&pfd, 1, timeout_ms) < 0 && errno != EINTR)
+            throw std::system_error(errno, std::system_category(),
+                "directory_watcher: could not wait for " + _directory);
+
+        _read_events();
+    }
+
+    if (_ready.empty())
+        return std::nullopt;
+
+    auto path = _ready.front();
+    _ready.pop_front();
+    return path;
+}
+
+const std::optional<std::string>& directory_watcher::pending() const {
+
+    return _pending;
+}
+
+directory_watcher::~directory_watcher() {
+
+    ::close(_fd);
+}
+
+bool directory_watcher::_matches(const std::string& name) const {
+
+    if (name.empty() || name[0] == '.')
+        return false;
+
+    return _limit_ext_start.empty() || util::extension_without_compression(name)
+        .rfind("." + _limit_ext_start, 0) == 0;
+}
+
+void directory_watcher::_complete(std::string path) {
+
+    if (_pending == path)
+        _pending.reset();
+
+    if (_yielded.insert(path).second)
+        _ready.push_back(std::move(path));
+}
+
+void directory_watcher::_created(const std::string& path) {
+
+    // a rotating capture only starts a file after completing the one before
+    if (_pending && util::compare_file_ext_seq(*_pending, path))
+        _complete(*_pending);
+
+    if (!_yielded.count(path))
+        _pending = path;
+}
+
+void directory_watcher::_read_events() {
+
+    alignas(inotify_event) char buf[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+
+    while (true) {
+
+        auto n = ::read(_fd, buf, sizeof(buf));
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n < 0 && errno == EAGAIN)
+            return;
+
+        if (n < 0)
+            throw std::system_error(errno, std::system_category(),
+                "directory_watcher: could not read events for " + _directory);
+
+        for (char* p = buf; p < buf + n; p += sizeof(inotify_event) + ((inotify_event*) p)->len) {
+
+            const auto* event = (inotify_event*) p;
+
+            if (!event->len || (event->mask & IN_ISDIR) || !_matches(event->name))
+                continue;
+
+            auto path = (std::filesystem::path(_directory) / event->name).string();
+
+            if (event->mask & IN_CREATE)
+                _created(path);
+            else
+                _complete(path);
+        }
+    }
+}
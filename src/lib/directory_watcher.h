@@ -0,0 +1,50 @@
+#ifndef ZOOM_ANALYSIS_DIRECTORY_WATCHER_H
+#define ZOOM_ANALYSIS_DIRECTORY_WATCHER_H
+
+#include <deque>
+#include <optional>
+#include <set>
+#include <string>
+
+//! yields the files of a directory written by a rotating capture (e.g., trace.pcap0, trace.pcap1,
+//! ...) one at a time as they are completed, watching the directory with inotify
+//! - a file is complete once it was closed after writing, moved into the directory, or a file
+//!   after it in the sequence (see util::compare_file_ext_seq) was created
+//! - files already in the directory are yielded first, in sequence order, except for the last
+//!   one, which might still be written
+//! - every file is yielded only once, even if it is written again later
+class directory_watcher {
+public:
+
+    //! starts watching a directory for files whose extension starts with "." + limit_ext_start
+    //! (all non-hidden files if empty), throws std::system_error upon error
+    explicit directory_watcher(const std::string& directory,
+                               const std::string& limit_ext_start = "");
+
+    directory_watcher(const directory_watcher&) = delete;
+    directory_watcher& operator=(const directory_watcher&) = delete;
+
+    //! returns the path of the next complete file, or std::nullopt if none was completed within
+    //! timeout_ms (-1: wait indefinitely) or waiting was interrupted by a signal
+    std::optional<std::string> next(int timeout_ms);
+
+    //! returns the last file seen that is not known to be complete yet
+    [[nodiscard]] const std::optional<std::string>& pending() const;
+
+    ~directory_watcher();
+
+private:
+
+    bool _matches(const std::string& name) const;
+    void _complete(std::string path);
+    void _created(const std::string& path);
+    void _read_events();
+
+    std::string _directory, _limit_ext_start;
+    int _fd = -1;
+    std::deque<std::string> _ready;
+    std::set<std::string> _yielded;
+    std::optional<std::string> _pending;
+};
+
+#endif
@@ -0,0 +1,275 @@
+
+#include "file_decoder.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <stdexcept>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+#ifdef ZOOM_ANALYSIS_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef ZOOM_ANALYSIS_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+static const std::string GZIP_SUFFIX = ".gz";
+static const std::string ZSTD_SUFFIX = ".zst";
+
+// compressed bytes read from the file per read call
+static const std::size_t COMPRESSED_BUF_LEN = 1 << 20;
+
+static bool ends_with(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size()
+        && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+//! owns a file descriptor opened for sequential reading
+class fd_reader {
+public:
+
+    explicit fd_reader(const std::string& file_name) : _file_name(file_name) {
+
+        _fd = ::open(file_name.c_str(), O_RDONLY);
+
+        if (_fd < 0)
+            throw std::system_error(errno, std::system_category(),
+                "file_decoder: could not open " + file_name);
+
+        posix_fadvise(_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    fd_reader(const fd_reader&) = delete;
+    fd_reader& operator=(const fd_reader&) = delete;
+
+    //! reads at most len bytes, returns 0 at the end of the file
+    std::size_t read_some(unsigned char* buf, std::size_t len) {
+
+        while (true) {
+
+            auto n = ::read(_fd, buf, len);
+
+            if (n >= 0)
+                return (std::size_t) n;
+
+            if (errno != EINTR)
+                throw std::system_error(errno, std::system_category(),
+                    "file_decoder: could not read " + _file_name);
+        }
+    }
+
+    [[nodiscard]] const std::string& file_name() const {
+        return _file_name;
+    }
+
+    ~fd_reader() {
+        ::close(_fd);
+    }
+
+private:
+    std::string _file_name;
+    int _fd = -1;
+};
+
+class plain_decoder : public file_decoder {
+public:
+
+    explicit plain_decoder(const std::string& file_name) : _in(file_name) { }
+
+    std::size_t read(unsigned char* buf, std::size_t len) override {
+
+        std::size_t got = 0;
+
+        while (got < len) {
+
+            auto n = _in.read_some(buf + got, len - got);
+
+            if (n == 0)
+                break;
+
+            got += n;
+        }
+
+        return got;
+    }
+
+private:
+    fd_reader _in;
+};
+
+#ifdef ZOOM_ANALYSIS_HAVE_ZLIB
+
+class gzip_decoder : public file_decoder {
+public:
+
+    explicit gzip_decoder(const std::string& file_name)
+        : _in(file_name), _in_buf(COMPRESSED_BUF_LEN) {
+
+        // 32: detect gzip or zlib header automatically
+        if (inflateInit2(&_zs, 15 + 32) != Z_OK)
+            throw std::runtime_error("file_decoder: could not initialize zlib");
+    }
+
+    std::size_t read(unsigned char* buf, std::size_t len) override {
+
+        std::size_t got = 0;
+
+        while (got < len && !_done) {
+
+            if (_zs.avail_in == 0) {
+
+                auto n = _in.read_some(_in_buf.data(), _in_buf.size());
+
+                if (n == 0) {
+
+                    if (_in_member)
+                        throw std::runtime_error("file_decoder: truncated gzip file "
+                            + _in.file_name());
+
+                    _done = true;
+                    break;
+                }
+
+                _zs.next_in = _in_buf.data();
+                _zs.avail_in = (uInt) n;
+            }
+
+            _zs.next_out = buf + got;
+            _zs.avail_out = (uInt) std::min<std::size_t>(len - got, UINT_MAX);
+
+            auto ret = inflate(&_zs, Z_NO_FLUSH);
+            got = (std::size_t) (_zs.next_out - buf);
+
+            if (ret == Z_STREAM_END) { // concatenated members are decompressed as one stream
+                _in_member = false;
+                inflateReset(&_zs);
+            } else if (ret == Z_OK) {
+                _in_member = true;
+            } else if (ret != Z_BUF_ERROR) {
+                throw std::runtime_error("file_decoder: corrupt gzip file " + _in.file_name());
+            }
+        }
+
+        return got;
+    }
+
+    ~gzip_decoder() override {
+        inflateEnd(&_zs);
+    }
+
+private:
+    fd_reader _in;
+    std::vector<unsigned char> _in_buf;
+    z_stream _zs = {};
+    bool _in_member = false, _done = false;
+};
+
+#endif
+
+#ifdef ZOOM_ANALYSIS_HAVE_ZSTD
+
+class zstd_decoder : public file_decoder {
+public:
+
+    explicit zstd_decoder(const std::string& file_name)
+        : _in(file_name), _in_buf(ZSTD_DStreamInSize()), _ds(ZSTD_createDStream()) {
+
+        if (!_ds || ZSTD_isError(ZSTD_initDStream(_ds)))
+            throw std::runtime_error("file_decoder: could not initialize zstd");
+    }
+
+    std::size_t read(unsigned char* buf, std::size_t len) override {
+
+        ZSTD_outBuffer out = { buf, len, 0 };
+
+        while (out.pos < len && !_done) {
+
+            if (_zin.pos == _zin.size) {
+
+                auto n = _in.read_some(_in_buf.data(), _in_buf.size());
+
+                if (n == 0) {
+
+                    if (_in_frame)
+                        throw std::runtime_error("file_decoder: truncated zstd file "
+                            + _in.file_name());
+
+                    _done = true;
+                    break;
+                }
+
+                _zin = { _in_buf.data(), n, 0 };
+            }
+
+            auto ret = ZSTD_decompressStream(_ds, &out, &_zin);
+
+            if (ZSTD_isError(ret))
+                throw std::runtime_error("file_decoder: corrupt zstd file " + _in.file_name()
+                    + ": " + ZSTD_getErrorName(ret));
+
+            _in_frame = ret != 0; // 0 when a frame is complete and fully flushed
+        }
+
+        return out.pos;
+    }
+
+    ~zstd_decoder() override {
+        ZSTD_freeDStream(_ds);
+    }
+
+private:
+    fd_reader _in;
+    std::vector<unsigned char> _in_buf;
+    ZSTD_DStream* _ds = nullptr;
+    ZSTD_inBuffer _zin = { nullptr, 0, 0 };
+    bool _in_frame = false, _done = false;
+};
+
+#endif
+
+file_decoder::compression file_decoder::compression_from_name(const std::string& file_name) {
+
+    if (ends_with(file_name, GZIP_SUFFIX))
+        return compression::gzip;
+    else if (ends_with(file_name, ZSTD_SUFFIX))
+        return compression::zstd;
+    else
+        return compression::none;
+}
+
+std::string file_decoder::strip_compressed_suffix(const std::string& file_name) {
+
+    switch (compression_from_name(file_name)) {
+        case compression::gzip: return file_name.substr(0, file_name.size() - GZIP_SUFFIX.size());
+        case compression::zstd: return file_name.substr(0, file_name.size() - ZSTD_SUFFIX.size());
+        default:                return file_name;
+    }
+}
+
+std::unique_ptr<file_decoder> file_decoder::open(const std::string& file_name) {
+
+    switch (compression_from_name(file_name)) {
+
+        case compression::gzip:
+#ifdef ZOOM_ANALYSIS_HAVE_ZLIB
+            return std::make_unique<gzip_decoder>(file_name);
+#else
+            throw std::runtime_error("file_decoder: built without zlib, cannot read " + file_name);
+#endif
+
+        case compression::zstd:
+#ifdef ZOOM_ANALYSIS_HAVE_ZSTD
+            return std::make_unique<zstd_decoder>(file_name);
+#else
+            throw std::runtime_error("file_decoder: built without zstd, cannot read " + file_name);
+#endif
+
+        default:
+            return std::make_unique<plain_decoder>(file_name);
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef ZOOM_ANALYSIS_FILE_DECODER_H
+#define ZOOM_ANALYSIS_FILE_DECODER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+//! reads a file sequentially, decompressing it on the fly if its name ends in a compressed suffix
+//! - .gz requires zlib, .zst requires libzstd at build time (ZOOM_ANALYSIS_HAVE_ZLIB/_ZSTD)
+class file_decoder {
+public:
+
+    enum class compression : unsigned {
+        none = 0,
+        gzip = 1,
+        zstd = 2
+    };
+
+    //! returns the compression of a file based on its suffix
+    static compression compression_from_name(const std::string& file_name);
+
+    //! returns the file name without a compressed suffix, e.g., trace.pcap2 for trace.pcap2.zst
+    static std::string strip_compressed_suffix(const std::string& file_name);
+
+    //! opens a file, throws std::runtime_error if it cannot be opened or the compression of the
+    //! file is not supported by this build
+    static std::unique_ptr<file_decoder> open(const std::string& file_name);
+
+    file_decoder() = default;
+    file_decoder(const file_decoder&) = delete;
+    file_decoder& operator=(const file_decoder&) = delete;
+
+    //! reads up to len (decompressed) bytes into buf, returns less than len only at the end of file
+    //! - throws std::runtime_error on read errors and corrupt compressed data
+    virtual std::size_t read(unsigned char* buf, std::size_t len) = 0;
+
+    virtual ~file_decoder() = default;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef ZOOM_ANALYSIS_FILE_ROTATION_H
+#define ZOOM_ANALYSIS_FILE_ROTATION_H
+
+#include <chrono>
+#include <string>
+
+//! when a writer closes its file and continues with the next file of a sequence
+//! - the files are named by appending 0, 1, ... to the output's file name (e.g., out.pcap0,
+//!   out.pcap1, ...), the order util::compare_file_ext_seq sorts them in
+//! - a file is never rotated before its first record, so that records larger than max_bytes
+//!   are written, too
+struct file_rotation {
+    unsigned long long max_bytes = 0;  // per file, 0 for no limit
+    std::chrono::seconds interval {0}; // wall-clock time per file, 0 for no limit
+
+    [[nodiscard]] bool enabled() const {
+        return max_bytes > 0 || interval.count() > 0;
+    }
+
+    //! returns true if a file opened at start, holding file_bytes bytes and records (if
+    //! has_records), is to be closed before writing len bytes more
+    [[nodiscard]] bool due(std::chrono::steady_clock::time_point start,
+                           unsigned long long file_bytes, std::size_t len,
+                           bool has_records) const {
+
+        if (!has_records)
+            return false;
+
+        if (max_bytes > 0 && file_bytes + len > max_bytes)
+            return true;
+
+        return interval.count() > 0 && std::chrono::steady_clock::now() - start >= interval;
+    }
+
+    //! returns the name of file seq of the output file_name
+    static std::string file_name(const std::string& file_name, unsigned seq) {
+        return file_name + std::to_string(seq);
+    }
+};
+
+#endif
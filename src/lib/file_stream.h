@@ -27,6 +27,11 @@ public:
             throw std::runtime_error("file_stream: could not open " + file_name);
     }
 
+    //! writes buffered data to the underlying file
+    void flush() {
+        _stream.flush();
+    }
+
     //! closes the underlying file
     virtual void close() {
         _stream.close();
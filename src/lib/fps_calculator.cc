@@ -2,18 +2,17 @@
 #include "fps_calculator.h"
 
 #include <stdexcept>
-#include "pcap_util.h"
 
 fps_calculator::fps_calculator(std::size_t ring_len)
     : _frames(ring_len) { }
 
-unsigned fps_calculator::add_frame(const timeval& ts) {
+unsigned fps_calculator::add_frame(timestamp_ns ts) {
 
     if (!_frames.push(ts)) {
         throw std::runtime_error("too many frames");
     }
 
-    while (!_frames.empty() && (ts - _frames.peek()) >= timeval{1, 0}) {
+    while (!_frames.empty() && ts - _frames.peek() >= timestamp::NS_PER_SEC) {
         _frames.pop();
     }
 
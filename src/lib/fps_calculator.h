@@ -5,6 +5,7 @@
 #include <cstdlib>
 
 #include "ring_buffer.h"
+#include "timestamp.h"
 
 class fps_calculator {
 
@@ -14,12 +15,12 @@ public:
     fps_calculator& operator=(const fps_calculator& copy_from) = default;
 
     explicit fps_calculator(std::size_t ring_len = 64);
-    [[nodiscard]] unsigned add_frame(const timeval& ts);
+    [[nodiscard]] unsigned add_frame(timestamp_ns ts);
 
     virtual ~fps_calculator() = default;
 
 private:
-    ring_buffer<timeval> _frames;
+    ring_buffer<timestamp_ns> _frames;
 };
 
 #endif
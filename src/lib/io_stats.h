@@ -0,0 +1,57 @@
+#ifndef ZOOM_ANALYSIS_IO_STATS_H
+#define ZOOM_ANALYSIS_IO_STATS_H
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+//! bytes and packets read by a reader, and how the time divides into reading and consuming them
+//! - read_time: within the reader's read calls, i.e., blocked on the disk, waiting for a background
+//!   thread (stall_time), or parsing records
+//! - consumer_time: between read calls, i.e., processing the packets read
+//! - a run is disk-bound if read_time dominates and stall_time is a large part of it, CPU-bound
+//!   if consumer_time dominates
+struct io_stats {
+    unsigned long long byte_count = 0;
+    unsigned long pkt_count       = 0;
+    double total_time             = 0; // seconds from the first read call until done (or now)
+    double read_time              = 0; // seconds
+    double stall_time             = 0; // seconds, part of read_time
+
+    [[nodiscard]] double consumer_time() const {
+        return std::max(total_time - read_time, 0.0);
+    }
+
+    //! returns the throughput over total_time
+    [[nodiscard]] double mbytes_per_sec() const {
+        return total_time > 0 ? ((double) byte_count / 1e6) / total_time : 0.0;
+    }
+
+    //! returns the throughput of the reader alone, over read_time
+    [[nodiscard]] double read_mbytes_per_sec() const {
+        return read_time > 0 ? ((double) byte_count / 1e6) / read_time : 0.0;
+    }
+
+    //! adds the counters of a reader that ran after this one
+    void add(const io_stats& other) {
+        byte_count += other.byte_count;
+        pkt_count += other.pkt_count;
+        total_time += other.total_time;
+        read_time += other.read_time;
+        stall_time += other.stall_time;
+    }
+
+    //! returns a one-line summary, e.g., for progress lines
+    [[nodiscard]] std::string to_str() const {
+
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3) << pkt_count << " pkts, "
+           << (double) byte_count / 1e6 << " MB in " << total_time << " s ("
+           << mbytes_per_sec() << " MB/s), read " << read_time << " s (" << read_mbytes_per_sec()
+           << " MB/s, stall " << stall_time << " s), consumer " << consumer_time() << " s";
+        return ss.str();
+    }
+};
+
+#endif
@@ -0,0 +1,358 @@
+
+#include "io_uring_chunk_source.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <system_error>
+#include <unistd.h>
+
+//! minimal io_uring setup without liburing: one submission and one completion queue
+struct io_uring_chunk_source::ring {
+
+    explicit ring(unsigned entries) {
+
+        io_uring_params params = {};
+        fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+
+        if (fd < 0)
+            throw std::system_error(errno, std::system_category(),
+                "io_uring_chunk_source: io_uring not available");
+
+        sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_len = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        sqes_len = params.sq_entries * sizeof(io_uring_sqe);
+
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+            sq_len = cq_len = std::max(sq_len, cq_len);
+
+        sq_ptr = _map(sq_len, IORING_OFF_SQ_RING);
+        cq_ptr = params.features & IORING_FEAT_SINGLE_MMAP
+            ? sq_ptr : _map(cq_len, IORING_OFF_CQ_RING);
+        sqes = (io_uring_sqe*) _map(sqes_len, IORING_OFF_SQES);
+
+        auto sq = (unsigned char*) sq_ptr, cq = (unsigned char*) cq_ptr;
+
+        sq_tail  = (unsigned*) (sq + params.sq_off.tail);
+        sq_mask  = (unsigned*) (sq + params.sq_off.ring_mask);
+        sq_array = (unsigned*) (sq + params.sq_off.array);
+        cq_head  = (unsigned*) (cq + params.cq_off.head);
+        cq_tail  = (unsigned*) (cq + params.cq_off.tail);
+        cq_mask  = (unsigned*) (cq + params.cq_off.ring_mask);
+        cqes     = (io_uring_cqe*) (cq + params.cq_off.cqes);
+    }
+
+    ring(const ring&) = delete;
+    ring& operator=(const ring&) = delete;
+
+    ~ring() {
+        _release();
+    }
+
+    //! queues a read, the caller guarantees that there is room in the submission queue
+    void prep_read(int file_fd, unsigned char* buf, unsigned len, std::uint64_t offset,
+                   std::uint64_t user_data) {
+
+        unsigned tail = *sq_tail;
+        unsigned idx = tail & *sq_mask;
+        io_uring_sqe* sqe = &sqes[idx];
+
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = file_fd;
+        sqe->addr = (std::uint64_t) buf;
+        sqe->len = len;
+        sqe->off = offset;
+        sqe->user_data = user_data;
+
+        sq_array[idx] = idx;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        to_submit++;
+    }
+
+    //! submits queued reads and waits for at least min_complete completions
+    void enter(unsigned min_complete) {
+
+        unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+
+        if (to_submit == 0 && min_complete == 0)
+            return;
+
+        while (true) {
+
+            auto ret = syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+
+            if (ret < 0 && errno == EINTR)
+                continue;
+
+            if (ret < 0)
+                throw std::system_error(errno, std::system_category(),
+                    "io_uring_chunk_source: io_uring_enter failed");
+
+            to_submit -= (unsigned) ret;
+            return;
+        }
+    }
+
+    //! calls f on all available completions
+    template<typename F>
+    void reap(F f) {
+
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail; head++)
+            f(cqes[head & *cq_mask]);
+
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    int fd = -1;
+    void* sq_ptr = nullptr;
+    void* cq_ptr = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    std::size_t sq_len = 0, cq_len = 0, sqes_len = 0;
+    unsigned *sq_tail = nullptr, *sq_mask = nullptr, *sq_array = nullptr;
+    unsigned *cq_head = nullptr, *cq_tail = nullptr, *cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned to_submit = 0;
+
+private:
+
+    void* _map(std::size_t len, std::uint64_t offset) {
+
+        void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+            (off_t) offset);
+
+        if (p == MAP_FAILED) {
+            auto err = errno;
+            _release();
+            throw std::system_error(err, std::system_category(),
+                "io_uring_chunk_source: could not map ring");
+        }
+
+        return p;
+    }
+
+    void _release() {
+
+        if (sqes)
+            munmap(sqes, sqes_len);
+
+        if (cq_ptr && cq_ptr != sq_ptr)
+            munmap(cq_ptr, cq_len);
+
+        if (sq_ptr)
+            munmap(sq_ptr, sq_len);
+
+        if (fd >= 0)
+            ::close(fd);
+
+        sqes = nullptr, cq_ptr = sq_ptr = nullptr, fd = -1;
+    }
+};
+
+io_uring_chunk_source::io_uring_chunk_source(const std::vector<std::string>& file_names,
+    std::size_t buf_len, unsigned buf_count)
+    : _file_names(file_names),
+      _fds(file_names.size(), -1),
+      _file_sizes(file_names.size(), 0),
+      _buf_len((buf_len + BUF_ALIGN - 1) / BUF_ALIGN * BUF_ALIGN),
+      _slots(buf_count) {
+
+    if (buf_count < 2)
+        throw std::invalid_argument("io_uring_chunk_source: need at least two buffers");
+
+    if (_buf_len > (1u << 30))
+        throw std::invalid_argument("io_uring_chunk_source: buffers larger than 1 GiB");
+
+    for (auto& slot : _slots) {
+
+        slot.buf.reset((unsigned char*) std::aligned_alloc(BUF_ALIGN, _buf_len));
+
+        if (!slot.buf)
+            throw std::bad_alloc();
+    }
+
+    _ring = std::make_unique<ring>(buf_count);
+}
+
+bool io_uring_chunk_source::next(chunk& c) {
+
+    if (!_started) { // reads are only issued here so that errors surface from next()
+
+        _started = true;
+
+        for (unsigned idx = 0; idx < _slots.size() && _plan(_slots[idx]); idx++) {
+            if (!_slots[idx].done)
+                _submit(idx);
+        }
+
+    } else if (_holding) { // reuse the buffer of the previous chunk for the next read
+
+        auto& prev = _slots[_consume_idx];
+        prev.active = false;
+
+        if (_plan(prev) && !prev.done)
+            _submit(_consume_idx);
+
+        _consume_idx = (_consume_idx + 1) % _slots.size();
+        _holding = false;
+    }
+
+    _ring->enter(0);
+
+    auto& s = _slots[_consume_idx];
+
+    if (!s.active)
+        return false;
+
+    while (!s.done)
+        _wait();
+
+    if (s.file_start)
+        _close_files_before(s.file);
+
+    c = { .buf = s.buf.get(), .len = s.got, .file = s.file, .file_start = s.file_start };
+    _holding = true;
+    return true;
+}
+
+double io_uring_chunk_source::stall_time() const {
+
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(_stall_time);
+    return (double) duration.count() / 1000000;
+}
+
+io_uring_chunk_source::~io_uring_chunk_source() {
+
+    // the kernel may still write into the buffers, so wait for all reads before freeing them
+    try {
+        while (_in_flight > 0) {
+            _ring->enter(1);
+            _ring->reap([this](const io_uring_cqe&) { _in_flight--; });
+        }
+    } catch (const std::system_error&) {
+        // nothing sensible left to do, closing the ring cancels remaining reads
+    }
+
+    _close_files_before((unsigned) _file_names.size());
+}
+
+bool io_uring_chunk_source::_plan(slot& s) {
+
+    while (_plan_file < _file_names.size()) {
+
+        if (_plan_offset == 0 && _fds[_plan_file] < 0) {
+
+            int fd = ::open(_file_names[_plan_file].c_str(), O_RDONLY);
+            struct stat st = {};
+
+            if (fd < 0 || fstat(fd, &st) < 0) {
+                auto err = errno;
+
+                if (fd >= 0)
+                    ::close(fd);
+
+                throw std::system_error(err, std::system_category(),
+                    "io_uring_chunk_source: could not open " + _file_names[_plan_file]);
+            }
+
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            _fds[_plan_file] = fd;
+            _file_sizes[_plan_file] = (std::uint64_t) st.st_size;
+        }
+
+        auto size = _file_sizes[_plan_file];
+
+        if (_plan_offset < size || size == 0) {
+
+            s.file = _plan_file;
+            s.offset = _plan_offset;
+            s.len = (std::size_t) std::min<std::uint64_t>(_buf_len, size - _plan_offset);
+            s.got = 0;
+            s.file_start = _plan_offset == 0;
+            s.active = true;
+            s.done = s.len == 0; // empty files are delivered as a single empty chunk
+
+            _plan_offset += s.len;
+
+            if (_plan_offset == size) {
+                _plan_file++;
+                _plan_offset = 0;
+            }
+
+            return true;
+        }
+
+        _plan_file++;
+        _plan_offset = 0;
+    }
+
+    return false;
+}
+
+void io_uring_chunk_source::_submit(unsigned idx) {
+
+    auto& s = _slots[idx];
+
+    _ring->prep_read(_fds[s.file], s.buf.get() + s.got, (unsigned) (s.len - s.got),
+        s.offset + s.got, idx);
+
+    _in_flight++;
+}
+
+void io_uring_chunk_source::_wait() {
+
+    auto start = std::chrono::high_resolution_clock::now();
+    _ring->enter(1);
+    _stall_time += std::chrono::high_resolution_clock::now() - start;
+
+    int error = 0;
+    unsigned error_file = 0;
+
+    _ring->reap([&](const io_uring_cqe& cqe) {
+
+        auto idx = (unsigned) cqe.user_data;
+        auto& s = _slots[idx];
+
+        _in_flight--;
+
+        if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+            _submit(idx);
+        } else if (cqe.res < 0) {
+            error = -cqe.res, error_file = s.file;
+            s.done = true;
+        } else if (cqe.res == 0) { // the file shrank since it was opened
+            s.done = true;
+        } else {
+            s.got += (std::size_t) cqe.res;
+
+            if (s.got < s.len) {
+                _submit(idx); // short read
+            } else {
+                s.done = true;
+            }
+        }
+    });
+
+    if (error)
+        throw std::system_error(error, std::system_category(),
+            "io_uring_chunk_source: could not read " + _file_names[error_file]);
+}
+
+void io_uring_chunk_source::_close_files_before(unsigned file) {
+
+    for (unsigned i = 0; i < file && i < _fds.size(); i++) {
+        if (_fds[i] >= 0) {
+            ::close(_fds[i]);
+            _fds[i] = -1;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef ZOOM_ANALYSIS_IO_URING_CHUNK_SOURCE_H
+#define ZOOM_ANALYSIS_IO_URING_CHUNK_SOURCE_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+
+#include "chunk_source.h"
+
+//! reads files through io_uring, keeping several large reads in flight at once
+//! - reads are issued in file order and continue into the following files, so that the
+//!   beginning of the next file is already in flight while the current one is parsed
+//! - chunks are delivered in order regardless of the order in which reads complete
+//! - throws std::system_error from the constructor if the kernel does not support io_uring
+class io_uring_chunk_source : public chunk_source {
+public:
+
+    static const std::size_t DEFAULT_BUF_LEN   = 4 << 20;
+    static const unsigned    DEFAULT_BUF_COUNT = 8;
+
+    explicit io_uring_chunk_source(const std::vector<std::string>& file_names,
+                                   std::size_t buf_len = DEFAULT_BUF_LEN,
+                                   unsigned buf_count = DEFAULT_BUF_COUNT);
+
+    bool next(chunk& c) override;
+    [[nodiscard]] double stall_time() const override;
+
+    //! waits for reads still in flight and closes all files
+    ~io_uring_chunk_source() override;
+
+private:
+
+    static const std::size_t BUF_ALIGN = 4096;
+
+    struct ring;
+
+    struct free_deleter {
+        void operator()(unsigned char* p) const {
+            std::free(p);
+        }
+    };
+
+    struct slot {
+        std::unique_ptr<unsigned char, free_deleter> buf;
+        unsigned file         = 0;
+        std::uint64_t offset  = 0;
+        std::size_t len = 0, got = 0;
+        bool file_start       = false;
+        bool active           = false; // holds a planned read that was not consumed yet
+        bool done             = false; // the read completed
+    };
+
+    bool _plan(slot& s);
+    void _submit(unsigned idx);
+    void _wait();
+    void _close_files_before(unsigned file);
+
+    std::vector<std::string> _file_names;
+    std::vector<int> _fds;
+    std::vector<std::uint64_t> _file_sizes;
+    std::size_t _buf_len;
+    std::vector<slot> _slots;
+    std::unique_ptr<ring> _ring;
+    unsigned _consume_idx = 0, _in_flight = 0, _plan_file = 0;
+    std::uint64_t _plan_offset = 0;
+    bool _started = false, _holding = false;
+    std::chrono::high_resolution_clock::duration _stall_time = {};
+};
+
+#endif
@@ -0,0 +1,440 @@
+#include "ipfix_exporter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <netdb.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <system_error>
+#include <unistd.h>
+
+ipfix_exporter::collector ipfix_exporter::collector::parse(const std::string& s) {
+
+    collector c;
+    auto rest = s;
+    auto scheme_end = rest.find("://");
+
+    if (scheme_end != std::string::npos) {
+
+        auto scheme = rest.substr(0, scheme_end);
+
+        if (scheme == "udp") {
+            c.proto = transport::udp;
+        } else if (scheme == "tcp") {
+            c.proto = transport::tcp;
+        } else {
+            throw std::invalid_argument("ipfix_exporter: unknown transport " + scheme);
+        }
+
+        rest = rest.substr(scheme_end + 3);
+    }
+
+    std::string port;
+
+    if (!rest.empty() && rest[0] == '[') {
+
+        auto host_end = rest.find(']');
+
+        if (host_end == std::string::npos
+            || (host_end + 1 < rest.size() && rest[host_end + 1] != ':'))
+            throw std::invalid_argument("ipfix_exporter: invalid collector " + s);
+
+        c.host = rest.substr(1, host_end - 1);
+        port = host_end + 1 < rest.size() ? rest.substr(host_end + 2) : "";
+
+    } else if (std::count(rest.begin(), rest.end(), ':') == 1) {
+        c.host = rest.substr(0, rest.find(':'));
+        port = rest.substr(rest.find(':') + 1);
+    } else {
+        // a host name, an IPv4 address, or an IPv6 address without port
+        c.host = rest;
+    }
+
+    if (c.host.empty())
+        throw std::invalid_argument("ipfix_exporter: collector without host " + s);
+
+    if (!port.empty()) {
+
+        std::size_t end = 0;
+        unsigned long p = 0;
+
+        try {
+            p = std::stoul(port, &end);
+        } catch (const std::logic_error&) {
+            end = 0;
+        }
+
+        if (end != port.size() || p == 0 || p > 65535)
+            throw std::invalid_argument("ipfix_exporter: invalid port " + port);
+
+        c.port = (std::uint16_t) p;
+    }
+
+    return c;
+}
+
+std::string ipfix_exporter::collector::to_str() const {
+
+    auto h = host.find(':') != std::string::npos ? "[" + host + "]" : host;
+    return (proto == transport::tcp ? "tcp://" : "udp://") + h + ":" + std::to_string(port);
+}
+
+ipfix_exporter::ipfix_exporter(const collector& collector, std::uint32_t domain_id)
+    : _collector(collector), _domain_id(domain_id) {
+
+    _msg.reserve(max_msg_len());
+    _connect();
+}
+
+void ipfix_exporter::add_template(std::uint16_t id, const std::vector<field>& fields) {
+
+    if (id < MIN_TEMPLATE_ID || fields.empty())
+        throw std::invalid_argument("ipfix_exporter: invalid template " + std::to_string(id));
+
+    // the records collected so far are sent without the new template
+    flush();
+
+    _template t;
+    t.id = id;
+
+    auto put16 = [&t](std::uint16_t v) {
+        t.encoded.push_back((unsigned char) (v >> 8));
+        t.encoded.push_back((unsigned char) v);
+    };
+
+    put16(id);
+    put16((std::uint16_t) fields.size());
+
+    for (const auto& f : fields) {
+
+        put16(f.enterprise ? (std::uint16_t) (f.id | 0x8000) : f.id);
+        put16(f.len);
+
+        if (f.enterprise) {
+            put16((std::uint16_t) (f.enterprise >> 16));
+            put16((std::uint16_t) f.enterprise);
+        }
+
+        t.record_len += f.len;
+    }
+
+    auto it = std::find_if(_templates.begin(), _templates.end(),
+                           [id](const auto& other) { return other.id == id; });
+
+    if (it != _templates.end())
+        *it = std::move(t);
+    else
+        _templates.push_back(std::move(t));
+
+    _templates_due = true;
+}
+
+ipfix_exporter& ipfix_exporter::record(std::uint16_t template_id) {
+
+    _check_record();
+
+    _record_end = 0;
+
+    const auto& t = _find_template(template_id);
+    auto len = t.record_len + (_set_id != template_id ? SET_HDR_LEN : 0);
+
+    if (!_msg.empty() && _msg.size() + len > max_msg_len())
+        flush();
+
+    if (_msg.empty())
+        _start_msg();
+
+    if (_set_id != template_id) {
+
+        _end_set();
+
+        _set_start = _msg.size();
+        _set_id = template_id;
+        _put(template_id, 2);
+        _put(0, 2);
+    }
+
+    _record_end = _msg.size() + t.record_len;
+    _msg_records++;
+
+    return *this;
+}
+
+ipfix_exporter& ipfix_exporter::u8(std::uint8_t v) {
+    _put(v, 1);
+    return *this;
+}
+
+ipfix_exporter& ipfix_exporter::u16(std::uint16_t v) {
+    _put(v, 2);
+    return *this;
+}
+
+ipfix_exporter& ipfix_exporter::u32(std::uint32_t v) {
+    _put(v, 4);
+    return *this;
+}
+
+ipfix_exporter& ipfix_exporter::u64(std::uint64_t v) {
+    _put(v, 8);
+    return *this;
+}
+
+void ipfix_exporter::flush() {
+
+    _check_record();
+
+    if (_msg.empty())
+        return;
+
+    _end_set();
+    _put_hdr(_msg);
+    _send();
+
+    _seq += _msg_records;
+    _msg.clear();
+    _msg_records = 0;
+    _record_end = 0;
+}
+
+std::size_t ipfix_exporter::max_msg_len() const {
+    return _collector.proto == transport::udp ? UDP_MSG_LEN : TCP_MSG_LEN;
+}
+
+std::uint64_t ipfix_exporter::record_count() const {
+    return _record_count;
+}
+
+std::uint64_t ipfix_exporter::msg_count() const {
+    return _msg_count;
+}
+
+std::uint64_t ipfix_exporter::error_count() const {
+    return _error_count;
+}
+
+ipfix_exporter::~ipfix_exporter() {
+
+    try {
+        flush();
+    } catch (const std::exception&) {
+        // records left incomplete are dropped
+    }
+
+    if (_fd >= 0)
+        ::close(_fd);
+}
+
+void ipfix_exporter::_connect() {
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = _collector.proto == transport::udp ? SOCK_DGRAM : SOCK_STREAM;
+
+    addrinfo* addrs = nullptr;
+    auto rc = getaddrinfo(_collector.host.c_str(), std::to_string(_collector.port).c_str(),
+                          &hints, &addrs);
+
+    if (rc != 0)
+        throw std::runtime_error("ipfix_exporter: could not resolve " + _collector.host + ": "
+                                 + gai_strerror(rc));
+
+    int err = 0;
+
+    for (auto* a = addrs; a && _fd < 0; a = a->ai_next) {
+
+        int fd = socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+
+        if (fd < 0) {
+            err = errno;
+            continue;
+        }
+
+        if (connect(fd, a->ai_addr, a->ai_addrlen) < 0) {
+            err = errno;
+            ::close(fd);
+            continue;
+        }
+
+        _fd = fd;
+    }
+
+    freeaddrinfo(addrs);
+
+    if (_fd < 0)
+        throw std::system_error(err, std::system_category(), "ipfix_exporter: could not connect "
+            "to " + _collector.to_str());
+
+    _templates_due = true;
+}
+
+void ipfix_exporter::_start_msg() {
+
+    auto now = std::chrono::steady_clock::now();
+
+    _msg.assign(HDR_LEN, 0);
+    _msg_templates = false;
+
+    if (_collector.proto == transport::udp
+        && now - _templates_sent >= std::chrono::seconds(TEMPLATE_REFRESH_S))
+        _templates_due = true;
+
+    if (!_templates_due || _templates.empty())
+        return;
+
+    _put_templates(_msg);
+
+    _msg_templates = true;
+    _templates_due = false;
+    _templates_sent = now;
+}
+
+void ipfix_exporter::_put_templates(std::vector<unsigned char>& msg) const {
+
+    auto set_start = msg.size();
+    msg.insert(msg.end(), { 0, TEMPLATE_SET_ID, 0, 0 });
+
+    for (const auto& t : _templates)
+        msg.insert(msg.end(), t.encoded.begin(), t.encoded.end());
+
+    auto set_len = msg.size() - set_start;
+    msg[set_start + 2] = (unsigned char) (set_len >> 8);
+    msg[set_start + 3] = (unsigned char) set_len;
+}
+
+void ipfix_exporter::_put_hdr(std::vector<unsigned char>& msg) const {
+
+    auto export_time = (std::uint32_t) std::time(nullptr);
+    std::uint32_t hdr[] = { VERSION, (std::uint32_t) msg.size(), export_time, _seq, _domain_id };
+    unsigned lens[] = { 2, 2, 4, 4, 4 };
+    std::size_t pos = 0;
+
+    for (std::size_t i = 0; i < 5; i++) {
+        for (unsigned b = 0; b < lens[i]; b++)
+            msg[pos++] = (unsigned char) (hdr[i] >> (8 * (lens[i] - 1 - b)));
+    }
+}
+
+void ipfix_exporter::_end_set() {
+
+    if (_set_start) {
+        auto set_len = _msg.size() - _set_start;
+        _msg[_set_start + 2] = (unsigned char) (set_len >> 8);
+        _msg[_set_start + 3] = (unsigned char) set_len;
+    }
+
+    _set_start = 0;
+    _set_id = 0;
+}
+
+void ipfix_exporter::_send() {
+
+    auto now = std::chrono::steady_clock::now();
+    bool connected = _fd >= 0;
+
+    if (!connected && now >= _reconnect_at) {
+        try {
+            _connect();
+            connected = true;
+        } catch (const std::runtime_error&) {
+            _reconnect_at = now + std::chrono::seconds(RECONNECT_S);
+        }
+    }
+
+    // a message started while disconnected lacks the templates the new connection needs, which
+    // are sent in a message of their own before it
+    if (connected && _templates_due && !_msg_templates && !_templates.empty()) {
+
+        std::vector<unsigned char> msg(HDR_LEN, 0);
+        _put_templates(msg);
+        _put_hdr(msg);
+
+        connected = _write(msg);
+
+        if (connected) {
+            _msg_count++;
+            _templates_due = false;
+            _templates_sent = now;
+        }
+    }
+
+    bool sent = connected && _write(_msg);
+
+    if (sent) {
+        _msg_count++;
+        _record_count += _msg_records;
+        return;
+    }
+
+    _error_count++;
+
+    // a stream cut off within a message cannot be continued, and the templates of a message
+    // dropped must be sent again on the next connection
+    if (_collector.proto == transport::tcp) {
+
+        _templates_due = true;
+
+        if (_fd >= 0) {
+            ::close(_fd);
+            _fd = -1;
+            _reconnect_at = now;
+        }
+    }
+}
+
+bool ipfix_exporter::_write(const std::vector<unsigned char>& msg) const {
+
+    if (_collector.proto == transport::udp) {
+
+        ssize_t n;
+
+        do {
+            n = ::send(_fd, msg.data(), msg.size(), MSG_NOSIGNAL);
+        } while (n < 0 && errno == EINTR);
+
+        return n == (ssize_t) msg.size();
+    }
+
+    std::size_t len = 0;
+
+    while (len < msg.size()) {
+
+        auto n = ::send(_fd, msg.data() + len, msg.size() - len, MSG_NOSIGNAL);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            break;
+
+        len += (std::size_t) n;
+    }
+
+    return len == msg.size();
+}
+
+void ipfix_exporter::_check_record() {
+
+    if (_record_end && _msg.size() != _record_end)
+        throw std::logic_error("ipfix_exporter: record is shorter than its template");
+}
+
+const ipfix_exporter::_template& ipfix_exporter::_find_template(std::uint16_t id) const {
+
+    for (const auto& t : _templates) {
+        if (t.id == id)
+            return t;
+    }
+
+    throw std::logic_error("ipfix_exporter: unknown template " + std::to_string(id));
+}
+
+void ipfix_exporter::_put(std::uint64_t v, unsigned len) {
+
+    if (_record_end && _msg.size() + len > _record_end)
+        throw std::logic_error("ipfix_exporter: record is longer than its template");
+
+    for (unsigned b = 0; b < len; b++)
+        _msg.push_back((unsigned char) (v >> (8 * (len - 1 - b))));
+}
@@ -0,0 +1,126 @@
+#ifndef ZOOM_ANALYSIS_IPFIX_EXPORTER_H
+#define ZOOM_ANALYSIS_IPFIX_EXPORTER_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//! sends data records to an IPFIX collector (RFC 7011) over UDP or TCP
+//! - records are collected in a message of at most max_msg_len() bytes, which is sent once the
+//!   next record does not fit and by flush()
+//! - templates are sent before the first record, over UDP again every TEMPLATE_REFRESH_S seconds
+//!   (RFC 7011, 8.4) as collectors may have missed them, and over TCP after reconnecting
+//!   (at most every RECONNECT_S seconds)
+//! - a message that cannot be sent is dropped and counted (see error_count()), so that a
+//!   collector that is down does not stop the measurement
+class ipfix_exporter {
+public:
+    static constexpr std::uint16_t DEFAULT_PORT = 4739;
+    static constexpr std::uint16_t VERSION = 10;
+    static constexpr std::size_t HDR_LEN = 16;
+    static constexpr std::size_t SET_HDR_LEN = 4;
+    static constexpr std::uint16_t TEMPLATE_SET_ID = 2;
+    static constexpr std::uint16_t MIN_TEMPLATE_ID = 256;
+    static constexpr unsigned TEMPLATE_REFRESH_S = 60;
+    static constexpr unsigned RECONNECT_S = 5;
+
+    //! messages over UDP fit into an Ethernet frame unfragmented
+    static constexpr std::size_t UDP_MSG_LEN = 1400;
+    static constexpr std::size_t TCP_MSG_LEN = 65535;
+
+    enum class transport {
+        udp,
+        tcp
+    };
+
+    struct collector {
+        transport proto = transport::udp;
+        std::string host;
+        std::uint16_t port = DEFAULT_PORT;
+
+        //! parses [udp://|tcp://]HOST[:PORT], with IPv6 addresses in brackets, e.g.,
+        //! tcp://[::1]:4739, throws std::invalid_argument upon error
+        static collector parse(const std::string& s);
+
+        [[nodiscard]] std::string to_str() const;
+    };
+
+    //! a field of a template, an information element of IANA or of an enterprise
+    struct field {
+        std::uint16_t id = 0;
+        std::uint16_t len = 0;
+        std::uint32_t enterprise = 0; // 0 for IANA's information elements
+    };
+
+    //! connects to the collector, throws std::runtime_error if its host cannot be resolved and
+    //! std::system_error if it cannot be connected to
+    explicit ipfix_exporter(const collector& collector, std::uint32_t domain_id = 0);
+
+    ipfix_exporter(const ipfix_exporter&) = delete;
+    ipfix_exporter& operator=(const ipfix_exporter&) = delete;
+
+    //! adds a template of id (at least MIN_TEMPLATE_ID) for the records following
+    void add_template(std::uint16_t id, const std::vector<field>& fields);
+
+    //! starts a record of a template, whose fields are appended in order with u8() to u64()
+    ipfix_exporter& record(std::uint16_t template_id);
+
+    ipfix_exporter& u8(std::uint8_t v);
+    ipfix_exporter& u16(std::uint16_t v);
+    ipfix_exporter& u32(std::uint32_t v);
+    ipfix_exporter& u64(std::uint64_t v);
+
+    //! sends the records collected, if any
+    void flush();
+
+    [[nodiscard]] std::size_t max_msg_len() const;
+
+    //! returns the records and messages sent and the messages dropped
+    //! - records of messages dropped count as lost in the sequence numbers the collector sees
+    [[nodiscard]] std::uint64_t record_count() const;
+    [[nodiscard]] std::uint64_t msg_count() const;
+    [[nodiscard]] std::uint64_t error_count() const;
+
+    //! sends the records collected, ignoring errors, and closes the connection
+    ~ipfix_exporter();
+
+private:
+    struct _template {
+        std::uint16_t id = 0;
+        std::size_t record_len = 0;
+        std::vector<unsigned char> encoded; // template record
+    };
+
+    void _connect();
+    void _start_msg();
+    void _end_set();
+    void _send();
+    bool _write(const std::vector<unsigned char>& msg) const;
+    void _check_record();
+    const _template& _find_template(std::uint16_t id) const;
+
+    void _put_templates(std::vector<unsigned char>& msg) const;
+    void _put_hdr(std::vector<unsigned char>& msg) const;
+    void _put(std::uint64_t v, unsigned len);
+
+    collector _collector;
+    std::uint32_t _domain_id = 0;
+    int _fd = -1;
+
+    std::vector<_template> _templates;
+    bool _templates_due = true;
+    std::chrono::steady_clock::time_point _templates_sent, _reconnect_at;
+
+    std::vector<unsigned char> _msg;     // header and sets of the message being assembled
+    bool _msg_templates = false;         // whether _msg begins with the template set
+    std::size_t _set_start = 0;          // of the data set open, 0 if none
+    std::uint16_t _set_id = 0;
+    std::size_t _record_end = 0;         // of the record being appended to
+    std::uint32_t _msg_records = 0;
+    std::uint32_t _seq = 0;              // records of the messages before, sent or dropped
+
+    std::uint64_t _record_count = 0, _msg_count = 0, _error_count = 0;
+};
+
+#endif
@@ -4,6 +4,8 @@
 #include <cstdint>
 #include <cstdlib>
 
+#include "timestamp.h"
+
 class jitter_calculator {
 
 public:
@@ -11,7 +13,7 @@ public:
     explicit jitter_calculator(unsigned sampling_rate = 90000);
 
     //! returns RTP jitter in milliseconds
-    [[nodiscard]] double add_frame(const timeval& ts, std::uint32_t rtp_ts);
+    [[nodiscard]] double add_frame(timestamp_ns ts, std::uint32_t rtp_ts);
 
     //! converts a RTP timestamp to wallclock time in milliseconds
     static inline unsigned long long rtp_ts_to_wallclock_ms(std::uint32_t rtp_ts,
@@ -19,9 +21,9 @@ public:
         return (unsigned long long) ((double) rtp_ts / (double) sampling_rate_khz * 1000);
     }
 
-    //! converts a timeval to milliseconds
-    static inline unsigned long long timeval_to_ms(timeval tv) {
-        return (unsigned long long) (((double) tv.tv_sec * 1000.0) + (tv.tv_usec / 1000.0));
+    //! converts a timestamp to milliseconds (rounded down)
+    static inline unsigned long long ts_to_ms(timestamp_ns ts) {
+        return (unsigned long long) (ts / timestamp::NS_PER_MS);
     }
 
 private:
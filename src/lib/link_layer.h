@@ -0,0 +1,283 @@
+#ifndef ZOOM_ANALYSIS_LINK_LAYER_H
+#define ZOOM_ANALYSIS_LINK_LAYER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <tuple>
+
+#include "net.h"
+#include "pcap_util.h"
+
+//! decoders of the link-layer headers in front of IPv4 packets
+//! - one decoder per pcap link type, so that the loop over the packets of a file is compiled for
+//!   a single link type and the link type is dispatched once per run of packets (see decode)
+//! - decapsulates GRE, ERSPAN and VXLAN packets of mirrored traffic (see decapsulate)
+namespace link_layer {
+
+    const std::uint16_t ETH_TYPE_VLAN = 0x8100; // 802.1Q
+    const std::uint16_t ETH_TYPE_QINQ = 0x88a8; // 802.1ad (outer tag)
+
+    const unsigned VLAN_TAG_LEN  = 4;
+    const unsigned MAX_VLAN_TAGS = 2;
+
+    const unsigned ETH_TYPE_OFFSET  = 12;
+    const unsigned SLL_HDR_LEN      = 16;
+    const unsigned SLL_ADDR_OFFSET  = 6;
+    const unsigned SLL_TYPE_OFFSET  = 14;
+    const unsigned SLL2_HDR_LEN     = 20;
+    const unsigned SLL2_ADDR_OFFSET = 12;
+
+    const std::uint8_t  IP_PROTO_GRE      = 47;
+    const std::uint16_t GRE_TYPE_TEB      = 0x6558; // transparent Ethernet bridging
+    const std::uint16_t GRE_TYPE_ERSPAN_2 = 0x88be; // ERSPAN type I (no header) and II
+    const std::uint16_t GRE_TYPE_ERSPAN_3 = 0x22eb;
+    const std::uint16_t VXLAN_PORT        = 4789;
+
+    const unsigned GRE_HDR_LEN         = 4; // without optional fields
+    const unsigned ERSPAN_2_HDR_LEN    = 8;
+    const unsigned ERSPAN_3_HDR_LEN    = 12;
+    const unsigned ERSPAN_3_SUBHDR_LEN = 8;
+    const unsigned VXLAN_HDR_LEN       = 8;
+
+    enum class tunnel_type : std::uint8_t {
+        none   = 0,
+        gre    = 1, // IPv4 or Ethernet over GRE
+        erspan = 2,
+        vxlan  = 3
+    };
+
+    inline std::string tunnel_type_string(tunnel_type type) {
+        switch (type) {
+            case tunnel_type::gre:    return "gre";
+            case tunnel_type::erspan: return "erspan";
+            case tunnel_type::vxlan:  return "vxlan";
+            default:                  return "none";
+        }
+    }
+
+    //! outer IPv4 addresses of a tunnel packet, in host byte order
+    struct tunnel_endpoints {
+        tunnel_type type = tunnel_type::none;
+        std::uint32_t ip_src = 0;
+        std::uint32_t ip_dst = 0;
+
+        inline bool operator<(const tunnel_endpoints& other) const {
+            return std::tie(type, ip_src, ip_dst)
+                < std::tie(other.type, other.ip_src, other.ip_dst);
+        }
+
+        inline bool operator==(const tunnel_endpoints& other) const {
+            return std::tie(type, ip_src, ip_dst)
+                == std::tie(other.type, other.ip_src, other.ip_dst);
+        }
+    };
+
+    //! location of the IPv4 packet within a frame
+    struct frame {
+        bool ipv4 = false;
+        unsigned ip_offset = 0;
+        //! source MAC address, nullptr if the link-layer header has none
+        //! - of the outer header for tunnel packets
+        const net::eth::addr* src_addr = nullptr;
+        //! endpoints of the tunnel the IPv4 packet was decapsulated from, if any
+        tunnel_endpoints tunnel;
+    };
+
+    inline std::uint16_t read_u16(const unsigned char* buf) {
+        return (std::uint16_t) (buf[0] << 8u | buf[1]);
+    }
+
+    //! returns the frame of a payload of the given EtherType at offset
+    //! - skips up to MAX_VLAN_TAGS 802.1Q/802.1ad tags in front of the payload
+    inline frame from_eth_type(const unsigned char* buf, unsigned cap_len, std::uint16_t type,
+                               unsigned offset, const net::eth::addr* src_addr) {
+
+        for (unsigned i = 0; i < MAX_VLAN_TAGS && (type == ETH_TYPE_VLAN || type == ETH_TYPE_QINQ)
+             && offset + VLAN_TAG_LEN <= cap_len; i++) {
+            type = read_u16(buf + offset + 2);
+            offset += VLAN_TAG_LEN;
+        }
+
+        return {
+            .ipv4 = type == (std::uint16_t) net::eth::type::ipv4
+                && offset + net::ipv4::HDR_LEN <= cap_len,
+            .ip_offset = offset,
+            .src_addr = src_addr
+        };
+    }
+
+    //! returns the frame of a tunnel packet whose outer IPv4 packet is at f.ip_offset
+    //! - the IPv4 packet is the inner one of GRE (IPv4 or Ethernet), ERSPAN type I to III, and
+    //!   VXLAN (UDP port 4789) packets, or not set if the inner packet is no IPv4 packet
+    //! - returns f unchanged for other packets, fragments, and GRE with source routing
+    inline frame decapsulate(const unsigned char* buf, unsigned cap_len, const frame& f) {
+
+        if (!f.ipv4)
+            return f;
+
+        const auto* ip = (const net::ipv4::hdr*) (buf + f.ip_offset);
+        unsigned offset = f.ip_offset + ip->ihl_bytes();
+        tunnel_type type;
+        bool inner_eth = true;
+
+        // later fragments carry no tunnel header, first fragments only a part of the inner packet
+        if ((ntohs(ip->fragment_offset) & 0x3fffu) != 0)
+            return f;
+
+        if (ip->next_proto_id == IP_PROTO_GRE && offset + GRE_HDR_LEN <= cap_len) {
+
+            std::uint8_t flags = buf[offset];
+            std::uint16_t proto = read_u16(buf + offset + 2);
+            bool seq = flags & 0x10u;
+
+            // version 0 without routing
+            if ((buf[offset + 1] & 0x07u) != 0 || (flags & 0x40u))
+                return f;
+
+            // optional checksum and reserved, key, sequence number
+            offset += GRE_HDR_LEN + 4 * ((flags >> 7u & 1u) + (flags >> 5u & 1u) + seq);
+
+            if (proto == (std::uint16_t) net::eth::type::ipv4) {
+                type = tunnel_type::gre;
+                inner_eth = false;
+            } else if (proto == GRE_TYPE_TEB) {
+                type = tunnel_type::gre;
+            } else if (proto == GRE_TYPE_ERSPAN_2) {
+                type = tunnel_type::erspan;
+                offset += seq ? ERSPAN_2_HDR_LEN : 0; // type I without sequence number and header
+            } else if (proto == GRE_TYPE_ERSPAN_3 && offset + ERSPAN_3_HDR_LEN <= cap_len) {
+                type = tunnel_type::erspan;
+                offset += ERSPAN_3_HDR_LEN
+                    + (buf[offset + ERSPAN_3_HDR_LEN - 1] & 0x01u ? ERSPAN_3_SUBHDR_LEN : 0);
+            } else {
+                return f;
+            }
+
+        } else if (ip->next_proto_id == (std::uint8_t) net::ipv4::proto::udp
+                   && offset + net::udp::HDR_LEN + VXLAN_HDR_LEN <= cap_len
+                   && read_u16(buf + offset + 2) == VXLAN_PORT) {
+
+            type = tunnel_type::vxlan;
+            offset += net::udp::HDR_LEN + VXLAN_HDR_LEN;
+
+        } else {
+            return f;
+        }
+
+        frame inner;
+
+        if (!inner_eth) {
+            inner.ipv4 = offset + net::ipv4::HDR_LEN <= cap_len && (buf[offset] >> 4u) == 4;
+            inner.ip_offset = offset;
+        } else if (offset + net::eth::HDR_LEN <= cap_len) {
+            inner = from_eth_type(buf, cap_len, read_u16(buf + offset + ETH_TYPE_OFFSET),
+                                  offset + net::eth::HDR_LEN, nullptr);
+        }
+
+        inner.src_addr = f.src_addr;
+        inner.tunnel = { type, ntohl(ip->src_addr), ntohl(ip->dst_addr) };
+        return inner;
+    }
+
+    //! decodes frames of the link type, not defined for unsupported link types
+    template<pcap_link_type link_type> struct decoder;
+
+    //! Ethernet, optionally with 802.1Q and QinQ tags
+    template<> struct decoder<pcap_link_type::eth> {
+        static frame decode(const unsigned char* buf, unsigned cap_len) {
+
+            if (cap_len < net::eth::HDR_LEN)
+                return {};
+
+            return from_eth_type(buf, cap_len, read_u16(buf + ETH_TYPE_OFFSET), net::eth::HDR_LEN,
+                                 &((const net::eth::hdr*) buf)->src_addr);
+        }
+    };
+
+    //! IPv4 or IPv6 packets without a link-layer header (DLT_RAW)
+    template<> struct decoder<pcap_link_type::raw> {
+        static frame decode(const unsigned char* buf, unsigned cap_len) {
+            return { .ipv4 = cap_len >= net::ipv4::HDR_LEN && (buf[0] >> 4u) == 4 };
+        }
+    };
+
+    //! IPv4 packets without a link-layer header
+    template<> struct decoder<pcap_link_type::ipv4> {
+        static frame decode(const unsigned char*, unsigned cap_len) {
+            return { .ipv4 = cap_len >= net::ipv4::HDR_LEN };
+        }
+    };
+
+    //! Linux "cooked" capture (e.g., tcpdump -i any)
+    //! - the address is the sender's, a source MAC address if it is 6 bytes long
+    template<> struct decoder<pcap_link_type::sll> {
+        static frame decode(const unsigned char* buf, unsigned cap_len) {
+
+            if (cap_len < SLL_HDR_LEN)
+                return {};
+
+            return from_eth_type(buf, cap_len, read_u16(buf + SLL_TYPE_OFFSET), SLL_HDR_LEN,
+                                 read_u16(buf + 4) == net::eth::ADDR_LEN
+                                 ? (const net::eth::addr*) (buf + SLL_ADDR_OFFSET) : nullptr);
+        }
+    };
+
+    //! Linux "cooked" capture v2, with the protocol first and the interface index
+    template<> struct decoder<pcap_link_type::sll2> {
+        static frame decode(const unsigned char* buf, unsigned cap_len) {
+
+            if (cap_len < SLL2_HDR_LEN)
+                return {};
+
+            return from_eth_type(buf, cap_len, read_u16(buf), SLL2_HDR_LEN,
+                                 buf[11] == net::eth::ADDR_LEN
+                                 ? (const net::eth::addr*) (buf + SLL2_ADDR_OFFSET) : nullptr);
+        }
+    };
+
+    //! calls f with the decoder of the link type, returns false for unsupported link types
+    template<typename F>
+    inline bool dispatch(pcap_link_type link_type, F&& f) {
+
+        switch (link_type) {
+            case pcap_link_type::eth:  f(decoder<pcap_link_type::eth>{});  return true;
+            case pcap_link_type::raw:  f(decoder<pcap_link_type::raw>{});  return true;
+            case pcap_link_type::ipv4: f(decoder<pcap_link_type::ipv4>{}); return true;
+            case pcap_link_type::sll:  f(decoder<pcap_link_type::sll>{});  return true;
+            case pcap_link_type::sll2: f(decoder<pcap_link_type::sll2>{}); return true;
+            default: return false;
+        }
+    }
+
+    inline bool is_supported(pcap_link_type link_type) {
+        return dispatch(link_type, [](auto) { });
+    }
+
+    //! decodes the frames of len packets into frames, decapsulating tunnel packets
+    //! - dispatches on the link type once per run of packets of the same link type, i.e., once
+    //!   per call for files of a single link type
+    //! - frames of unsupported link types carry no IPv4 packet
+    inline void decode(const pcap_pkt* pkts, std::size_t len, frame* frames) {
+
+        for (std::size_t begin = 0, end; begin < len; begin = end) {
+
+            auto link_type = pkts[begin].link_type;
+
+            for (end = begin + 1; end < len && pkts[end].link_type == link_type; end++);
+
+            bool supported = dispatch(link_type, [&](auto decoder) {
+                for (auto i = begin; i < end; i++)
+                    frames[i] = decapsulate(pkts[i].buf, pkts[i].cap_len,
+                                            decoder.decode(pkts[i].buf, pkts[i].cap_len));
+            });
+
+            if (!supported) {
+                for (auto i = begin; i < end; i++)
+                    frames[i] = {};
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,92 @@
+
+#include "mmap_file.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+
+mmap_file::mmap_file(const std::string& file_name) {
+
+    open(file_name);
+}
+
+mmap_file::mmap_file(mmap_file&& other) noexcept
+    : _data(std::exchange(other._data, nullptr)),
+      _size(std::exchange(other._size, 0)),
+      _open(std::exchange(other._open, false)) { }
+
+mmap_file& mmap_file::operator=(mmap_file&& other) noexcept {
+
+    if (this != &other) {
+        close();
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+        _open = std::exchange(other._open, false);
+    }
+
+    return *this;
+}
+
+void mmap_file::open(const std::string& file_name) {
+
+    if (_open)
+        throw std::logic_error("mmap_file: already open");
+
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+
+    if (fd < 0)
+        throw std::system_error(errno, std::system_category(), "mmap_file: could not open "
+            + file_name);
+
+    struct stat st = {};
+
+    if (fstat(fd, &st) < 0) {
+        auto err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::system_category(), "mmap_file: could not stat "
+            + file_name);
+    }
+
+    _size = (std::size_t) st.st_size;
+
+    if (_size > 0) {
+
+        void* addr = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (addr == MAP_FAILED) {
+            auto err = errno;
+            ::close(fd);
+            _size = 0;
+            throw std::system_error(err, std::system_category(), "mmap_file: could not map "
+                + file_name);
+        }
+
+        // read-ahead aggressively and drop pages behind the reader early
+        madvise(addr, _size, MADV_SEQUENTIAL);
+        _data = (const unsigned char*) addr;
+    }
+
+    // the mapping stays valid after closing the descriptor
+    ::close(fd);
+    _open = true;
+}
+
+void mmap_file::close() {
+
+    if (_data)
+        munmap((void*) _data, _size);
+
+    _data = nullptr;
+    _size = 0;
+    _open = false;
+}
+
+mmap_file::~mmap_file() {
+
+    close();
+}
@@ -0,0 +1,46 @@
+#ifndef ZOOM_ANALYSIS_MMAP_FILE_H
+#define ZOOM_ANALYSIS_MMAP_FILE_H
+
+#include <cstddef>
+#include <string>
+
+//! read-only memory mapping of an entire file, advised for sequential access
+class mmap_file {
+public:
+    mmap_file() = default;
+
+    //! maps a file, throws std::system_error upon error
+    explicit mmap_file(const std::string& file_name);
+
+    mmap_file(const mmap_file&) = delete;
+    mmap_file& operator=(const mmap_file&) = delete;
+    mmap_file(mmap_file&& other) noexcept;
+    mmap_file& operator=(mmap_file&& other) noexcept;
+
+    //! maps a file, throws std::system_error upon error
+    void open(const std::string& file_name);
+
+    //! unmaps the file if it is mapped
+    void close();
+
+    [[nodiscard]] inline const unsigned char* data() const {
+        return _data;
+    }
+
+    [[nodiscard]] inline std::size_t size() const {
+        return _size;
+    }
+
+    [[nodiscard]] inline bool is_open() const {
+        return _open;
+    }
+
+    ~mmap_file();
+
+private:
+    const unsigned char* _data = nullptr;
+    std::size_t _size = 0;
+    bool _open = false;
+};
+
+#endif
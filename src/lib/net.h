@@ -4,8 +4,11 @@
 
 #include <arpa/inet.h> // for ntohs, ntohl, etc.
 
+#include <array>
 #include <cstdint>
+#include <cstring>
 #include <iomanip>
+#include <limits>
 #include <ostream>
 #include <sstream>
 #include <stdexcept>
@@ -120,15 +123,59 @@ namespace net {
             }
         };
 
+        //! decimal digits of an address octet, for addr_to_chars
+        struct octet_chars {
+            char digits[4] = {}; // zero-padded at the end, e.g., "42\0\0"
+            std::uint8_t len = 0;
+        };
+
+        static constexpr std::array<octet_chars, 256> make_octet_table() {
+
+            std::array<octet_chars, 256> table = {};
+
+            for (unsigned i = 0; i < 256; i++) {
+
+                auto& t = table[i];
+
+                if (i >= 100)
+                    t.digits[t.len++] = (char) ('0' + i / 100);
+
+                if (i >= 10)
+                    t.digits[t.len++] = (char) ('0' + i / 10 % 10);
+
+                t.digits[t.len++] = (char) ('0' + i % 10);
+            }
+
+            return table;
+        }
+
+        inline constexpr std::array<octet_chars, 256> OCTET_TABLE = make_octet_table();
+
+        //! bytes addr_to_chars may write, more than the longest address
+        const std::size_t ADDR_CHARS_LEN = 16;
+
+        //! writes an address in dotted-decimal notation to out, which must hold ADDR_CHARS_LEN
+        //! bytes, returns the end of the address written
+        inline char* addr_to_chars(std::uint32_t addr, char* out) {
+
+            for (unsigned shift = 24; ; shift -= 8) {
+
+                const auto& octet = OCTET_TABLE[addr >> shift & 0xffu];
+                std::memcpy(out, octet.digits, 4);
+                out += octet.len;
+
+                if (shift == 0)
+                    return out;
+
+                *out++ = '.';
+            }
+        }
+
         //! converts a 4 Byte unsigned Integer to dotted-decimal notation
         //!
         static std::string addr_to_str(const std::uint32_t &addr) {
-            std::string s;
-            s += std::to_string(addr >> 24u & 0x000000ffu) + ".";
-            s += std::to_string(addr >> 16u & 0x000000ffu) + ".";
-            s += std::to_string(addr >> 8u & 0x000000ffu) + ".";
-            s += std::to_string(addr >> 0u & 0x000000ffu);
-            return s;
+            char buf[ADDR_CHARS_LEN];
+            return std::string(buf, addr_to_chars(addr, buf));
         }
 
         //! converts an IPv4 address in dotted-decimal notation to a 4 Byte unsigned integer
@@ -168,8 +215,9 @@ namespace net {
         //! returns an ipv4_5tuple struct from raw packet buffer
         //! - reverses the byte order of the ip_src, ip_dst, tp_src, tp_dst fields
         //! - leaves tp_src = 0, tp_dst = 0 if the transport layer protocol is
-        //!   neither TCP or UDP
-        static ipv4_5tuple from_ipv4_pkt_data(const unsigned char* pkt_data);
+        //!   neither TCP or UDP, or if the ports are not within the cap_len bytes captured
+        static ipv4_5tuple from_ipv4_pkt_data(const unsigned char* pkt_data,
+            unsigned cap_len = std::numeric_limits<unsigned>::max());
 
         ipv4_5tuple() = default;
         ipv4_5tuple(std::uint32_t ip_src, std::uint32_t ip_dst, std::uint16_t tp_src,
@@ -0,0 +1,76 @@
+#include "pcap_demux_writer.h"
+
+#include <algorithm>
+
+pcap_demux_writer::pcap_demux_writer(std::function<std::string(std::uint64_t)> file_name,
+                                     pcap_link_type link_type, unsigned max_open)
+    : _file_name(std::move(file_name)), _link_type(link_type), _max_open(std::max(max_open, 1u)) { }
+
+void pcap_demux_writer::write(std::uint64_t key, const pcap_pkt& pkt) {
+
+    _writer(key).write(pkt);
+    _count++;
+}
+
+pcap_file_writer& pcap_demux_writer::_writer(std::uint64_t key) {
+
+    auto it = _open.find(key);
+
+    if (it != _open.end()) {
+        _lru.splice(_lru.begin(), _lru, it->second.lru_it);
+        return *it->second.writer;
+    }
+
+    if (_open.size() >= _max_open) {
+        auto lru_key = _lru.back();
+        _open.at(lru_key).writer->close();
+        _open.erase(lru_key);
+        _lru.pop_back();
+    }
+
+    auto writer = std::make_unique<pcap_file_writer>(BUF_LEN);
+
+    if (_written.insert(key).second) {
+        writer->open(_file_name(key), _link_type);
+    } else {
+        writer->open_append(_file_name(key), _link_type);
+        _reopen_count++;
+    }
+
+    _lru.push_front(key);
+    auto& file = _open[key] = { std::move(writer), _lru.begin() };
+    return *file.writer;
+}
+
+void pcap_demux_writer::flush() {
+
+    for (auto& [key, file] : _open) {
+        file.writer->flush();
+    }
+}
+
+void pcap_demux_writer::close() {
+
+    for (auto& [key, file] : _open) {
+        file.writer->close();
+    }
+
+    _open.clear();
+    _lru.clear();
+}
+
+pcap_link_type pcap_demux_writer::link_type() const {
+    return _link_type;
+}
+
+unsigned long pcap_demux_writer::count() const {
+    return _count;
+}
+
+std::size_t pcap_demux_writer::file_count() const {
+    return _written.size();
+}
+
+unsigned long pcap_demux_writer::reopen_count() const {
+    return _reopen_count;
+}
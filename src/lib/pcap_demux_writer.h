@@ -0,0 +1,67 @@
+#ifndef ZOOM_ANALYSIS_PCAP_DEMUX_WRITER_H
+#define ZOOM_ANALYSIS_PCAP_DEMUX_WRITER_H
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "pcap_file_writer.h"
+#include "pcap_util.h"
+
+//! writes packets to one pcap file per key (e.g., per flow) in a single pass
+//! - keeps at most max_open files open, closing the least recently written one when another one
+//!   is needed, and appends to a file closed before when its key is written again
+//! - creates (or truncates) the file of a key when it is first written
+class pcap_demux_writer {
+public:
+    static constexpr unsigned    DEFAULT_MAX_OPEN = 256;
+    static constexpr std::size_t BUF_LEN          = pcap_file_writer::MIN_BUF_LEN; // per open file
+
+    //! file_name returns the name of the file of a key
+    pcap_demux_writer(std::function<std::string(std::uint64_t)> file_name,
+                      pcap_link_type link_type, unsigned max_open = DEFAULT_MAX_OPEN);
+    pcap_demux_writer(const pcap_demux_writer&) = delete;
+    pcap_demux_writer& operator=(const pcap_demux_writer&) = delete;
+
+    //! writes the packet to the file of the key, throws std::system_error upon error
+    void write(std::uint64_t key, const pcap_pkt& pkt);
+
+    //! writes buffered packets of the open files to the files
+    void flush();
+
+    //! closes all open files
+    void close();
+
+    [[nodiscard]] pcap_link_type link_type() const;
+
+    //! returns the number of packets written to all files
+    [[nodiscard]] unsigned long count() const;
+
+    //! returns the number of files written
+    [[nodiscard]] std::size_t file_count() const;
+
+    //! returns how often a file closed before was opened again
+    [[nodiscard]] unsigned long reopen_count() const;
+
+private:
+    struct open_file {
+        std::unique_ptr<pcap_file_writer> writer;
+        std::list<std::uint64_t>::iterator lru_it;
+    };
+
+    pcap_file_writer& _writer(std::uint64_t key);
+
+    std::function<std::string(std::uint64_t)> _file_name;
+    pcap_link_type _link_type;
+    unsigned _max_open;
+    std::unordered_map<std::uint64_t, open_file> _open;
+    std::list<std::uint64_t> _lru; // most recently written first
+    std::unordered_set<std::uint64_t> _written;
+    unsigned long _count = 0, _reopen_count = 0;
+};
+
+#endif
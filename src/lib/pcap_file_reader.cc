@@ -1,52 +1,183 @@
 
 #include "pcap_file_reader.h"
 
-pcap_file_reader::pcap_file_reader(const std::string& file_name)
-    : pcap_file_reader(std::vector<std::string>({ file_name })){ }
+#include <algorithm>
 
-pcap_file_reader::pcap_file_reader(const std::vector<std::string>& file_names) {
+#include "file_decoder.h"
+#include "io_uring_chunk_source.h"
+#include "read_ahead_chunk_source.h"
 
-    int data_link_type = PCAP_ERROR;
-    std::vector<int> data_link_types = { };
+// bytes read from the beginning of each file to find the link types of a pcapng file
+static const std::size_t PEEK_LEN = 64 << 10;
 
-    for (const auto& file_name : file_names) {
+static std::vector<pcap_link_type> read_native_link_types(const std::string& file_name) {
 
-        auto pcap = pcap_open_offline(file_name.c_str(), _errbuf);
+    std::vector<unsigned char> buf(PEEK_LEN);
 
-        if (pcap) {
+    try {
+        auto len = file_decoder::open(file_name)->read(buf.data(), buf.size());
+        return pcap_record_walker::peek_link_types(buf.data(), len);
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error("pcap_reader: could not open " + file_name + ": " + e.what());
+    }
+}
 
-            if ((data_link_type = pcap_datalink(pcap)) >= 0) {
-                data_link_types.push_back(data_link_type);
-            } else {
-                throw std::runtime_error("pcap_reader: failed retrieving data link type for "
-                    + file_name);
-            }
+//! returns the link type (LINKTYPE_*) of a data link type of libpcap (DLT_*), which differ for raw
+//! IP and loopback frames: e.g., libpcap reads LINKTYPE_RAW (101) files as DLT_RAW, which is 12 on
+//! Linux and 14 on OpenBSD
+static pcap_link_type link_type_from_dlt(int dlt) {
+#ifdef DLT_RAW
+    if (dlt == DLT_RAW)
+        return pcap_link_type::raw;
+#endif
+#ifdef DLT_LOOP
+    if (dlt == DLT_LOOP)
+        return pcap_link_type::loop;
+#endif
+    return pcap_link_type { dlt };
+}
 
-            if (!data_link_types.empty() && data_link_type != data_link_types[0]) {
-                throw std::runtime_error("pcap_reader: inconsistent data link types starting in "
-                    + file_name);
-            }
+static pcap_link_type read_libpcap_link_type(const std::string& file_name) {
 
-            _pcap.push_back(pcap);
-            _file_count++;
+    char errbuf[PCAP_ERRBUF_SIZE] = {};
+    auto pcap = pcap_open_offline(file_name.c_str(), errbuf);
 
-        } else {
-            throw std::runtime_error("pcap_reader: could not open " + file_name);
+    if (!pcap)
+        throw std::runtime_error("pcap_reader: could not open " + file_name + ": " + errbuf);
+
+    auto link_type = pcap_datalink(pcap);
+    pcap_close(pcap);
+
+    if (link_type < 0)
+        throw std::runtime_error("pcap_reader: failed retrieving data link type for " + file_name);
+
+    return link_type_from_dlt(link_type);
+}
+
+pcap_file_reader::backend pcap_file_reader::backend_from_string(const std::string& s) {
+
+    for (auto b : { backend::libpcap, backend::mmap, backend::read_ahead, backend::io_uring }) {
+        if (s == backend_string(b))
+            return b;
+    }
+
+    throw std::invalid_argument("pcap_reader: unknown back end " + s);
+}
+
+std::vector<pcap_file_reader::byte_range> pcap_file_reader::split(const std::string& file_name,
+    unsigned count) {
+
+    mmap_file file(file_name);
+    pcap_record_walker::file_info info;
+
+    try {
+        info = pcap_record_walker::parse_file_hdr(file.data(), file.size());
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error("pcap_reader: could not split " + file_name + ": " + e.what());
+    }
+
+    // ranges end where the next one begins, boundaries that cannot be found collapse to the end
+    std::vector<std::uint64_t> bounds = { pcap_format::FILE_HDR_LEN };
+    std::uint64_t data_len = file.size() - pcap_format::FILE_HDR_LEN;
+
+    for (unsigned i = 1; i < count; i++) {
+
+        std::uint64_t guess = std::max<std::uint64_t>(bounds.back(),
+            pcap_format::FILE_HDR_LEN + data_len * i / count);
+
+        bounds.push_back(guess + pcap_record_walker::find_record_boundary(
+            file.data() + guess, file.size() - guess, info));
+    }
+
+    bounds.push_back(file.size());
+
+    std::vector<byte_range> ranges;
+
+    for (std::size_t i = 0; i + 1 < bounds.size(); i++) {
+        if (bounds[i + 1] > bounds[i])
+            ranges.push_back({ bounds[i], bounds[i + 1] });
+    }
+
+    return ranges;
+}
+
+pcap_file_reader::pcap_file_reader(const std::string& file_name, backend b)
+    : pcap_file_reader(std::vector<std::string>({ file_name }), b){ }
+
+pcap_file_reader::pcap_file_reader(const std::string& file_name, const byte_range& range)
+    : _backend(backend::mmap), _file_names({ file_name }), _range(range) {
+
+    _summaries.push_back({ file_name, { }, false });
+    _summaries.back().entry.link_types = read_native_link_types(file_name);
+    _file_count = 1;
+}
+
+pcap_file_reader::pcap_file_reader(const std::vector<std::string>& file_names, backend b,
+    bool merge, const pcap_manifest* manifest)
+    : _backend(b), _file_names(file_names), _merge(merge) {
+
+    bool compressed = std::any_of(file_names.begin(), file_names.end(), [](const auto& name) {
+        return file_decoder::compression_from_name(name) != file_decoder::compression::none;
+    });
+
+    if (compressed)
+        _backend = backend::read_ahead;
+
+    if (_merge) {
+
+        // every file is read by its own reader with small buffers, see MERGE_BUF_LEN
+        for (const auto& file_name : file_names) {
+
+            auto tap = std::make_unique<pcap_file_reader>(std::vector<std::string>({ file_name }),
+                _backend, false, manifest);
+            tap->_merge_tap = true;
+
+            _taps.push_back(std::move(tap));
+            _file_count++;
         }
+
+        _tap_pkts.resize(_taps.size());
+        return;
+    }
+
+    for (const auto& file_name : file_names) {
+
+        const auto* cached = manifest ? manifest->find(file_name) : nullptr;
+
+        _summaries.push_back({ file_name, { }, false });
+        _file_count++;
+
+        if (cached)
+            _summaries.back().entry.link_types = cached->link_types;
+    }
+
+    // only the first file is opened here for datalink_type(), the link types of the others are
+    // read once they are opened for reading, one at a time
+    if (!_summaries.empty() && _summaries[0].entry.link_types.empty()) {
+        _summaries[0].entry.link_types = _backend != backend::libpcap
+            ? read_native_link_types(file_names[0])
+            : std::vector<pcap_link_type> { read_libpcap_link_type(file_names[0]) };
     }
 }
 
 pcap_link_type pcap_file_reader::datalink_type() const {
 
+    std::vector<pcap_link_type> link_types;
+
+    for (const auto& summary : file_summaries()) {
+        link_types.insert(link_types.end(), summary.entry.link_types.begin(),
+                          summary.entry.link_types.end());
+    }
+
     int data_link_type = -2;
 
-    for (pcap* pcap : _pcap) {
+    for (auto link_type : link_types) {
 
-        if (data_link_type == -2 && pcap_datalink(pcap) >= 0) {
-            data_link_type = pcap_datalink(pcap);
-        } else if (data_link_type >= 0 && pcap_datalink(pcap) != data_link_type) {
+        if (data_link_type == -2 && (int) link_type >= 0) {
+            data_link_type = (int) link_type;
+        } else if (data_link_type >= 0 && (int) link_type != data_link_type) {
             return pcap_link_type::multiple_error;
-        } else if (pcap_datalink(pcap) < 0) {
+        } else if ((int) link_type < 0) {
             return pcap_link_type::error;
         }
     }
@@ -56,35 +187,288 @@ pcap_link_type pcap_file_reader::datalink_type() const {
 
 bool pcap_file_reader::next(pcap_pkt& pkt) {
 
-    return next(&pkt.buf, pkt.ts, pkt.frame_len, pkt.cap_len);
+    if (!(_pkt_count++))
+        _start = std::chrono::high_resolution_clock::now();
+
+    if (_merge)
+        return _next_merge(pkt);
+    else if (_backend != backend::libpcap)
+        return _next_native(pkt);
+    else
+        return _next_libpcap(pkt);
 }
 
-bool pcap_file_reader::next(const unsigned char** buf, timeval& ts,
+bool pcap_file_reader::next(const unsigned char** buf, timestamp_ns& ts,
     unsigned short& frame_len, unsigned short& cap_len) {
 
-    if (!(_pkt_count++))
-        _start = std::chrono::high_resolution_clock::now();
+    pcap_pkt pkt;
 
-    auto pcap_status = pcap_next_ex(_pcap[_current_file], &_hdr, &_pl_buf);
+    if (!next(pkt))
+        return false;
 
-    if (pcap_status == -2) {
+    *buf = pkt.buf;
+    ts = pkt.ts;
+    frame_len = pkt.frame_len;
+    cap_len = pkt.cap_len;
 
-        if (_file_count > _current_file + 1) {
-            _current_file++;
-            next(buf, ts, frame_len, cap_len);
-        } else {
-            _done = true;
-            _end = std::chrono::high_resolution_clock::now();
+    return true;
+}
+
+std::size_t pcap_file_reader::next_batch(pcap_pkt* pkts, std::size_t max_pkts) {
+
+    auto call_start = std::chrono::high_resolution_clock::now();
+
+    if (!_pkt_count)
+        _start = call_start;
+
+    std::size_t n = 0;
+
+    if (_backend != backend::libpcap && !_merge) {
+
+        // stops at the end of a chunk, which is only released when fetching the next one
+        while (!_done) {
+
+            while (n < max_pkts && _walker.next(pkts[n])) {
+                _byte_count += pcap_format::REC_HDR_LEN + pkts[n].cap_len;
+                _count(pkts[n]);
+                n++;
+            }
+
+            if (n > 0)
+                break;
+
+            _next_chunk();
         }
 
     } else {
-        *buf = _pl_buf;
-        ts = _hdr->ts;
-        frame_len = _hdr->len;
-        cap_len = _hdr->caplen;
+
+        // pcap_next_ex reuses its buffer for every packet and merging advances each file
+        // independently, so data is copied and pointers are set only after the batch is complete
+        // (the buffer may grow while filling it)
+        _batch_buf.clear();
+        _batch_offsets.clear();
+
+        while (n < max_pkts && (_merge ? _next_merge(pkts[n]) : _next_libpcap(pkts[n]))) {
+            _batch_offsets.push_back(_batch_buf.size());
+            _batch_buf.insert(_batch_buf.end(), pkts[n].buf, pkts[n].buf + pkts[n].cap_len);
+            n++;
+        }
+
+        for (std::size_t i = 0; i < n; i++)
+            pkts[i].buf = _batch_buf.data() + _batch_offsets[i];
     }
 
-    return !_done;
+    _pkt_count += n;
+    _time_batch(call_start);
+    return n;
+}
+
+void pcap_file_reader::_time_batch(std::chrono::high_resolution_clock::time_point call_start) {
+
+    auto now = std::chrono::high_resolution_clock::now();
+    _read_time += now - call_start;
+
+    // so that the total time includes all of the last call
+    if (_done)
+        _end = now;
+
+    if (_merge)
+        return;
+
+    // a file's total time runs from the start of one call to the start of the next call, so
+    // that it includes the time the consumer spent on the file's packets
+    if (_last_batch)
+        _summaries[_last_batch_file].io.total_time +=
+            std::chrono::duration<double>(call_start - *_last_batch).count();
+
+    auto& io = _summaries[_current_file].io;
+    io.read_time += std::chrono::duration<double>(now - call_start).count();
+
+    if (_done) {
+        io.total_time += std::chrono::duration<double>(now - call_start).count();
+        _last_batch.reset();
+    } else {
+        _last_batch = call_start;
+        _last_batch_file = _current_file;
+    }
+}
+
+bool pcap_file_reader::_next_libpcap(pcap_pkt& pkt) {
+
+    while (!_done) {
+
+        const auto& file_name = _file_names[_current_file];
+
+        // only the file currently read is open, see close()
+        if (!_pcap && !(_pcap = pcap_open_offline_with_tstamp_precision(file_name.c_str(),
+                PCAP_TSTAMP_PRECISION_NANO, _errbuf)))
+            throw std::runtime_error("pcap_reader: could not open " + file_name + ": " + _errbuf);
+
+        auto& link_types = _summaries[_current_file].entry.link_types;
+
+        if (link_types.empty())
+            link_types = { link_type_from_dlt(pcap_datalink(_pcap)) };
+
+        auto pcap_status = pcap_next_ex(_pcap, &_hdr, &_pl_buf);
+
+        if (pcap_status == -2) {
+
+            // the last file stays open until close(), its last packet must remain valid
+            if (_file_count > _current_file + 1) {
+                pcap_close(_pcap);
+                _pcap = nullptr;
+                _current_file++;
+            } else {
+                _finish();
+            }
+
+        } else if (pcap_status == -1) {
+            throw std::runtime_error("pcap_reader: could not read " + file_name + ": "
+                + pcap_geterr(_pcap));
+        } else {
+            pkt.buf = _pl_buf;
+            pkt.ts = timestamp::from_sec(_hdr->ts.tv_sec, _hdr->ts.tv_usec); // nanoseconds
+            pkt.frame_len = _hdr->len;
+            pkt.cap_len = _hdr->caplen;
+            pkt.link_type = link_type_from_dlt(pcap_datalink(_pcap));
+            _byte_count += pcap_format::REC_HDR_LEN + _hdr->caplen;
+            _count(pkt);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool pcap_file_reader::_next_native(pcap_pkt& pkt) {
+
+    while (!_done) {
+
+        if (_walker.next(pkt)) {
+            _byte_count += pcap_format::REC_HDR_LEN + pkt.cap_len;
+            _count(pkt);
+            return true;
+        }
+
+        _next_chunk();
+    }
+
+    return false;
+}
+
+bool pcap_file_reader::_next_merge(pcap_pkt& pkt) {
+
+    if (_done)
+        return false;
+
+    // the previously returned packet stays valid until now, so its file only advances here
+    if (!_merge_started) {
+
+        for (unsigned tap = 0; tap < _taps.size(); tap++) {
+            if (_taps[tap]->next(_tap_pkts[tap]))
+                _merge_heap.push({ _tap_pkts[tap].ts, tap });
+        }
+
+        _merge_started = true;
+
+    } else if (_taps[_current_file]->next(_tap_pkts[_current_file])) {
+        _merge_heap.push({ _tap_pkts[_current_file].ts, _current_file });
+    }
+
+    if (_merge_heap.empty()) {
+        _finish();
+        return false;
+    }
+
+    _current_file = _merge_heap.top().tap;
+    _merge_heap.pop();
+
+    pkt = _tap_pkts[_current_file];
+    _byte_count += pcap_format::REC_HDR_LEN + pkt.cap_len;
+    return true;
+}
+
+void pcap_file_reader::_count(const pcap_pkt& pkt) {
+
+    auto& summary = _summaries[_current_file];
+    auto& entry = summary.entry;
+
+    summary.io.pkt_count++;
+    summary.io.byte_count += pcap_format::REC_HDR_LEN + pkt.cap_len;
+
+    // files are not necessarily sorted by time
+    if (!entry.pkt_count++) {
+        entry.first_ts = pkt.ts;
+        entry.last_ts = pkt.ts;
+    } else if (pkt.ts < entry.first_ts) {
+        entry.first_ts = pkt.ts;
+    } else if (pkt.ts > entry.last_ts) {
+        entry.last_ts = pkt.ts;
+    }
+}
+
+std::unique_ptr<chunk_source> pcap_file_reader::_open_source() const {
+
+    // readers merged with others keep their memory footprint small and independent of the
+    // number of files merged (mmap only maps what is touched)
+    if (_range)
+        return std::make_unique<mmap_range_chunk_source>(_file_names[0],
+            pcap_format::FILE_HDR_LEN, _range->begin, _range->end);
+
+    switch (_backend) {
+        case backend::mmap:
+            return std::make_unique<mmap_chunk_source>(_file_names);
+        case backend::read_ahead:
+            if (_merge_tap)
+                return std::make_unique<read_ahead_chunk_source>(_file_names, MERGE_BUF_LEN);
+            return std::make_unique<read_ahead_chunk_source>(_file_names);
+        case backend::io_uring:
+            if (_merge_tap)
+                return std::make_unique<io_uring_chunk_source>(_file_names, MERGE_BUF_LEN, 2);
+            return std::make_unique<io_uring_chunk_source>(_file_names);
+        default:
+            throw std::logic_error("pcap_reader: no chunk source for back end "
+                + backend_string(_backend));
+    }
+}
+
+void pcap_file_reader::_next_chunk() {
+
+    chunk_source::chunk c;
+
+    if (!_source) // opened on first use so that readers merged with others can size their buffers
+        _source = _open_source();
+
+    if (!_source->next(c)) {
+        _finish();
+        return;
+    }
+
+    if (c.file_start) {
+
+        _current_file = c.file;
+        _walker.begin();
+
+        auto& summary = _summaries[_current_file];
+
+        // as read_native_link_types(), from the data read anyway
+        if (summary.entry.link_types.empty()) {
+            try {
+                summary.entry.link_types = pcap_record_walker::peek_link_types(c.buf, c.len);
+            } catch (const std::runtime_error& e) {
+                throw std::runtime_error("pcap_reader: could not read " + summary.file_name
+                    + ": " + e.what());
+            }
+        }
+    }
+
+    _walker.feed(c.buf, c.len);
+}
+
+void pcap_file_reader::_finish() {
+
+    _done = true;
+    _end = std::chrono::high_resolution_clock::now();
 }
 
 unsigned pcap_file_reader::file_count() const {
@@ -92,11 +476,37 @@ unsigned pcap_file_reader::file_count() const {
     return _file_count;
 }
 
+std::vector<pcap_file_reader::file_summary> pcap_file_reader::file_summaries() const {
+
+    if (_merge) {
+
+        std::vector<file_summary> summaries;
+
+        for (const auto& tap : _taps)
+            summaries.push_back(tap->file_summaries()[0]);
+
+        return summaries;
+    }
+
+    // files are read in order, so a file is complete once reading moved on to a later one
+    auto summaries = _summaries;
+
+    for (unsigned i = 0; i < summaries.size(); i++)
+        summaries[i].complete = !_range && (_done || i < _current_file);
+
+    return summaries;
+}
+
 unsigned long pcap_file_reader::pkt_count() const {
 
     return _pkt_count;
 }
 
+unsigned long long pcap_file_reader::byte_count() const {
+
+    return _byte_count;
+}
+
 double pcap_file_reader::time_in_loop() const {
 
     if (!_done)
@@ -106,10 +516,51 @@ double pcap_file_reader::time_in_loop() const {
     return (double) duration.count() / 1000000;
 }
 
+double pcap_file_reader::gbytes_per_sec() const {
+
+    auto t = time_in_loop();
+    return t > 0 ? ((double) _byte_count / 1e9) / t : 0.0;
+}
+
+pcap_file_reader::backend pcap_file_reader::active_backend() const {
+
+    return _backend;
+}
+
+io_stats pcap_file_reader::io() const {
+
+    io_stats io;
+    io.byte_count = _byte_count;
+    io.pkt_count = _pkt_count;
+    io.read_time = std::chrono::duration<double>(_read_time).count();
+    io.stall_time = stall_time();
+
+    if (_pkt_count || _done)
+        io.total_time = std::chrono::duration<double>(
+            (_done ? _end : std::chrono::high_resolution_clock::now()) - _start).count();
+
+    return io;
+}
+
+double pcap_file_reader::stall_time() const {
+
+    double stall_time = _source ? _source->stall_time() : 0.0;
+
+    for (const auto& tap : _taps)
+        stall_time += tap->stall_time();
+
+    return stall_time;
+}
+
 void pcap_file_reader::close() {
 
-    for (auto* p : _pcap) {
-        pcap_close(p);
-        p = nullptr;
+    if (_pcap) {
+        pcap_close(_pcap);
+        _pcap = nullptr;
     }
+
+    _source.reset();
+
+    for (auto& tap : _taps)
+        tap->close();
 }
@@ -2,36 +2,170 @@
 #define ZOOM_ANALYSIS_PCAP_FILE_READER_H
 
 #include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <queue>
 #include <vector>
 #include <string>
 #include <stdexcept>
 #include <pcap.h>
 
+#include "chunk_source.h"
+#include "io_stats.h"
+#include "pcap_manifest.h"
+#include "pcap_record_walker.h"
 #include "pcap_util.h"
 
 class pcap_file_reader {
 public:
-    explicit pcap_file_reader(const std::string& file_name);
-    explicit pcap_file_reader(const std::vector<std::string>& file_names);
+
+    enum class backend : unsigned {
+        libpcap    = 0, // pcap_next_ex, supports all formats libpcap reads
+        mmap       = 1, // native zero-copy reader on memory-mapped pcap and pcapng files
+        read_ahead = 2, // native reader fed by a background thread reading into large buffers
+        io_uring   = 3  // native reader fed by several large io_uring reads in flight at once
+    };
+
+    static std::string backend_string(const backend& b) {
+        switch (b) {
+            case backend::libpcap:    return "libpcap";
+            case backend::mmap:       return "mmap";
+            case backend::read_ahead: return "readahead";
+            case backend::io_uring:   return "io_uring";
+            default:                  return "unknown";
+        }
+    }
+
+    //! throws std::invalid_argument if s does not name a back end
+    static backend backend_from_string(const std::string& s);
+
+    //! part of a classic pcap file, from the first byte of a record to one past the last byte
+    struct byte_range {
+        std::uint64_t begin = 0, end = 0;
+    };
+
+    //! splits the records of a classic pcap file into at most count byte ranges of about equal
+    //! size, each starting at a record boundary found with pcap_record_walker::find_record_boundary
+    //! - throws std::runtime_error if the file is not an uncompressed classic pcap file
+    static std::vector<byte_range> split(const std::string& file_name, unsigned count);
+
+    //! packets read from a file so far
+    struct file_summary {
+        std::string file_name;
+        pcap_manifest::entry entry; // without file size and modification time
+        bool complete = false;      // all packets of the file were read
+        io_stats io;                // times only measured by next_batch() without merging
+    };
+
+    //! bytes buffered per file by the read-ahead and io_uring back ends when merging files
+    static constexpr std::size_t MERGE_BUF_LEN = 1 << 20;
+
+    //! gets the link types of the first file, files are only opened for reading one at a time (or
+    //! all at once when merging) and closed once read, which is when their link types are read
+    //! - the link types of files with an up-to-date entry in manifest are taken from it instead
+    //! - compressed files (.gz, .zst, see file_decoder) are always decompressed on the producer
+    //!   thread of the read-ahead back end, regardless of b
+    //! - merge: reads all files at once and yields their packets in global timestamp order, e.g.,
+    //!   for captures of the same period on several taps (files are concatenated otherwise)
+    explicit pcap_file_reader(const std::string& file_name, backend b = backend::libpcap);
+    explicit pcap_file_reader(const std::vector<std::string>& file_names,
+                              backend b = backend::libpcap, bool merge = false,
+                              const pcap_manifest* manifest = nullptr);
+
+    //! reads only the records in a byte range of a classic pcap file as returned by split(),
+    //! using the mmap back end
+    pcap_file_reader(const std::string& file_name, const byte_range& range);
+
+    //! returns the link type shared by all files and interfaces known so far, or multiple_error
+    //! if they differ: those of the first file, of files in the manifest, and of files opened
+    //! - pcapng files may declare several interfaces, every packet carries the link type of the
+    //!   interface it was captured on in pcap_pkt::link_type
     [[nodiscard]] pcap_link_type datalink_type() const;
+
     bool next(pcap_pkt& pkt);
-    bool next(const unsigned char** buf, timeval& ts, unsigned short& frame_len,
+    bool next(const unsigned char** buf, timestamp_ns& ts, unsigned short& frame_len,
               unsigned short& cap_len);
+
+    //! reads up to max_pkts packets into pkts, returns the number of packets read (0 when done)
+    //! - packet buffers stay valid until the next call to next() or next_batch()
+    //! - native back ends hand out views into their buffers and end batches at chunk boundaries,
+    //!   the libpcap back end and merging copy packet data into a buffer owned by the reader
+    std::size_t next_batch(pcap_pkt* pkts, std::size_t max_pkts);
+
     [[nodiscard]] unsigned file_count() const;
+
+    //! returns a summary of the packets read from each file so far, in the order of the files
+    //! - files of readers on a byte range are never complete
+    [[nodiscard]] std::vector<file_summary> file_summaries() const;
+
     [[nodiscard]] unsigned long pkt_count() const;
+
+    //! returns the number of capture bytes (record headers and captured data) read so far
+    [[nodiscard]] unsigned long long byte_count() const;
     [[nodiscard]] double time_in_loop() const;
+
+    //! returns the read throughput over time_in_loop() in GB/s
+    [[nodiscard]] double gbytes_per_sec() const;
+
+    //! returns the time in seconds the reader waited for input data to arrive
+    //! - only measured by the read-ahead and io_uring back ends, 0 otherwise
+    [[nodiscard]] double stall_time() const;
+
+    //! returns the bytes and packets read so far and the time spent within and between calls to
+    //! next_batch() (next() is not timed, see io_stats)
+    [[nodiscard]] io_stats io() const;
+
+    //! returns the back end actually reading the files
+    [[nodiscard]] backend active_backend() const;
     void close();
     ~pcap_file_reader() = default;
 
 private:
-    std::vector<pcap*> _pcap;
+
+    struct merge_entry {
+        timestamp_ns ts;
+        unsigned tap;
+
+        // min-heap on timestamps, ties go to the file listed first
+        bool operator>(const merge_entry& other) const {
+            return ts == other.ts ? tap > other.tap : ts > other.ts;
+        }
+    };
+
+    bool _next_libpcap(pcap_pkt& pkt);
+    bool _next_native(pcap_pkt& pkt);
+    bool _next_merge(pcap_pkt& pkt);
+    void _count(const pcap_pkt& pkt);
+    void _time_batch(std::chrono::high_resolution_clock::time_point call_start);
+    [[nodiscard]] std::unique_ptr<chunk_source> _open_source() const;
+    void _next_chunk();
+    void _finish();
+
+    backend _backend = backend::libpcap;
+    std::vector<std::string> _file_names;
+    std::vector<file_summary> _summaries;
+    pcap* _pcap = nullptr; // of the current file with the libpcap back end
+    std::unique_ptr<chunk_source> _source;
+    pcap_record_walker _walker;
+    std::optional<byte_range> _range;
+    bool _merge = false, _merge_tap = false, _merge_started = false;
+    std::vector<std::unique_ptr<pcap_file_reader>> _taps;
+    std::vector<pcap_pkt> _tap_pkts;
+    std::priority_queue<merge_entry, std::vector<merge_entry>, std::greater<>> _merge_heap;
+    std::vector<unsigned char> _batch_buf;
+    std::vector<std::size_t> _batch_offsets;
     struct pcap_pkthdr* _hdr = {};
     const u_char* _pl_buf = {};
     char _errbuf[PCAP_ERRBUF_SIZE] = {};
     bool _done = false;
     unsigned _current_file = 0, _file_count = 0;
     unsigned long _pkt_count = 0;
+    unsigned long long _byte_count = 0;
     std::chrono::high_resolution_clock::time_point _start, _end;
+    std::chrono::high_resolution_clock::duration _read_time {};
+    std::optional<std::chrono::high_resolution_clock::time_point> _last_batch; // see _time_batch
+    unsigned _last_batch_file = 0;
 };
 
 #endif
@@ -1,53 +1,278 @@
-
 #include "pcap_file_writer.h"
 
-pcap_file_writer::pcap_file_writer(const std::string& file_name, pcap_link_type link_type) {
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <system_error>
+#include <unistd.h>
+
+#include "pcap_format.h"
+
+pcap_file_writer::pcap_file_writer(const std::string& file_name, pcap_link_type link_type,
+                                   bool direct, const file_rotation& rotation) {
 
-    open(file_name, link_type);
+    open(file_name, link_type, direct, rotation);
 }
 
-void pcap_file_writer::open(const std::string& file_name, pcap_link_type link_type) {
+pcap_file_writer::pcap_file_writer(std::size_t buf_len)
+    : _buf_len((std::max(buf_len, MIN_BUF_LEN) + BUF_ALIGN - 1) / BUF_ALIGN * BUF_ALIGN) { }
 
-    if (!(_pcap = pcap_open_dead((int) link_type, 65535)))
-        throw std::runtime_error("pcap_file_writer: could not initialize pcap_t");
+void pcap_file_writer::open(const std::string& file_name, pcap_link_type link_type,
+                            bool direct, const file_rotation& rotation) {
 
-    if (!(_pcap_dumper = pcap_dump_open(_pcap, file_name.c_str())))
-        throw std::runtime_error("pcap_file_writer: could not open pcap dump for" + file_name);
+    _open(file_name, link_type, direct, rotation, false);
 }
 
-void pcap_file_writer::write(const pcap_pkt& pkt) {
+void pcap_file_writer::open_append(const std::string& file_name, pcap_link_type link_type) {
+
+    _open(file_name, link_type, false, {}, true);
+}
 
-    struct pcap_pkthdr pcap_hdr {
-        .ts = pkt.ts,
-        .caplen = pkt.cap_len,
-        .len = pkt.frame_len
-    };
+void pcap_file_writer::_open(const std::string& file_name, pcap_link_type link_type,
+                             bool direct, const file_rotation& rotation, bool append) {
 
-    pcap_dump((u_char*) _pcap_dumper, &pcap_hdr, pkt.buf);
-    _count++;
+    if (_fd >= 0)
+        throw std::logic_error("pcap_file_writer: already open");
+
+    if (!_buf) {
+        _buf.reset((unsigned char*) std::aligned_alloc(BUF_ALIGN, _buf_len));
+
+        if (!_buf)
+            throw std::bad_alloc();
+    }
+
+    _base_name = file_name;
+    _link_type = link_type;
+    _want_direct = direct;
+    _append_mode = append;
+    _rotation = rotation;
+    _byte_count = 0;
+    _count = 0;
+    _write_time = {};
+
+    _open_file(0);
+}
+
+void pcap_file_writer::_open_file(unsigned seq) {
+
+    auto file_name = _rotation.enabled() ? file_rotation::file_name(_base_name, seq) : _base_name;
+    int flags = O_WRONLY | O_CREAT | (_append_mode ? 0 : O_TRUNC);
+    _direct = false;
+
+#ifdef O_DIRECT
+    if (_want_direct) {
+        _fd = ::open(file_name.c_str(), flags | O_DIRECT, 0644);
+        _direct = _fd >= 0;
+    }
+#endif
+
+    if (_fd < 0)
+        _fd = ::open(file_name.c_str(), flags, 0644);
+
+    if (_fd < 0)
+        throw std::system_error(errno, std::system_category(), "pcap_file_writer: could not open "
+            + file_name);
+
+    _file_name = file_name;
+    _file_seq = seq;
+    _file_bytes = 0;
+    _file_pkts = 0;
+    _file_start = std::chrono::steady_clock::now();
+    _buf_pos = 0;
+    _offset = 0;
+
+    if (_append_mode) {
+
+        auto size = ::lseek(_fd, 0, SEEK_END);
+
+        if (size < 0) {
+            auto err = errno;
+            ::close(_fd);
+            _fd = -1;
+            throw std::system_error(err, std::system_category(),
+                "pcap_file_writer: could not seek to the end of " + file_name);
+        }
+
+        _offset = (unsigned long long) size;
+
+        if (_offset > 0)
+            return;
+    }
+
+    pcap_format::file_hdr hdr;
+    hdr.magic = pcap_format::MAGIC_US;
+    hdr.version_major = 2;
+    hdr.version_minor = 4;
+    hdr.snaplen = 65535;
+    hdr.link_type = (std::uint32_t) _link_type;
+    _append(&hdr, sizeof(hdr));
+}
+
+void pcap_file_writer::_close_file() {
+
+    _write_buf(true);
+
+    if (::close(_fd) < 0) {
+        _fd = -1;
+        throw std::system_error(errno, std::system_category(), "pcap_file_writer: could not close "
+            + _file_name);
+    }
+
+    _fd = -1;
+}
+
+void pcap_file_writer::write(const pcap_pkt& pkt) {
+
+    const unsigned char* buf = pkt.buf;
+    write(&buf, pkt.ts, pkt.frame_len, pkt.cap_len);
 }
 
-void pcap_file_writer::write(const unsigned char** buf, const timeval& timestamp,
+void pcap_file_writer::write(const unsigned char** buf, timestamp_ns ts,
     unsigned short frame_len, unsigned short cap_len) {
 
-    struct pcap_pkthdr pcap_hdr {
-        .ts = timestamp,
-        .caplen = cap_len,
-        .len = frame_len
-    };
+    auto tv = timestamp::to_timeval(ts);
+
+    pcap_format::rec_hdr hdr;
+    hdr.ts_s = (std::uint32_t) tv.tv_sec;
+    hdr.ts_frac = (std::uint32_t) tv.tv_usec;
+    hdr.caplen = cap_len;
+    hdr.len = frame_len;
+
+    if (_rotation.enabled()
+        && _rotation.due(_file_start, _file_bytes, sizeof(hdr) + cap_len, _file_pkts > 0)) {
+        _close_file();
+        _open_file(_file_seq + 1);
+    }
 
-    pcap_dump((u_char*) _pcap_dumper, &pcap_hdr, *buf);
+    if (_buf_pos + sizeof(hdr) + cap_len > _buf_len)
+        _write_buf(false);
+
+    _append(&hdr, sizeof(hdr));
+    _append(*buf, cap_len);
     _count++;
+    _file_pkts++;
 }
 
 unsigned long pcap_file_writer::count() const {
     return _count;
 }
 
+bool pcap_file_writer::is_open() const {
+    return _fd >= 0;
+}
+
+pcap_link_type pcap_file_writer::link_type() const {
+    return _link_type;
+}
+
+bool pcap_file_writer::direct() const {
+    return _direct;
+}
+
+const std::string& pcap_file_writer::file_name() const {
+    return _file_name;
+}
+
+unsigned pcap_file_writer::file_count() const {
+    return _file_name.empty() ? 0 : _file_seq + 1;
+}
+
+unsigned long long pcap_file_writer::byte_count() const {
+    return _byte_count;
+}
+
+double pcap_file_writer::write_time() const {
+    return std::chrono::duration<double>(_write_time).count();
+}
+
+double pcap_file_writer::mbytes_per_sec() const {
+
+    auto t = write_time();
+    return t > 0 ? ((double) _byte_count / 1e6) / t : 0.0;
+}
+
+void pcap_file_writer::flush() {
+
+    if (_fd >= 0)
+        _write_buf(true);
+}
+
 void pcap_file_writer::close() {
 
-    pcap_close(_pcap);
-    pcap_dump_close(_pcap_dumper);
-    _pcap = nullptr;
-    _pcap_dumper = nullptr;
+    if (_fd >= 0)
+        _close_file();
+}
+
+pcap_file_writer::~pcap_file_writer() {
+
+    try {
+        close();
+    } catch (const std::exception&) {
+        // errors are only reported by an explicit close()
+    }
+}
+
+void pcap_file_writer::_append(const void* data, std::size_t len) {
+
+    std::memcpy(_buf.get() + _buf_pos, data, len);
+    _buf_pos += len;
+    _file_bytes += len;
+    _byte_count += len;
+}
+
+//! writes the buffer, or, with O_DIRECT, its largest aligned part if not all
+//! - with O_DIRECT, the rest of all is written without O_DIRECT but kept in the buffer, so that
+//!   the next aligned write starts at an aligned offset and writes it again
+void pcap_file_writer::_write_buf(bool all) {
+
+    auto len = _direct ? _buf_pos / BUF_ALIGN * BUF_ALIGN : _buf_pos;
+
+    if (len > 0) {
+        _pwrite(_buf.get(), len, _offset);
+        _offset += len;
+        _buf_pos -= len;
+        std::memmove(_buf.get(), _buf.get() + len, _buf_pos);
+    }
+
+#ifdef O_DIRECT
+    if (all && _direct && _buf_pos > 0) {
+
+        int flags = fcntl(_fd, F_GETFL);
+
+        if (flags < 0 || fcntl(_fd, F_SETFL, flags & ~O_DIRECT) < 0)
+            throw std::system_error(errno, std::system_category(),
+                "pcap_file_writer: could not disable O_DIRECT for " + _file_name);
+
+        _pwrite(_buf.get(), _buf_pos, _offset);
+
+        if (fcntl(_fd, F_SETFL, flags) < 0)
+            throw std::system_error(errno, std::system_category(),
+                "pcap_file_writer: could not enable O_DIRECT for " + _file_name);
+    }
+#endif
+}
+
+void pcap_file_writer::_pwrite(const unsigned char* data, std::size_t len,
+                               unsigned long long offset) {
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    while (len > 0) {
+
+        auto n = ::pwrite(_fd, data, len, (off_t) offset);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            throw std::system_error(n < 0 ? errno : EIO, std::system_category(),
+                "pcap_file_writer: could not write " + _file_name);
+
+        data += n;
+        len -= (std::size_t) n;
+        offset += (unsigned long long) n;
+    }
+
+    _write_time += std::chrono::high_resolution_clock::now() - start;
 }
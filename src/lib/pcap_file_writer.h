@@ -1,26 +1,114 @@
-
 #ifndef ZOOM_ANALYSIS_PCAP_FILE_WRITER_H
 #define ZOOM_ANALYSIS_PCAP_FILE_WRITER_H
 
+#include <chrono>
+#include <cstdlib>
+#include <memory>
 #include <string>
 #include <stdexcept>
-#include <pcap.h>
+#include "file_rotation.h"
 #include "pcap_util.h"
 
+//! writes classic pcap files (microsecond timestamps, snaplen 65535), as pcap_dump() does
+//! - assembles record headers and packets in a large aligned buffer and writes it at once
+//! - with direct, writes the buffer with O_DIRECT, bypassing the page cache, e.g., so that the
+//!   output of a long run does not evict the input read ahead; falls back to buffered writes for
+//!   file systems that do not support O_DIRECT (e.g., tmpfs)
+//! - with rotation, writes a sequence of files, each starting with a file header
 class pcap_file_writer {
 public:
+    static constexpr std::size_t BUF_LEN     = 4 << 20;
+    static constexpr std::size_t MIN_BUF_LEN = 128 << 10; // holds the largest record
+    static constexpr std::size_t BUF_ALIGN   = 4096;
+
     pcap_file_writer() = default;
-    explicit pcap_file_writer(const std::string& file_name, pcap_link_type link_type);
-    void open(const std::string& file_name, pcap_link_type link_type);
+
+    //! with a buffer of buf_len bytes (at least MIN_BUF_LEN), e.g., smaller for many writers
+    explicit pcap_file_writer(std::size_t buf_len);
+
+    explicit pcap_file_writer(const std::string& file_name, pcap_link_type link_type,
+                              bool direct = false, const file_rotation& rotation = {});
+    pcap_file_writer(const pcap_file_writer&) = delete;
+    pcap_file_writer& operator=(const pcap_file_writer&) = delete;
+
+    //! creates or truncates the file, throws std::system_error upon error
+    void open(const std::string& file_name, pcap_link_type link_type, bool direct = false,
+              const file_rotation& rotation = {});
+
+    //! opens the file to append packets to, creates it if it does not exist (without O_DIRECT
+    //! and rotation), throws std::system_error upon error
+    //! - the file must have been written with the same link type, e.g., by this class
+    void open_append(const std::string& file_name, pcap_link_type link_type);
+
+    //! writes microsecond timestamps, rounded down from the nanoseconds of the packets
     void write(const pcap_pkt& pkt);
-    void write(const unsigned char** buf, const timeval& timestamp,
+    void write(const unsigned char** buf, timestamp_ns ts,
                unsigned short frame_len, unsigned short cap_len);
     [[nodiscard]] unsigned long count() const;
+    [[nodiscard]] bool is_open() const;
+
+    //! of the file opened, all packets written must be of this link type
+    [[nodiscard]] pcap_link_type link_type() const;
+
+    //! returns true if the file is (or was, once closed) written with O_DIRECT
+    [[nodiscard]] bool direct() const;
+
+    //! returns the name of the file currently written, see file_rotation
+    [[nodiscard]] const std::string& file_name() const;
+
+    //! returns the number of files opened so far, more than one with rotation
+    [[nodiscard]] unsigned file_count() const;
+
+    //! returns the bytes written to all files so far, including the file headers and packets
+    //! still buffered (kept after close, as are the other counters)
+    [[nodiscard]] unsigned long long byte_count() const;
+
+    //! returns the time in seconds spent in write calls to the file
+    [[nodiscard]] double write_time() const;
+
+    //! returns the write throughput over write_time() in MB/s
+    [[nodiscard]] double mbytes_per_sec() const;
+
+    //! writes buffered packets to the file, e.g., for readers following the file
+    void flush();
+
+    //! writes buffered packets and closes the file
     void close();
+
+    //! closes the file if it is open, ignoring errors
+    ~pcap_file_writer();
+
 private:
-    pcap_t* _pcap = nullptr;
-    pcap_dumper_t* _pcap_dumper = nullptr;
+    struct free_deleter {
+        void operator()(unsigned char* p) const {
+            std::free(p);
+        }
+    };
+
+    void _open(const std::string& file_name, pcap_link_type link_type, bool direct,
+               const file_rotation& rotation, bool append);
+    void _open_file(unsigned seq);
+    void _close_file();
+    void _append(const void* data, std::size_t len);
+    void _write_buf(bool all);
+    void _pwrite(const unsigned char* data, std::size_t len, unsigned long long offset);
+
+    std::string _base_name, _file_name;
+    int _fd = -1;
+    bool _direct = false, _want_direct = false, _append_mode = false;
+    std::size_t _buf_len = BUF_LEN;
+    file_rotation _rotation;
+    unsigned _file_seq = 0;
+    unsigned long long _file_bytes = 0;
+    unsigned long _file_pkts = 0;
+    std::chrono::steady_clock::time_point _file_start;
+    std::unique_ptr<unsigned char, free_deleter> _buf;
+    std::size_t _buf_pos = 0;
+    unsigned long long _offset = 0; // of the buffer in the file
+    unsigned long long _byte_count = 0;
     unsigned long _count = 0;
+    pcap_link_type _link_type = pcap_link_type::error;
+    std::chrono::high_resolution_clock::duration _write_time {};
 };
 
 #endif
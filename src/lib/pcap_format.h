@@ -0,0 +1,94 @@
+#ifndef ZOOM_ANALYSIS_PCAP_FORMAT_H
+#define ZOOM_ANALYSIS_PCAP_FORMAT_H
+
+#include <cstdint>
+
+namespace pcap_format {
+
+    // https://datatracker.ietf.org/doc/html/draft-ietf-opsawg-pcap
+
+    const std::uint32_t MAGIC_US         = 0xa1b2c3d4;
+    const std::uint32_t MAGIC_US_SWAPPED = 0xd4c3b2a1;
+    const std::uint32_t MAGIC_NS         = 0xa1b23c4d;
+    const std::uint32_t MAGIC_NS_SWAPPED = 0x4d3cb2a1;
+
+    const unsigned FILE_HDR_LEN = 24;
+    const unsigned REC_HDR_LEN  = 16;
+
+    //! largest record libpcap accepts when reading (see MAXIMUM_SNAPLEN in libpcap)
+    const std::uint32_t MAX_CAPLEN = 262144;
+
+    struct file_hdr { // 24
+        std::uint32_t magic         = 0; // 4
+        std::uint16_t version_major = 0; // 2
+        std::uint16_t version_minor = 0; // 2
+        std::int32_t  thiszone      = 0; // 4
+        std::uint32_t sigfigs       = 0; // 4
+        std::uint32_t snaplen       = 0; // 4
+        std::uint32_t link_type     = 0; // 4
+    };
+
+    struct rec_hdr { // 16
+        std::uint32_t ts_s    = 0; // 4
+        std::uint32_t ts_frac = 0; // 4, microseconds or nanoseconds depending on magic
+        std::uint32_t caplen  = 0; // 4
+        std::uint32_t len     = 0; // 4
+    };
+
+    static_assert(sizeof(file_hdr) == FILE_HDR_LEN);
+    static_assert(sizeof(rec_hdr) == REC_HDR_LEN);
+}
+
+namespace pcapng_format {
+
+    // https://datatracker.ietf.org/doc/html/draft-ietf-opsawg-pcapng
+
+    const std::uint32_t BLOCK_SHB = 0x0a0d0d0a; // section header, same in either byte order
+    const std::uint32_t BLOCK_IDB = 0x00000001; // interface description
+    const std::uint32_t BLOCK_OPB = 0x00000002; // obsolete packet
+    const std::uint32_t BLOCK_SPB = 0x00000003; // simple packet
+    const std::uint32_t BLOCK_EPB = 0x00000006; // enhanced packet
+
+    const std::uint32_t BYTE_ORDER_MAGIC = 0x1a2b3c4d;
+
+    //! type, length, and trailing length, also enough to read the byte order of a section header
+    const unsigned MIN_BLOCK_LEN = 12;
+    const unsigned BLOCK_HDR_LEN = 8;
+
+    //! largest block libpcap accepts when reading (see MAX_BLOCKSIZE in libpcap)
+    const std::uint32_t MAX_BLOCK_LEN = 16 * 1024 * 1024;
+
+    const std::uint16_t OPT_END         = 0;
+    const std::uint16_t OPT_IF_TSRESOL  = 9;
+    const std::uint16_t OPT_IF_TSOFFSET = 14;
+
+    struct block_hdr { // 8
+        std::uint32_t type = 0; // 4
+        std::uint32_t len  = 0; // 4, total block length including header and trailer
+    };
+
+    struct idb_hdr { // 8
+        std::uint16_t link_type = 0; // 2
+        std::uint16_t reserved  = 0; // 2
+        std::uint32_t snaplen   = 0; // 4
+    };
+
+    struct epb_hdr { // 20, the obsolete packet block uses the same layout
+        std::uint32_t interface = 0; // 4, 16 bit interface and 16 bit drop count in the OPB
+        std::uint32_t ts_high   = 0; // 4
+        std::uint32_t ts_low    = 0; // 4
+        std::uint32_t caplen    = 0; // 4
+        std::uint32_t len       = 0; // 4
+    };
+
+    struct spb_hdr { // 4
+        std::uint32_t len = 0; // 4
+    };
+
+    static_assert(sizeof(block_hdr) == BLOCK_HDR_LEN);
+    static_assert(sizeof(idb_hdr) == 8);
+    static_assert(sizeof(epb_hdr) == 20);
+    static_assert(sizeof(spb_hdr) == 4);
+}
+
+#endif
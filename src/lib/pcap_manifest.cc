@@ -0,0 +1,132 @@
+
+#include "pcap_manifest.h"
+
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <sys/stat.h>
+#include <system_error>
+
+#include "util.h"
+
+const std::string pcap_manifest::FILE_NAME = ".pcap_manifest.csv";
+
+// separates the link types of the interfaces of a file within a CSV field
+static const char LINK_TYPE_DELIM = ';';
+
+// fields per line: file,size,mtime_ns,link_types,pkts,first_ts_ns,last_ts_ns
+static const std::size_t FIELD_COUNT = 7;
+
+static bool stat_file(const std::string& file_name, std::uint64_t& size, std::int64_t& mtime_ns) {
+
+    struct stat st = {};
+
+    if (::stat(file_name.c_str(), &st) != 0)
+        return false;
+
+    size = (std::uint64_t) st.st_size;
+    mtime_ns = (std::int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+pcap_manifest::pcap_manifest(const std::string& directory)
+    : _file_name((std::filesystem::path(directory) / FILE_NAME).string()) {
+
+    if (!std::filesystem::exists(_file_name))
+        return;
+
+    util::read_csv(_file_name, [this](const std::vector<std::string>& words) {
+
+        if (words.size() != FIELD_COUNT)
+            return;
+
+        try {
+
+            entry e;
+            e.file_size = std::stoull(words[1]);
+            e.mtime_ns = std::stoll(words[2]);
+
+            std::stringstream ss(words[3]);
+            std::string link_type;
+
+            while (std::getline(ss, link_type, LINK_TYPE_DELIM))
+                e.link_types.push_back(pcap_link_type { util::str_to_signed<int>(link_type) });
+
+            e.pkt_count = std::stoul(words[4]);
+            e.first_ts = std::stoll(words[5]);
+            e.last_ts = std::stoll(words[6]);
+
+            if (!e.link_types.empty())
+                _entries[words[0]] = e;
+
+        } catch (const std::logic_error&) { } // std::invalid_argument and std::out_of_range
+    });
+}
+
+const pcap_manifest::entry* pcap_manifest::find(const std::string& file_name) const {
+
+    auto it = _entries.find(std::filesystem::path(file_name).filename().string());
+    std::uint64_t size;
+    std::int64_t mtime_ns;
+
+    if (it == _entries.end() || !stat_file(file_name, size, mtime_ns)
+        || size != it->second.file_size || mtime_ns != it->second.mtime_ns)
+        return nullptr;
+
+    return &it->second;
+}
+
+void pcap_manifest::update(const std::string& file_name, entry e) {
+
+    auto name = std::filesystem::path(file_name).filename().string();
+
+    if (name.find(',') != std::string::npos || e.link_types.empty()
+        || !stat_file(file_name, e.file_size, e.mtime_ns))
+        return;
+
+    _entries[name] = e;
+    _modified = true;
+}
+
+std::size_t pcap_manifest::size() const {
+
+    return _entries.size();
+}
+
+void pcap_manifest::save() {
+
+    if (!_modified)
+        return;
+
+    auto tmp_file_name = _file_name + ".tmp";
+    std::ofstream out(tmp_file_name);
+
+    if (!out)
+        throw std::runtime_error("pcap_manifest: could not open " + tmp_file_name);
+
+    out << "# file,size,mtime_ns,link_types,pkts,first_ts_ns,last_ts_ns" << std::endl;
+
+    for (const auto& [name, e] : _entries) {
+
+        out << name << "," << e.file_size << "," << e.mtime_ns << ",";
+
+        for (std::size_t i = 0; i < e.link_types.size(); i++)
+            out << (i ? std::string(1, LINK_TYPE_DELIM) : "") << (int) e.link_types[i];
+
+        out << "," << e.pkt_count << "," << e.first_ts << "," << e.last_ts << "\n";
+    }
+
+    out.close();
+
+    if (!out)
+        throw std::runtime_error("pcap_manifest: could not write " + tmp_file_name);
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_file_name, _file_name, ec);
+
+    if (ec)
+        throw std::runtime_error("pcap_manifest: could not replace " + _file_name + ": "
+            + ec.message());
+
+    _modified = false;
+}
@@ -0,0 +1,59 @@
+#ifndef ZOOM_ANALYSIS_PCAP_MANIFEST_H
+#define ZOOM_ANALYSIS_PCAP_MANIFEST_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "pcap_util.h"
+
+//! caches a summary of every capture file of a directory in a hidden CSV file in it, so that
+//! later runs know the link types and the period of a file without opening it
+//! - an entry is only used as long as the size and modification time of its file are unchanged
+//! - the manifest is a cache: lines that cannot be parsed are ignored and dropped on save()
+class pcap_manifest {
+public:
+
+    //! name of the manifest file in the directory of the capture files
+    static const std::string FILE_NAME;
+
+    struct entry {
+        std::uint64_t file_size = 0;
+        std::int64_t mtime_ns   = 0;
+        std::vector<pcap_link_type> link_types;
+        unsigned long pkt_count = 0;
+        timestamp_ns first_ts = 0, last_ts = 0; // earliest and latest packet
+
+        //! whether a packet of the file may have a timestamp in [start_s, end_s)
+        [[nodiscard]] bool overlaps(std::int64_t start_s, std::int64_t end_s) const {
+            return pkt_count > 0 && timestamp::sec(last_ts) >= start_s
+                && timestamp::sec(first_ts) < end_s;
+        }
+    };
+
+    //! loads the manifest of a directory if it has one
+    explicit pcap_manifest(const std::string& directory);
+
+    //! returns the entry of a file if it is still up to date, nullptr otherwise
+    [[nodiscard]] const entry* find(const std::string& file_name) const;
+
+    //! adds or replaces the entry of a file, taking its size and modification time from the file
+    //! - files whose name cannot be stored in the CSV file (i.e., containing ',') are ignored
+    void update(const std::string& file_name, entry e);
+
+    //! returns the number of entries
+    [[nodiscard]] std::size_t size() const;
+
+    //! writes the manifest if entries were updated since loading it, replacing the file only
+    //! once it was written completely, throws std::runtime_error upon error
+    void save();
+
+private:
+
+    std::string _file_name;
+    std::map<std::string, entry> _entries; // by file name without directory
+    bool _modified = false;
+};
+
+#endif
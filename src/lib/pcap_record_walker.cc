@@ -0,0 +1,457 @@
+
+#include "pcap_record_walker.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+pcap_record_walker::file_info pcap_record_walker::parse_file_hdr(const unsigned char* buf,
+    std::size_t len) {
+
+    if (len < pcap_format::FILE_HDR_LEN)
+        throw std::runtime_error("pcap_record_walker: file too short for pcap header");
+
+    pcap_format::file_hdr hdr;
+    std::memcpy(&hdr, buf, pcap_format::FILE_HDR_LEN);
+
+    file_info info;
+
+    switch (hdr.magic) {
+        case pcap_format::MAGIC_US:                                           break;
+        case pcap_format::MAGIC_US_SWAPPED: info.swapped = true;              break;
+        case pcap_format::MAGIC_NS:         info.nsec = true;                 break;
+        case pcap_format::MAGIC_NS_SWAPPED: info.nsec = true, info.swapped = true; break;
+        default:
+            throw std::runtime_error("pcap_record_walker: not a classic pcap file");
+    }
+
+    auto u32 = [&info](std::uint32_t v) { return info.swapped ? __builtin_bswap32(v) : v; };
+
+    info.snaplen = u32(hdr.snaplen);
+    // upper 16 bits may carry FCS information, see LINKTYPE_FCS_LEN
+    info.link_type = pcap_link_type { (int) (u32(hdr.link_type) & 0x0000ffff) };
+
+    return info;
+}
+
+std::vector<pcap_link_type> pcap_record_walker::peek_link_types(const unsigned char* buf,
+    std::size_t len) {
+
+    std::uint32_t magic = 0;
+
+    if (len >= sizeof(magic))
+        std::memcpy(&magic, buf, sizeof(magic));
+
+    if (magic != pcapng_format::BLOCK_SHB)
+        return { parse_file_hdr(buf, len).link_type };
+
+    // interfaces must be described before the first packet referring to them
+    pcap_record_walker walker;
+    pcap_pkt pkt;
+
+    walker.begin();
+    walker.feed(buf, len);
+    walker.next(pkt);
+
+    return walker.link_types();
+}
+
+std::size_t pcap_record_walker::find_record_boundary(const unsigned char* buf, std::size_t len,
+    const file_info& info) {
+
+    auto u32 = [&info](std::uint32_t v) { return info.swapped ? __builtin_bswap32(v) : v; };
+
+    std::uint32_t max_caplen = info.snaplen > 0 && info.snaplen < pcap_format::MAX_CAPLEN
+        ? info.snaplen : pcap_format::MAX_CAPLEN;
+    std::uint32_t max_frac = info.nsec ? 1000000000 : 1000000;
+
+    // fills rec if a plausible record starts at offset and fits into buf
+    auto plausible = [&](std::size_t offset, pcap_format::rec_hdr& rec) {
+
+        if (len - offset < pcap_format::REC_HDR_LEN)
+            return false;
+
+        std::memcpy(&rec, buf + offset, pcap_format::REC_HDR_LEN);
+        rec = { u32(rec.ts_s), u32(rec.ts_frac), u32(rec.caplen), u32(rec.len) };
+
+        // a frame length of zero also rules out runs of zeros
+        return rec.ts_frac < max_frac && rec.caplen <= max_caplen && rec.len > 0
+            && rec.caplen <= rec.len && rec.len <= pcap_format::MAX_CAPLEN
+            && len - offset - pcap_format::REC_HDR_LEN >= rec.caplen;
+    };
+
+    for (std::size_t start = 0; start < len; start++) {
+
+        std::size_t offset = start;
+        pcap_format::rec_hdr rec, prev;
+        unsigned chain_len = 0;
+
+        while (chain_len < RECORD_CHAIN_LEN && offset < len && plausible(offset, rec)) {
+
+            if (chain_len > 0 && (rec.ts_s > prev.ts_s ? rec.ts_s - prev.ts_s
+                                                       : prev.ts_s - rec.ts_s) > MAX_CHAIN_TS_GAP)
+                break;
+
+            prev = rec;
+            offset += pcap_format::REC_HDR_LEN + rec.caplen;
+            chain_len++;
+        }
+
+        if (chain_len == RECORD_CHAIN_LEN || (chain_len > 0 && offset == len))
+            return start;
+    }
+
+    return len;
+}
+
+void pcap_record_walker::begin() {
+
+    _buf = nullptr;
+    _len = 0, _offset = 0;
+    _format = format::unknown;
+    _info = {};
+    _hdr_done = false;
+    _interfaces.clear();
+    _carry_len = 0;
+}
+
+void pcap_record_walker::feed(const unsigned char* buf, std::size_t len) {
+
+    _buf = buf;
+    _len = len;
+    _offset = 0;
+}
+
+std::vector<pcap_link_type> pcap_record_walker::link_types() const {
+
+    if (_format == format::classic)
+        return _hdr_done ? std::vector<pcap_link_type> { _info.link_type }
+                         : std::vector<pcap_link_type> {};
+
+    std::vector<pcap_link_type> link_types;
+
+    for (const auto& interface : _interfaces)
+        link_types.push_back(interface.link_type);
+
+    return link_types;
+}
+
+bool pcap_record_walker::_next_slow(pcap_pkt& pkt) {
+
+    if (_format == format::unknown) {
+
+        // only peeks at the magic number, the first block or file header is read below
+        std::uint32_t magic;
+
+        if (_carry_len == 0 && _len - _offset >= sizeof(magic)) {
+            std::memcpy(&magic, _buf + _offset, sizeof(magic));
+        } else if (_gather(sizeof(magic))) {
+            std::memcpy(&magic, _carry[_carry_idx].data(), sizeof(magic));
+        } else {
+            return false;
+        }
+
+        _format = magic == pcapng_format::BLOCK_SHB ? format::pcapng : format::classic;
+
+        if (_format == format::pcapng)
+            return _next_pcapng(pkt);
+    }
+
+    if (!_hdr_done) {
+
+        if (_carry_len == 0 && _len - _offset >= pcap_format::FILE_HDR_LEN) {
+            _info = parse_file_hdr(_buf + _offset, pcap_format::FILE_HDR_LEN);
+            _offset += pcap_format::FILE_HDR_LEN;
+        } else if (_gather(pcap_format::FILE_HDR_LEN)) {
+            _info = parse_file_hdr(_carry[_carry_idx].data(), pcap_format::FILE_HDR_LEN);
+            _carry_len = 0;
+        } else {
+            return false;
+        }
+
+        _hdr_done = true;
+        return next(pkt);
+    }
+
+    if (!_gather(pcap_format::REC_HDR_LEN))
+        return false;
+
+    pcap_format::rec_hdr rec;
+    std::memcpy(&rec, _carry[_carry_idx].data(), pcap_format::REC_HDR_LEN);
+
+    std::uint32_t caplen = _u32(rec.caplen);
+
+    if (caplen > pcap_format::MAX_CAPLEN)
+        _throw_corrupt();
+
+    if (!_gather(pcap_format::REC_HDR_LEN + caplen))
+        return false;
+
+    _fill(pkt, _carry[_carry_idx].data() + pcap_format::REC_HDR_LEN, rec);
+    _carry_len = 0;
+    return true;
+}
+
+bool pcap_record_walker::_next_pcapng(pcap_pkt& pkt) {
+
+    while (true) {
+
+        const unsigned char* block;
+        std::uint32_t len;
+
+        if (_carry_len) { // completes a block started in an earlier chunk
+
+            if (!_gather(pcapng_format::MIN_BLOCK_LEN))
+                return false;
+
+            len = _block_len(_carry[_carry_idx].data());
+
+            if (!_gather(len))
+                return false;
+
+            block = _carry[_carry_idx].data();
+            _carry_len = 0;
+
+        } else {
+
+            if (_len - _offset < pcapng_format::MIN_BLOCK_LEN) {
+                _stash();
+                return false;
+            }
+
+            len = _block_len(_buf + _offset);
+
+            if (_len - _offset < len) {
+                _stash();
+                return false;
+            }
+
+            block = _buf + _offset;
+            _offset += len;
+        }
+
+        if (_block(block, len, pkt))
+            return true;
+    }
+}
+
+std::uint32_t pcap_record_walker::_block_len(const unsigned char* block) {
+
+    pcapng_format::block_hdr hdr;
+    std::memcpy(&hdr, block, sizeof(hdr));
+
+    // a section header sets the byte order for all blocks up to the next one
+    if (hdr.type == pcapng_format::BLOCK_SHB) {
+
+        std::uint32_t byte_order_magic;
+        std::memcpy(&byte_order_magic, block + sizeof(hdr), sizeof(byte_order_magic));
+
+        if (byte_order_magic == pcapng_format::BYTE_ORDER_MAGIC) {
+            _info.swapped = false;
+        } else if (byte_order_magic == __builtin_bswap32(pcapng_format::BYTE_ORDER_MAGIC)) {
+            _info.swapped = true;
+        } else {
+            throw std::runtime_error("pcap_record_walker: invalid pcapng byte order magic");
+        }
+    }
+
+    std::uint32_t len = _u32(hdr.len);
+
+    if (len < pcapng_format::MIN_BLOCK_LEN || len % 4 != 0 || len > pcapng_format::MAX_BLOCK_LEN)
+        _throw_corrupt();
+
+    return len;
+}
+
+bool pcap_record_walker::_block(const unsigned char* block, std::uint32_t len, pcap_pkt& pkt) {
+
+    pcapng_format::block_hdr hdr;
+    std::memcpy(&hdr, block, sizeof(hdr));
+
+    const unsigned char* body = block + pcapng_format::BLOCK_HDR_LEN;
+    std::uint32_t body_len = len - pcapng_format::MIN_BLOCK_LEN;
+
+    switch (_u32(hdr.type)) {
+
+        case pcapng_format::BLOCK_SHB: {
+
+            std::uint16_t version_major;
+
+            if (body_len < 8)
+                _throw_corrupt();
+
+            std::memcpy(&version_major, body + 4, sizeof(version_major));
+
+            if (_u16(version_major) != 1)
+                throw std::runtime_error("pcap_record_walker: unsupported pcapng version");
+
+            _interfaces.clear(); // interface ids are local to a section
+            return false;
+        }
+
+        case pcapng_format::BLOCK_IDB:
+            _add_interface(body, body_len);
+            return false;
+
+        case pcapng_format::BLOCK_EPB:
+        case pcapng_format::BLOCK_OPB: {
+
+            pcapng_format::epb_hdr epb;
+
+            if (body_len < sizeof(epb))
+                _throw_corrupt();
+
+            std::memcpy(&epb, body, sizeof(epb));
+
+            std::uint32_t interface_id = _u32(epb.interface);
+            std::uint32_t caplen = _u32(epb.caplen);
+
+            if (_u32(hdr.type) == pcapng_format::BLOCK_OPB) { // followed by a 16 bit drop count
+                std::uint16_t opb_interface_id;
+                std::memcpy(&opb_interface_id, body, sizeof(opb_interface_id));
+                interface_id = _u16(opb_interface_id);
+            }
+
+            if (caplen > body_len - sizeof(epb) || caplen > pcap_format::MAX_CAPLEN)
+                _throw_corrupt();
+
+            if (interface_id >= _interfaces.size())
+                throw std::runtime_error("pcap_record_walker: packet for undeclared interface");
+
+            const auto& interface = _interfaces[interface_id];
+            std::uint64_t ts = ((std::uint64_t) _u32(epb.ts_high) << 32) | _u32(epb.ts_low);
+            std::uint64_t frac = ts % interface.ts_per_sec;
+
+            pkt.buf = body + sizeof(epb);
+            pkt.ts = timestamp::from_sec((std::int64_t) (ts / interface.ts_per_sec)
+                + interface.ts_offset, (std::int64_t) (interface.ts_per_sec == 1000000
+                    ? frac * timestamp::NS_PER_US
+                    : (std::uint64_t) ((unsigned __int128) frac * timestamp::NS_PER_SEC
+                        / interface.ts_per_sec)));
+            pkt.frame_len = (unsigned short) _u32(epb.len);
+            pkt.cap_len = (unsigned short) caplen;
+            pkt.link_type = interface.link_type;
+            return true;
+        }
+
+        case pcapng_format::BLOCK_SPB: {
+
+            pcapng_format::spb_hdr spb;
+
+            if (body_len < sizeof(spb))
+                _throw_corrupt();
+
+            if (_interfaces.empty())
+                throw std::runtime_error("pcap_record_walker: packet for undeclared interface");
+
+            std::memcpy(&spb, body, sizeof(spb));
+
+            // simple packet blocks carry neither a captured length nor a timestamp
+            const auto& interface = _interfaces[0];
+            std::uint32_t frame_len = _u32(spb.len);
+            std::uint32_t caplen = std::min<std::uint32_t>(frame_len, body_len - sizeof(spb));
+
+            if (interface.snaplen > 0)
+                caplen = std::min(caplen, interface.snaplen);
+
+            if (caplen > pcap_format::MAX_CAPLEN)
+                _throw_corrupt();
+
+            pkt.buf = body + sizeof(spb);
+            pkt.ts = 0;
+            pkt.frame_len = (unsigned short) frame_len;
+            pkt.cap_len = (unsigned short) caplen;
+            pkt.link_type = interface.link_type;
+            return true;
+        }
+
+        default: // statistics, name resolution, custom, ...
+            return false;
+    }
+}
+
+void pcap_record_walker::_add_interface(const unsigned char* body, std::uint32_t len) {
+
+    pcapng_format::idb_hdr idb;
+
+    if (len < sizeof(idb))
+        _throw_corrupt();
+
+    std::memcpy(&idb, body, sizeof(idb));
+
+    interface_info interface;
+    interface.link_type = pcap_link_type { _u16(idb.link_type) };
+    interface.snaplen = _u32(idb.snaplen);
+
+    // options are padded to 32 bits and terminated by opt_endofopt or the end of the block
+    for (std::uint32_t offset = sizeof(idb); offset + 4 <= len; ) {
+
+        std::uint16_t code, opt_len;
+        std::memcpy(&code, body + offset, sizeof(code));
+        std::memcpy(&opt_len, body + offset + 2, sizeof(opt_len));
+        code = _u16(code), opt_len = _u16(opt_len);
+
+        const unsigned char* value = body + offset + 4;
+        offset += 4 + ((opt_len + 3u) & ~3u);
+
+        if (code == pcapng_format::OPT_END || offset > len)
+            break;
+
+        if (code == pcapng_format::OPT_IF_TSRESOL && opt_len == 1) {
+
+            unsigned exp = *value & 0x7f;
+
+            if ((*value & 0x80) ? exp > 63 : exp > 19)
+                throw std::runtime_error("pcap_record_walker: unsupported timestamp resolution");
+
+            interface.ts_per_sec = 1;
+
+            for (unsigned i = 0; i < exp; i++)
+                interface.ts_per_sec *= (*value & 0x80) ? 2 : 10;
+
+        } else if (code == pcapng_format::OPT_IF_TSOFFSET && opt_len == 8) {
+
+            std::uint64_t ts_offset;
+            std::memcpy(&ts_offset, value, sizeof(ts_offset));
+            interface.ts_offset = (std::int64_t) (_info.swapped ? __builtin_bswap64(ts_offset)
+                                                                : ts_offset);
+        }
+    }
+
+    _interfaces.push_back(interface);
+}
+
+bool pcap_record_walker::_gather(std::size_t n) {
+
+    auto& carry = _carry[_carry_idx];
+
+    auto min_size = std::max<std::size_t>(n, pcap_format::REC_HDR_LEN + pcap_format::MAX_CAPLEN);
+
+    if (carry.size() < min_size)
+        carry.resize(min_size);
+
+    if (_carry_len < n && _offset < _len) {
+        auto take = std::min(n - _carry_len, _len - _offset);
+        std::memcpy(carry.data() + _carry_len, _buf + _offset, take);
+        _carry_len += take;
+        _offset += take;
+    }
+
+    return _carry_len >= n;
+}
+
+void pcap_record_walker::_stash() {
+
+    if (_offset == _len)
+        return;
+
+    _carry_idx ^= 1;
+    _carry_len = 0;
+    _gather(_len - _offset);
+}
+
+void pcap_record_walker::_throw_corrupt() const {
+
+    throw std::runtime_error("pcap_record_walker: corrupt record at chunk offset "
+        + std::to_string(_offset));
+}
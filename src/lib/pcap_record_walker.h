@@ -0,0 +1,159 @@
+#ifndef ZOOM_ANALYSIS_PCAP_RECORD_WALKER_H
+#define ZOOM_ANALYSIS_PCAP_RECORD_WALKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <sys/time.h>
+#include <vector>
+
+#include "pcap_format.h"
+#include "pcap_util.h"
+
+//! walks the records of a classic pcap or pcapng file held in memory without copying packet data
+//! - the file is supplied in one or more chunks, records spanning two chunks are reassembled
+//!   in an internal buffer
+//! - pcapng files yield packets from enhanced, simple, and obsolete packet blocks, each with the
+//!   link type and timestamp resolution of the interface it was captured on
+class pcap_record_walker {
+public:
+
+    //! consecutive plausible record headers required by find_record_boundary()
+    static const unsigned RECORD_CHAIN_LEN = 8;
+
+    //! largest difference in seconds between timestamps of consecutive records in a chain
+    static const std::uint32_t MAX_CHAIN_TS_GAP = 3600;
+
+    struct file_info {
+        pcap_link_type link_type = pcap_link_type::error;
+        std::uint32_t snaplen    = 0;
+        bool swapped             = false;
+        bool nsec                = false;
+    };
+
+    //! parses a classic pcap file header, throws std::runtime_error if buf does not start with one
+    static file_info parse_file_hdr(const unsigned char* buf, std::size_t len);
+
+    //! returns the link types a classic pcap or pcapng file starting with buf declares before its
+    //! first packet, throws std::runtime_error if buf does not start with either format
+    static std::vector<pcap_link_type> peek_link_types(const unsigned char* buf, std::size_t len);
+
+    //! returns the offset of the first position in buf where a chain of plausible record headers
+    //! starts, len if there is none, so that a classic pcap file can be read from anywhere
+    //! - a header is plausible if its lengths fit the file's snaplen and its timestamp is valid
+    //!   and close to the one of the previous header, a chain ends after RECORD_CHAIN_LEN
+    //!   headers or exactly at the end of buf
+    //! - buf should extend to the end of the file, data is assumed to follow the file header info
+    static std::size_t find_record_boundary(const unsigned char* buf, std::size_t len,
+                                            const file_info& info);
+
+    //! starts walking a new file, drops any incomplete record left over from the previous file
+    void begin();
+
+    //! supplies the next chunk of the current file
+    //! - buf must stay valid until the walker runs out of data in it
+    void feed(const unsigned char* buf, std::size_t len);
+
+    //! points pkt at the next record, returns false when the current chunk is exhausted
+    //! - pkt stays valid until the chunk it points into is released and at least until next()
+    //!   has returned false once more
+    //! - a truncated record at the end of a file is treated as the end of the file
+    //! - throws std::runtime_error on an invalid file header or a corrupt record
+    inline bool next(pcap_pkt& pkt) {
+
+        if (_format == format::pcapng)
+            return _next_pcapng(pkt);
+
+        if (_carry_len || !_hdr_done)
+            return _next_slow(pkt);
+
+        if (_len - _offset < pcap_format::REC_HDR_LEN) {
+            _stash();
+            return false;
+        }
+
+        pcap_format::rec_hdr rec;
+        std::memcpy(&rec, _buf + _offset, pcap_format::REC_HDR_LEN);
+
+        std::uint32_t caplen = _u32(rec.caplen);
+
+        if (caplen > pcap_format::MAX_CAPLEN)
+            _throw_corrupt();
+
+        if (_len - _offset - pcap_format::REC_HDR_LEN < caplen) {
+            _stash();
+            return false;
+        }
+
+        _fill(pkt, _buf + _offset + pcap_format::REC_HDR_LEN, rec);
+        _offset += pcap_format::REC_HDR_LEN + caplen;
+        return true;
+    }
+
+    //! returns the classic pcap file header, only meaningful for classic pcap files
+    [[nodiscard]] inline const file_info& info() const {
+        return _info;
+    }
+
+    //! returns the link types of the interfaces seen so far in the current file (pcapng section)
+    [[nodiscard]] std::vector<pcap_link_type> link_types() const;
+
+private:
+
+    enum class format : unsigned {
+        unknown = 0,
+        classic = 1,
+        pcapng  = 2
+    };
+
+    struct interface_info {
+        pcap_link_type link_type = pcap_link_type::error;
+        std::uint32_t snaplen    = 0;
+        std::uint64_t ts_per_sec = 1000000; // if_tsresol, microseconds unless specified
+        std::int64_t ts_offset   = 0;       // if_tsoffset in seconds
+    };
+
+    [[nodiscard]] inline std::uint32_t _u32(std::uint32_t v) const {
+        return _info.swapped ? __builtin_bswap32(v) : v;
+    }
+
+    [[nodiscard]] inline std::uint16_t _u16(std::uint16_t v) const {
+        return _info.swapped ? __builtin_bswap16(v) : v;
+    }
+
+    inline void _fill(pcap_pkt& pkt, const unsigned char* data, const pcap_format::rec_hdr& rec) {
+
+        std::uint32_t frac = _u32(rec.ts_frac);
+
+        pkt.buf = data;
+        pkt.ts = timestamp::from_sec(_u32(rec.ts_s),
+            _info.nsec ? frac : (std::int64_t) frac * timestamp::NS_PER_US);
+        pkt.frame_len = (unsigned short) _u32(rec.len);
+        pkt.cap_len = (unsigned short) _u32(rec.caplen);
+        pkt.link_type = _info.link_type;
+    }
+
+    bool _next_slow(pcap_pkt& pkt);
+    bool _next_pcapng(pcap_pkt& pkt);
+    std::uint32_t _block_len(const unsigned char* block);
+    bool _block(const unsigned char* block, std::uint32_t len, pcap_pkt& pkt);
+    void _add_interface(const unsigned char* body, std::uint32_t len);
+    bool _gather(std::size_t n);
+    void _stash();
+    [[noreturn]] void _throw_corrupt() const;
+
+    const unsigned char* _buf = nullptr;
+    std::size_t _len = 0, _offset = 0;
+    format _format = format::unknown;
+    file_info _info = {};
+    bool _hdr_done = false;
+    std::vector<interface_info> _interfaces;
+
+    // partial records are collected alternately in two buffers so that a reassembled record
+    // handed out at the start of a chunk survives the partial record stashed at its end
+    std::vector<unsigned char> _carry[2];
+    unsigned _carry_idx = 0;
+    std::size_t _carry_len = 0;
+};
+
+#endif
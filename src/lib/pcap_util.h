@@ -5,11 +5,7 @@
 #include <iomanip>
 #include <ostream>
 
-struct pcap_pkt {
-    const unsigned char *buf = nullptr;
-    timeval ts = { 0, 0 };
-    unsigned short frame_len = 0, cap_len = 0;
-};
+#include "timestamp.h"
 
 enum class pcap_link_type : int {
     error          = -2,
@@ -17,46 +13,17 @@ enum class pcap_link_type : int {
     null           = 0,
     eth            = 1,
     raw            = 101,
-    loop           = 108
+    loop           = 108,
+    sll            = 113,
+    ipv4           = 228,
+    sll2           = 276
 };
 
-static bool operator<(const timeval& a, const timeval& b) {
-
-    if (a.tv_sec == b.tv_sec) {
-        return a.tv_usec < b.tv_usec;
-    } else {
-        return a.tv_sec < b.tv_sec;
-    }
-}
-
-static bool operator==(const timeval& a, const timeval& b) {
-    return a.tv_sec == b.tv_sec && a.tv_usec == b.tv_usec;
-}
-
-static bool operator>(const timeval& a, const timeval& b) {
-    return !(a == b) && !(a < b);
-}
-
-static bool operator>=(const timeval& a, const timeval& b) {
-    return a == b || a > b;
-}
-
-static timeval operator-(const timeval& a, const timeval& b) {
-
-    timeval res {0, 0};
-    res.tv_sec = a.tv_sec - b.tv_sec;
-    res.tv_usec = a.tv_usec - b.tv_usec;
-
-    if (res.tv_usec < 0) {
-        res.tv_sec -= 1;
-        res.tv_usec += 1000000;
-    }
-
-    return res;
-}
-
-static std::ostream& operator<<(std::ostream& os, const timeval& tv) {
-    return os << std::dec << (unsigned long) tv.tv_sec << "," << std::dec << (unsigned) tv.tv_usec;
-}
+struct pcap_pkt {
+    const unsigned char *buf = nullptr;
+    timestamp_ns ts = 0;
+    unsigned short frame_len = 0, cap_len = 0;
+    pcap_link_type link_type = pcap_link_type::error; // of the interface the packet was captured on
+};
 
 #endif
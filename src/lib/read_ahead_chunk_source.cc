@@ -0,0 +1,165 @@
+
+#include "read_ahead_chunk_source.h"
+
+#include <chrono>
+#include <fcntl.h>
+#include <new>
+#include <unistd.h>
+
+#include "file_decoder.h"
+
+// bytes at the beginning of the next file the kernel is asked to read ahead of time
+static const off_t NEXT_FILE_HINT_LEN = 64 << 20;
+
+read_ahead_chunk_source::read_ahead_chunk_source(const std::vector<std::string>& file_names,
+    std::size_t buf_len, unsigned buf_count)
+    : _file_names(file_names),
+      _buf_len((buf_len + BUF_ALIGN - 1) / BUF_ALIGN * BUF_ALIGN),
+      _slots(buf_count) {
+
+    if (buf_count < 2)
+        throw std::invalid_argument("read_ahead_chunk_source: need at least two buffers");
+
+    for (auto& slot : _slots) {
+
+        slot.buf.reset((unsigned char*) std::aligned_alloc(BUF_ALIGN, _buf_len));
+
+        if (!slot.buf)
+            throw std::bad_alloc();
+    }
+
+    _thread = std::thread(&read_ahead_chunk_source::_run, this);
+}
+
+bool read_ahead_chunk_source::next(chunk& c) {
+
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    if (_holding) { // release the previous chunk to the producer
+        _slots[_consume_idx].ready = false;
+        _consume_idx = (_consume_idx + 1) % _slots.size();
+        _holding = false;
+        _cv.notify_all();
+    }
+
+    if (!_slots[_consume_idx].ready && !_eof && !_error) {
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        _cv.wait(lock, [this]() {
+            return _slots[_consume_idx].ready || _eof || _error;
+        });
+
+        _stall_time += std::chrono::high_resolution_clock::now() - start;
+    }
+
+    if (_slots[_consume_idx].ready) {
+        c = _slots[_consume_idx].c;
+        _holding = true;
+        return true;
+    }
+
+    if (_error)
+        std::rethrow_exception(_error);
+
+    return false;
+}
+
+double read_ahead_chunk_source::stall_time() const {
+
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(_stall_time);
+    return (double) duration.count() / 1000000;
+}
+
+read_ahead_chunk_source::~read_ahead_chunk_source() {
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+
+    _cv.notify_all();
+
+    if (_thread.joinable())
+        _thread.join();
+}
+
+void read_ahead_chunk_source::_run() {
+
+    try {
+        for (unsigned file = 0; file < _file_names.size(); file++) {
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+
+                if (_stop)
+                    break;
+            }
+
+            if (file + 1 < _file_names.size())
+                _hint_file(file + 1);
+
+            if (!_produce_file(file))
+                break;
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _eof = true;
+    }
+
+    _cv.notify_all();
+}
+
+bool read_ahead_chunk_source::_produce_file(unsigned file) {
+
+    auto decoder = file_decoder::open(_file_names[file]);
+    bool file_start = true, file_end = false;
+
+    while (!file_end) {
+
+        slot* s;
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv.wait(lock, [this]() { return !_slots[_produce_idx].ready || _stop; });
+
+            if (_stop)
+                return false;
+
+            s = &_slots[_produce_idx];
+        }
+
+        // the decoder fills the whole buffer so that a short chunk always marks the end of the file
+        std::size_t len = decoder->read(s->buf.get(), _buf_len);
+        file_end = len < _buf_len;
+
+        // empty trailing chunks are skipped unless the file is empty altogether
+        if (len > 0 || file_start) {
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            s->c = { .buf = s->buf.get(), .len = len, .file = file, .file_start = file_start };
+            s->ready = true;
+            _produce_idx = (_produce_idx + 1) % _slots.size();
+            file_start = false;
+            _cv.notify_all();
+        }
+    }
+
+    return true;
+}
+
+void read_ahead_chunk_source::_hint_file(unsigned file) const {
+
+    int fd = ::open(_file_names[file].c_str(), O_RDONLY);
+
+    if (fd < 0) // reported once the file is read
+        return;
+
+    posix_fadvise(fd, 0, NEXT_FILE_HINT_LEN, POSIX_FADV_WILLNEED);
+    ::close(fd);
+}
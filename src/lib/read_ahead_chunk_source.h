@@ -0,0 +1,68 @@
+#ifndef ZOOM_ANALYSIS_READ_AHEAD_CHUNK_SOURCE_H
+#define ZOOM_ANALYSIS_READ_AHEAD_CHUNK_SOURCE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "chunk_source.h"
+
+//! reads files sequentially on a producer thread into a ring of large aligned buffers
+//! - with the default two buffers, the consumer parses one buffer while the next one is filled
+//! - compressed files (see file_decoder) are decompressed on the producer thread
+//! - hints the kernel to start reading the beginning of the next file while reading the current
+class read_ahead_chunk_source : public chunk_source {
+public:
+
+    static const std::size_t DEFAULT_BUF_LEN   = 16 << 20;
+    static const unsigned    DEFAULT_BUF_COUNT = 2;
+
+    //! starts the producer thread, errors reading files are rethrown by next()
+    explicit read_ahead_chunk_source(const std::vector<std::string>& file_names,
+                                     std::size_t buf_len = DEFAULT_BUF_LEN,
+                                     unsigned buf_count = DEFAULT_BUF_COUNT);
+
+    bool next(chunk& c) override;
+    [[nodiscard]] double stall_time() const override;
+
+    //! stops and joins the producer thread
+    ~read_ahead_chunk_source() override;
+
+private:
+
+    static const std::size_t BUF_ALIGN = 4096;
+
+    struct free_deleter {
+        void operator()(unsigned char* p) const {
+            std::free(p);
+        }
+    };
+
+    struct slot {
+        std::unique_ptr<unsigned char, free_deleter> buf;
+        chunk c     = {};
+        bool ready  = false; // filled by the producer and not yet released by the consumer
+    };
+
+    void _run();
+    //! returns false if stopped by the destructor
+    bool _produce_file(unsigned file);
+    void _hint_file(unsigned file) const;
+
+    std::vector<std::string> _file_names;
+    std::size_t _buf_len;
+    std::vector<slot> _slots;
+    unsigned _produce_idx = 0, _consume_idx = 0;
+    bool _holding = false, _stop = false, _eof = false;
+    std::exception_ptr _error = nullptr;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::chrono::high_resolution_clock::duration _stall_time = {};
+    std::thread _thread;
+};
+
+#endif
@@ -9,6 +9,8 @@
 
 namespace rtcp {
 
+    static const unsigned HDR_LEN = 8; // up to the SSRC
+
     struct hdr {
 
         // https://datatracker.ietf.org/doc/html/rfc3550#section-6.4.1
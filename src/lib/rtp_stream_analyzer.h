@@ -29,7 +29,7 @@ public:
         bool seen             = false;
         std::uint16_t rtp_seq = 0;
         std::uint32_t rtp_ts  = 0;
-        timeval ts            = { 0, 0 };
+        timestamp_ns ts       = 0;
         unsigned pl_len       = 0;
         PacketMeta meta       = {};
     };
@@ -37,8 +37,8 @@ public:
     struct frame {
         std::uint32_t rtp_ts  = 0;
         unsigned pkts_seen    = 0;
-        timeval ts_min        = {0, 0};
-        timeval ts_max        = {0, 0};
+        timestamp_ns ts_min   = 0;
+        timestamp_ns ts_max   = 0;
         unsigned total_pl_len = 0;
         unsigned fps          = 0;
         double jitter         = 0.0;
@@ -47,9 +47,9 @@ public:
 
     struct timestamps {
         std::uint32_t first_rtp = 0, last_rtp = 0;
-        timeval first_timeval = { 0, 0 }, last_timeval = { 0, 0 };
+        timestamp_ns first_ts = 0, last_ts = 0;
 
-        void update(std::uint32_t rtp_ts, timeval ts) {
+        void update(std::uint32_t rtp_ts, timestamp_ns ts) {
 
             if (first_rtp == 0 || rtp_ts < first_rtp)
                 first_rtp = rtp_ts;
@@ -57,11 +57,11 @@ public:
             if (last_rtp == 0 || rtp_ts > last_rtp)
                 last_rtp = rtp_ts;
 
-            if ((first_timeval.tv_sec == 0 && first_timeval.tv_usec == 0) || ts < first_timeval)
-                first_timeval = ts;
+            if (first_ts == 0 || ts < first_ts)
+                first_ts = ts;
 
-            if ((last_timeval.tv_sec == 0 && last_timeval.tv_usec == 0) || ts > last_timeval)
-                last_timeval = ts;
+            if (last_ts == 0 || ts > last_ts)
+                last_ts = ts;
         }
     };
 
@@ -132,7 +132,7 @@ public:
     rtp_stream_analyzer(rtp_stream_analyzer&&) noexcept            = default;
     rtp_stream_analyzer& operator=(rtp_stream_analyzer&&) noexcept = default;
 
-    void add(std::uint16_t rtp_seq, std::uint32_t rtp_ts, const timeval& ts, unsigned pl_len,
+    void add(std::uint16_t rtp_seq, std::uint32_t rtp_ts, timestamp_ns ts, unsigned pl_len,
              const PacketMeta& meta) {
 
         _timestamps.update(rtp_ts, ts);
@@ -143,7 +143,7 @@ public:
                 .pl_len = pl_len
             };
 
-            _current_ts_s = ts.tv_sec;
+            _current_ts_s = timestamp::sec(ts);
 
         } else {
 
@@ -159,7 +159,7 @@ public:
 
                     if (i < seq_diff) {
                         // fill in sequence numbers but set seen = false for skipped packets
-                        _set(idx, head_seq + i, 0, {0, 0}, pl_len, false, meta);
+                        _set(idx, head_seq + i, 0, 0, pl_len, false, meta);
                     } else { // seen (last) sequence number
                         _set(idx, rtp_seq, rtp_ts, ts, pl_len, true, meta);
                     }
@@ -187,11 +187,11 @@ public:
                 }
             }
 
-            if (ts.tv_sec > _current_ts_s) {
+            if (timestamp::sec(ts) > _current_ts_s) {
                 _stats_handler(*this, _stats_report_count++, _current_ts_s, _current_ts_counters);
 
                 _current_ts_counters = {};
-                _current_ts_s = ts.tv_sec;
+                _current_ts_s = timestamp::sec(ts);
             }
 
         }
@@ -287,7 +287,7 @@ private:
         return i & (Len - 1); // == i % _size (for powers of 2)
     }
 
-    void _set(unsigned idx, std::uint16_t rtp_seq, std::uint32_t rtp_ts, const timeval& ts,
+    void _set(unsigned idx, std::uint16_t rtp_seq, std::uint32_t rtp_ts, timestamp_ns ts,
               unsigned pl_len, bool seen, const PacketMeta& meta) {
 
         if (_ring[idx].seen && _ring[idx].rtp_seq == rtp_seq) {
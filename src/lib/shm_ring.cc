@@ -0,0 +1,164 @@
+#include "shm_ring.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+const std::string& shm_ring::name() const {
+    return _name;
+}
+
+std::size_t shm_ring::slot_len() const {
+    return _slot_len;
+}
+
+std::size_t shm_ring::slot_count() const {
+    return _slot_count;
+}
+
+std::string shm_ring::shm_name(const std::string& name) {
+    return !name.empty() && name[0] == '/' ? name : "/" + name;
+}
+
+shm_ring::~shm_ring() {
+
+    if (_hdr)
+        munmap(_hdr, _len);
+}
+
+void shm_ring::_map(int fd, std::size_t len, bool writable) {
+
+    void* addr = mmap(nullptr, len, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+                      fd, 0);
+    auto err = errno;
+
+    // the mapping stays valid after closing the descriptor
+    ::close(fd);
+
+    if (addr == MAP_FAILED)
+        throw std::system_error(err, std::system_category(), "shm_ring: could not map " + _name);
+
+    _hdr = (_header*) addr;
+    _slots = (unsigned char*) addr + sizeof(_header);
+    _len = len;
+}
+
+std::size_t shm_ring::_map_len(std::size_t slot_len, std::size_t slot_count) {
+    return sizeof(_header) + slot_count * _stride(slot_len);
+}
+
+std::size_t shm_ring::_stride(std::size_t slot_len) {
+    return (sizeof(_slot_header) + slot_len + 7) & ~(std::size_t) 7;
+}
+
+shm_ring_writer::shm_ring_writer(const std::string& name, std::size_t slot_len,
+                                 std::size_t slot_count) {
+
+    if (slot_len == 0 || slot_count == 0)
+        throw std::invalid_argument("shm_ring_writer: slot_len and slot_count must be positive");
+
+    _name = shm_name(name);
+    shm_unlink(_name.c_str());
+
+    int fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+
+    if (fd < 0)
+        throw std::system_error(errno, std::system_category(), "shm_ring_writer: could not create "
+            + _name);
+
+    auto len = _map_len(slot_len, slot_count);
+
+    if (ftruncate(fd, (off_t) len) < 0) {
+        auto err = errno;
+        ::close(fd);
+        shm_unlink(_name.c_str());
+        throw std::system_error(err, std::system_category(), "shm_ring_writer: could not size "
+            + _name);
+    }
+
+    try {
+        _map(fd, len, true);
+    } catch (const std::system_error&) {
+        shm_unlink(_name.c_str());
+        throw;
+    }
+
+    // the object is zero-filled: the slots are empty, readers check the magic last
+    auto* hdr = new (_hdr) _header;
+    hdr->version = VERSION;
+    hdr->slot_len = (std::uint32_t) slot_len;
+    hdr->slot_count = slot_count;
+    hdr->head.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(hdr->magic, MAGIC, sizeof(MAGIC));
+
+    _slot_len = slot_len;
+    _slot_stride = _stride(slot_len);
+    _slot_count = slot_count;
+}
+
+shm_ring_writer::~shm_ring_writer() {
+    shm_unlink(_name.c_str());
+}
+
+shm_ring_reader::shm_ring_reader(const std::string& name) {
+
+    _name = shm_name(name);
+
+    int fd = shm_open(_name.c_str(), O_RDONLY, 0);
+
+    if (fd < 0)
+        throw std::system_error(errno, std::system_category(), "shm_ring_reader: could not open "
+            + _name);
+
+    struct stat st = {};
+
+    if (fstat(fd, &st) < 0) {
+        auto err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::system_category(), "shm_ring_reader: could not stat "
+            + _name);
+    }
+
+    auto len = (std::size_t) st.st_size;
+
+    if (len < sizeof(_header)) {
+        ::close(fd);
+        throw std::runtime_error("shm_ring_reader: " + _name + " is not a ring");
+    }
+
+    _map(fd, len, false);
+
+    bool is_ring = std::memcmp(_hdr->magic, MAGIC, sizeof(MAGIC)) == 0;
+
+    // the writer sets the magic after the other fields
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (!is_ring || _hdr->version != VERSION || _hdr->slot_len == 0 || _hdr->slot_count == 0
+            || len < _map_len(_hdr->slot_len, _hdr->slot_count))
+        throw std::runtime_error("shm_ring_reader: " + _name + " is not a ring of version "
+                                 + std::to_string(VERSION));
+
+    _slot_len = _hdr->slot_len;
+    _slot_stride = _stride(_slot_len);
+    _slot_count = _hdr->slot_count;
+    _seq = head();
+}
+
+std::uint64_t shm_ring_reader::seq() const {
+    return _seq;
+}
+
+std::uint64_t shm_ring_reader::lost() const {
+    return _lost;
+}
+
+void shm_ring_reader::rewind() {
+
+    auto head = this->head();
+    _seq = head > _slot_count ? head - _slot_count : 0;
+}
@@ -0,0 +1,195 @@
+#ifndef ZOOM_ANALYSIS_SHM_RING_H
+#define ZOOM_ANALYSIS_SHM_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+//! a ring of fixed-size records in POSIX shared memory (/dev/shm/NAME on Linux) that one process
+//! publishes to and any number of processes on the host read, without copies through files
+//! - the writer numbers the records from 0 and never waits for readers: the slot of a record is
+//!   reused once slot_count newer records are published
+//! - each slot stores the sequence number of its record, so that readers tell records they
+//!   missed (see shm_ring_reader::lost) from records being overwritten while they copy them
+class shm_ring {
+public:
+    static constexpr std::size_t DEFAULT_SLOT_COUNT = 1 << 16;
+
+    shm_ring(const shm_ring&) = delete;
+    shm_ring& operator=(const shm_ring&) = delete;
+
+    //! returns the name of the shared memory object, starting with '/'
+    [[nodiscard]] const std::string& name() const;
+
+    //! returns the bytes of a record
+    [[nodiscard]] std::size_t slot_len() const;
+    [[nodiscard]] std::size_t slot_count() const;
+
+    //! returns the sequence number of the next record to be published
+    [[nodiscard]] std::uint64_t head() const {
+        return _hdr->head.load(std::memory_order_acquire);
+    }
+
+    //! returns the name as shm_open() takes it, e.g., "/zoom" for "zoom"
+    static std::string shm_name(const std::string& name);
+
+    virtual ~shm_ring();
+
+protected:
+    static constexpr char MAGIC[8] = {'Z', 'O', 'O', 'M', 'R', 'I', 'N', 'G'};
+    static constexpr std::uint32_t VERSION = 1;
+
+    struct _header {                         // 64 Bytes
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t slot_len;
+        std::uint64_t slot_count;
+        std::atomic<std::uint64_t> head;     // sequence number of the next record
+        std::uint8_t pad[32];
+    };
+
+    //! precedes the record in each slot
+    struct _slot_header {                    // 8 Bytes
+        std::atomic<std::uint64_t> seq;      // of the record plus 1, 0 while it is written
+    };
+
+    static_assert(sizeof(_header) == 64);
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+    shm_ring() = default;
+
+    //! maps len bytes of the shared memory object, closes fd
+    void _map(int fd, std::size_t len, bool writable);
+
+    [[nodiscard]] _slot_header* _slot(std::uint64_t seq) const {
+        return (_slot_header*) (_slots + (seq % _slot_count) * _slot_stride);
+    }
+
+    //! returns the bytes of the ring for slot_count records of slot_len bytes
+    static std::size_t _map_len(std::size_t slot_len, std::size_t slot_count);
+
+    //! returns the bytes of a slot, its header and record, aligned to 8 bytes
+    static std::size_t _stride(std::size_t slot_len);
+
+    std::string _name;
+    _header* _hdr = nullptr;
+    unsigned char* _slots = nullptr;
+    std::size_t _len = 0;                    // mapped
+    std::size_t _slot_len = 0, _slot_stride = 0;
+    std::uint64_t _slot_count = 0;
+};
+
+//! creates a ring and publishes records to it
+class shm_ring_writer : public shm_ring {
+public:
+    //! creates the ring, replacing a ring of the same name (whose readers keep their mapping),
+    //! throws std::system_error upon error
+    shm_ring_writer(const std::string& name, std::size_t slot_len,
+                    std::size_t slot_count = DEFAULT_SLOT_COUNT);
+
+    //! publishes a record of len bytes, at most slot_len, the rest of the slot is set to 0
+    void publish(const void* data, std::size_t len) {
+
+        if (len > _slot_len)
+            throw std::logic_error("shm_ring_writer: record of " + std::to_string(len)
+                                   + " bytes exceeds slot_len");
+
+        auto* slot = _slot(_head);
+        auto* record = (unsigned char*) (slot + 1);
+
+        // readers that copy the slot meanwhile see the sequence number change
+        slot->seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        std::memcpy(record, data, len);
+        std::memset(record + len, 0, _slot_len - len);
+
+        slot->seq.store(++_head, std::memory_order_release);
+        _hdr->head.store(_head, std::memory_order_release);
+    }
+
+    template <typename T>
+    void publish(const T& record) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        publish(&record, sizeof(record));
+    }
+
+    //! removes the name of the ring, readers attached keep their mapping
+    ~shm_ring_writer() override;
+
+private:
+    std::uint64_t _head = 0;
+};
+
+//! attaches to a ring and reads the records published from then on
+class shm_ring_reader : public shm_ring {
+public:
+    //! attaches to the ring at its head, throws std::system_error if it cannot be opened and
+    //! std::runtime_error if it is not a ring
+    explicit shm_ring_reader(const std::string& name);
+
+    //! copies the next record (slot_len bytes) to data, returns false if it is not yet published
+    //! - skips records overwritten before they were copied, see lost()
+    bool next(void* data) {
+
+        for (;;) {
+
+            auto head = this->head();
+
+            if (_seq >= head)
+                return false;
+
+            if (head - _seq > _slot_count) {
+                _lost += head - _slot_count - _seq;
+                _seq = head - _slot_count;
+            }
+
+            auto* slot = _slot(_seq);
+
+            if (slot->seq.load(std::memory_order_acquire) == _seq + 1) {
+
+                std::memcpy(data, slot + 1, _slot_len);
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (slot->seq.load(std::memory_order_relaxed) == _seq + 1) {
+                    _seq++;
+                    return true;
+                }
+            }
+
+            // the writer reused the slot
+            _lost++;
+            _seq++;
+        }
+    }
+
+    //! copies the next record to record, whose size must be slot_len
+    template <typename T>
+    bool next(T& record) {
+
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        if (sizeof(record) != _slot_len)
+            throw std::logic_error("shm_ring_reader: record size does not match slot_len");
+
+        return next((void*) &record);
+    }
+
+    //! returns the sequence number of the next record to read
+    [[nodiscard]] std::uint64_t seq() const;
+
+    //! returns the records skipped because the writer reused their slots before they were read
+    [[nodiscard]] std::uint64_t lost() const;
+
+    //! continues with the oldest record in the ring
+    void rewind();
+
+private:
+    std::uint64_t _seq = 0;
+    std::uint64_t _lost = 0;
+};
+
+#endif
@@ -1,4 +1,5 @@
 
+#include <chrono>
 #include <vector>
 #include <filesystem>
 
@@ -6,11 +7,17 @@
 #define ZOOM_ANALYSIS_SIMPLE_BINARY_READER_H
 
 #include "file_stream.h"
+#include "io_stats.h"
 
+//! reads a file of T records
+//! - without use_buffer, reads BLOCK_LEN records per read call and times the read calls (see io)
+//! - with use_buffer, reads the whole file in the constructor
 template <typename T>
 class simple_binary_reader : public file_stream
 {
 public:
+    static constexpr std::size_t BLOCK_LEN = 4096;
+
     explicit simple_binary_reader(const std::string& file_name, bool use_buffer = false)
             : file_stream(file_name, std::ios::binary | std::ios::in),
               _file_name(file_name),
@@ -19,11 +26,14 @@ public:
         T t;
 
         if (_use_buffer) {
+            auto start = std::chrono::high_resolution_clock::now();
+
             while (!_eof()) {
                 _stream.read((char*) &t, sizeof(T));
                 _data.push_back(t);
             }
             _iter = std::begin(_data);
+            _read_time += std::chrono::high_resolution_clock::now() - start;
         }
     }
 
@@ -32,13 +42,22 @@ public:
         if (_count == 0)
             _start = std::chrono::high_resolution_clock::now();
 
-        if (_use_buffer)
+        if (_use_buffer) {
             t = *(_iter++);
-        else
-            _stream.read((char*) &t, sizeof(T));
 
-        if (done())
-            return false;
+            if (done())
+                return false;
+        } else {
+            if (_block_pos == _block_len)
+                _read_block();
+
+            if (_block_pos == _block_len) {
+                _end = std::chrono::high_resolution_clock::now();
+                return false;
+            }
+
+            t = _block[_block_pos++];
+        }
 
         _count++;
         return true;
@@ -53,6 +72,19 @@ public:
         return _count;
     }
 
+    //! returns the bytes and records read so far and the time spent within and between read calls
+    //! - with use_buffer, the read time is the time spent reading the file in the constructor
+    [[nodiscard]] io_stats io() {
+
+        io_stats io;
+        io.byte_count = _count * sizeof(T);
+        io.pkt_count = _count;
+        io.read_time = std::chrono::duration<double>(_read_time).count();
+        io.total_time = (_count || done() ? time_in_loop() : 0.0)
+            + (_use_buffer ? io.read_time : 0.0);
+        return io;
+    }
+
     [[nodiscard]] double time_in_loop() {
 
         if (!done()) {
@@ -66,10 +98,12 @@ public:
     }
 
     void reset() {
-        if (_use_buffer)
+        if (_use_buffer) {
             _iter = std::begin(_data);
-        else
+        } else {
             _reset();
+            _block_pos = _block_len = 0;
+        }
     }
 
     bool done() {
@@ -80,7 +114,7 @@ public:
                 return true;
             }
         } else {
-            if (_eof()) {
+            if (_block_pos == _block_len && _eof()) {
                 _end = std::chrono::high_resolution_clock::now();
                 return true;
             }
@@ -92,12 +126,28 @@ public:
     ~simple_binary_reader() override = default;
 
 private:
+    //! reads the next block of records, a partial record at the end of the file is ignored
+    void _read_block() {
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        _block.resize(BLOCK_LEN);
+        _stream.read((char*) _block.data(), (std::streamsize) (BLOCK_LEN * sizeof(T)));
+        _block_len = (std::size_t) _stream.gcount() / sizeof(T);
+        _block_pos = 0;
+
+        _read_time += std::chrono::high_resolution_clock::now() - start;
+    }
+
     std::string _file_name;
     bool _use_buffer;
     std::vector<T> _data;
     typename std::vector<T>::const_iterator _iter;
+    std::vector<T> _block;
+    std::size_t _block_pos = 0, _block_len = 0;
     unsigned long _count = 0;
     std::chrono::high_resolution_clock::time_point _start, _end;
+    std::chrono::high_resolution_clock::duration _read_time {};
 };
 
 #endif
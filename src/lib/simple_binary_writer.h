@@ -1,25 +1,69 @@
 #ifndef ZOOM_ANALYSIS_SIMPLE_BINARY_WRITER_H
 #define ZOOM_ANALYSIS_SIMPLE_BINARY_WRITER_H
 
+#include "async_writer.h"
+#include "file_rotation.h"
 #include "file_stream.h"
 
+//! writes a file of T records
+//! - with rotation, writes a sequence of files
+//! - with a writer, writes the files on its background thread
 template <typename T>
 class simple_binary_writer : public file_stream {
 public:
 
     simple_binary_writer() = default;
 
-    explicit simple_binary_writer(const std::string& file_name)
-        : file_stream(file_name, std::ios::binary | std::ios::out) { }
+    explicit simple_binary_writer(const std::string& file_name,
+                                  const file_rotation& rotation = {}) {
+        open(file_name, rotation);
+    }
+
+    //! the writer must outlive this one
+    void open(const std::string& file_name, const file_rotation& rotation = {},
+              async_writer* writer = nullptr) {
 
-    void open(const std::string& file_name) {
-        file_stream::open(file_name, std::ios::binary | std::ios::out);
+        _base_name = file_name;
+        _rotation = rotation;
+        _writer = writer;
+        _open_file(0);
     }
 
     //! writes t to the file
     void write(const T& t) {
-        _stream.write((char*) &t, sizeof(T));
+
+        if (_rotation.enabled()
+            && _rotation.due(_file_start, _file_count * sizeof(T), sizeof(T), _file_count > 0)) {
+            close();
+            _open_file(_file_seq + 1);
+        }
+
+        if (_writer) {
+            _async.write((const char*) &t, sizeof(T));
+        } else {
+            _stream.write((const char*) &t, sizeof(T));
+        }
         _count++;
+        _file_count++;
+    }
+
+    //! writes buffered entries to the file (or queues them for the writer)
+    void flush() {
+
+        if (_writer) {
+            _async.flush();
+        } else {
+            file_stream::flush();
+        }
+    }
+
+    void close() override {
+
+        if (_writer) {
+            _async.close();
+        } else {
+            file_stream::close();
+        }
     }
 
     //! returns number of entries written so far
@@ -27,7 +71,39 @@ public:
         return _count;
     }
 
+    //! returns the name of the file currently written, see file_rotation
+    [[nodiscard]] const std::string& file_name() const {
+        return _file_name;
+    }
+
+    //! returns the number of files opened so far, more than one with rotation
+    [[nodiscard]] unsigned file_count() const {
+        return _file_name.empty() ? 0 : _file_seq + 1;
+    }
+
 private:
+    void _open_file(unsigned seq) {
+
+        _file_name = _rotation.enabled() ? file_rotation::file_name(_base_name, seq) : _base_name;
+
+        if (_writer) {
+            _async.open(*_writer, _file_name);
+        } else {
+            file_stream::open(_file_name, std::ios::binary | std::ios::out);
+        }
+
+        _file_seq = seq;
+        _file_count = 0;
+        _file_start = std::chrono::steady_clock::now();
+    }
+
+    std::string _base_name, _file_name;
+    async_writer* _writer = nullptr;
+    async_writer::stream _async;
+    file_rotation _rotation;
+    unsigned _file_seq = 0;
+    unsigned long _file_count = 0;
+    std::chrono::steady_clock::time_point _file_start;
     unsigned long _count = 0;
 };
 
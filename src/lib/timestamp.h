@@ -0,0 +1,45 @@
+#ifndef ZOOM_ANALYSIS_TIMESTAMP_H
+#define ZOOM_ANALYSIS_TIMESTAMP_H
+
+#include <cstdint>
+#include <sys/time.h>
+
+//! nanoseconds since the epoch, compared and subtracted as a single integer
+//! - covers the years 1678 to 2262
+typedef std::int64_t timestamp_ns;
+
+namespace timestamp {
+
+    const std::int64_t NS_PER_SEC = 1000000000;
+    const std::int64_t NS_PER_MS  = 1000000;
+    const std::int64_t NS_PER_US  = 1000;
+
+    inline timestamp_ns from_sec(std::int64_t s, std::int64_t ns = 0) {
+        return s * NS_PER_SEC + ns;
+    }
+
+    inline timestamp_ns from_timeval(const timeval& tv) {
+        return from_sec(tv.tv_sec, (std::int64_t) tv.tv_usec * NS_PER_US);
+    }
+
+    //! returns the whole seconds of a timestamp (rounded down, also before the epoch)
+    inline std::int64_t sec(timestamp_ns t) {
+        return t / NS_PER_SEC - (t % NS_PER_SEC < 0);
+    }
+
+    //! returns the nanoseconds of a timestamp within its second
+    inline std::int64_t subsec_ns(timestamp_ns t) {
+        return t - sec(t) * NS_PER_SEC;
+    }
+
+    //! returns the microseconds of a timestamp within its second (rounded down)
+    inline std::int64_t subsec_us(timestamp_ns t) {
+        return subsec_ns(t) / NS_PER_US;
+    }
+
+    inline timeval to_timeval(timestamp_ns t) {
+        return { (time_t) sec(t), (suseconds_t) subsec_us(t) };
+    }
+}
+
+#endif
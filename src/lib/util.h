@@ -86,11 +86,28 @@ namespace util {
         return result;
     }
 
+    /*!
+     * returns the extension of a file path ignoring a compressed suffix
+     *
+     * - e.g., ".pcap2" for both test.pcap2 and test.pcap2.zst (see file_decoder)
+     */
+    static std::string extension_without_compression(const std::filesystem::path& path) {
+
+        auto extension_str = path.extension().string();
+
+        if (extension_str == ".gz" || extension_str == ".zst") {
+            return path.stem().extension().string();
+        } else {
+            return extension_str;
+        }
+    }
+
     /*!
      * returns list of non-hidden file paths inside a directory
      *
      * - returns list with single path entry if file name provided
      * - optionally filters by beginning of extension string (e.g., "pcap" matches "pcapX")
+     * - the extension is taken before a compressed suffix (e.g., "pcap" matches "pcapX.gz")
      */
     static std::vector<std::string> files_in_directory(const std::string& file_or_directory,
                                                 const std::string& limit_ext_start = "") {
@@ -106,13 +123,13 @@ namespace util {
             for (auto const& dir_entry: std::filesystem::directory_iterator{in_path}) {
 
                 const auto path_str = dir_entry.path().string();
-                const auto extension_str = dir_entry.path().extension().string();
+                const auto extension_str = extension_without_compression(dir_entry.path());
                 const auto name_str = dir_entry.path().filename().string();
 
                 // checks if path is regular file (no dir, links, ., .., etc.) and non-hidden
                 if (dir_entry.is_regular_file() && name_str[0] != '.') {
                     if (!limit_ext_start.empty()) {
-                        if (extension_str.find_first_of(limit_ext_start) != std::string::npos) {
+                        if (extension_str.rfind("." + limit_ext_start, 0) == 0) {
                             files.push_back(path_str);
                         }
                     } else {
@@ -136,13 +153,15 @@ namespace util {
      * compares numbers appended to a file extension
      *
      * - e.g., test.pcap2 < test.pcap10 (unlike lexicographical comparison)
+     * - ignores compressed suffixes, e.g., test.pcap2.zst < test.pcap10.zst
      * - falls back to lexicographical ordering when no numeric ending found
      * - use with std::sort, e.g., std::sort(v.begin(), v.end(), util::compare_file_ext_seq)
      */
     static bool compare_file_ext_seq(const std::string& a, const std::string& b) {
 
         std::filesystem::path path_a{a}, path_b{b};
-        auto ext_a = path_a.extension().string(), ext_b = path_b.extension().string();
+        auto ext_a = extension_without_compression(path_a);
+        auto ext_b = extension_without_compression(path_b);
         auto seq_pos_a = ext_a.find_first_of("0123456789", 0);
         auto seq_pos_b = ext_b.find_first_of("0123456789", 0);
 
@@ -1,5 +1,7 @@
 #include "zoom.h"
 
+#include <algorithm>
+
 char zoom::media_type_to_char(zoom::media_type t) {
 
     switch (t) {
@@ -92,10 +94,7 @@ zoom::pkt::pkt()
     flags.from_srv = 0;
 }
 
-zoom::pkt::pkt(const struct zoom::headers& hdr, timeval tv, bool is_p2p) {
-
-    ts.s = tv.tv_sec;
-    ts.us = tv.tv_usec;
+zoom::pkt::pkt(const struct zoom::headers& hdr, timestamp_ns ts, bool is_p2p) : ts(ts) {
 
     flags.p2p = is_p2p ? 1 : 0;
     flags.srv = is_p2p ? 0 : 1;
@@ -104,21 +103,24 @@ zoom::pkt::pkt(const struct zoom::headers& hdr, timeval tv, bool is_p2p) {
     ip_5t.ip_dst = ntohl(hdr.ip->dst_addr);
     ip_5t.ip_proto = hdr.ip->next_proto_id;
 
-    if (ip_5t.ip_proto == 17) {
+    if (ip_5t.ip_proto == 17 && hdr.udp) {
         ip_5t.tp_src = ntohs(hdr.udp->src_port);
         ip_5t.tp_dst = ntohs(hdr.udp->dst_port);
         udp_pl_len = ntohs(hdr.udp->dgram_len);
     }
 
-    if (!is_p2p) {
+    if (!is_p2p && hdr.zoom_outer) {
         zoom_srv_type = hdr.zoom_outer[0];
         flags.to_srv = (hdr.zoom_outer[7] == 0x00);
         flags.from_srv = (hdr.zoom_outer[7] == 0x04);
     }
 
-    zoom_media_type = hdr.zoom_inner[0];
+    if (hdr.zoom_inner) {
+        zoom_media_type = hdr.zoom_inner[0];
+    }
 
-    if (zoom_media_type == 0x10) {
+    // the frame's packet count precedes the RTP header
+    if (zoom_media_type == 0x10 && hdr.rtp) {
         pkts_in_frame = hdr.zoom_inner[23];
     }
 
@@ -169,91 +171,140 @@ zoom::media_stream_meta zoom::media_stream_meta::from_pkt(const zoom::pkt& pkt)
     };
 }
 */
-struct zoom::headers zoom::parse_zoom_pkt_buf(const unsigned char* buf, bool includes_eth, bool is_p2p) {
+struct zoom::headers zoom::parse_zoom_pkt_buf(const unsigned char* buf, unsigned ip_offset,
+                                              bool is_p2p, unsigned cap_len) {
 
     struct headers hdr;
-    unsigned eth_offset = includes_eth ? net::eth::HDR_LEN : 0;
 
-    hdr.ip = (net::ipv4::hdr*) (buf + eth_offset);
+    if (cap_len < ip_offset + net::ipv4::HDR_LEN) {
+        hdr.truncated = true;
+        return hdr;
+    }
+
+    hdr.ip = (net::ipv4::hdr*) (buf + ip_offset);
+
+    // bytes past the IPv4 packet are link-layer padding, the length is 0 for packets captured
+    // before TCP segmentation offload
+    unsigned ip_len = ntohs(hdr.ip->total_length);
+    bool has_ip_len = ip_len >= hdr.ip->ihl_bytes();
+    unsigned end = has_ip_len ? std::min(cap_len, ip_offset + ip_len) : cap_len;
+
+    // whether the capture (e.g., its snaplen) cut off a part of the packet
+    bool snapped = has_ip_len && cap_len < ip_offset + ip_len;
+
+    auto captured = [end](unsigned offset, unsigned len) { return offset + len <= end; };
 
     if (hdr.ip->next_proto_id == 17) {
 
-        hdr.udp = (net::udp::hdr*) (buf + eth_offset + hdr.ip->ihl_bytes());
-        hdr.udp_pl_offset = eth_offset + hdr.ip->ihl_bytes() + net::udp::HDR_LEN;
+        if (!captured(ip_offset + hdr.ip->ihl_bytes(), net::udp::HDR_LEN)) {
+            hdr.truncated = snapped;
+            return hdr;
+        }
+
+        hdr.udp = (net::udp::hdr*) (buf + ip_offset + hdr.ip->ihl_bytes());
+        hdr.udp_pl_offset = ip_offset + hdr.ip->ihl_bytes() + net::udp::HDR_LEN;
         auto* udp_pl = buf + hdr.udp_pl_offset;
 
-        if (is_p2p) {
-            hdr.zoom_inner = udp_pl;
-        } else {
-            hdr.zoom_outer = udp_pl;
+        unsigned srv_offset = is_p2p ? 0 : SRV_HDR_LEN;
+        unsigned inner_offset = hdr.udp_pl_offset;
 
-            if (hdr.zoom_outer[0] == SRV_MEDIA_TYPE) {
-                hdr.zoom_inner = udp_pl + 8;
+        if (!is_p2p) {
+
+            if (!captured(hdr.udp_pl_offset, SRV_HDR_LEN)) {
+                hdr.truncated = snapped;
+                return hdr;
             }
-        }
 
-        if (!is_p2p && udp_pl[0] == SRV_MEDIA_TYPE) {
             hdr.zoom_outer = udp_pl;
-            hdr.zoom_inner = udp_pl + 8;
-        } else {
-            hdr.zoom_inner = udp_pl;
+            inner_offset += udp_pl[0] == SRV_MEDIA_TYPE ? SRV_HDR_LEN : 0;
         }
 
-        if (hdr.zoom_inner && (hdr.zoom_inner[0] == AUDIO_TYPE
-            || hdr.zoom_inner[0] == VIDEO_TYPE
-            || (is_p2p && hdr.zoom_inner[0] == P2P_SCREEN_SHARE_TYPE))
-            || (!is_p2p && hdr.zoom_inner[0] == SRV_SCREEN_SHARE_TYPE
-                && hdr.zoom_inner[7] == P2P_SCREEN_SHARE_TYPE)
-            || (hdr.zoom_inner[0] == RTCP_SR_TYPE
-                || hdr.zoom_inner[0] == RTCP_SR_SD_TYPE)) {
-
-            if (hdr.zoom_inner[0] == AUDIO_TYPE) {
-                hdr.rtp_rtcp_offset = hdr.udp_pl_offset + (is_p2p ? 0 : 8) + 19;
-                hdr.rtp = (rtp::hdr*) (buf + hdr.rtp_rtcp_offset);
-            } else if (hdr.zoom_inner[0] == VIDEO_TYPE) {
-
-                if (hdr.zoom_inner[20] == 0x02) {
-                    hdr.rtp_rtcp_offset = hdr.udp_pl_offset + (is_p2p ? 0 : 8) + 24;
-                    hdr.rtp = (rtp::hdr*) (buf + hdr.rtp_rtcp_offset);
-                } else {
-                    hdr.rtp_rtcp_offset = hdr.udp_pl_offset + (is_p2p ? 0 : 8) + 20;
-                    hdr.rtp = (rtp::hdr*) (buf + hdr.rtp_rtcp_offset);
-                }
+        if (!captured(inner_offset, 1)) {
+            hdr.truncated = snapped;
+            return hdr;
+        }
 
-            } else if (is_p2p && hdr.zoom_inner[0] == P2P_SCREEN_SHARE_TYPE) {
-                hdr.rtp_rtcp_offset = hdr.udp_pl_offset + 20;
-                hdr.rtp = (rtp::hdr*) (buf + hdr.rtp_rtcp_offset);
-            } else if (!is_p2p && hdr.zoom_inner[0] == SRV_SCREEN_SHARE_TYPE
-                && hdr.zoom_inner[7] == P2P_SCREEN_SHARE_TYPE) {
-                hdr.rtp_rtcp_offset = hdr.udp_pl_offset + 35;
-                hdr.rtp = (rtp::hdr*) (buf + hdr.rtp_rtcp_offset);
-            } else if (hdr.zoom_inner[0] == RTCP_SR_TYPE || hdr.zoom_inner[0] == RTCP_SR_SD_TYPE) {
-                hdr.rtp_rtcp_offset = hdr.udp_pl_offset + (is_p2p ? 0 : 8) + 16;
+        hdr.zoom_inner = buf + inner_offset;
+
+        // byte i of the inner header, 0 (no type) if not captured
+        auto inner = [&](unsigned i) {
+            return captured(inner_offset + i, 1) ? hdr.zoom_inner[i] : (unsigned char) 0;
+        };
+
+        if (inner(0) == AUDIO_TYPE) {
+            hdr.rtp_rtcp_offset = hdr.udp_pl_offset + srv_offset + 19;
+        } else if (inner(0) == VIDEO_TYPE) {
+            hdr.rtp_rtcp_offset = hdr.udp_pl_offset + srv_offset + (inner(20) == 0x02 ? 24 : 20);
+        } else if (is_p2p && inner(0) == P2P_SCREEN_SHARE_TYPE) {
+            hdr.rtp_rtcp_offset = hdr.udp_pl_offset + 20;
+        } else if (!is_p2p && inner(0) == SRV_SCREEN_SHARE_TYPE
+            && inner(7) == P2P_SCREEN_SHARE_TYPE) {
+            hdr.rtp_rtcp_offset = hdr.udp_pl_offset + 35;
+        } else if (inner(0) == RTCP_SR_TYPE || inner(0) == RTCP_SR_SD_TYPE) {
+            hdr.rtp_rtcp_offset = hdr.udp_pl_offset + srv_offset + 16;
+
+            // sender reports up to the RTP timestamp of the sender info, see zoom::pkt
+            if (captured(hdr.rtp_rtcp_offset, rtcp::HDR_LEN)
+                && (buf[hdr.rtp_rtcp_offset + 1] != 200
+                    || captured(hdr.rtp_rtcp_offset, rtcp::HDR_LEN + 12))) {
                 hdr.rtcp = (rtcp::hdr*) (buf + hdr.rtp_rtcp_offset);
+                hdr.hdr_end = hdr.rtp_rtcp_offset + rtcp::HDR_LEN
+                    + (hdr.rtcp->pt == 200 ? 12 : 0);
+            } else {
+                hdr.truncated = snapped;
             }
 
-            if (hdr.rtp && hdr.rtp->extension()) { // get rtp extension header with type == 1
+            return hdr;
+        } else {
+            hdr.truncated = snapped && !captured(inner_offset, 8); // type might depend on byte 7
+            return hdr;
+        }
+
+        if (!captured(hdr.rtp_rtcp_offset, rtp::HDR_LEN)) {
+            hdr.truncated = snapped;
+            return hdr;
+        }
+
+        hdr.rtp = (rtp::hdr*) (buf + hdr.rtp_rtcp_offset);
+        hdr.hdr_end = hdr.rtp_rtcp_offset + rtp::HDR_LEN;
 
-                auto* rtp_ext_ptr = buf + hdr.rtp_rtcp_offset + rtp::HDR_LEN;
-                auto ext_bytes =  (rtp_ext_ptr[2] << 8) + (rtp_ext_ptr[3]) * 4;
+        if (hdr.rtp->extension()) { // get rtp extension header with type == 1
 
-                for (auto ext_byte_i = 4; ext_byte_i < 4 + ext_bytes;) {
-                    if (rtp_ext_ptr[ext_byte_i] != 0) { // 0 -> padding byte
+            auto ext_offset = hdr.rtp_rtcp_offset + rtp::HDR_LEN;
 
-                        auto type = (rtp_ext_ptr[ext_byte_i] >> 4) & 0x0f;
-                        auto len = (rtp_ext_ptr[ext_byte_i] & 0x0f) + 1;
+            if (!captured(ext_offset, 4)) {
+                hdr.rtp_ext_truncated = snapped;
+                hdr.hdr_end = end;
+                return hdr;
+            }
 
-                        if (type == 1 && len == 3) {
-                            std::memcpy(hdr.rtp_ext1, rtp_ext_ptr + ext_byte_i + 1, 3);
-                            break;
-                        }
+            auto* rtp_ext_ptr = buf + ext_offset;
+            unsigned ext_bytes = ((rtp_ext_ptr[2] << 8) | rtp_ext_ptr[3]) * 4;
+            bool found = false;
 
-                        ext_byte_i += (len + 1);
-                    } else {
-                        ext_byte_i++;
+            hdr.hdr_end = std::min(end, ext_offset + 4 + ext_bytes);
+
+            for (unsigned ext_byte_i = 4; ext_byte_i < 4 + ext_bytes
+                 && captured(ext_offset + ext_byte_i, 1);) {
+
+                if (rtp_ext_ptr[ext_byte_i] != 0) { // 0 -> padding byte
+
+                    auto type = (rtp_ext_ptr[ext_byte_i] >> 4) & 0x0f;
+                    auto len = (rtp_ext_ptr[ext_byte_i] & 0x0f) + 1;
+
+                    if (type == 1 && len == 3 && captured(ext_offset + ext_byte_i + 1, 3)) {
+                        std::memcpy(hdr.rtp_ext1, rtp_ext_ptr + ext_byte_i + 1, 3);
+                        found = true;
+                        break;
                     }
+
+                    ext_byte_i += (len + 1);
+                } else {
+                    ext_byte_i++;
                 }
             }
+
+            hdr.rtp_ext_truncated = !found && snapped && !captured(ext_offset, 4 + ext_bytes);
         }
     }
 
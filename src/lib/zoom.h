@@ -2,9 +2,11 @@
 #define ZOOM_ANALYSIS_ZOOM_H
 
 #include <arpa/inet.h>
+#include <limits>
 
 #include "rtp.h"
 #include "rtcp.h"
+#include "timestamp.h"
 
 namespace zoom {
 
@@ -16,6 +18,8 @@ namespace zoom {
     const std::uint8_t RTCP_SR_TYPE          = 0x21;
     const std::uint8_t RTCP_SR_SD_TYPE       = 0x22;
 
+    const unsigned SRV_HDR_LEN = 8; // outer header of packets relayed by a server
+
     struct headers {
         const net::ipv4::hdr* ip        = nullptr;
         const net::udp::hdr* udp        = nullptr;
@@ -27,20 +31,24 @@ namespace zoom {
 
         unsigned udp_pl_offset          = 0;
         unsigned rtp_rtcp_offset        = 0;
+        //! end of the RTP header and header extension, or of the RTCP header and sender info,
+        //! within the bytes captured; 0 for packets without RTP or RTCP header
+        //! - the packet cut off here parses to the same headers (see zoom_flows -H)
+        unsigned hdr_end                = 0;
+
+        //! the capture cut off a part of the headers above (e.g., with a small snaplen)
+        bool truncated                  = false;
+        //! the capture cut off the RTP header extension before the extension of type 1
+        bool rtp_ext_truncated          = false;
     };
 
     struct pkt {
 
         pkt();
-        pkt(const struct zoom::headers& hdr, timeval tv, bool is_p2p);
+        pkt(const struct zoom::headers& hdr, timestamp_ns ts, bool is_p2p);
         pkt(const pkt&) = default;
         pkt& operator=(const pkt&) = default;
 
-        struct ts {
-            std::uint32_t s  = 0;
-            std::uint32_t us = 0;
-        };
-
         struct flags {
             std::uint8_t p2p      : 1;
             std::uint8_t srv      : 1;
@@ -74,7 +82,7 @@ namespace zoom {
             rtcp_data rtcp;
         };
 
-        ts ts                        = {};  //  8 Bytes
+        timestamp_ns ts              = 0;   //  8 Bytes
         net::ipv4_5tuple ip_5t       = {};  // 16 Bytes
         flags flags                  = {};  //  1 Byte
         std::uint8_t zoom_srv_type   = 0;   //  1 Byte
@@ -144,8 +152,13 @@ namespace zoom {
         unsigned pkts_hint        = 0;
     };
 
+    //! parses the headers of a Zoom packet whose IPv4 header starts at ip_offset of buf
+    //! - see link_layer::frame for the offset in frames of other link types than Ethernet
+    //! - reads only the cap_len bytes of buf and within the IPv4 packet's length, so that only
+    //!   the headers captured are set (see headers::truncated)
     [[nodiscard]] struct headers parse_zoom_pkt_buf(const unsigned char* buf,
-            bool includes_eth = true, bool is_p2p = false);
+            unsigned ip_offset = net::eth::HDR_LEN, bool is_p2p = false,
+            unsigned cap_len = std::numeric_limits<unsigned>::max());
 }
 
 #endif
@@ -1,49 +1,166 @@
 #include "zoom_analyzer.h"
 
+#include <system_error>
+
+using column_type = arrow_writer::column_type;
+
 void zoom::analyzer::enable_pkt_log(const std::string &file_path)
 {
 
-    _pkt_log.open(file_path);
-
-    _pkt_log.stream << "#ts_s,ts_us,dir,flow_type,ip_proto,ip_src,tp_src,ip_dst,tp_dst,media_type,"
-                    << "pkts_in_frame,ssrc,pt,rtp_seq,rtp_ts,pl_len,rtp_ext1,drop" << std::endl;
+    if (pkt_log_writer::is_pkt_log_file_name(file_path))
+    {
+        try
+        {
+            _pkt_bin_log.open(file_path, &_writer());
+        }
+        catch (const std::system_error&)
+        {
+            throw std::runtime_error("zoom::analyzer: could not open log file at " + file_path);
+        }
+
+        _pkt_log.enabled = true;
+        return;
+    }
+
+    _pkt_log.open(_writer(), file_path, {
+        {"ts_s", column_type::int64}, {"ts_us", column_type::uint32},
+        {"dir", column_type::utf8}, {"flow_type", column_type::utf8, true},
+        {"ip_proto", column_type::uint8}, {"ip_src", column_type::utf8},
+        {"tp_src", column_type::uint16}, {"ip_dst", column_type::utf8},
+        {"tp_dst", column_type::uint16}, {"media_type", column_type::utf8, true},
+        {"pkts_in_frame", column_type::uint16, true}, {"ssrc", column_type::uint32},
+        {"pt", column_type::uint8}, {"rtp_seq", column_type::uint16},
+        {"rtp_ts", column_type::uint32}, {"pl_len", column_type::uint16},
+        {"rtp_ext1", column_type::uint32, true}, {"drop", column_type::uint8}});
+
+    if (!_pkt_log.arrow)
+    {
+        _pkt_log.csv.append(PKT_LOG_CSV_HEADER).end_row();
+    }
 }
 
 void zoom::analyzer::enable_frame_log(const std::string &file_path)
 {
 
-    _frame_log.open(file_path);
-
-    _frame_log.stream << "ip_proto,ip_src,tp_src,ip_dst,tp_dst,ssrc,media_type,rtp_ext1,"
-                      << "min_ts_s, min_ts_us,max_ts_s,max_ts_us,rtp_ts,pkts_seen,pkts_hint,"
-                      << "frame_size,fps,jitter_ms, times, rtps, diff, group"
-                      << std::endl;
+    _frame_log.open(_writer(), file_path, {
+        {"ip_proto", column_type::uint8}, {"ip_src", column_type::utf8},
+        {"tp_src", column_type::uint16}, {"ip_dst", column_type::utf8},
+        {"tp_dst", column_type::uint16}, {"ssrc", column_type::uint32},
+        {"media_type", column_type::uint8}, {"rtp_ext1", column_type::uint32},
+        {"min_ts_s", column_type::int64}, {"min_ts_us", column_type::uint32},
+        {"max_ts_s", column_type::int64}, {"max_ts_us", column_type::uint32},
+        {"rtp_ts", column_type::uint32}, {"pkts_seen", column_type::uint32},
+        {"pkts_hint", column_type::uint32}, {"frame_size", column_type::uint32},
+        {"fps", column_type::uint32}, {"jitter_ms", column_type::float64},
+        {"times", column_type::float64}, {"rtps", column_type::float64},
+        {"diff", column_type::float64}, {"group", column_type::uint32}});
+
+    if (!_frame_log.arrow)
+    {
+        _frame_log.csv.append("ip_proto,ip_src,tp_src,ip_dst,tp_dst,ssrc,media_type,rtp_ext1,"
+                              "min_ts_s, min_ts_us,max_ts_s,max_ts_us,rtp_ts,pkts_seen,"
+                              "pkts_hint,frame_size,fps,jitter_ms, times, rtps, diff, group")
+                      .end_row();
+    }
 }
 
 void zoom::analyzer::enable_streams_log(const std::string &file_path)
 {
 
-    _streams_log.open(file_path);
+    _streams_log.open(_writer(), file_path);
 }
 
 void zoom::analyzer::enable_stats_log(const std::string &file_path)
 {
 
-    _stats_log.open(file_path);
+    _stats_log.open(_writer(), file_path, {
+        {"ts_s", column_type::uint32}, {"report_count", column_type::uint32},
+        {"rtp_ssrc", column_type::uint32}, {"media_type", column_type::utf8},
+        {"stream_type", column_type::utf8}, {"ip_src", column_type::utf8},
+        {"tp_src", column_type::uint16}, {"ip_dst", column_type::utf8},
+        {"tp_dst", column_type::uint16}, {"pkts", column_type::uint64},
+        {"bytes", column_type::uint64}, {"lost", column_type::uint64},
+        {"duplicate", column_type::uint64}, {"out_of_order", column_type::uint64},
+        {"frames", column_type::uint64}, {"mean_frame_len", column_type::float64},
+        {"mean_jitter", column_type::float64}});
+
+    if (!_stats_log.arrow)
+    {
+        _stats_log.csv.append("ts_s,report_count,rtp_ssrc,media_type,stream_type,ip_src,tp_src,"
+                              "ip_dst,tp_dst,pkts,bytes,lost,duplicate,out_of_order,frames,"
+                              "mean_frame_len,mean_jitter").end_row();
+    }
+}
+
+void zoom::analyzer::enable_event_ring(const std::string &name, std::size_t slot_count)
+{
 
-    _stats_log.stream << "ts_s,report_count,rtp_ssrc,media_type,stream_type,ip_src,tp_src,ip_dst,"
-                      << "tp_dst,pkts,bytes,lost,duplicate,out_of_order,frames,mean_frame_len,"
-                      << "mean_jitter" << std::endl;
+    try
+    {
+        _event_ring = std::make_unique<shm_ring_writer>(name, sizeof(event), slot_count);
+    }
+    catch (const std::system_error&)
+    {
+        throw std::runtime_error("zoom::analyzer: could not create event ring " + name);
+    }
 }
 
-void zoom::analyzer::_log::open(const std::string &file_path)
+void zoom::analyzer::close_logs()
 {
 
-    stream.open(file_path);
-    enabled = true;
+    for (auto* log : { &_pkt_log, &_frame_log, &_streams_log, &_stats_log })
+    {
+        if (log->stream.is_open())
+            log->close();
+    }
 
-    if (!stream.is_open())
+    if (_pkt_bin_log.is_open())
+        _pkt_bin_log.close();
+
+    if (_log_writer)
+        _log_writer->drain();
+}
+
+const async_writer* zoom::analyzer::log_writer() const
+{
+
+    return _log_writer.get();
+}
+
+const shm_ring_writer* zoom::analyzer::event_ring() const
+{
+
+    return _event_ring.get();
+}
+
+async_writer& zoom::analyzer::_writer()
+{
+
+    if (!_log_writer)
+        _log_writer = std::make_unique<async_writer>();
+
+    return *_log_writer;
+}
+
+void zoom::analyzer::_log::open(async_writer& writer, const std::string &file_path,
+                                const std::vector<arrow_writer::field>& arrow_schema)
+{
+
+    try
+    {
+        stream.open(writer, file_path);
+    }
+    catch (const std::system_error&)
+    {
         throw std::runtime_error("zoom::analyzer: could not open log file at " + file_path);
+    }
+
+    if (!arrow_schema.empty() && arrow_writer::is_arrow_file_name(file_path))
+    {
+        arrow = std::make_unique<arrow_writer>(stream, arrow_schema);
+    }
+
+    enabled = true;
 }
 
 void zoom::analyzer::_log::close()
@@ -52,5 +169,11 @@ void zoom::analyzer::_log::close()
     if (!stream.is_open())
         throw std::logic_error("zoom::analyzer: could not close log file: file is not open");
 
+    if (arrow)
+    {
+        arrow->close();
+    }
+
+    csv.flush();
     stream.close();
 }
@@ -2,8 +2,15 @@
 #ifndef ZOOM_ANALYSIS_ZOOM_ANALYZER_H
 #define ZOOM_ANALYSIS_ZOOM_ANALYZER_H
 
+#include <memory>
 #include <string>
-#include <fstream>
+
+#include "arrow_writer.h"
+#include "async_writer.h"
+#include "csv_writer.h"
+#include "shm_ring.h"
+#include "zoom_events.h"
+#include "zoom_pkt_log.h"
 
 namespace zoom {
     class analyzer {
@@ -11,27 +18,53 @@ namespace zoom {
         analyzer() = default;
         analyzer(const analyzer&) = delete;
         analyzer& operator=(const analyzer&) = delete;
-        analyzer(analyzer&&) = default;
-        analyzer& operator=(analyzer&&) = default;
+        analyzer(analyzer&&) = delete; // the CSV writers of the logs refer to their streams
+        analyzer& operator=(analyzer&&) = delete;
 
+        //! writes the binary packet log (see pkt_log_writer) if the file name ends in .zpl
         void enable_pkt_log(const std::string& file_path);
         void enable_frame_log(const std::string& file_path);
         void enable_streams_log(const std::string& file_path);
         void enable_stats_log(const std::string& stats_path);
 
+        //! publishes frames and statistics as zoom::event records to a ring of slot_count records
+        //! in shared memory (see shm_ring), replacing a ring of the same name
+        void enable_event_ring(const std::string& name,
+                               std::size_t slot_count = shm_ring::DEFAULT_SLOT_COUNT);
+
+        //! closes the logs enabled and waits until they are written, throws upon error
+        void close_logs();
+
+        //! returns the writer thread of the logs, nullptr if no log is enabled
+        [[nodiscard]] const async_writer* log_writer() const;
+
+        //! returns the event ring, nullptr if it is not enabled
+        [[nodiscard]] const shm_ring_writer* event_ring() const;
+
     protected:
 
+        //! formatted by csv, or by arrow if the log has an Arrow schema and the file name ends in
+        //! .arrow or .feather, and written on the writer thread, so that file I/O does not gate
+        //! the analysis
         struct _log {
-            void open(const std::string& file_path);
+            void open(async_writer& writer, const std::string& file_path,
+                      const std::vector<arrow_writer::field>& arrow_schema = {});
             bool enabled = false;
-            std::ofstream stream;
+            async_writer::stream stream;
+            csv_writer csv {stream};
+            std::unique_ptr<arrow_writer> arrow;
             void close();
         };
 
+        async_writer& _writer();
+
+        std::unique_ptr<async_writer> _log_writer; // outlives the logs
         _log _pkt_log;
+        pkt_log_writer _pkt_bin_log;   // instead of _pkt_log's file, see enable_pkt_log
         _log _frame_log;
         _log _streams_log;
         _log _stats_log;
+        std::unique_ptr<shm_ring_writer> _event_ring;
     };
 }
 
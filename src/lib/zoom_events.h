@@ -0,0 +1,81 @@
+#ifndef ZOOM_ANALYSIS_ZOOM_EVENTS_H
+#define ZOOM_ANALYSIS_ZOOM_EVENTS_H
+
+#include <cstdint>
+
+#include "timestamp.h"
+
+//! the records zoom::analyzer publishes to its event ring (see shm_ring, enable_event_ring) as
+//! rtp_stream_analyzer evicts frames and reports statistics, so that other processes, e.g.,
+//! dashboards, see them without reading the CSV logs
+//! - each record is an event of the size of the ring's slots, its type is the first byte
+namespace zoom {
+
+    enum class event_type : std::uint8_t {
+        frame = 1,
+        stats = 2
+    };
+
+    struct frame_event {                  // 72 Bytes
+        event_type type            = event_type::frame;
+        std::uint8_t ip_proto      = 0;
+        char media_type            = 0;   // see media_type_to_char
+        char stream_type           = 0;   // see stream_type_to_char
+        std::uint32_t rtp_ssrc     = 0;
+        std::uint32_t ip_src       = 0;
+        std::uint32_t ip_dst       = 0;
+        std::uint16_t tp_src       = 0;
+        std::uint16_t tp_dst       = 0;
+        std::uint32_t rtp_ts       = 0;
+        timestamp_ns ts_min        = 0;   // of the frame's first and last packet
+        timestamp_ns ts_max        = 0;
+        std::uint32_t pkts_seen    = 0;
+        std::uint32_t pkts_hint    = 0;   // the frame's packet count in the Zoom header
+        std::uint32_t frame_size   = 0;   // bytes of the packets' payloads
+        std::uint32_t fps          = 0;
+        std::uint8_t rtp_ext1[3]   = {0};
+        std::uint8_t pad[5]        = {0};
+        double jitter_ms           = 0.0;
+    };
+
+    struct stats_event {                  // 96 Bytes
+        event_type type            = event_type::stats;
+        std::uint8_t ip_proto      = 0;
+        char media_type            = 0;
+        char stream_type           = 0;
+        std::uint32_t report_count = 0;
+        std::uint32_t ts_s         = 0;   // of the end of the report's interval
+        std::uint32_t rtp_ssrc     = 0;
+        std::uint32_t ip_src       = 0;
+        std::uint32_t ip_dst       = 0;
+        std::uint16_t tp_src       = 0;
+        std::uint16_t tp_dst       = 0;
+        std::uint32_t pad          = 0;
+        std::uint64_t pkts         = 0;   // of the stream so far
+        std::uint64_t bytes        = 0;
+        std::uint64_t lost         = 0;
+        std::uint64_t duplicate    = 0;
+        std::uint64_t out_of_order = 0;
+        std::uint64_t frames       = 0;
+        double mean_frame_len      = 0.0; // -1 without frames
+        double mean_jitter         = 0.0;
+    };
+
+    //! both events start with their type
+    union event {
+        frame_event frame;
+        stats_event stats;
+
+        event() : frame() { }
+
+        [[nodiscard]] event_type type() const {
+            return frame.type;
+        }
+    };
+
+    static_assert(sizeof(frame_event) == 72);
+    static_assert(sizeof(stats_event) == 96);
+    static_assert(sizeof(event) == 96);
+}
+
+#endif
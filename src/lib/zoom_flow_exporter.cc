@@ -0,0 +1,177 @@
+#include "zoom_flow_exporter.h"
+
+#include <arpa/inet.h>
+
+zoom::flow_exporter::flow_exporter(const ipfix_exporter::collector& collector,
+                                   const config& config)
+    : _exporter(collector, config.domain_id), _config(config) {
+
+    auto enterprise = [](ie id, std::uint16_t len) {
+        return ipfix_exporter::field { (std::uint16_t) id, len, ENTERPRISE_NUMBER };
+    };
+
+    _exporter.add_template(TEMPLATE_ID, {
+        { 8, 4 },   // sourceIPv4Address
+        { 12, 4 },  // destinationIPv4Address
+        { 7, 2 },   // sourceTransportPort
+        { 11, 2 },  // destinationTransportPort
+        { 4, 1 },   // protocolIdentifier
+        { 148, 8 }, // flowId, see flow_tracker::flow_stats::id
+        { 152, 8 }, // flowStartMilliseconds, of the record's first packet
+        { 153, 8 }, // flowEndMilliseconds, of its last packet
+        { 2, 8 },   // packetDeltaCount
+        { 1, 8 },   // octetDeltaCount, frame lengths as tracked
+        { 136, 1 }, // flowEndReason
+        enterprise(ie::flow_type, 1),
+        enterprise(ie::zoom_pkts, 8),
+        enterprise(ie::zoom_bytes, 8),
+        enterprise(ie::audio_pkts, 8),
+        enterprise(ie::video_pkts, 8),
+        enterprise(ie::screen_share_pkts, 8),
+        enterprise(ie::other_pkts, 8)
+    });
+}
+
+void zoom::flow_exporter::add(const net::ipv4_5tuple& ip_5t, const flow_tracker::flow_stats& flow,
+                              timestamp_ns ts, unsigned bytes, const headers& hdr) {
+
+    if (ts >= _next_expire_ts) {
+        expire(ts);
+        _next_expire_ts = ts + timestamp::NS_PER_SEC;
+    }
+
+    auto [it, inserted] = _flows.try_emplace(ip_5t);
+    auto& f = it->second;
+
+    if (inserted) {
+        f.id = flow.id;
+        f.exported_ts = ts;
+    }
+
+    if (f.pkts == 0 || ts < f.first_ts) {
+        f.first_ts = ts;
+    }
+
+    if (f.pkts == 0 || ts > f.last_ts) {
+        f.last_ts = ts;
+    }
+
+    f.type = flow.type;
+    f.pkts++;
+    f.bytes += bytes;
+
+    // as in the type summary of zoom_flows: P2P packets start with the media encapsulation,
+    // server packets with an outer header, followed by it for media packets
+    const unsigned char* media = nullptr;
+
+    if (flow.type == flow_tracker::flow_type::udp_p2p && hdr.zoom_inner) {
+        media = hdr.zoom_inner;
+    } else if (flow.type == flow_tracker::flow_type::udp_srv && hdr.zoom_outer) {
+        media = hdr.zoom_outer[0] == SRV_MEDIA_TYPE ? hdr.zoom_inner : nullptr;
+    } else {
+        return;
+    }
+
+    f.zoom_pkts++;
+    f.zoom_bytes += ntohs(hdr.udp->dgram_len);
+
+    if (!media) {
+        return;
+    }
+
+    switch (media[0]) {
+        case AUDIO_TYPE:
+            f.audio_pkts++;
+            break;
+        case VIDEO_TYPE:
+            f.video_pkts++;
+            break;
+        case SRV_SCREEN_SHARE_TYPE:
+        case P2P_SCREEN_SHARE_TYPE:
+            f.screen_share_pkts++;
+            break;
+        default:
+            break;
+    }
+}
+
+void zoom::flow_exporter::expire(timestamp_ns ts) {
+
+    const auto idle = timestamp::from_sec(_config.idle_timeout_s);
+    const auto active = timestamp::from_sec(_config.active_timeout_s);
+    bool exported = false;
+
+    for (auto it = _flows.begin(); it != _flows.end();) {
+
+        auto& [ip_5t, f] = *it;
+
+        if (ts - f.last_ts >= idle) {
+
+            if (f.pkts > 0) {
+                _export(ip_5t, f, end_reason::idle_timeout);
+                exported = true;
+            }
+
+            it = _flows.erase(it);
+            continue;
+        }
+
+        if (f.pkts > 0 && ts - f.exported_ts >= active) {
+            _export(ip_5t, f, end_reason::active_timeout);
+            f.exported_ts = ts;
+            exported = true;
+        }
+
+        ++it;
+    }
+
+    // records are sent as they are exported rather than once a message is full, which may take
+    // long with few flows
+    if (exported) {
+        _exporter.flush();
+    }
+}
+
+void zoom::flow_exporter::flush() {
+    _exporter.flush();
+}
+
+void zoom::flow_exporter::close() {
+
+    for (auto& [ip_5t, f] : _flows) {
+        if (f.pkts > 0) {
+            _export(ip_5t, f, end_reason::forced_end);
+        }
+    }
+
+    _flows.clear();
+    _exporter.flush();
+}
+
+std::size_t zoom::flow_exporter::flow_count() const {
+    return _flows.size();
+}
+
+const ipfix_exporter& zoom::flow_exporter::exporter() const {
+    return _exporter;
+}
+
+void zoom::flow_exporter::_export(const net::ipv4_5tuple& ip_5t, _flow& flow,
+                                  end_reason reason) {
+
+    _exporter.record(TEMPLATE_ID)
+        .u32(ip_5t.ip_src).u32(ip_5t.ip_dst).u16(ip_5t.tp_src).u16(ip_5t.tp_dst)
+        .u8(ip_5t.ip_proto)
+        .u64(flow.id)
+        .u64((std::uint64_t) (flow.first_ts / timestamp::NS_PER_MS))
+        .u64((std::uint64_t) (flow.last_ts / timestamp::NS_PER_MS))
+        .u64(flow.pkts).u64(flow.bytes)
+        .u8((std::uint8_t) reason)
+        .u8((std::uint8_t) flow.type)
+        .u64(flow.zoom_pkts).u64(flow.zoom_bytes)
+        .u64(flow.audio_pkts).u64(flow.video_pkts).u64(flow.screen_share_pkts)
+        .u64(flow.zoom_pkts - flow.audio_pkts - flow.video_pkts - flow.screen_share_pkts);
+
+    flow.pkts = flow.bytes = flow.zoom_pkts = flow.zoom_bytes = 0;
+    flow.audio_pkts = flow.video_pkts = flow.screen_share_pkts = 0;
+}
@@ -0,0 +1,100 @@
+#ifndef ZOOM_ANALYSIS_ZOOM_FLOW_EXPORTER_H
+#define ZOOM_ANALYSIS_ZOOM_FLOW_EXPORTER_H
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "ipfix_exporter.h"
+#include "net.h"
+#include "timestamp.h"
+#include "zoom.h"
+#include "zoom_flow_tracker.h"
+
+namespace zoom {
+
+    //! exports the Zoom flows of a flow_tracker to an IPFIX collector while packets are tracked
+    //! - a record holds the packets of a flow since its previous record: flows are exported every
+    //!   active_timeout_s while they see packets, once more when they were idle for
+    //!   idle_timeout_s, and all at close(), timeouts are in packet time (see expire())
+    //! - besides IANA's information elements for the 5-tuple, times, and counters, records hold
+    //!   information elements of ENTERPRISE_NUMBER for the flow type, the packets and bytes with
+    //!   a Zoom header, and the Zoom media types of these packets
+    class flow_exporter {
+
+    public:
+
+        //! IANA's enterprise number for documentation (RFC 5612), collectors decoding the
+        //! enterprise information elements must be configured for it
+        static constexpr std::uint32_t ENTERPRISE_NUMBER = 32473;
+        static constexpr std::uint16_t TEMPLATE_ID = 256;
+
+        //! information elements of ENTERPRISE_NUMBER
+        enum class ie : std::uint16_t {
+            flow_type         = 1, // unsigned8, see flow_tracker::flow_type
+            zoom_pkts         = 2, // unsigned64, packets with a Zoom header
+            zoom_bytes        = 3, // unsigned64, UDP bytes of these packets
+            audio_pkts        = 4, // unsigned64, Zoom media packets by type
+            video_pkts        = 5,
+            screen_share_pkts = 6,
+            other_pkts        = 7  // unsigned64, zoom_pkts not counted above
+        };
+
+        //! flowEndReason (IANA's information element 136)
+        enum class end_reason : std::uint8_t {
+            idle_timeout   = 1,
+            active_timeout = 2,
+            forced_end     = 4
+        };
+
+        struct config {
+            unsigned active_timeout_s = 60;
+            unsigned idle_timeout_s   = 30;
+            std::uint32_t domain_id   = 0;
+        };
+
+        //! connects to the collector and adds the template, throws like ipfix_exporter
+        flow_exporter(const ipfix_exporter::collector& collector, const config& config);
+
+        flow_exporter(const flow_exporter&) = delete;
+        flow_exporter& operator=(const flow_exporter&) = delete;
+
+        //! counts a packet of a Zoom flow as tracked (bytes: its frame length) and parsed
+        //! - exports the flows whose timeouts expired before the packet, once per second
+        void add(const net::ipv4_5tuple& ip_5t, const flow_tracker::flow_stats& flow,
+                 timestamp_ns ts, unsigned bytes, const headers& hdr);
+
+        //! exports the flows whose timeouts expired by ts, removing those idle, and sends their
+        //! records
+        void expire(timestamp_ns ts);
+
+        //! sends the records collected, e.g., after each input file when following
+        void flush();
+
+        //! exports all flows (forced end) and sends the records
+        void close();
+
+        //! returns the flows seen and not yet removed as idle
+        [[nodiscard]] std::size_t flow_count() const;
+
+        [[nodiscard]] const ipfix_exporter& exporter() const;
+
+    private:
+
+        struct _flow {
+            unsigned id = 0;
+            flow_tracker::flow_type type = flow_tracker::flow_type::unknown;
+            timestamp_ns first_ts = 0, last_ts = 0, exported_ts = 0;
+            std::uint64_t pkts = 0, bytes = 0, zoom_pkts = 0, zoom_bytes = 0;
+            std::uint64_t audio_pkts = 0, video_pkts = 0, screen_share_pkts = 0;
+        };
+
+        void _export(const net::ipv4_5tuple& ip_5t, _flow& flow, end_reason reason);
+
+        ipfix_exporter _exporter;
+        config _config;
+        std::unordered_map<net::ipv4_5tuple, _flow> _flows;
+        timestamp_ns _next_expire_ts = 0;
+    };
+}
+
+#endif
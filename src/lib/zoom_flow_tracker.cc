@@ -3,6 +3,10 @@
 #include "zoom_flow_tracker.h"
 #include "zoom_nets.h"
 
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
 bool zoom::flow_tracker::flow_stats::is_udp() const {
     return type == flow_type::udp_srv || type == flow_type::udp_p2p || type == flow_type::udp_stun;
 }
@@ -19,11 +23,11 @@ bool zoom::flow_tracker::flow_stats::is_p2p() const {
     return type == flow_type::udp_p2p;
 }
 
-zoom::flow_tracker::flow_tracker(unsigned int stun_expiration)
-    : _stun_expiration(stun_expiration) { }
+zoom::flow_tracker::flow_tracker(unsigned int stun_expiration, bool mergeable)
+    : _stun_expiration(stun_expiration), _mergeable(mergeable) { }
 
 std::optional<zoom::flow_tracker::flow_stats> zoom::flow_tracker::track(
-    const net::ipv4_5tuple& ip_5t, const timeval& ts, unsigned bytes) {
+    const net::ipv4_5tuple& ip_5t, timestamp_ns ts, unsigned bytes) {
 
     _total_pkts_processed++;
 
@@ -53,20 +57,13 @@ std::optional<zoom::flow_tracker::flow_stats> zoom::flow_tracker::track(
 
                 if (_is_stun_port(ip_5t.tp_src) || _is_stun_port(ip_5t.tp_dst)) {
 
-                    net::ipv4_port p2p_local_peer;
-
-                    if (_is_stun_port(ip_5t.tp_src)) {
-                        p2p_local_peer = {ip_5t.ip_dst, ip_5t.tp_dst};
-                    } else {
-                        p2p_local_peer = {ip_5t.ip_src, ip_5t.tp_src};
-                    }
-
+                    auto p2p_local_peer = _stun_local_peer(ip_5t);
                     auto p2p_peers_it = _p2p_peers.find(p2p_local_peer);
 
                     if (p2p_peers_it == _p2p_peers.end()) {
-                        _p2p_peers.insert({p2p_local_peer, ts.tv_sec});
+                        _p2p_peers.insert({p2p_local_peer, timestamp::sec(ts)});
                     } else {
-                        p2p_peers_it->second = ts.tv_sec;
+                        p2p_peers_it->second = timestamp::sec(ts);
                     }
 
                     ft = flow_type::udp_stun;
@@ -89,15 +86,21 @@ std::optional<zoom::flow_tracker::flow_stats> zoom::flow_tracker::track(
                 auto _p2p_peers_dst_it = _p2p_peers.find({ip_5t.ip_dst, ip_5t.tp_dst});
 
                 if (_p2p_peers_src_it != _p2p_peers.end()
-                    && ts.tv_sec <= _p2p_peers_src_it->second + _stun_expiration) {
+                    && timestamp::sec(ts) <= _p2p_peers_src_it->second + _stun_expiration) {
 
                     ft = flow_type::udp_p2p;
 
                 } else if (_p2p_peers_dst_it != _p2p_peers.end()
-                           && ts.tv_sec <= _p2p_peers_dst_it->second + _stun_expiration) {
+                           && timestamp::sec(ts) <= _p2p_peers_dst_it->second + _stun_expiration) {
 
                     ft = flow_type::udp_p2p;
                 } else {
+
+                    if (_mergeable) {
+                        _untracked_udp_endpoints.insert({ip_5t.ip_src, ip_5t.tp_src});
+                        _untracked_udp_endpoints.insert({ip_5t.ip_dst, ip_5t.tp_dst});
+                    }
+
                     return std::nullopt;
                 }
             } else {
@@ -108,10 +111,111 @@ std::optional<zoom::flow_tracker::flow_stats> zoom::flow_tracker::track(
         flow_stats fs{_next_id++, 1, bytes, ts, ts, ft };
         _flows.insert(std::make_pair(ip_5t, fs));
         _zoom_pkts_detected++;
+
+        if (_mergeable)
+            _first_pkt_bytes.push_back(bytes);
+
         return fs;
     }
 }
 
+void zoom::flow_tracker::track_batch(const pkt_info* pkts, std::optional<flow_stats>* results,
+    std::size_t n) {
+
+    for (std::size_t i = 0; i < n && _flows.size() >= BATCH_LOOKUP_MIN_FLOWS; i++) {
+
+        auto bucket = _flows.bucket(pkts[i].ip_5t);
+        auto bucket_it = _flows.cbegin(bucket);
+
+        if (bucket_it != _flows.cend(bucket))
+            __builtin_prefetch(&*bucket_it);
+    }
+
+    for (std::size_t i = 0; i < n; i++)
+        results[i] = track(pkts[i].ip_5t, pkts[i].ts, pkts[i].bytes);
+}
+
+bool zoom::flow_tracker::can_merge(const flow_tracker& next) const {
+
+    if (!next._mergeable)
+        throw std::logic_error("flow_tracker: tracker not mergeable");
+
+    // packets next could not assign to a flow may belong to P2P peers announced here
+    for (const auto& endpoint : next._untracked_udp_endpoints) {
+        if (_p2p_peers.count(endpoint))
+            return false;
+    }
+
+    // STUN flows continued from here announced their peers again in next, but not when tracking
+    // all packets here, so next must not have detected P2P flows based on them
+    std::unordered_set<net::ipv4_port> p2p_endpoints;
+
+    for (const auto& [ip_5t, stats] : next._flows) {
+        if (stats.is_p2p()) {
+            p2p_endpoints.insert({ip_5t.ip_src, ip_5t.tp_src});
+            p2p_endpoints.insert({ip_5t.ip_dst, ip_5t.tp_dst});
+        }
+    }
+
+    for (const auto& [ip_5t, stats] : next._flows) {
+        if (stats.is_stun() && _flows.count(ip_5t) && p2p_endpoints.count(_stun_local_peer(ip_5t)))
+            return false;
+    }
+
+    return true;
+}
+
+void zoom::flow_tracker::merge(const flow_tracker& next) {
+
+    if (!next._mergeable)
+        throw std::logic_error("flow_tracker: tracker not mergeable");
+
+    // new flows are numbered in the order next detected them
+    std::vector<std::pair<const net::ipv4_5tuple*, const flow_stats*>> next_flows;
+    next_flows.reserve(next._flows.size());
+
+    for (const auto& [ip_5t, stats] : next._flows)
+        next_flows.emplace_back(&ip_5t, &stats);
+
+    std::sort(next_flows.begin(), next_flows.end(), [](const auto& a, const auto& b) {
+        return a.second->id < b.second->id;
+    });
+
+    for (const auto& [ip_5t, next_stats] : next_flows) {
+
+        auto flows_it = _flows.find(*ip_5t);
+
+        if (flows_it != _flows.end()) {
+
+            auto& stats = flows_it->second;
+            stats.pkts += next_stats->pkts, stats.bytes += next_stats->bytes;
+
+            if (next_stats->last_ts > stats.last_ts)
+                stats.last_ts = next_stats->last_ts;
+
+            // the packet starting the flow in next continued it here
+            _zoom_bytes_detected += next._first_pkt_bytes[next_stats->id];
+
+        } else {
+
+            auto stats = *next_stats;
+            stats.id = _next_id++;
+            _flows.insert(std::make_pair(*ip_5t, stats));
+
+            if (_mergeable)
+                _first_pkt_bytes.push_back(next._first_pkt_bytes[next_stats->id]);
+
+            // only new STUN flows announce their peers, at the time of their first packet
+            if (stats.is_stun())
+                _p2p_peers[_stun_local_peer(*ip_5t)] = timestamp::sec(stats.start_ts);
+        }
+    }
+
+    _total_pkts_processed += next._total_pkts_processed;
+    _zoom_pkts_detected += next._zoom_pkts_detected;
+    _zoom_bytes_detected += next._zoom_bytes_detected;
+}
+
 unsigned zoom::flow_tracker::count_zoom_flows_detected() const {
     return _next_id;
 }
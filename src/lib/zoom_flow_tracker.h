@@ -3,12 +3,14 @@
 #define ZOOM_ANALYSIS_ZOOM_FLOW_TRACKER_H
 
 #include "net.h"
+#include "timestamp.h"
 
 #include <ctime>
 #include <optional>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace zoom {
 
@@ -27,7 +29,7 @@ namespace zoom {
         struct flow_stats {
             unsigned id = 0;
             unsigned long pkts = 0, bytes = 0;
-            timeval start_ts = { 0, 0 }, last_ts = { 0, 0 };
+            timestamp_ns start_ts = 0, last_ts = 0;
             flow_type type = flow_type::unknown;
 
             [[nodiscard]] bool is_udp() const;
@@ -36,6 +38,17 @@ namespace zoom {
             [[nodiscard]] bool is_p2p() const;
         };
 
+        //! flows from which on track_batch() looks up buckets ahead, smaller flow tables stay in
+        //! cache, where looking up buckets twice only adds work
+        static constexpr std::size_t BATCH_LOOKUP_MIN_FLOWS = 1 << 14;
+
+        //! input to track_batch()
+        struct pkt_info {
+            net::ipv4_5tuple ip_5t = {};
+            timestamp_ns ts        = 0;
+            unsigned bytes         = 0;
+        };
+
         static std::string flow_type_string(const flow_type& ft) {
             switch (ft) {
                 case flow_type::tcp:      return "tcp";
@@ -46,14 +59,34 @@ namespace zoom {
             }
         }
 
-        explicit flow_tracker(unsigned stun_expiration = 300);
+        //! mergeable: also keeps what is required to merge() this tracker into another one, e.g.,
+        //! the endpoints of UDP packets that did not belong to a Zoom flow
+        explicit flow_tracker(unsigned stun_expiration = 300, bool mergeable = false);
 
         flow_tracker(const flow_tracker&) = default;
         flow_tracker& operator=(const flow_tracker&) = default;
 
-        std::optional<flow_stats> track(const net::ipv4_5tuple& ip_5t, const timeval& ts,
+        std::optional<flow_stats> track(const net::ipv4_5tuple& ip_5t, timestamp_ns ts,
                                         unsigned bytes);
 
+        //! tracks n packets in order, equivalent to calling track() on each packet
+        //! - with at least BATCH_LOOKUP_MIN_FLOWS flows, looks up all flow table buckets of the
+        //!   batch before tracking so that their cache misses overlap instead of stalling one
+        //!   packet at a time
+        void track_batch(const pkt_info* pkts, std::optional<flow_stats>* results, std::size_t n);
+
+        //! returns whether merge() of a tracker that processed the packets directly following
+        //! those tracked by this one yields the same flows as tracking all packets with this one
+        //! - P2P flows are detected based on STUN flows seen before, so this is not the case if
+        //!   next missed P2P packets because the STUN flows revealing them were tracked here
+        //! - next must be mergeable, throws std::logic_error otherwise
+        [[nodiscard]] bool can_merge(const flow_tracker& next) const;
+
+        //! adds the flows and counters of a tracker that processed the packets directly following
+        //! those tracked by this one, flows seen by both are continued and keep their id
+        //! - only exact if can_merge(next), throws std::logic_error if next is not mergeable
+        void merge(const flow_tracker& next);
+
         unsigned count_zoom_flows_detected() const;
         unsigned long long count_total_pkts_processed() const;
         unsigned long long count_zoom_pkts_detected() const;
@@ -75,8 +108,19 @@ namespace zoom {
             return p == 3478 || p == 3479;
         }
 
+        //! returns the local endpoint of a STUN flow, which may use it for P2P flows afterwards
+        inline static net::ipv4_port _stun_local_peer(const net::ipv4_5tuple& ip_5t) {
+            if (_is_stun_port(ip_5t.tp_src))
+                return { ip_5t.ip_dst, ip_5t.tp_dst };
+            else
+                return { ip_5t.ip_src, ip_5t.tp_src };
+        }
+
         unsigned _next_id = 0;
         unsigned _stun_expiration = 300;
+        bool _mergeable = false;
+        std::unordered_set<net::ipv4_port> _untracked_udp_endpoints = {};
+        std::vector<unsigned> _first_pkt_bytes = {}; // by flow id, not in _zoom_bytes_detected
         std::unordered_map<net::ipv4_5tuple, flow_stats> _flows = {};
         std::unordered_map<net::ipv4_port, long> _p2p_peers = {};
         unsigned long long _total_pkts_processed = 0;
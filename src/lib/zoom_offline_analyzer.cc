@@ -1,6 +1,8 @@
 #include "zoom_offline_analyzer.h"
+#include <cstring>
 #include <set>
 #include <iostream>
+#include <limits>
 #include <numeric>
 #include <unordered_map>
 #include <string>
@@ -39,6 +41,13 @@ namespace std
     };
 }
 
+// the 3 bytes of the RTP extension as a number, for the Arrow logs
+static std::uint32_t rtp_ext1_value(const std::uint8_t ext[3])
+{
+
+    return ((std::uint32_t)ext[0] << 16) | ((std::uint32_t)ext[1] << 8) | ext[2];
+}
+
 void zoom::offline_analyzer::add(const zoom::pkt &pkt)
 {
 
@@ -66,10 +75,8 @@ void zoom::offline_analyzer::add(const zoom::pkt &pkt)
             }
         }
 
-        timeval tv{pkt.ts.s, (int)pkt.ts.us};
-
         streams_it->second.analyzer.add(
-            pkt.proto.rtp.seq, pkt.proto.rtp.ts, tv, pkt.udp_pl_len, {.rtp_ext1 = {pkt.rtp_ext1[0], pkt.rtp_ext1[1], pkt.rtp_ext1[2]}, .pkt_type = pkt.zoom_media_type, .pkts_hint = pkt.pkts_in_frame});
+            pkt.proto.rtp.seq, pkt.proto.rtp.ts, pkt.ts, pkt.udp_pl_len, {.rtp_ext1 = {pkt.rtp_ext1[0], pkt.rtp_ext1[1], pkt.rtp_ext1[2]}, .pkt_type = pkt.zoom_media_type, .pkts_hint = pkt.pkts_in_frame});
     }
 }
 
@@ -107,10 +114,9 @@ static inline unsigned long long rtp_ts_to_wallclock_ms(std::uint32_t rtp_ts,
     return (unsigned long long)((double)rtp_ts / (double)sampling_rate_khz * 1000);
 }
 
-static inline unsigned long long timeval_to_ms(timeval tv)
+static inline unsigned long long ts_to_ms(timestamp_ns ts)
 {
-    // Ensure one of the operands is a floating-point type
-    return static_cast<unsigned long long>((static_cast<double>(tv.tv_sec) * 1000.0) + (static_cast<double>(tv.tv_usec) / 1000.0));
+    return static_cast<unsigned long long>(ts / timestamp::NS_PER_MS);
 }
 
 int getGroupNumber(std::uint32_t ssrc, const zoom::media_stream_key &k, std::unordered_map<FiveTuple, int> &tupleToCategory, int &categoryCounter)
@@ -161,12 +167,17 @@ void zoom::offline_analyzer::_frame_handler(const stream_analyzer &a,
     auto meta = a.meta();
     const auto *first_pkt = &(f.pkts[0]);
 
+    if (_event_ring)
+    {
+        _publish_frame_event(a, f);
+    }
+
     // modifications begin here
     if (_frame_log.enabled)
     {
         std::uint32_t rtp_ts = f.rtp_ts;
 
-        auto times = timeval_to_ms(f.ts_max);
+        auto times = ts_to_ms(f.ts_max);
         // std::cout << "Times: " << times << std::endl;
         auto rtps = rtp_ts_to_wallclock_ms(rtp_ts, 90000);
 
@@ -205,6 +216,9 @@ void zoom::offline_analyzer::_stats_handler(const stream_analyzer &a, unsigned r
                                             unsigned ts, const struct stream_analyzer::stats &c)
 {
 
+    if (_event_ring)
+        _publish_stats_event(a.meta(), report_count, ts, c);
+
     if (_stats_log.enabled)
         _write_stats_log(a.meta(), report_count, ts, c);
 }
@@ -212,163 +226,291 @@ void zoom::offline_analyzer::_stats_handler(const stream_analyzer &a, unsigned r
 void zoom::offline_analyzer::write_streams_log()
 {
 
-    _streams_log.stream << "rtp_ssrc,media_type,stream_type,ip_src,tp_src,ip_dst,tp_dst,"
-                        << "start_ts_s,start_ts_us,end_ts_s,end_ts_us,start_rtp_ts,end_rtp_ts,"
-                        << "pkts,bytes" << std::endl;
+    auto &csv = _streams_log.csv;
+
+    csv.append("rtp_ssrc,media_type,stream_type,ip_src,tp_src,ip_dst,tp_dst,"
+               "start_ts_s,start_ts_us,end_ts_s,end_ts_us,start_rtp_ts,end_rtp_ts,"
+               "pkts,bytes").end_row();
 
     for (const auto &[key, data] : _media_streams)
     {
 
-        _streams_log.stream
-            << key.rtp_ssrc << ","
-            << zoom::media_type_to_char(key.media_type) << ","
-            << zoom::stream_type_to_char(key.stream_type) << ","
+        csv.field(key.rtp_ssrc)
+            .field(zoom::media_type_to_char(key.media_type))
+            .field(zoom::stream_type_to_char(key.stream_type))
 
-            << net::ipv4::addr_to_str(key.ip_5t.ip_src) << ","
-            << key.ip_5t.tp_src << ","
-            << net::ipv4::addr_to_str(key.ip_5t.ip_dst) << ","
-            << key.ip_5t.tp_dst << ","
+            .addr_field(key.ip_5t.ip_src)
+            .field(key.ip_5t.tp_src)
+            .addr_field(key.ip_5t.ip_dst)
+            .field(key.ip_5t.tp_dst)
 
-            << data.analyzer.timestamps().first_timeval.tv_sec << ","
-            << data.analyzer.timestamps().first_timeval.tv_usec << ","
-            << data.analyzer.timestamps().last_timeval.tv_sec << ","
-            << data.analyzer.timestamps().last_timeval.tv_usec << ","
+            .field(timestamp::sec(data.analyzer.timestamps().first_ts))
+            .field(timestamp::subsec_us(data.analyzer.timestamps().first_ts))
+            .field(timestamp::sec(data.analyzer.timestamps().last_ts))
+            .field(timestamp::subsec_us(data.analyzer.timestamps().last_ts))
 
-            << data.analyzer.timestamps().first_rtp << ","
-            << data.analyzer.timestamps().last_rtp << ","
+            .field(data.analyzer.timestamps().first_rtp)
+            .field(data.analyzer.timestamps().last_rtp)
 
-            << data.analyzer.stats().total_pkts << ","
-            << data.analyzer.stats().total_bytes
-            << std::endl;
+            .field(data.analyzer.stats().total_pkts)
+            .field(data.analyzer.stats().total_bytes)
+            .end_row();
     }
 }
 
 void zoom::offline_analyzer::_write_pkt_log(const zoom::pkt &pkt)
 {
 
-    _pkt_log.stream << std::dec << pkt.ts.s << "," << pkt.ts.us << ",u,";
+    if (_pkt_bin_log.is_open())
+    {
+        _pkt_bin_log.write(pkt);
+        return;
+    }
+
+    if (_pkt_log.arrow)
+    {
+        _write_pkt_log(*_pkt_log.arrow, pkt);
+        return;
+    }
+
+    write_pkt_log_csv(_pkt_log.csv, pkt_log_stream::from_pkt(pkt),
+                      pkt_log_pkt::from_pkt(pkt, 0));
+}
+
+void zoom::offline_analyzer::_write_frame_log(const stream_analyzer &a, const stream_analyzer::frame &f, double times, double rtps, int groupNumber, double diff)
+{
+
+    auto meta = a.meta();
+    const auto *first_pkt = &(f.pkts[0]);
+
+    if (_frame_log.arrow)
+    {
+        _frame_log.arrow->value(meta.ip_5t.ip_proto)
+            .addr_value(meta.ip_5t.ip_src)
+            .value(meta.ip_5t.tp_src)
+            .addr_value(meta.ip_5t.ip_dst)
+            .value(meta.ip_5t.tp_dst)
+            .value(meta.rtp_ssrc)
+            .value(first_pkt->meta.pkt_type)
+            .value(rtp_ext1_value(first_pkt->meta.rtp_ext1))
+            .value(timestamp::sec(f.ts_min))
+            .value(timestamp::subsec_us(f.ts_min))
+            .value(timestamp::sec(f.ts_max))
+            .value(timestamp::subsec_us(f.ts_max))
+            .value(f.rtp_ts)
+            .value(f.pkts_seen)
+            .value(first_pkt->meta.pkts_hint)
+            .value(f.total_pl_len)
+            .value(f.fps)
+            .value(f.jitter)
+            .value(times)
+            .value(rtps)
+            .value(diff)
+            .value((unsigned)groupNumber)
+            .end_row();
+        return;
+    }
+
+    const int precision = std::numeric_limits<long double>::digits10;
+
+    _frame_log.csv
+        .field(meta.ip_5t)
+        .field((unsigned)meta.rtp_ssrc)
+        .field((unsigned)first_pkt->meta.pkt_type)
+        .field((unsigned)first_pkt->meta.rtp_ext1[0])
+        .append_hex(first_pkt->meta.rtp_ext1[1], 2)
+        .append_hex(first_pkt->meta.rtp_ext1[2], 2)
+        .field((unsigned)timestamp::sec(f.ts_min))
+        .field((unsigned)timestamp::subsec_us(f.ts_min))
+        .field((unsigned)timestamp::sec(f.ts_max))
+        .field((unsigned)timestamp::subsec_us(f.ts_max))
+        .field((unsigned)f.rtp_ts)
+        .field((unsigned)f.pkts_seen)
+        .field((unsigned)first_pkt->meta.pkts_hint)
+        .field((unsigned)f.total_pl_len)
+        .field((unsigned)f.fps)
+        .field(f.jitter, 5)
+        .field(times, precision)
+        .field(rtps, precision)
+        .field(diff, precision)
+        .field((unsigned)groupNumber)
+        .end_row();
+}
+
+void zoom::offline_analyzer::_write_stats_log(const zoom::media_stream_key &k, unsigned report_count,
+                                              unsigned ts,
+                                              const struct stream_analyzer::stats &c)
+{
+
+    if (_stats_log.arrow)
+    {
+        _stats_log.arrow->value(ts)
+            .value(report_count)
+            .value(k.rtp_ssrc)
+            .value(zoom::media_type_to_char(k.media_type))
+            .value(zoom::stream_type_to_char(k.stream_type))
+            .addr_value(k.ip_5t.ip_src)
+            .value(k.ip_5t.tp_src)
+            .addr_value(k.ip_5t.ip_dst)
+            .value(k.ip_5t.tp_dst)
+            .value(c.total_pkts)
+            .value(c.total_bytes)
+            .value(c.lost_pkts)
+            .value(c.duplicate_pkts)
+            .value(c.out_of_order_pkts)
+            .value(c.total_frames)
+            .value(c.mean_frame_size())
+            .value(c.mean_jitter())
+            .end_row();
+        return;
+    }
+
+    _stats_log.csv
+        .field(ts)
+        .field(report_count)
+
+        .field(k.rtp_ssrc)
+        .field(zoom::media_type_to_char(k.media_type))
+        .field(zoom::stream_type_to_char(k.stream_type))
+
+        .addr_field(k.ip_5t.ip_src)
+        .field(k.ip_5t.tp_src)
+        .addr_field(k.ip_5t.ip_dst)
+        .field(k.ip_5t.tp_dst)
+
+        .field(c.total_pkts)
+        .field(c.total_bytes)
+
+        .field(c.lost_pkts)
+        .field(c.duplicate_pkts)
+        .field(c.out_of_order_pkts)
+
+        .field(c.total_frames)
+        .field(c.mean_frame_size())
+        .field(c.mean_jitter())
+        .end_row();
+}
+
+void zoom::offline_analyzer::_publish_frame_event(const stream_analyzer &a,
+                                                  const stream_analyzer::frame &f)
+{
+
+    const auto &meta = a.meta();
+    const auto *first_pkt = &(f.pkts[0]);
+
+    event e;
+    auto &frame = e.frame;
+    frame.ip_proto = meta.ip_5t.ip_proto;
+    frame.media_type = zoom::media_type_to_char(meta.media_type);
+    frame.stream_type = zoom::stream_type_to_char(meta.stream_type);
+    frame.rtp_ssrc = meta.rtp_ssrc;
+    frame.ip_src = meta.ip_5t.ip_src;
+    frame.ip_dst = meta.ip_5t.ip_dst;
+    frame.tp_src = meta.ip_5t.tp_src;
+    frame.tp_dst = meta.ip_5t.tp_dst;
+    frame.rtp_ts = f.rtp_ts;
+    frame.ts_min = f.ts_min;
+    frame.ts_max = f.ts_max;
+    frame.pkts_seen = f.pkts_seen;
+    frame.pkts_hint = first_pkt->meta.pkts_hint;
+    frame.frame_size = f.total_pl_len;
+    frame.fps = f.fps;
+    std::memcpy(frame.rtp_ext1, first_pkt->meta.rtp_ext1, sizeof(frame.rtp_ext1));
+    frame.jitter_ms = f.jitter;
+
+    _event_ring->publish(e);
+}
+
+void zoom::offline_analyzer::_publish_stats_event(const zoom::media_stream_key &k,
+                                                  unsigned report_count, unsigned ts,
+                                                  const struct stream_analyzer::stats &c)
+{
+
+    event e;
+    e.stats = stats_event{};
+    auto &stats = e.stats;
+    stats.ip_proto = k.ip_5t.ip_proto;
+    stats.media_type = zoom::media_type_to_char(k.media_type);
+    stats.stream_type = zoom::stream_type_to_char(k.stream_type);
+    stats.report_count = report_count;
+    stats.ts_s = ts;
+    stats.rtp_ssrc = k.rtp_ssrc;
+    stats.ip_src = k.ip_5t.ip_src;
+    stats.ip_dst = k.ip_5t.ip_dst;
+    stats.tp_src = k.ip_5t.tp_src;
+    stats.tp_dst = k.ip_5t.tp_dst;
+    stats.pkts = c.total_pkts;
+    stats.bytes = c.total_bytes;
+    stats.lost = c.lost_pkts;
+    stats.duplicate = c.duplicate_pkts;
+    stats.out_of_order = c.out_of_order_pkts;
+    stats.frames = c.total_frames;
+    stats.mean_frame_len = c.mean_frame_size();
+    stats.mean_jitter = c.mean_jitter();
+
+    _event_ring->publish(e);
+}
+
+void zoom::offline_analyzer::_write_pkt_log(arrow_writer &arrow, const zoom::pkt &pkt)
+{
+
+    arrow.value(timestamp::sec(pkt.ts)).value(timestamp::subsec_us(pkt.ts)).value("u");
 
     if (pkt.flags.srv)
     {
-        _pkt_log.stream << "s,";
+        arrow.value("s");
     }
     else if (pkt.flags.p2p)
     {
-        _pkt_log.stream << "p,";
+        arrow.value("p");
     }
     else
     {
-        _pkt_log.stream << "NA,";
+        arrow.null();
     }
 
-    _pkt_log.stream << pkt.ip_5t << ",";
+    arrow.value(pkt.ip_5t.ip_proto)
+        .addr_value(pkt.ip_5t.ip_src)
+        .value(pkt.ip_5t.tp_src)
+        .addr_value(pkt.ip_5t.ip_dst)
+        .value(pkt.ip_5t.tp_dst);
 
-    // TODO: handle screen share
     if (pkt.zoom_media_type == zoom::AUDIO_TYPE)
     {
-        _pkt_log.stream << "a,";
+        arrow.value("a");
     }
     else if (pkt.zoom_media_type == zoom::VIDEO_TYPE)
     {
-        _pkt_log.stream << "v,";
+        arrow.value("v");
     }
     else
     {
-        _pkt_log.stream << "NA,";
+        arrow.null();
     }
 
     if (pkt.pkts_in_frame)
     {
-        _pkt_log.stream << pkt.pkts_in_frame << ",";
+        arrow.value(pkt.pkts_in_frame);
     }
     else
     {
-        _pkt_log.stream << "NA,";
+        arrow.null();
     }
 
-    _pkt_log.stream
-        << std::dec << (unsigned)pkt.proto.rtp.ssrc << ","
-        << std::dec << (unsigned)pkt.proto.rtp.pt << ","
-        << std::dec << (unsigned)pkt.proto.rtp.seq << ","
-        << std::dec << (unsigned)pkt.proto.rtp.ts << ","
-        << std::dec << (unsigned)pkt.udp_pl_len << ",";
+    arrow.value(pkt.proto.rtp.ssrc)
+        .value(pkt.proto.rtp.pt)
+        .value(pkt.proto.rtp.seq)
+        .value(pkt.proto.rtp.ts)
+        .value(pkt.udp_pl_len);
 
-    if (pkt.rtp_ext1[0] != 0 || pkt.rtp_ext1[1] != 0 || pkt.rtp_ext1[2] != 0)
+    if (auto ext1 = rtp_ext1_value(pkt.rtp_ext1))
     {
-        _pkt_log.stream << "0x";
-        _pkt_log.stream << std::hex << std::setw(2) << std::setfill('0') << (unsigned)pkt.rtp_ext1[0];
-        _pkt_log.stream << std::hex << std::setw(2) << std::setfill('0') << (unsigned)pkt.rtp_ext1[1];
-        _pkt_log.stream << std::hex << std::setw(2) << std::setfill('0') << (unsigned)pkt.rtp_ext1[2];
-        _pkt_log.stream << ",";
+        arrow.value(ext1);
     }
     else
     {
-        _pkt_log.stream << "NA,";
+        arrow.null();
     }
 
-    _pkt_log.stream << "0" << std::endl;
-}
-
-void zoom::offline_analyzer::_write_frame_log(const stream_analyzer &a, const stream_analyzer::frame &f, double times, double rtps, int groupNumber, double diff)
-{
-
-    auto meta = a.meta();
-    const auto *first_pkt = &(f.pkts[0]);
-
-    _frame_log.stream
-        << meta.ip_5t << ","
-        << std::dec << (unsigned)meta.rtp_ssrc << ","
-        << std::dec << (unsigned)first_pkt->meta.pkt_type << ","
-        //<< std::hex << std::setw(2) << std::setfill('0')
-        << (unsigned)first_pkt->meta.rtp_ext1[0]
-        << std::hex << std::setw(2) << std::setfill('0')
-        << (unsigned)first_pkt->meta.rtp_ext1[1]
-        << std::hex << std::setw(2) << std::setfill('0')
-        << (unsigned)first_pkt->meta.rtp_ext1[2] << ","
-        << std::dec << (unsigned)f.ts_min.tv_sec << ","
-        << std::dec << (unsigned)f.ts_min.tv_usec << ","
-        << std::dec << (unsigned)f.ts_max.tv_sec << ","
-        << std::dec << (unsigned)f.ts_max.tv_usec << ","
-        << std::dec << (unsigned)f.rtp_ts << ","
-        << std::dec << (unsigned)f.pkts_seen << ","
-        << std::dec << (unsigned)first_pkt->meta.pkts_hint << ","
-        << std::dec << (unsigned)f.total_pl_len << ","
-        << std::dec << (unsigned)f.fps << ","
-        << std::setprecision(5) << f.jitter << ","
-        << std::setprecision(std::numeric_limits<long double>::digits10) << times << "," // Add the new columns
-        << std::setprecision(std::numeric_limits<long double>::digits10) << rtps << ","
-        << std::dec << diff << ","
-        << std::dec << (unsigned)groupNumber
-        << std::endl;
-}
-
-void zoom::offline_analyzer::_write_stats_log(const zoom::media_stream_key &k, unsigned report_count,
-                                              unsigned ts,
-                                              const struct stream_analyzer::stats &c)
-{
-
-    _stats_log.stream
-        << ts << ","
-        << report_count << ","
-
-        << k.rtp_ssrc << ","
-        << zoom::media_type_to_char(k.media_type) << ","
-        << zoom::stream_type_to_char(k.stream_type) << ","
-
-        << net::ipv4::addr_to_str(k.ip_5t.ip_src) << ","
-        << k.ip_5t.tp_src << ","
-        << net::ipv4::addr_to_str(k.ip_5t.ip_dst) << ","
-        << k.ip_5t.tp_dst << ","
-
-        << std::dec << c.total_pkts << ","
-        << std::dec << c.total_bytes << ","
-
-        << std::dec << c.lost_pkts << ","
-        << std::dec << c.duplicate_pkts << ","
-        << std::dec << c.out_of_order_pkts << ","
-
-        << std::dec << c.total_frames << ","
-        << std::dec << c.mean_frame_size() << ","
-        << std::dec << c.mean_jitter()
-        << std::endl;
+    arrow.value(0).end_row();
 }
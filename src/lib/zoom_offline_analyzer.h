@@ -32,8 +32,8 @@ namespace zoom
 
     public:
         offline_analyzer() = default;
-        offline_analyzer(offline_analyzer &&) = default;
-        offline_analyzer &operator=(offline_analyzer &&) = default;
+        offline_analyzer(offline_analyzer &&) = delete;
+        offline_analyzer &operator=(offline_analyzer &&) = delete;
 
         void add(const zoom::pkt &pkt);
         void write_streams_log();
@@ -47,9 +47,14 @@ namespace zoom
                             unsigned ts, const struct stream_analyzer::stats &c);
 
         void _write_pkt_log(const zoom::pkt &pkt);
+        void _write_pkt_log(arrow_writer &arrow, const zoom::pkt &pkt);
         void _write_frame_log(const stream_analyzer &a, const struct stream_analyzer::frame &frame, double times, double rtps, int groupNumber, double diff);
         void _write_stats_log(const zoom::media_stream_key &k, unsigned report_count, unsigned ts,
                               const struct stream_analyzer::stats &c);
+        void _publish_frame_event(const stream_analyzer &a,
+                                  const struct stream_analyzer::frame &f);
+        void _publish_stats_event(const zoom::media_stream_key &k, unsigned report_count,
+                                  unsigned ts, const struct stream_analyzer::stats &c);
 
         unsigned long _pkts_processed = 0;
 
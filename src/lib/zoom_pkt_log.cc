@@ -0,0 +1,205 @@
+#include "zoom_pkt_log.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+
+zoom::pkt_log_stream zoom::pkt_log_stream::from_pkt(const pkt& pkt) {
+
+    pkt_log_stream s;
+    s.rtp_ssrc = pkt.proto.rtp.ssrc;
+    s.ip_src = pkt.ip_5t.ip_src;
+    s.ip_dst = pkt.ip_5t.ip_dst;
+    s.tp_src = pkt.ip_5t.tp_src;
+    s.tp_dst = pkt.ip_5t.tp_dst;
+    s.ip_proto = pkt.ip_5t.ip_proto;
+    s.rtp_pt = pkt.proto.rtp.pt;
+    s.flow_type = pkt.flags.srv ? 's' : pkt.flags.p2p ? 'p' : 0;
+    s.zoom_media_type = pkt.zoom_media_type;
+    return s;
+}
+
+bool zoom::pkt_log_stream::operator==(const pkt_log_stream& s) const {
+
+    return std::tie(rtp_ssrc, ip_src, ip_dst, tp_src, tp_dst, ip_proto, rtp_pt, flow_type,
+                    zoom_media_type)
+        == std::tie(s.rtp_ssrc, s.ip_src, s.ip_dst, s.tp_src, s.tp_dst, s.ip_proto, s.rtp_pt,
+                    s.flow_type, s.zoom_media_type);
+}
+
+zoom::pkt_log_pkt zoom::pkt_log_pkt::from_pkt(const pkt& pkt, std::uint32_t stream) {
+
+    pkt_log_pkt p;
+    p.stream = stream;
+    p.rtp_ts = pkt.proto.rtp.ts;
+    p.ts = pkt.ts;
+    p.rtp_seq = pkt.proto.rtp.seq;
+    p.udp_pl_len = pkt.udp_pl_len;
+    std::memcpy(p.rtp_ext1, pkt.rtp_ext1, sizeof(p.rtp_ext1));
+    p.pkts_in_frame = (std::uint8_t) pkt.pkts_in_frame;
+    return p;
+}
+
+void zoom::write_pkt_log_csv(csv_writer& csv, const pkt_log_stream& s, const pkt_log_pkt& p) {
+
+    csv.field(timestamp::sec(p.ts)).field(timestamp::subsec_us(p.ts)).field("u");
+
+    if (s.flow_type)
+        csv.field(s.flow_type);
+    else
+        csv.field("NA");
+
+    csv.field((unsigned) s.ip_proto)
+       .addr_field(s.ip_src)
+       .field(s.tp_src)
+       .addr_field(s.ip_dst)
+       .field(s.tp_dst);
+
+    // TODO: handle screen share
+    if (s.zoom_media_type == AUDIO_TYPE)
+        csv.field("a");
+    else if (s.zoom_media_type == VIDEO_TYPE)
+        csv.field("v");
+    else
+        csv.field("NA");
+
+    if (p.pkts_in_frame)
+        csv.field((unsigned) p.pkts_in_frame);
+    else
+        csv.field("NA");
+
+    csv.field((unsigned) s.rtp_ssrc)
+       .field((unsigned) s.rtp_pt)
+       .field((unsigned) p.rtp_seq)
+       .field((unsigned) p.rtp_ts)
+       .field((unsigned) p.udp_pl_len);
+
+    if (p.rtp_ext1[0] != 0 || p.rtp_ext1[1] != 0 || p.rtp_ext1[2] != 0) {
+        csv.field("0x")
+           .append_hex(p.rtp_ext1[0], 2)
+           .append_hex(p.rtp_ext1[1], 2)
+           .append_hex(p.rtp_ext1[2], 2);
+    } else {
+        csv.field("NA");
+    }
+
+    csv.field(0).end_row();
+}
+
+void zoom::pkt_log_writer::open(const std::string& file_name, async_writer* writer) {
+
+    if (_open)
+        throw std::logic_error("zoom::pkt_log_writer: already open");
+
+    _writer.open(file_name, {}, writer);
+    _streams.clear();
+    _pkt_count = 0;
+    _open = true;
+}
+
+bool zoom::pkt_log_writer::is_open() const {
+    return _open;
+}
+
+void zoom::pkt_log_writer::write(const pkt& pkt) {
+
+    auto stream = pkt_log_stream::from_pkt(pkt);
+
+    // packets mostly follow packets of the same stream, which spares the lookup
+    if (_pkt_count == 0 || !(stream == _last_stream)) {
+
+        auto [it, inserted] = _streams.try_emplace(stream, (std::uint32_t) _streams.size());
+
+        if (inserted) {
+            pkt_log_record r;
+            r.stream = stream;
+            r.stream.handle = it->second | PKT_LOG_STREAM_FLAG;
+            _writer.write(r);
+        }
+
+        _last_stream = stream;
+        _last_stream.handle = it->second;
+    }
+
+    pkt_log_record r;
+    r.pkt = pkt_log_pkt::from_pkt(pkt, _last_stream.handle);
+    _writer.write(r);
+    _pkt_count++;
+}
+
+void zoom::pkt_log_writer::close() {
+
+    if (!_open)
+        throw std::logic_error("zoom::pkt_log_writer: could not close: file is not open");
+
+    _writer.close();
+    _open = false;
+}
+
+unsigned long zoom::pkt_log_writer::pkt_count() const {
+    return _pkt_count;
+}
+
+std::size_t zoom::pkt_log_writer::stream_count() const {
+    return _streams.size();
+}
+
+bool zoom::pkt_log_writer::is_pkt_log_file_name(std::string_view file_name) {
+
+    std::string_view ext = ".zpl";
+    return file_name.size() > ext.size()
+        && file_name.compare(file_name.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+std::size_t zoom::pkt_log_writer::_stream_hash::operator()(const pkt_log_stream& s) const {
+
+    std::size_t a = ((std::size_t) s.ip_src << 32u) | s.ip_dst;
+    std::size_t b = ((std::size_t) s.rtp_ssrc << 32u) | ((std::size_t) s.tp_src << 16u)
+        | s.tp_dst;
+    std::size_t c = ((std::size_t) s.ip_proto << 24u) | ((std::size_t) s.rtp_pt << 16u)
+        | ((std::size_t) (std::uint8_t) s.flow_type << 8u) | s.zoom_media_type;
+    a ^= b + 0x9e3779b9 + (a << 6u) + (a >> 2u);
+    return a ^ (c + 0x9e3779b9 + (a << 6u) + (a >> 2u));
+}
+
+zoom::pkt_log_reader::pkt_log_reader(const std::string& file_name)
+    : _reader(file_name) { }
+
+bool zoom::pkt_log_reader::next(pkt_log_pkt& pkt) {
+
+    pkt_log_record r;
+
+    while (_reader.next(r)) {
+
+        if (r.is_stream()) {
+
+            // the writer numbers the streams in the order of their records
+            auto handle = r.stream.handle & ~PKT_LOG_STREAM_FLAG;
+
+            if (handle != _streams.size())
+                throw std::runtime_error("zoom::pkt_log_reader: unexpected stream handle "
+                                         + std::to_string(handle));
+
+            _streams.push_back(r.stream);
+            continue;
+        }
+
+        if (r.pkt.stream >= _streams.size())
+            throw std::runtime_error("zoom::pkt_log_reader: packet of unknown stream "
+                                     + std::to_string(r.pkt.stream));
+
+        pkt = r.pkt;
+        _pkt_count++;
+        return true;
+    }
+
+    return false;
+}
+
+unsigned long zoom::pkt_log_reader::pkt_count() const {
+    return _pkt_count;
+}
+
+std::size_t zoom::pkt_log_reader::stream_count() const {
+    return _streams.size();
+}
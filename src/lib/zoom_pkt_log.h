@@ -0,0 +1,131 @@
+#ifndef ZOOM_ANALYSIS_ZOOM_PKT_LOG_H
+#define ZOOM_ANALYSIS_ZOOM_PKT_LOG_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "async_writer.h"
+#include "csv_writer.h"
+#include "simple_binary_reader.h"
+#include "simple_binary_writer.h"
+#include "zoom.h"
+
+//! the binary packet log of zoom_rtp: a file of 24-byte records, one per packet, each preceded
+//! by a record of its stream (addresses, ports, SSRC, ...) written once before the stream's first
+//! packet, instead of a CSV line of about 100 bytes per packet (see zoom_pkt_log to convert it)
+namespace zoom {
+
+    //! set in the handle of the records of streams
+    const std::uint32_t PKT_LOG_STREAM_FLAG = 0x80000000;
+
+    //! the header of the packet log in CSV
+    const char* const PKT_LOG_CSV_HEADER = "#ts_s,ts_us,dir,flow_type,ip_proto,ip_src,tp_src,"
+        "ip_dst,tp_dst,media_type,pkts_in_frame,ssrc,pt,rtp_seq,rtp_ts,pl_len,rtp_ext1,drop";
+
+    struct pkt_log_stream {               // 24 Bytes
+        std::uint32_t handle       = 0;   // numbered from 0, with PKT_LOG_STREAM_FLAG
+        std::uint32_t rtp_ssrc     = 0;
+        std::uint32_t ip_src       = 0;
+        std::uint32_t ip_dst       = 0;
+        std::uint16_t tp_src       = 0;
+        std::uint16_t tp_dst       = 0;
+        std::uint8_t ip_proto      = 0;
+        std::uint8_t rtp_pt        = 0;
+        char flow_type             = 0;   // 's' (server), 'p' (P2P), or 0
+        std::uint8_t zoom_media_type = 0;
+
+        //! returns the stream of the packet, without handle
+        static pkt_log_stream from_pkt(const pkt& pkt);
+
+        //! compares the streams, not their handles
+        bool operator==(const pkt_log_stream& s) const;
+    };
+
+    struct pkt_log_pkt {                  // 24 Bytes
+        std::uint32_t stream       = 0;   // the handle of the stream
+        std::uint32_t rtp_ts       = 0;
+        timestamp_ns ts            = 0;
+        std::uint16_t rtp_seq      = 0;
+        std::uint16_t udp_pl_len   = 0;
+        std::uint8_t rtp_ext1[3]   = {0};
+        std::uint8_t pkts_in_frame = 0;   // a byte of the Zoom header
+
+        static pkt_log_pkt from_pkt(const pkt& pkt, std::uint32_t stream);
+    };
+
+    //! both records start with the handle, so that stream.handle tells them apart
+    union pkt_log_record {
+        pkt_log_pkt pkt;
+        pkt_log_stream stream;
+
+        pkt_log_record() : pkt() { }
+
+        [[nodiscard]] bool is_stream() const {
+            return stream.handle & PKT_LOG_STREAM_FLAG;
+        }
+    };
+
+    static_assert(sizeof(pkt_log_stream) == 24);
+    static_assert(sizeof(pkt_log_pkt) == 24);
+    static_assert(sizeof(pkt_log_record) == 24);
+
+    //! writes the packet as a row of the packet log in CSV (see PKT_LOG_CSV_HEADER)
+    void write_pkt_log_csv(csv_writer& csv, const pkt_log_stream& s, const pkt_log_pkt& p);
+
+    //! writes the binary packet log through a simple_binary_writer
+    class pkt_log_writer {
+    public:
+        //! creates or truncates the file, written on the writer's thread if one is given
+        //! - throws std::runtime_error or std::system_error if the file cannot be opened
+        void open(const std::string& file_name, async_writer* writer = nullptr);
+        [[nodiscard]] bool is_open() const;
+
+        //! writes the packet, preceded by its stream if it is the stream's first packet
+        void write(const pkt& pkt);
+
+        void close();
+
+        [[nodiscard]] unsigned long pkt_count() const;
+        [[nodiscard]] std::size_t stream_count() const;
+
+        //! returns true if the file name ends in .zpl
+        static bool is_pkt_log_file_name(std::string_view file_name);
+
+    private:
+        struct _stream_hash {
+            std::size_t operator()(const pkt_log_stream& s) const;
+        };
+
+        simple_binary_writer<pkt_log_record> _writer;
+        std::unordered_map<pkt_log_stream, std::uint32_t, _stream_hash> _streams;
+        pkt_log_stream _last_stream;   // of the last packet, which the next likely shares
+        bool _open = false;
+        unsigned long _pkt_count = 0;
+    };
+
+    //! reads a binary packet log
+    class pkt_log_reader {
+    public:
+        explicit pkt_log_reader(const std::string& file_name);
+
+        //! reads the next packet, throws std::runtime_error if its stream was not written before
+        bool next(pkt_log_pkt& pkt);
+
+        //! returns the stream of a packet read
+        [[nodiscard]] const pkt_log_stream& stream(const pkt_log_pkt& pkt) const {
+            return _streams[pkt.stream];
+        }
+
+        [[nodiscard]] unsigned long pkt_count() const;
+        [[nodiscard]] std::size_t stream_count() const;
+
+    private:
+        simple_binary_reader<pkt_log_record> _reader;
+        std::vector<pkt_log_stream> _streams;
+        unsigned long _pkt_count = 0;
+    };
+}
+
+#endif
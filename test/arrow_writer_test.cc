@@ -0,0 +1,195 @@
+#include <catch.h>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include "lib/arrow_writer.h"
+
+//! reads the tables of a FlatBuffer as far as the tests need
+struct fb_table {
+    const char* buf;
+    std::size_t pos;
+
+    template <typename T>
+    [[nodiscard]] T read(std::size_t at) const {
+        T value;
+        std::memcpy(&value, buf + at, sizeof(value));
+        return value;
+    }
+
+    //! returns the position of the field, 0 if it is not set
+    [[nodiscard]] std::size_t field(unsigned id) const {
+
+        auto vtable = pos - read<std::int32_t>(pos);
+
+        if (4 + 2 * id >= read<std::uint16_t>(vtable))
+            return 0;
+
+        auto offset = read<std::uint16_t>(vtable + 4 + 2 * id);
+        return offset ? pos + offset : 0;
+    }
+
+    template <typename T>
+    [[nodiscard]] T scalar(unsigned id) const {
+        auto at = field(id);
+        return at ? read<T>(at) : T{};
+    }
+
+    //! returns the position of the object the field refers to
+    [[nodiscard]] std::size_t ref(unsigned id) const {
+        auto at = field(id);
+        return at + read<std::uint32_t>(at);
+    }
+
+    [[nodiscard]] fb_table table(unsigned id) const {
+        return { buf, ref(id) };
+    }
+
+    [[nodiscard]] std::uint32_t vector_len(unsigned id) const {
+        return read<std::uint32_t>(ref(id));
+    }
+
+    [[nodiscard]] fb_table vector_table(unsigned id, unsigned i) const {
+        auto at = ref(id) + 4 + 4 * i;
+        return { buf, at + read<std::uint32_t>(at) };
+    }
+
+    [[nodiscard]] std::string string(unsigned id) const {
+        auto at = ref(id);
+        return { buf + at + 4, read<std::uint32_t>(at) };
+    }
+};
+
+static fb_table fb_root(const char* buf) {
+    std::uint32_t root;
+    std::memcpy(&root, buf, sizeof(root));
+    return { buf, root };
+}
+
+TEST_CASE("arrow_writer: writes record batches in the IPC file format", "[arrow_writer]") {
+
+    using column_type = arrow_writer::column_type;
+    std::stringstream out;
+
+    {
+        arrow_writer arrow(out, { { "x", column_type::int32 },
+                                  { "s", column_type::utf8, true },
+                                  { "d", column_type::float64 } }, 2);
+
+        for (int i = 0; i < 5; i++) {
+
+            arrow.value(-i);
+
+            if (i % 2)
+                arrow.value(std::string(i, 'a'));
+            else
+                arrow.null();
+
+            arrow.value(i / 4.0).end_row();
+        }
+
+        CHECK(arrow.row_count() == 5);
+        arrow.close();
+        CHECK(arrow.is_closed());
+    }
+
+    auto file = out.str();
+    const char* buf = file.data();
+
+    REQUIRE(file.size() % 8 == 2); // the footer is aligned, its length and the magic follow
+    CHECK(file.compare(0, 8, std::string("ARROW1\0\0", 8)) == 0);
+    CHECK(file.compare(file.size() - 6, 6, "ARROW1") == 0);
+
+    std::int32_t footer_len;
+    std::memcpy(&footer_len, buf + file.size() - 10, sizeof(footer_len));
+    REQUIRE(footer_len > 0);
+    REQUIRE((std::size_t) footer_len < file.size());
+
+    auto footer = fb_root(buf + file.size() - 10 - footer_len);
+    CHECK(footer.scalar<std::int16_t>(0) == 4); // V5
+
+    auto schema = footer.table(1);
+    REQUIRE(schema.vector_len(1) == 3);
+    CHECK(schema.vector_table(1, 0).string(0) == "x");
+    CHECK(schema.vector_table(1, 0).scalar<std::uint8_t>(2) == 2); // Int
+    CHECK(schema.vector_table(1, 0).table(3).scalar<std::int32_t>(0) == 32);
+    CHECK(schema.vector_table(1, 0).table(3).scalar<std::uint8_t>(1) == 1);
+    CHECK(schema.vector_table(1, 1).string(0) == "s");
+    CHECK(schema.vector_table(1, 1).scalar<std::uint8_t>(1) == 1);
+    CHECK(schema.vector_table(1, 1).scalar<std::uint8_t>(2) == 5); // Utf8
+    CHECK(schema.vector_table(1, 2).scalar<std::uint8_t>(2) == 3); // FloatingPoint
+
+    // the record batches of 2, 2, and 1 rows
+    auto blocks = footer.ref(3);
+    REQUIRE(footer.read<std::uint32_t>(blocks) == 3);
+    int i = 0;
+
+    for (unsigned b = 0; b < 3; b++) {
+
+        auto block = blocks + 4 + 24 * b;
+        auto offset = footer.read<std::int64_t>(block);
+        auto metadata_len = footer.read<std::int32_t>(block + 8);
+        auto body_len = footer.read<std::int64_t>(block + 16);
+
+        REQUIRE(offset % 8 == 0);
+        REQUIRE(metadata_len % 8 == 0);
+        CHECK(fb_table{buf, 0}.read<std::uint32_t>(offset) == 0xffffffff);
+
+        auto msg = fb_root(buf + offset + 8);
+        CHECK(msg.scalar<std::uint8_t>(1) == 3); // RecordBatch
+        CHECK(msg.scalar<std::int64_t>(3) == body_len);
+
+        auto batch = msg.table(2);
+        auto rows = batch.scalar<std::int64_t>(0);
+        CHECK(rows == (b < 2 ? 2 : 1));
+        REQUIRE(batch.vector_len(1) == 3);
+        REQUIRE(batch.vector_len(2) == 7);
+
+        auto nodes = batch.ref(1) + 4;
+        auto buffers = batch.ref(2) + 4;
+        const char* body = buf + offset + metadata_len;
+
+        CHECK(batch.read<std::int64_t>(nodes) == rows);
+        CHECK(batch.read<std::int64_t>(nodes + 8) == 0);
+        CHECK(batch.read<std::int64_t>(nodes + 16 + 8) == (rows + 1) / 2);
+
+        for (std::int64_t r = 0; r < rows; r++, i++) {
+
+            auto x_values = batch.read<std::int64_t>(buffers + 16);
+            auto s_validity = batch.read<std::int64_t>(buffers + 32);
+            auto s_offsets = batch.read<std::int64_t>(buffers + 48);
+            auto d_values = batch.read<std::int64_t>(buffers + 96);
+
+            CHECK(fb_table{body, 0}.read<std::int32_t>(x_values + 4 * r) == -i);
+            CHECK(fb_table{body, 0}.read<double>(d_values + 8 * r) == i / 4.0);
+            CHECK(((body[s_validity] >> r) & 1) == i % 2);
+
+            auto s_len = fb_table{body, 0}.read<std::int32_t>(s_offsets + 4 * (r + 1))
+                         - fb_table{body, 0}.read<std::int32_t>(s_offsets + 4 * r);
+            CHECK(s_len == (i % 2 ? i : 0));
+        }
+    }
+
+    CHECK(i == 5);
+}
+
+TEST_CASE("arrow_writer: rejects values not matching the schema", "[arrow_writer]") {
+
+    using column_type = arrow_writer::column_type;
+    std::stringstream out;
+    arrow_writer arrow(out, { { "x", column_type::uint16 }, { "s", column_type::utf8, true } });
+
+    CHECK_THROWS_AS(arrow.value("x"), std::logic_error);
+    CHECK_THROWS_AS(arrow.null(), std::logic_error);
+
+    arrow.value(1u);
+    CHECK_THROWS_AS(arrow.end_row(), std::logic_error);
+    CHECK_THROWS_AS(arrow.value(1.0), std::logic_error);
+
+    arrow.null().end_row();
+    CHECK(arrow.row_count() == 1);
+
+    CHECK(arrow_writer::is_arrow_file_name("pkts.arrow"));
+    CHECK(arrow_writer::is_arrow_file_name("/tmp/stats.feather"));
+    CHECK_FALSE(arrow_writer::is_arrow_file_name("pkts.csv"));
+    CHECK_FALSE(arrow_writer::is_arrow_file_name(".arrow"));
+}
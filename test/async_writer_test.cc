@@ -0,0 +1,77 @@
+#include <catch.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+#include "lib/async_writer.h"
+
+static std::string read_file(const std::filesystem::path& path) {
+
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+TEST_CASE("async_writer: writes the streams of several files", "[async_writer]") {
+
+    auto dir = std::filesystem::temp_directory_path() / "zoom_async_writer_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directory(dir);
+
+    std::string expected_a, expected_b;
+
+    {
+        // small buffers and a single queued one, so that the producer waits for the thread
+        async_writer writer(16, 1);
+        async_writer::stream a, b;
+        a.open(writer, (dir / "a.csv").string());
+        b.open(writer, (dir / "b.csv").string());
+
+        for (unsigned i = 0; i < 1000; i++) {
+
+            a << i << ",a\n";
+            expected_a += std::to_string(i) + ",a\n";
+
+            if (i % 3 == 0) {
+                b << i << ",b" << std::endl;
+                expected_b += std::to_string(i) + ",b\n";
+            }
+        }
+
+        // moved streams continue the file
+        async_writer::stream c(std::move(b));
+        CHECK_FALSE(b.is_open());
+        REQUIRE(c.is_open());
+        c << "end\n";
+        expected_b += "end\n";
+
+        a.close();
+        c.close();
+        writer.drain();
+
+        CHECK(writer.byte_count() == expected_a.size() + expected_b.size());
+        CHECK(writer.max_queued() == 1);
+        CHECK(writer.stall_time() >= 0);
+    }
+
+    CHECK(read_file(dir / "a.csv") == expected_a);
+    CHECK(read_file(dir / "b.csv") == expected_b);
+
+    // streams not closed are written once destroyed, before the writer
+    {
+        async_writer writer;
+        async_writer::stream s;
+        s.open(writer, (dir / "c.csv").string());
+        s << "c\n";
+    }
+
+    CHECK(read_file(dir / "c.csv") == "c\n");
+
+    async_writer writer;
+    async_writer::stream s;
+    CHECK_THROWS_AS(s.open(writer, (dir / "missing" / "d.csv").string()), std::system_error);
+    CHECK_FALSE(s.is_open());
+
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,73 @@
+#include <catch.h>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include "lib/csv_writer.h"
+
+TEST_CASE("csv_writer: formats fields as operator<< does", "[csv_writer]") {
+
+    std::stringstream expected, out;
+
+    {
+        csv_writer csv(out);
+
+        for (std::uint32_t addr : { 0u, 0x0a09791cu, 0x7f000001u, 0xc0a80164u, 0xffffffffu,
+                                    0x01020304u, 0x63646566u }) {
+
+            net::ipv4_5tuple ip_5t(addr, ~addr, 8801, 65535, 17);
+
+            expected << net::ipv4::addr_to_str(addr) << "," << ip_5t << "\n";
+            csv.addr_field(addr).field(ip_5t).end_row();
+        }
+
+        for (double d : { 0.0, -0.0, 1.0, 0.1, 1.0 / 3, 123456.789, 1e-5, 2.5e17, -42.125,
+                          1632344358.742734, std::nan(""),
+                          std::numeric_limits<double>::infinity() }) {
+
+            for (int precision : { 5, 6, std::numeric_limits<long double>::digits10 }) {
+                expected << std::setprecision(precision) << d << "\n";
+                csv.field(d, precision).end_row();
+            }
+
+            expected << std::setprecision(6) << d << "\n";
+            csv.field(d).end_row();
+        }
+
+        expected << std::dec << 0 << "," << 4294967295u << "," << -7 << ","
+                 << 18446744073709551615ul << ",NA,a,0x" << std::hex << std::setw(2) << std::setfill('0') << 5u
+                 << std::setw(2) << 171u << std::setw(2) << 0u << std::dec << "\n";
+        csv.field(0).field(4294967295u).field(-7).field(18446744073709551615ul).field("NA")
+           .field('a').field("0x").append_hex(5, 2).append_hex(171, 2).append_hex(0, 2).end_row();
+
+        csv.flush();
+    }
+
+    CHECK(out.str() == expected.str());
+}
+
+TEST_CASE("csv_writer: writes whole rows to the stream", "[csv_writer]") {
+
+    std::stringstream out;
+    csv_writer csv(out, 8);
+
+    csv.field("abc").field(123);
+    CHECK(out.str().empty());
+
+    csv.end_row();
+    CHECK(out.str() == "abc,123\n");
+
+    // rows longer than the buffer grow it
+    std::string long_field(10000, 'x');
+    csv.field(long_field).field(1).end_row();
+    CHECK(out.str() == "abc,123\n" + long_field + ",1\n");
+
+    csv.field(1);
+    csv.end_row();
+    csv.field(2);
+    CHECK(out.str() == "abc,123\n" + long_field + ",1\n");
+
+    csv.end_row();
+    csv.flush();
+    CHECK(out.str() == "abc,123\n" + long_field + ",1\n1\n2\n");
+}
@@ -0,0 +1,43 @@
+#include <catch.h>
+#include <filesystem>
+#include <fstream>
+#include "lib/directory_watcher.h"
+
+TEST_CASE("directory_watcher: yields files of a rotating capture as they are completed",
+          "[directory_watcher]") {
+
+    auto dir = std::filesystem::temp_directory_path() / "zoom_directory_watcher_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directory(dir);
+
+    auto write = [&dir](const std::string& name) {
+        std::ofstream(dir / name) << "data";
+        return (dir / name).string();
+    };
+
+    // existing files are complete except for the last one in sequence order
+    auto pcap2 = write("trace.pcap2");
+    auto pcap10 = write("trace.pcap10");
+    write("notes.txt");
+    write(".trace.pcap11");
+
+    directory_watcher watcher(dir.string(), "pcap");
+
+    CHECK(watcher.next(0) == pcap2);
+    CHECK(watcher.next(0) == std::nullopt);
+    CHECK(watcher.pending() == pcap10);
+
+    // creating the next file completes the pending one, closing it after writing completes it
+    auto pcap11 = write("trace.pcap11");
+    CHECK(watcher.next(1000) == pcap10);
+    CHECK(watcher.next(1000) == pcap11);
+    CHECK_FALSE(watcher.pending());
+
+    // files are only yielded once
+    write("trace.pcap11");
+    write("trace.pcap12.zst");
+    CHECK(watcher.next(1000) == (dir / "trace.pcap12.zst").string());
+    CHECK(watcher.next(0) == std::nullopt);
+
+    std::filesystem::remove_all(dir);
+}
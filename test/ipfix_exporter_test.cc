@@ -0,0 +1,385 @@
+#include <catch.h>
+#include <arpa/inet.h>
+#include <cstdint>
+#include <netinet/in.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+#include "lib/ipfix_exporter.h"
+#include "lib/zoom_flow_exporter.h"
+
+#include "test_packets.h"
+
+typedef std::vector<unsigned char> bytes;
+
+static std::uint64_t get(const bytes& b, std::size_t offset, unsigned len) {
+
+    std::uint64_t v = 0;
+
+    for (unsigned i = 0; i < len; i++)
+        v = (v << 8) | b.at(offset + i);
+
+    return v;
+}
+
+//! a collector on localhost at a free port, which receives the messages of an exporter
+struct test_collector {
+    ipfix_exporter::transport proto;
+    int fd = -1, conn = -1;
+    std::uint16_t port = 0;
+
+    explicit test_collector(ipfix_exporter::transport proto) : proto(proto) {
+
+        fd = socket(AF_INET, proto == ipfix_exporter::transport::udp ? SOCK_DGRAM : SOCK_STREAM,
+                    0);
+        REQUIRE(fd >= 0);
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t addr_len = sizeof(addr);
+
+        REQUIRE(bind(fd, (sockaddr*) &addr, sizeof(addr)) == 0);
+        REQUIRE(getsockname(fd, (sockaddr*) &addr, &addr_len) == 0);
+        port = ntohs(addr.sin_port);
+
+        if (proto == ipfix_exporter::transport::tcp)
+            REQUIRE(listen(fd, 1) == 0);
+    }
+
+    [[nodiscard]] ipfix_exporter::collector collector() const {
+        return { proto, "127.0.0.1", port };
+    }
+
+    //! returns the next message, empty after waiting for a second
+    bytes next() {
+
+        timeval timeout = { 1, 0 };
+
+        if (proto == ipfix_exporter::transport::udp) {
+
+            bytes msg(65536);
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            auto n = recv(fd, msg.data(), msg.size(), 0);
+            msg.resize(n > 0 ? (std::size_t) n : 0);
+            return msg;
+        }
+
+        if (conn < 0) {
+            conn = accept(fd, nullptr, nullptr);
+            REQUIRE(conn >= 0);
+            setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        }
+
+        bytes msg(ipfix_exporter::HDR_LEN);
+
+        if (!read_all(msg.data(), msg.size()))
+            return {};
+
+        msg.resize(get(msg, 2, 2));
+
+        if (!read_all(msg.data() + ipfix_exporter::HDR_LEN, msg.size() - ipfix_exporter::HDR_LEN))
+            return {};
+
+        return msg;
+    }
+
+    bool read_all(unsigned char* data, std::size_t len) const {
+
+        for (std::size_t read = 0; read < len;) {
+
+            auto n = recv(conn, data + read, len - read, 0);
+
+            if (n <= 0)
+                return false;
+
+            read += (std::size_t) n;
+        }
+
+        return true;
+    }
+
+    ~test_collector() {
+
+        if (conn >= 0)
+            close(conn);
+
+        close(fd);
+    }
+};
+
+//! returns the sets of a message by set id
+static std::vector<std::pair<std::uint16_t, bytes>> sets(const bytes& msg) {
+
+    std::vector<std::pair<std::uint16_t, bytes>> sets;
+
+    for (std::size_t pos = ipfix_exporter::HDR_LEN; pos < msg.size();) {
+
+        auto len = get(msg, pos + 2, 2);
+        REQUIRE(len >= ipfix_exporter::SET_HDR_LEN);
+        REQUIRE(pos + len <= msg.size());
+
+        sets.emplace_back((std::uint16_t) get(msg, pos, 2),
+                          bytes(msg.begin() + (long) pos + 4, msg.begin() + (long) (pos + len)));
+        pos += len;
+    }
+
+    return sets;
+}
+
+//! returns the records of a template in the data sets of a message
+static std::vector<bytes> records(const bytes& msg, std::uint16_t template_id,
+                                  std::size_t record_len) {
+
+    std::vector<bytes> records;
+
+    for (const auto& [id, set] : sets(msg)) {
+
+        if (id != template_id)
+            continue;
+
+        REQUIRE(set.size() % record_len == 0);
+
+        for (std::size_t pos = 0; pos < set.size(); pos += record_len)
+            records.emplace_back(set.begin() + (long) pos,
+                                 set.begin() + (long) (pos + record_len));
+    }
+
+    return records;
+}
+
+TEST_CASE("ipfix_exporter::collector: parses collectors", "[ipfix]") {
+
+    auto c = ipfix_exporter::collector::parse("10.0.0.1");
+    CHECK(c.proto == ipfix_exporter::transport::udp);
+    CHECK(c.host == "10.0.0.1");
+    CHECK(c.port == ipfix_exporter::DEFAULT_PORT);
+
+    c = ipfix_exporter::collector::parse("tcp://collector.example:9995");
+    CHECK(c.proto == ipfix_exporter::transport::tcp);
+    CHECK(c.host == "collector.example");
+    CHECK(c.port == 9995);
+    CHECK(c.to_str() == "tcp://collector.example:9995");
+
+    c = ipfix_exporter::collector::parse("udp://[::1]:4740");
+    CHECK(c.host == "::1");
+    CHECK(c.port == 4740);
+    CHECK(c.to_str() == "udp://[::1]:4740");
+
+    CHECK(ipfix_exporter::collector::parse("::1").host == "::1");
+
+    CHECK_THROWS_AS(ipfix_exporter::collector::parse("sctp://10.0.0.1"), std::invalid_argument);
+    CHECK_THROWS_AS(ipfix_exporter::collector::parse("10.0.0.1:0"), std::invalid_argument);
+    CHECK_THROWS_AS(ipfix_exporter::collector::parse("10.0.0.1:65536"), std::invalid_argument);
+    CHECK_THROWS_AS(ipfix_exporter::collector::parse("10.0.0.1:47x"), std::invalid_argument);
+    CHECK_THROWS_AS(ipfix_exporter::collector::parse("udp://:4739"), std::invalid_argument);
+}
+
+TEST_CASE("ipfix_exporter: sends templates and records over UDP", "[ipfix]") {
+
+    test_collector collector(ipfix_exporter::transport::udp);
+    ipfix_exporter exporter(collector.collector(), 7);
+
+    exporter.add_template(300, { { 8, 4 }, { 2, 8 }, { 1, 1, 32473 } });
+
+    for (std::uint32_t i = 0; i < 3; i++)
+        exporter.record(300).u32(0x0a000001 + i).u64(i * 1000).u8(42);
+
+    exporter.flush();
+
+    auto msg = collector.next();
+    REQUIRE(msg.size() == 16 + 4 + 20 + 4 + 3 * 13);
+    CHECK(get(msg, 0, 2) == ipfix_exporter::VERSION);
+    CHECK(get(msg, 2, 2) == msg.size());
+    CHECK(get(msg, 8, 4) == 0);  // sequence number
+    CHECK(get(msg, 12, 4) == 7); // observation domain
+
+    auto s = sets(msg);
+    REQUIRE(s.size() == 2);
+    CHECK(s[0].first == ipfix_exporter::TEMPLATE_SET_ID);
+    CHECK(s[0].second == bytes { 0x01, 0x2c, 0x00, 0x03, 0x00, 0x08, 0x00, 0x04, 0x00, 0x02,
+                                 0x00, 0x08, 0x80, 0x01, 0x00, 0x01, 0x00, 0x00, 0x7e, 0xd9 });
+
+    auto r = records(msg, 300, 13);
+    REQUIRE(r.size() == 3);
+    CHECK(get(r[2], 0, 4) == 0x0a000003);
+    CHECK(get(r[2], 4, 8) == 2000);
+    CHECK(get(r[2], 12, 1) == 42);
+
+    SECTION("splits records into messages of at most max_msg_len() bytes") {
+
+        for (std::uint32_t i = 0; i < 200; i++)
+            exporter.record(300).u32(i).u64(i).u8(0);
+
+        exporter.flush();
+
+        std::size_t count = 0;
+
+        while (count < 200) {
+
+            msg = collector.next();
+            REQUIRE(!msg.empty());
+            CHECK(msg.size() <= ipfix_exporter::UDP_MSG_LEN);
+            CHECK(get(msg, 8, 4) == 3 + count);
+
+            // the templates are only sent again after TEMPLATE_REFRESH_S
+            for (const auto& [id, set] : sets(msg))
+                CHECK(id == 300);
+
+            auto part = records(msg, 300, 13);
+            REQUIRE(!part.empty());
+            CHECK(get(part[0], 0, 4) == count);
+            count += part.size();
+        }
+
+        CHECK(count == 200);
+        CHECK(exporter.record_count() == 203);
+        CHECK(exporter.error_count() == 0);
+    }
+
+    SECTION("rejects records that do not match their template") {
+
+        CHECK_THROWS_AS(exporter.record(301), std::logic_error);
+
+        exporter.record(300).u32(0);
+        CHECK_THROWS_AS(exporter.record(300), std::logic_error);
+
+        exporter.u64(0).u8(0);
+        CHECK_THROWS_AS(exporter.u8(0), std::logic_error);
+
+        CHECK_THROWS_AS(exporter.add_template(255, { { 8, 4 } }), std::invalid_argument);
+    }
+}
+
+TEST_CASE("ipfix_exporter: sends templates and records over TCP", "[ipfix]") {
+
+    test_collector collector(ipfix_exporter::transport::tcp);
+
+    {
+        ipfix_exporter exporter(collector.collector());
+        exporter.add_template(256, { { 4, 1 } });
+        exporter.add_template(257, { { 7, 2 }, { 11, 2 } });
+
+        exporter.record(256).u8(17);
+        exporter.record(257).u16(8801).u16(50000);
+        exporter.record(257).u16(8801).u16(50001);
+        exporter.flush();
+
+        exporter.record(256).u8(6);
+    }
+
+    auto msg = collector.next();
+    auto s = sets(msg);
+    REQUIRE(s.size() == 3);
+    CHECK(s[0].first == ipfix_exporter::TEMPLATE_SET_ID);
+    CHECK(s[0].second.size() == 8 + 12);
+    CHECK(records(msg, 256, 1) == std::vector<bytes> { { 17 } });
+    CHECK(records(msg, 257, 4).size() == 2);
+
+    // the exporter sends the records left when it is destroyed
+    msg = collector.next();
+    CHECK(get(msg, 8, 4) == 3);
+    REQUIRE(sets(msg).size() == 1);
+    CHECK(records(msg, 256, 1) == std::vector<bytes> { { 6 } });
+}
+
+TEST_CASE("ipfix_exporter: throws if it cannot connect", "[ipfix]") {
+
+    ipfix_exporter::collector closed;
+
+    {
+        test_collector collector(ipfix_exporter::transport::tcp);
+        closed = collector.collector();
+    }
+
+    CHECK_THROWS_AS(ipfix_exporter { closed }, std::system_error);
+}
+
+TEST_CASE("zoom::flow_exporter: exports flows as they time out", "[zoom][ipfix]") {
+
+    const std::size_t record_len = 103;
+    const std::size_t pkts = 37, reason = 53, type = 54, zoom_pkts = 55, zoom_bytes = 63,
+        video_pkts = 79, other_pkts = 95;
+
+    test_collector collector(ipfix_exporter::transport::udp);
+    zoom::flow_exporter exporter(collector.collector(), {});
+
+    auto hdr = zoom::parse_zoom_pkt_buf(test::zoom_srv_video_buf, net::eth::HDR_LEN, false);
+    auto ip_5t = net::ipv4_5tuple::from_ipv4_pkt_data(test::zoom_srv_video_buf
+                                                      + net::eth::HDR_LEN);
+
+    zoom::flow_tracker::flow_stats flow;
+    flow.id = 3;
+    flow.type = zoom::flow_tracker::flow_type::udp_srv;
+
+    SECTION("exports flows idle for idle_timeout_s") {
+
+        exporter.add(ip_5t, flow, timestamp::from_sec(1000), 909, hdr);
+        exporter.add(ip_5t, flow, timestamp::from_sec(1000, 500000000), 909, hdr);
+        CHECK(exporter.flow_count() == 1);
+
+        exporter.expire(timestamp::from_sec(1030));
+        CHECK(exporter.flow_count() == 1);
+
+        exporter.expire(timestamp::from_sec(1030, 500000000));
+        CHECK(exporter.flow_count() == 0);
+
+        // records exported are sent without waiting for further records
+        auto r = records(collector.next(), zoom::flow_exporter::TEMPLATE_ID, record_len);
+        REQUIRE(r.size() == 1);
+
+        // packets without a Zoom media header count as packets of other types
+        zoom::headers no_media = hdr;
+        no_media.zoom_inner = nullptr;
+        exporter.add(ip_5t, flow, timestamp::from_sec(1040), 100, no_media);
+        exporter.close();
+
+        r.push_back(records(collector.next(), zoom::flow_exporter::TEMPLATE_ID, record_len).at(0));
+
+        CHECK(get(r[0], 0, 4) == ip_5t.ip_src);
+        CHECK(get(r[0], 10, 2) == ip_5t.tp_dst);
+        CHECK(get(r[0], 13, 8) == 3);
+        CHECK(get(r[0], 21, 8) == 1000000);
+        CHECK(get(r[0], 29, 8) == 1000500);
+        CHECK(get(r[0], pkts, 8) == 2);
+        CHECK(get(r[0], pkts + 8, 8) == 2 * 909);
+        CHECK(get(r[0], reason, 1) == 1);
+        CHECK(get(r[0], type, 1) == 2);
+        CHECK(get(r[0], zoom_pkts, 8) == 2);
+        CHECK(get(r[0], zoom_bytes, 8) == 2 * 895);
+        CHECK(get(r[0], video_pkts, 8) == 2);
+        CHECK(get(r[0], other_pkts, 8) == 0);
+
+        CHECK(get(r[1], pkts, 8) == 1);
+        CHECK(get(r[1], reason, 1) == 4);
+        CHECK(get(r[1], video_pkts, 8) == 0);
+        CHECK(get(r[1], other_pkts, 8) == 1);
+    }
+
+    SECTION("exports flows with packets every active_timeout_s") {
+
+        for (std::int64_t s = 0; s <= 130; s += 10)
+            exporter.add(ip_5t, flow, timestamp::from_sec(s), 100, hdr);
+
+        exporter.close();
+
+        std::vector<bytes> r;
+
+        for (auto msg = collector.next(); !msg.empty(); msg = collector.next()) {
+            for (auto& record : records(msg, zoom::flow_exporter::TEMPLATE_ID, record_len))
+                r.push_back(std::move(record));
+        }
+
+        REQUIRE(r.size() == 3);
+        CHECK(get(r[0], pkts, 8) == 6);
+        CHECK(get(r[0], reason, 1) == 2);
+        CHECK(get(r[1], pkts, 8) == 6);
+        CHECK(get(r[1], 21, 8) == 60000);
+        CHECK(get(r[1], reason, 1) == 2);
+        CHECK(get(r[2], pkts, 8) == 2);
+        CHECK(get(r[2], reason, 1) == 4);
+        CHECK(exporter.exporter().record_count() == 3);
+    }
+}
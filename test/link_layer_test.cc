@@ -0,0 +1,226 @@
+#include <catch.h>
+#include <vector>
+#include "lib/link_layer.h"
+#include "lib/zoom.h"
+
+#include "test_packets.h"
+
+static const std::vector<unsigned char> eth_frame(test::zoom_srv_video_buf,
+    test::zoom_srv_video_buf + sizeof(test::zoom_srv_video_buf));
+
+//! returns the Ethernet test frame with the given VLAN tags inserted in front of its EtherType
+static std::vector<unsigned char> tagged_frame(const std::vector<std::uint16_t>& tpids) {
+
+    std::vector<unsigned char> buf(eth_frame.begin(), eth_frame.begin() + 12);
+
+    for (auto tpid : tpids)
+        buf.insert(buf.end(), { (unsigned char) (tpid >> 8u), (unsigned char) tpid, 0x00, 0x2a });
+
+    buf.insert(buf.end(), eth_frame.begin() + 12, eth_frame.end());
+    return buf;
+}
+
+static std::vector<unsigned char> sll_frame() {
+
+    std::vector<unsigned char> buf = { 0x00, 0x04, 0x00, 0x01, 0x00, 0x06 };
+    buf.insert(buf.end(), eth_frame.begin() + 6, eth_frame.begin() + 12); // source address
+    buf.insert(buf.end(), { 0x00, 0x00, 0x08, 0x00 });
+    buf.insert(buf.end(), eth_frame.begin() + net::eth::HDR_LEN, eth_frame.end());
+    return buf;
+}
+
+static pcap_pkt to_pkt(const std::vector<unsigned char>& buf, pcap_link_type link_type) {
+
+    pcap_pkt pkt;
+    pkt.buf = buf.data();
+    pkt.cap_len = pkt.frame_len = buf.size();
+    pkt.link_type = link_type;
+    return pkt;
+}
+
+TEST_CASE("link_layer: finds the IPv4 packet of frames", "[link_layer]") {
+
+    const auto* src_addr = &((const net::eth::hdr*) eth_frame.data())->src_addr;
+
+    SECTION("ethernet") {
+        auto f = link_layer::decoder<pcap_link_type::eth>::decode(eth_frame.data(),
+                                                                  eth_frame.size());
+        CHECK(f.ipv4);
+        CHECK(f.ip_offset == net::eth::HDR_LEN);
+        CHECK(f.src_addr == src_addr);
+    }
+
+    SECTION("802.1Q and QinQ") {
+
+        auto vlan = tagged_frame({ link_layer::ETH_TYPE_VLAN });
+        auto f = link_layer::decoder<pcap_link_type::eth>::decode(vlan.data(), vlan.size());
+        CHECK(f.ipv4);
+        CHECK(f.ip_offset == net::eth::HDR_LEN + 4);
+
+        auto qinq = tagged_frame({ link_layer::ETH_TYPE_QINQ, link_layer::ETH_TYPE_VLAN });
+        f = link_layer::decoder<pcap_link_type::eth>::decode(qinq.data(), qinq.size());
+        CHECK(f.ipv4);
+        CHECK(f.ip_offset == net::eth::HDR_LEN + 8);
+
+        auto hdr = zoom::parse_zoom_pkt_buf(qinq.data(), f.ip_offset, false);
+        REQUIRE(hdr.rtp != nullptr);
+        CHECK(hdr.rtp->seq == htons(7715));
+
+        // more tags than supported
+        auto tags3 = tagged_frame({ link_layer::ETH_TYPE_QINQ, link_layer::ETH_TYPE_VLAN,
+                                    link_layer::ETH_TYPE_VLAN });
+        CHECK_FALSE(link_layer::decoder<pcap_link_type::eth>::decode(tags3.data(), tags3.size())
+            .ipv4);
+    }
+
+    SECTION("raw") {
+        const auto* ip = eth_frame.data() + net::eth::HDR_LEN;
+        auto f = link_layer::decoder<pcap_link_type::raw>::decode(ip, net::ipv4::HDR_LEN);
+        CHECK(f.ipv4);
+        CHECK(f.ip_offset == 0);
+        CHECK(f.src_addr == nullptr);
+
+        const unsigned char ipv6[40] = { 0x60 };
+        CHECK_FALSE(link_layer::decoder<pcap_link_type::raw>::decode(ipv6, sizeof(ipv6)).ipv4);
+    }
+
+    SECTION("linux cooked capture") {
+        auto sll = sll_frame();
+        auto f = link_layer::decoder<pcap_link_type::sll>::decode(sll.data(), sll.size());
+        CHECK(f.ipv4);
+        CHECK(f.ip_offset == link_layer::SLL_HDR_LEN);
+        REQUIRE(f.src_addr != nullptr);
+        CHECK(f.src_addr->to_str() == src_addr->to_str());
+    }
+
+    SECTION("truncated") {
+        CHECK_FALSE(link_layer::decoder<pcap_link_type::eth>::decode(eth_frame.data(), 20).ipv4);
+        CHECK_FALSE(link_layer::decoder<pcap_link_type::sll>::decode(eth_frame.data(), 10).ipv4);
+    }
+}
+
+TEST_CASE("link_layer: decodes batches of mixed link types", "[link_layer]") {
+
+    auto vlan = tagged_frame({ link_layer::ETH_TYPE_VLAN });
+    auto sll = sll_frame();
+    std::vector<unsigned char> raw(eth_frame.begin() + net::eth::HDR_LEN, eth_frame.end());
+
+    pcap_pkt pkts[] = {
+        to_pkt(eth_frame, pcap_link_type::eth), to_pkt(vlan, pcap_link_type::eth),
+        to_pkt(raw, pcap_link_type::raw), to_pkt(sll, pcap_link_type::sll),
+        to_pkt(eth_frame, pcap_link_type::loop)
+    };
+
+    link_layer::frame frames[5];
+    link_layer::decode(pkts, 5, frames);
+
+    CHECK(frames[0].ip_offset == net::eth::HDR_LEN);
+    CHECK(frames[1].ip_offset == net::eth::HDR_LEN + 4);
+    CHECK(frames[2].ip_offset == 0);
+    CHECK(frames[3].ip_offset == link_layer::SLL_HDR_LEN);
+    CHECK_FALSE(frames[4].ipv4);
+
+    for (unsigned i = 0; i < 4; i++) {
+        CHECK(frames[i].ipv4);
+        CHECK(net::ipv4_5tuple::from_ipv4_pkt_data(pkts[i].buf + frames[i].ip_offset)
+            == net::ipv4_5tuple::from_ipv4_pkt_data(eth_frame.data() + net::eth::HDR_LEN));
+    }
+
+    CHECK(link_layer::is_supported(pcap_link_type::sll2));
+    CHECK_FALSE(link_layer::is_supported(pcap_link_type::multiple_error));
+}
+
+//! returns an Ethernet frame of an outer IPv4 packet from 192.0.2.1 to 192.0.2.2 with the payload
+static std::vector<unsigned char> outer_frame(std::uint8_t ip_proto,
+                                              const std::vector<unsigned char>& payload) {
+
+    std::vector<unsigned char> buf(eth_frame.begin(), eth_frame.begin() + net::eth::HDR_LEN);
+    buf.insert(buf.end(), { 0x45, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x40, ip_proto,
+                            0x00, 0x00, 192, 0, 2, 1, 192, 0, 2, 2 });
+    buf.insert(buf.end(), payload.begin(), payload.end());
+    return buf;
+}
+
+static std::vector<unsigned char> concat(std::vector<unsigned char> a,
+                                         const std::vector<unsigned char>& b) {
+    a.insert(a.end(), b.begin(), b.end());
+    return a;
+}
+
+TEST_CASE("link_layer: decapsulates tunnel packets", "[link_layer]") {
+
+    const std::vector<unsigned char> inner_ip(eth_frame.begin() + net::eth::HDR_LEN,
+                                              eth_frame.end());
+    const auto inner_5t = net::ipv4_5tuple::from_ipv4_pkt_data(inner_ip.data());
+
+    auto check = [&](const std::vector<unsigned char>& buf, link_layer::tunnel_type type,
+                     unsigned ip_offset) {
+
+        auto pkt = to_pkt(buf, pcap_link_type::eth);
+        link_layer::frame f;
+        link_layer::decode(&pkt, 1, &f);
+
+        REQUIRE(f.ipv4);
+        CHECK(f.ip_offset == ip_offset);
+        CHECK(f.src_addr == &((const net::eth::hdr*) buf.data())->src_addr);
+        CHECK(f.tunnel.type == type);
+        CHECK(f.tunnel.ip_src == net::ipv4::str_to_addr("192.0.2.1"));
+        CHECK(f.tunnel.ip_dst == net::ipv4::str_to_addr("192.0.2.2"));
+        CHECK(net::ipv4_5tuple::from_ipv4_pkt_data(buf.data() + f.ip_offset) == inner_5t);
+
+        auto hdr = zoom::parse_zoom_pkt_buf(buf.data(), f.ip_offset, false);
+        REQUIRE(hdr.rtp != nullptr);
+        CHECK(hdr.rtp->seq == htons(7715));
+    };
+
+    const unsigned outer_len = net::eth::HDR_LEN + net::ipv4::HDR_LEN;
+
+    SECTION("GRE") {
+        check(outer_frame(47, concat({ 0x00, 0x00, 0x08, 0x00 }, inner_ip)),
+              link_layer::tunnel_type::gre, outer_len + 4);
+
+        // with key, Ethernet payload
+        check(outer_frame(47, concat({ 0x20, 0x00, 0x65, 0x58, 0x00, 0x00, 0x00, 0x07 },
+                                     eth_frame)),
+              link_layer::tunnel_type::gre, outer_len + 8 + net::eth::HDR_LEN);
+    }
+
+    SECTION("ERSPAN") {
+        // type II: GRE with sequence number, ERSPAN header, VLAN-tagged mirrored frame
+        check(outer_frame(47, concat({ 0x10, 0x00, 0x88, 0xbe, 0x00, 0x00, 0x00, 0x01,
+                                       0x10, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00 },
+                                     tagged_frame({ link_layer::ETH_TYPE_VLAN }))),
+              link_layer::tunnel_type::erspan, outer_len + 16 + net::eth::HDR_LEN + 4);
+
+        // type III with platform-specific subheader
+        auto erspan_3 = std::vector<unsigned char>(4 + 12 + 8, 0);
+        erspan_3[2] = 0x22, erspan_3[3] = 0xeb, erspan_3[4] = 0x20, erspan_3[15] = 0x01;
+        check(outer_frame(47, concat(erspan_3, eth_frame)),
+              link_layer::tunnel_type::erspan, outer_len + 24 + net::eth::HDR_LEN);
+    }
+
+    SECTION("VXLAN") {
+        check(outer_frame(17, concat({ 0xc0, 0x00, 0x12, 0xb5, 0x00, 0x00, 0x00, 0x00,
+                                       0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2a, 0x00 },
+                                     eth_frame)),
+              link_layer::tunnel_type::vxlan, outer_len + 16 + net::eth::HDR_LEN);
+    }
+
+    SECTION("no tunnel") {
+        auto gre_routing = outer_frame(47, concat({ 0x40, 0x00, 0x08, 0x00 }, inner_ip));
+        auto f = link_layer::decapsulate(gre_routing.data(), gre_routing.size(),
+            link_layer::decoder<pcap_link_type::eth>::decode(gre_routing.data(),
+                                                             gre_routing.size()));
+        CHECK(f.ipv4);
+        CHECK(f.ip_offset == net::eth::HDR_LEN);
+        CHECK(f.tunnel.type == link_layer::tunnel_type::none);
+
+        // truncated inner frame
+        auto vxlan = outer_frame(17, { 0xc0, 0x00, 0x12, 0xb5, 0x00, 0x00, 0x00, 0x00,
+                                       0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2a, 0x00 });
+        f = link_layer::decapsulate(vxlan.data(), vxlan.size(),
+            link_layer::decoder<pcap_link_type::eth>::decode(vxlan.data(), vxlan.size()));
+        CHECK_FALSE(f.ipv4);
+        CHECK(f.tunnel.type == link_layer::tunnel_type::vxlan);
+    }
+}
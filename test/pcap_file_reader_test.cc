@@ -1,8 +1,21 @@
 
 #include <catch.h>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include "lib/link_layer.h"
 #include "lib/net.h"
 #include "lib/pcap_util.h"
+#include "lib/file_decoder.h"
+#include "lib/io_uring_chunk_source.h"
 #include "lib/pcap_file_reader.h"
+#include "lib/pcap_file_writer.h"
+#include "lib/pcap_format.h"
+#include "lib/pcap_record_walker.h"
+#include "lib/read_ahead_chunk_source.h"
 
 TEST_CASE("pcap_file_reader: single input file", "[pcap][pcap_file_reader]") {
 
@@ -11,7 +24,7 @@ TEST_CASE("pcap_file_reader: single input file", "[pcap][pcap_file_reader]") {
     SECTION("next(buf, ...)") {
 
         const unsigned char* buf = nullptr;
-        timeval ts = {0, 0};
+        timestamp_ns ts = 0;
         unsigned short frame_len = 0, cap_len = 0;
         unsigned total_frames = 0, total_bytes = 0;
 
@@ -19,7 +32,7 @@ TEST_CASE("pcap_file_reader: single input file", "[pcap][pcap_file_reader]") {
         total_frames++;
         total_bytes += frame_len;
 
-        CHECK(ts.tv_sec == 1646581842);
+        CHECK(timestamp::sec(ts) == 1646581842);
         CHECK(frame_len == 78);
         CHECK(cap_len == 64);
         CHECK(buf[0] == 0xbc);
@@ -29,7 +42,7 @@ TEST_CASE("pcap_file_reader: single input file", "[pcap][pcap_file_reader]") {
             total_bytes += frame_len;
         }
 
-        CHECK(ts.tv_sec == 1646581842);
+        CHECK(timestamp::sec(ts) == 1646581842);
         CHECK(frame_len == 66);
         CHECK(cap_len == 64);
         CHECK(buf[0] == 0xb2);
@@ -47,7 +60,7 @@ TEST_CASE("pcap_file_reader: single input file", "[pcap][pcap_file_reader]") {
         total_frames++;
         total_bytes += pkt.frame_len;
 
-        CHECK(pkt.ts.tv_sec == 1646581842);
+        CHECK(timestamp::sec(pkt.ts) == 1646581842);
         CHECK(pkt.frame_len == 78);
         CHECK(pkt.cap_len == 64);
         CHECK(pkt.buf[0] == 0xbc);
@@ -57,7 +70,7 @@ TEST_CASE("pcap_file_reader: single input file", "[pcap][pcap_file_reader]") {
             total_bytes += pkt.frame_len;
         }
 
-        CHECK(pkt.ts.tv_sec == 1646581842);
+        CHECK(timestamp::sec(pkt.ts) == 1646581842);
         CHECK(pkt.frame_len == 66);
         CHECK(pkt.cap_len == 64);
         CHECK(pkt.buf[0] == 0xb2);
@@ -104,16 +117,551 @@ TEST_CASE("pcap_file_reader: multiple input files", "[pcap][pcap_file_reader]")
     p.close();
 }
 
-TEST_CASE("pcap_file_reader: throws an exception when providing inconsistent data link types",
+TEST_CASE("pcap_file_reader: reports the link type of every packet for mixed data link types",
           "[pcap][pcap_file_reader]") {
 
-    std::vector<std::string> inconsistent_data_links = {
+    std::vector<std::string> mixed_data_links = {
         "data/test3.pcap",
         "data/test4_rawip.pcap",
         "data/test5.pcap"
     };
 
-    pcap_file_reader* p = nullptr;
+    for (auto backend : { pcap_file_reader::backend::libpcap, pcap_file_reader::backend::mmap }) {
 
-    CHECK_THROWS(p = new pcap_file_reader(inconsistent_data_links));
+        INFO("backend: " << pcap_file_reader::backend_string(backend));
+
+        pcap_file_reader p(mixed_data_links, backend);
+        pcap_pkt pkt;
+        unsigned eth_frames = 0, ipv4_frames = 0;
+
+        // the link types of the other files are read once they are reached
+        CHECK(p.datalink_type() == pcap_link_type::eth);
+
+        while (p.next(pkt)) {
+            eth_frames += pkt.link_type == pcap_link_type::eth;
+            ipv4_frames += pkt.link_type == pcap_link_type::ipv4;
+        }
+
+        CHECK(p.datalink_type() == pcap_link_type::multiple_error);
+
+        CHECK(eth_frames == 20);
+        CHECK(ipv4_frames == 10);
+        p.close();
+    }
+}
+
+TEST_CASE("pcap_file_reader: reads raw IP captures (LINKTYPE_RAW) with every back end",
+          "[pcap][pcap_file_reader]") {
+
+    // libpcap reads LINKTYPE_RAW files as DLT_RAW, whose value depends on the platform
+    auto file_name = (std::filesystem::temp_directory_path() / "zoom_test_raw.pcap").string();
+    unsigned pkts = 0, ipv4_pkts = 0;
+
+    {
+        pcap_file_reader r("data/zoom_test.pcap");
+        pcap_file_writer w(file_name, pcap_link_type::raw);
+        pcap_pkt pkt;
+
+        while (r.next(pkt)) {
+
+            auto frame = link_layer::decoder<pcap_link_type::eth>::decode(pkt.buf, pkt.cap_len);
+            ipv4_pkts += frame.ipv4 && frame.ip_offset == net::eth::HDR_LEN;
+
+            pkt.buf += net::eth::HDR_LEN;
+            pkt.cap_len -= net::eth::HDR_LEN;
+            pkt.frame_len -= net::eth::HDR_LEN;
+            w.write(pkt);
+            pkts++;
+        }
+
+        w.close();
+    }
+
+    REQUIRE(ipv4_pkts > 0);
+
+    for (auto backend : { pcap_file_reader::backend::libpcap, pcap_file_reader::backend::mmap,
+                          pcap_file_reader::backend::read_ahead,
+                          pcap_file_reader::backend::io_uring }) {
+
+        INFO("backend: " << pcap_file_reader::backend_string(backend));
+
+        pcap_file_reader r(file_name, backend);
+        pcap_pkt pkt;
+        unsigned raw_pkts = 0, decoded_ipv4_pkts = 0;
+
+        CHECK(r.datalink_type() == pcap_link_type::raw);
+        CHECK(link_layer::is_supported(r.datalink_type()));
+
+        while (r.next(pkt)) {
+
+            raw_pkts += pkt.link_type == pcap_link_type::raw;
+
+            link_layer::frame frame;
+            link_layer::decode(&pkt, 1, &frame);
+            decoded_ipv4_pkts += frame.ipv4 && frame.ip_offset == 0;
+        }
+
+        CHECK(raw_pkts == pkts);
+        CHECK(decoded_ipv4_pkts == ipv4_pkts);
+        r.close();
+    }
+
+    std::filesystem::remove(file_name);
+}
+
+TEST_CASE("pcap_file_reader: native back ends yield the same packets as libpcap",
+          "[pcap][pcap_file_reader]") {
+
+    // classic pcap and a sequence of pcapng files
+    std::vector<std::string> zoom_test = { "data/zoom_test.pcap" };
+    std::vector<std::string> pcapng_test = {
+        "data/test0.pcap", "data/test1.pcap", "data/test2.pcap", "data/test3.pcap",
+        "data/test4.pcap", "data/test5.pcap", "data/test6.pcap", "data/test7.pcap"
+    };
+
+    for (auto backend : { pcap_file_reader::backend::mmap, pcap_file_reader::backend::read_ahead,
+                          pcap_file_reader::backend::io_uring }) {
+
+        INFO("backend: " << pcap_file_reader::backend_string(backend));
+
+        pcap_file_reader l(pcapng_test, pcap_file_reader::backend::libpcap);
+        pcap_file_reader m(pcapng_test, backend);
+
+        CHECK(m.datalink_type() == l.datalink_type());
+
+        pcap_pkt l_pkt, m_pkt;
+        unsigned total_frames = 0;
+
+        while (l.next(l_pkt)) {
+            REQUIRE(m.next(m_pkt));
+            CHECK(m_pkt.ts == l_pkt.ts);
+            CHECK(m_pkt.frame_len == l_pkt.frame_len);
+            CHECK(m_pkt.cap_len == l_pkt.cap_len);
+            CHECK(m_pkt.link_type == l_pkt.link_type);
+            CHECK(std::memcmp(m_pkt.buf, l_pkt.buf, m_pkt.cap_len) == 0);
+            total_frames++;
+        }
+
+        CHECK_FALSE(m.next(m_pkt));
+        CHECK(total_frames == 80);
+        l.close();
+        m.close();
+    }
+
+    for (auto backend : { pcap_file_reader::backend::mmap, pcap_file_reader::backend::read_ahead,
+                          pcap_file_reader::backend::io_uring }) {
+
+        INFO("backend: " << pcap_file_reader::backend_string(backend));
+
+        pcap_file_reader l(zoom_test, pcap_file_reader::backend::libpcap);
+        pcap_file_reader m(zoom_test, backend);
+
+        CHECK(m.datalink_type() == l.datalink_type());
+
+        pcap_pkt l_pkt, m_pkt;
+        unsigned total_frames = 0;
+
+        while (l.next(l_pkt)) {
+            REQUIRE(m.next(m_pkt));
+            CHECK(m_pkt.ts == l_pkt.ts);
+            CHECK(m_pkt.frame_len == l_pkt.frame_len);
+            CHECK(m_pkt.cap_len == l_pkt.cap_len);
+            CHECK(std::memcmp(m_pkt.buf, l_pkt.buf, m_pkt.cap_len) == 0);
+            total_frames++;
+        }
+
+        CHECK_FALSE(m.next(m_pkt));
+        CHECK(total_frames == 64);
+        CHECK(m.byte_count() == l.byte_count());
+        CHECK(m.byte_count() + 24 == std::filesystem::file_size("data/zoom_test.pcap"));
+
+        l.close();
+        m.close();
+    }
+}
+
+TEST_CASE("pcap_file_reader: chunked back ends reassemble records spanning buffers",
+          "[pcap][pcap_file_reader]") {
+
+    // buffers much smaller than the file, so that headers and records straddle chunks
+    std::vector<std::string> files = { "data/zoom_test.pcap", "data/zoom_test.pcap" };
+    std::unique_ptr<chunk_source> source;
+
+    SECTION("read-ahead") {
+        source = std::make_unique<read_ahead_chunk_source>(files, 4096, 3);
+    }
+
+    SECTION("io_uring") {
+        source = std::make_unique<io_uring_chunk_source>(files, 4096, 5);
+    }
+
+    pcap_record_walker walker;
+    chunk_source::chunk c;
+
+    pcap_file_reader l(files, pcap_file_reader::backend::libpcap);
+    pcap_pkt l_pkt, pkt;
+    unsigned total_frames = 0, chunks = 0, file_starts = 0;
+
+    while (source->next(c)) {
+
+        chunks++;
+
+        if (c.file_start) {
+            CHECK(c.file == file_starts++);
+            walker.begin();
+        }
+
+        walker.feed(c.buf, c.len);
+
+        while (walker.next(pkt)) {
+            REQUIRE(l.next(l_pkt));
+            CHECK(pkt.ts == l_pkt.ts);
+            CHECK(pkt.frame_len == l_pkt.frame_len);
+            CHECK(pkt.cap_len == l_pkt.cap_len);
+            CHECK(std::memcmp(pkt.buf, l_pkt.buf, pkt.cap_len) == 0);
+            total_frames++;
+        }
+    }
+
+    CHECK(chunks > 2 * std::filesystem::file_size("data/zoom_test.pcap") / 4096);
+    CHECK(file_starts == 2);
+    CHECK(total_frames == 128);
+    CHECK_FALSE(l.next(l_pkt));
+    CHECK_FALSE(source->next(c));
+    l.close();
+}
+
+TEST_CASE("pcap_file_reader: reads compressed files", "[pcap][pcap_file_reader]") {
+
+    CHECK(file_decoder::compression_from_name("a.pcap") == file_decoder::compression::none);
+    CHECK(file_decoder::compression_from_name("a.pcap.gz") == file_decoder::compression::gzip);
+    CHECK(file_decoder::compression_from_name("a.pcap.zst") == file_decoder::compression::zstd);
+    CHECK(file_decoder::strip_compressed_suffix("a.pcap2.zst") == "a.pcap2");
+    CHECK(file_decoder::strip_compressed_suffix("a.pcap2") == "a.pcap2");
+
+    std::vector<std::string> compressed_files;
+
+#ifdef ZOOM_ANALYSIS_HAVE_ZLIB
+    compressed_files.emplace_back("data/zoom_test.pcap.gz"); // two concatenated gzip members
+#endif
+
+#ifdef ZOOM_ANALYSIS_HAVE_ZSTD
+    compressed_files.emplace_back("data/zoom_test.pcap.zst");
+#endif
+
+    for (const auto& compressed_file : compressed_files) {
+
+        INFO("file: " << compressed_file);
+
+        pcap_file_reader l("data/zoom_test.pcap", pcap_file_reader::backend::libpcap);
+        pcap_file_reader c(compressed_file, pcap_file_reader::backend::libpcap);
+
+        CHECK(c.active_backend() == pcap_file_reader::backend::read_ahead);
+        CHECK(c.datalink_type() == pcap_link_type::eth);
+
+        pcap_pkt l_pkt, c_pkt;
+        unsigned total_frames = 0;
+
+        while (l.next(l_pkt)) {
+            REQUIRE(c.next(c_pkt));
+            CHECK(c_pkt.ts == l_pkt.ts);
+            CHECK(c_pkt.cap_len == l_pkt.cap_len);
+            CHECK(std::memcmp(c_pkt.buf, l_pkt.buf, c_pkt.cap_len) == 0);
+            total_frames++;
+        }
+
+        CHECK_FALSE(c.next(c_pkt));
+        CHECK(total_frames == 64);
+        l.close();
+        c.close();
+    }
+}
+
+TEST_CASE("pcap_file_reader: merges files by timestamp", "[pcap][pcap_file_reader]") {
+
+    // splits a capture into two taps with interleaved timestamps, packets with equal timestamps
+    // stay on the same tap since ties are resolved in the order of the files
+    auto tmp = std::filesystem::temp_directory_path();
+    std::vector<std::string> taps = { tmp / "zoom_test_tap0.pcap", tmp / "zoom_test_tap1.pcap" };
+
+    {
+        pcap_file_reader r("data/zoom_test.pcap");
+        pcap_file_writer w0(taps[0], pcap_link_type::eth), w1(taps[1], pcap_link_type::eth);
+        pcap_pkt pkt;
+        timestamp_ns last = 0;
+        bool tap1 = true;
+
+        while (r.next(pkt)) {
+            tap1 ^= pkt.ts != last;
+            last = pkt.ts;
+            (tap1 ? w1 : w0).write(pkt);
+        }
+
+        r.close();
+        w0.close();
+        w1.close();
+    }
+
+    for (auto backend : { pcap_file_reader::backend::libpcap, pcap_file_reader::backend::mmap,
+                          pcap_file_reader::backend::read_ahead,
+                          pcap_file_reader::backend::io_uring }) {
+
+        INFO("backend: " << pcap_file_reader::backend_string(backend));
+
+        {
+            // split taps yield the original capture
+            pcap_file_reader l("data/zoom_test.pcap");
+            pcap_file_reader m(taps, backend, true);
+            pcap_pkt l_pkt, m_pkt;
+
+            CHECK(m.file_count() == 2);
+            CHECK(m.datalink_type() == pcap_link_type::eth);
+
+            while (l.next(l_pkt)) {
+                REQUIRE(m.next(m_pkt));
+                CHECK(m_pkt.ts == l_pkt.ts);
+                CHECK(m_pkt.cap_len == l_pkt.cap_len);
+                CHECK(std::memcmp(m_pkt.buf, l_pkt.buf, m_pkt.cap_len) == 0);
+            }
+
+            CHECK_FALSE(m.next(m_pkt));
+            CHECK(m.byte_count() == l.byte_count());
+            l.close();
+            m.close();
+        }
+
+        {
+            // batches are in timestamp order
+            std::array<pcap_pkt, 7> batch;
+            pcap_file_reader m(std::vector<std::string>{ "data/zoom_test.pcap", taps[0], taps[1] },
+                               backend, true);
+            timestamp_ns last = 0;
+            unsigned total_frames = 0;
+
+            while (auto n = m.next_batch(batch.data(), batch.size())) {
+                for (std::size_t i = 0; i < n; i++) {
+                    CHECK_FALSE(batch[i].ts < last);
+                    last = batch[i].ts;
+                    total_frames++;
+                }
+            }
+
+            CHECK(total_frames == 128);
+            CHECK(m.pkt_count() == 128);
+            m.close();
+        }
+    }
+
+    for (const auto& tap : taps)
+        std::filesystem::remove(tap);
+}
+
+TEST_CASE("pcap_file_reader: splits a classic pcap file at record boundaries",
+          "[pcap][pcap_file_reader]") {
+
+    auto file_len = std::filesystem::file_size("data/zoom_test.pcap");
+
+    for (unsigned count : { 1, 2, 3, 7, 64, 1000 }) {
+
+        INFO("count: " << count);
+
+        auto ranges = pcap_file_reader::split("data/zoom_test.pcap", count);
+
+        REQUIRE(!ranges.empty());
+        CHECK(ranges.size() <= count);
+        CHECK(ranges.front().begin == 24);
+        CHECK(ranges.back().end == file_len);
+
+        pcap_file_reader l("data/zoom_test.pcap");
+        pcap_pkt l_pkt, pkt;
+        unsigned total_frames = 0;
+
+        for (std::size_t i = 0; i < ranges.size(); i++) {
+
+            if (i > 0)
+                CHECK(ranges[i].begin == ranges[i - 1].end);
+
+            pcap_file_reader r("data/zoom_test.pcap", ranges[i]);
+            CHECK(r.datalink_type() == pcap_link_type::eth);
+
+            while (r.next(pkt)) {
+                REQUIRE(l.next(l_pkt));
+                CHECK(pkt.ts == l_pkt.ts);
+                CHECK(pkt.cap_len == l_pkt.cap_len);
+                CHECK(std::memcmp(pkt.buf, l_pkt.buf, pkt.cap_len) == 0);
+                total_frames++;
+            }
+
+            CHECK(r.byte_count() == ranges[i].end - ranges[i].begin);
+            r.close();
+        }
+
+        CHECK(total_frames == 64);
+        CHECK_FALSE(l.next(l_pkt));
+        l.close();
+    }
+
+    CHECK_THROWS(pcap_file_reader::split("data/test0.pcap", 2)); // pcapng
+}
+
+TEST_CASE("pcap_file_reader: keeps nanosecond timestamps", "[pcap][pcap_file_reader]") {
+
+    auto file_name = (std::filesystem::temp_directory_path() / "zoom_test_ns.pcap").string();
+
+    {
+        pcap_format::file_hdr hdr { pcap_format::MAGIC_NS, 2, 4, 0, 0, 65535, 1 };
+        std::array<unsigned char, 14> data = {};
+        std::ofstream out(file_name, std::ios::binary);
+
+        out.write((const char*) &hdr, sizeof(hdr));
+
+        for (std::uint32_t frac : { 123456789u, 999999999u }) {
+            pcap_format::rec_hdr rec { 1632344358, frac, (std::uint32_t) data.size(),
+                                       (std::uint32_t) data.size() };
+            out.write((const char*) &rec, sizeof(rec));
+            out.write((const char*) data.data(), data.size());
+        }
+    }
+
+    for (auto backend : { pcap_file_reader::backend::libpcap, pcap_file_reader::backend::mmap,
+                          pcap_file_reader::backend::read_ahead,
+                          pcap_file_reader::backend::io_uring }) {
+
+        INFO("backend: " << pcap_file_reader::backend_string(backend));
+
+        pcap_file_reader r(file_name, backend);
+        pcap_pkt pkt;
+
+        REQUIRE(r.next(pkt));
+        CHECK(pkt.ts == timestamp::from_sec(1632344358, 123456789));
+        REQUIRE(r.next(pkt));
+        CHECK(pkt.ts - timestamp::from_sec(1632344358) == 999999999);
+        CHECK(timestamp::subsec_us(pkt.ts) == 999999);
+        CHECK_FALSE(r.next(pkt));
+        r.close();
+    }
+
+    std::filesystem::remove(file_name);
+}
+
+TEST_CASE("pcap_file_reader: native back ends reject files that are neither pcap nor pcapng",
+          "[pcap][pcap_file_reader]") {
+
+    CHECK_THROWS(pcap_file_reader("data/capinfos.csv", pcap_file_reader::backend::mmap));
+    CHECK_THROWS(pcap_file_reader::backend_from_string("pcapng"));
+    CHECK(pcap_file_reader::backend_from_string("mmap") == pcap_file_reader::backend::mmap);
+    CHECK_THROWS(pcap_file_reader("data/capinfos.csv", pcap_file_reader::backend::read_ahead));
+
+    // files after the first one are only read once they are reached
+    for (auto backend : { pcap_file_reader::backend::libpcap, pcap_file_reader::backend::mmap,
+                          pcap_file_reader::backend::read_ahead,
+                          pcap_file_reader::backend::io_uring }) {
+
+        INFO("backend: " << pcap_file_reader::backend_string(backend));
+
+        pcap_file_reader r(std::vector<std::string> { "data/test0.pcap", "data/capinfos.csv" },
+                           backend);
+        pcap_pkt pkt;
+        unsigned pkts = 0;
+
+        CHECK(r.datalink_type() == pcap_link_type::eth);
+        CHECK_THROWS_AS([&]() { while (r.next(pkt)) pkts++; }(), std::runtime_error);
+        CHECK(pkts > 0);
+        r.close();
+    }
+}
+
+TEST_CASE("pcap_file_reader: next_batch", "[pcap][pcap_file_reader]") {
+
+    std::array<pcap_pkt, 7> batch;
+
+    SECTION("libpcap back end reads all packets of multiple files") {
+
+        pcap_file_reader p(std::vector<std::string>{ "data/test0.pcap", "data/test1.pcap" });
+        unsigned total_frames = 0, total_bytes = 0, batches = 0;
+
+        while (auto n = p.next_batch(batch.data(), batch.size())) {
+
+            CHECK(n <= batch.size());
+            batches++;
+
+            for (std::size_t i = 0; i < n; i++) {
+                total_frames++;
+                total_bytes += batch[i].frame_len;
+            }
+        }
+
+        CHECK(batches == 3);
+        CHECK(total_frames == 20);
+        CHECK(total_bytes == 856 + 795);
+        CHECK(p.pkt_count() == 20);
+        p.close();
+    }
+
+    SECTION("mmap back end yields the same packets as next()") {
+
+        pcap_file_reader r("data/zoom_test.pcap", pcap_file_reader::backend::mmap);
+        pcap_file_reader b("data/zoom_test.pcap", pcap_file_reader::backend::mmap);
+        pcap_pkt pkt;
+        unsigned total_frames = 0;
+
+        while (auto n = b.next_batch(batch.data(), batch.size())) {
+            for (std::size_t i = 0; i < n; i++) {
+                REQUIRE(r.next(pkt));
+                CHECK(batch[i].ts == pkt.ts);
+                CHECK(batch[i].cap_len == pkt.cap_len);
+                CHECK(std::memcmp(batch[i].buf, pkt.buf, pkt.cap_len) == 0);
+                total_frames++;
+            }
+        }
+
+        CHECK(total_frames == 64);
+        CHECK_FALSE(r.next(pkt));
+        r.close();
+        b.close();
+    }
+}
+
+TEST_CASE("pcap_file_reader: measures read and consumer time per file",
+          "[pcap][pcap_file_reader]") {
+
+    std::array<pcap_pkt, 7> batch;
+
+    for (auto backend : { pcap_file_reader::backend::libpcap, pcap_file_reader::backend::mmap,
+                          pcap_file_reader::backend::read_ahead }) {
+
+        INFO("backend: " << pcap_file_reader::backend_string(backend));
+
+        std::vector<std::string> file_names = { "data/test0.pcap", "data/test1.pcap" };
+        pcap_file_reader p(file_names, backend);
+        CHECK(p.io().total_time == 0);
+
+        while (p.next_batch(batch.data(), batch.size()));
+
+        auto io = p.io();
+        CHECK(io.pkt_count == 20);
+        CHECK(io.byte_count == p.byte_count());
+        CHECK(io.read_time > 0);
+        CHECK(io.read_time <= io.total_time);
+        CHECK(std::abs(io.total_time - p.time_in_loop()) < 1e-3);
+        CHECK(std::abs(io.consumer_time() - (io.total_time - io.read_time)) < 1e-9);
+
+        // the counters of the files add up to the totals, their times to at most the totals
+        auto summaries = p.file_summaries();
+        REQUIRE(summaries.size() == 2);
+
+        io_stats sum;
+
+        for (const auto& summary : summaries) {
+            CHECK(summary.io.pkt_count == 10);
+            CHECK(summary.io.byte_count > 0);
+            sum.add(summary.io);
+        }
+
+        CHECK(sum.pkt_count == io.pkt_count);
+        CHECK(sum.byte_count == io.byte_count);
+        CHECK(std::abs(sum.read_time - io.read_time) < 1e-6);
+        CHECK(sum.total_time <= io.total_time + 1e-3);
+        p.close();
+    }
 }
@@ -0,0 +1,214 @@
+#include <catch.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+#include "lib/pcap_demux_writer.h"
+#include "lib/pcap_file_reader.h"
+#include "lib/pcap_file_writer.h"
+#include "lib/pcap_format.h"
+#include "lib/util.h"
+
+TEST_CASE("pcap_file_writer: writes the packets read", "[pcap][pcap_file_writer]") {
+
+    auto file_name = (std::filesystem::temp_directory_path() / "zoom_test_writer.pcap").string();
+
+    for (bool direct : { false, true }) {
+
+        INFO("direct: " << direct);
+
+        {
+            pcap_file_reader r("data/zoom_test.pcap");
+            pcap_file_writer w(file_name, pcap_link_type::eth, direct);
+            pcap_pkt pkt;
+
+            while (r.next(pkt)) {
+                w.write(pkt);
+            }
+
+            CHECK(w.count() == 64);
+            CHECK(w.byte_count() == r.byte_count() + pcap_format::FILE_HDR_LEN);
+            r.close();
+            w.close();
+
+            CHECK(std::filesystem::file_size(file_name) == w.byte_count());
+        }
+
+        pcap_file_reader r("data/zoom_test.pcap"), w(file_name, pcap_file_reader::backend::mmap);
+        pcap_pkt r_pkt, w_pkt;
+
+        CHECK(w.datalink_type() == pcap_link_type::eth);
+
+        while (r.next(r_pkt)) {
+            REQUIRE(w.next(w_pkt));
+            CHECK(w_pkt.ts == r_pkt.ts);
+            CHECK(w_pkt.frame_len == r_pkt.frame_len);
+            REQUIRE(w_pkt.cap_len == r_pkt.cap_len);
+            CHECK(std::memcmp(w_pkt.buf, r_pkt.buf, r_pkt.cap_len) == 0);
+        }
+
+        CHECK_FALSE(w.next(w_pkt));
+        r.close();
+        w.close();
+    }
+
+    std::filesystem::remove(file_name);
+}
+
+TEST_CASE("pcap_file_writer: flushes across buffers", "[pcap][pcap_file_writer]") {
+
+    auto file_name = (std::filesystem::temp_directory_path() / "zoom_test_writer.pcap").string();
+
+    // several buffers of records of odd lengths, flushed within buffers
+    const unsigned pkt_count = 1500, cap_len = 9001;
+    std::vector<unsigned char> buf(cap_len);
+
+    for (bool direct : { false, true }) {
+
+        INFO("direct: " << direct);
+
+        pcap_file_writer w(file_name, pcap_link_type::raw, direct);
+
+        for (unsigned i = 0; i < pkt_count; i++) {
+
+            buf[0] = (unsigned char) i;
+            buf[cap_len - 1] = (unsigned char) (i >> 8u);
+            const unsigned char* data = buf.data();
+            w.write(&data, timestamp::from_sec(i, 1000), cap_len + 1, cap_len);
+
+            if (i % 97 == 0) {
+                w.flush();
+                CHECK(std::filesystem::file_size(file_name) == w.byte_count());
+            }
+        }
+
+        w.close();
+        CHECK(w.byte_count() == pcap_format::FILE_HDR_LEN
+            + pkt_count * (pcap_format::REC_HDR_LEN + cap_len));
+        CHECK(std::filesystem::file_size(file_name) == w.byte_count());
+
+        pcap_file_reader r(file_name, pcap_file_reader::backend::mmap);
+        pcap_pkt pkt;
+        unsigned i = 0;
+
+        CHECK(r.datalink_type() == pcap_link_type::raw);
+
+        while (r.next(pkt)) {
+            CHECK(pkt.ts == timestamp::from_sec(i, 1000));
+            CHECK(pkt.frame_len == cap_len + 1);
+            REQUIRE(pkt.cap_len == cap_len);
+            CHECK(pkt.buf[0] == (unsigned char) i);
+            CHECK(pkt.buf[cap_len - 1] == (unsigned char) (i >> 8u));
+            i++;
+        }
+
+        CHECK(i == pkt_count);
+        r.close();
+    }
+
+    std::filesystem::remove(file_name);
+}
+
+TEST_CASE("pcap_file_writer: rotates files by size", "[pcap][pcap_file_writer]") {
+
+    auto dir = std::filesystem::temp_directory_path() / "zoom_test_writer_rotation";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directory(dir);
+    auto file_name = (dir / "out.pcap").string();
+
+    file_rotation rotation;
+    rotation.max_bytes = 2000;
+
+    {
+        pcap_file_reader r("data/zoom_test.pcap");
+        pcap_file_writer w(file_name, pcap_link_type::eth, false, rotation);
+        pcap_pkt pkt;
+
+        while (r.next(pkt)) {
+            w.write(pkt);
+        }
+
+        CHECK(w.file_count() > 1);
+        CHECK(w.file_name() == file_name + std::to_string(w.file_count() - 1));
+        r.close();
+        w.close();
+    }
+
+    // the files are read in order as one trace, each at most max_bytes long
+    auto files = util::files_in_directory(dir.string(), "pcap");
+    std::sort(files.begin(), files.end(), util::compare_file_ext_seq);
+    CHECK(files.front() == file_name + "0");
+
+    for (const auto& file : files) {
+        CHECK(std::filesystem::file_size(file) <= rotation.max_bytes);
+    }
+
+    pcap_file_reader r("data/zoom_test.pcap"), w(files, pcap_file_reader::backend::mmap);
+    pcap_pkt r_pkt, w_pkt;
+
+    while (r.next(r_pkt)) {
+        REQUIRE(w.next(w_pkt));
+        CHECK(w_pkt.ts == r_pkt.ts);
+        REQUIRE(w_pkt.cap_len == r_pkt.cap_len);
+        CHECK(std::memcmp(w_pkt.buf, r_pkt.buf, r_pkt.cap_len) == 0);
+    }
+
+    CHECK_FALSE(w.next(w_pkt));
+    r.close();
+    w.close();
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("pcap_demux_writer: appends to files closed before", "[pcap][pcap_file_writer]") {
+
+    auto dir = std::filesystem::temp_directory_path() / "zoom_test_demux_writer";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directory(dir);
+
+    auto file_name = [&dir](std::uint64_t key) {
+        return (dir / (std::to_string(key) + ".pcap")).string();
+    };
+
+    // more keys than open files, written round robin
+    const unsigned keys = 5;
+    unsigned long count = 0;
+
+    {
+        pcap_file_reader r("data/zoom_test.pcap");
+        pcap_demux_writer w(file_name, pcap_link_type::eth, 2);
+        pcap_pkt pkt;
+
+        while (r.next(pkt)) {
+            w.write(count++ % keys, pkt);
+        }
+
+        CHECK(w.count() == count);
+        CHECK(w.file_count() == keys);
+        CHECK(w.reopen_count() > 0);
+        r.close();
+        w.close();
+    }
+
+    // every file holds the packets of its key in order
+    for (unsigned key = 0; key < keys; key++) {
+
+        pcap_file_reader r("data/zoom_test.pcap"), w(file_name(key));
+        pcap_pkt r_pkt, w_pkt;
+        unsigned long i = 0;
+
+        while (r.next(r_pkt)) {
+            if (i++ % keys == key) {
+                REQUIRE(w.next(w_pkt));
+                CHECK(w_pkt.ts == r_pkt.ts);
+                REQUIRE(w_pkt.cap_len == r_pkt.cap_len);
+                CHECK(std::memcmp(w_pkt.buf, r_pkt.buf, r_pkt.cap_len) == 0);
+            }
+        }
+
+        CHECK_FALSE(w.next(w_pkt));
+        r.close();
+        w.close();
+    }
+
+    std::filesystem::remove_all(dir);
+}
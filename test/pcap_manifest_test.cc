@@ -0,0 +1,72 @@
+#include <catch.h>
+#include <filesystem>
+#include <fstream>
+#include "lib/pcap_file_reader.h"
+#include "lib/pcap_manifest.h"
+
+TEST_CASE("pcap_manifest: caches file summaries until files change", "[pcap][pcap_manifest]") {
+
+    auto dir = std::filesystem::temp_directory_path() / "zoom_pcap_manifest_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directory(dir);
+
+    auto pcap0 = (dir / "trace.pcap0").string(), pcap1 = (dir / "trace.pcap1").string();
+    std::filesystem::copy_file("data/test0.pcap", pcap0);
+    std::filesystem::copy_file("data/test1.pcap", pcap1);
+
+    {
+        pcap_manifest manifest(dir.string());
+        CHECK(manifest.size() == 0);
+        CHECK(manifest.find(pcap0) == nullptr);
+
+        // only the first file is read completely
+        pcap_file_reader r({ pcap0, pcap1 });
+        pcap_pkt pkt;
+
+        for (unsigned i = 0; i < 11; i++)
+            REQUIRE(r.next(pkt));
+
+        auto summaries = r.file_summaries();
+        REQUIRE(summaries.size() == 2);
+        CHECK(summaries[0].complete);
+        CHECK(summaries[0].entry.pkt_count == 10);
+        CHECK(summaries[0].entry.link_types == std::vector<pcap_link_type> { pcap_link_type::eth });
+        CHECK(timestamp::sec(summaries[0].entry.first_ts) == 1646581842);
+        CHECK(summaries[0].entry.last_ts >= summaries[0].entry.first_ts);
+        CHECK_FALSE(summaries[1].complete);
+        CHECK(summaries[1].entry.pkt_count == 1);
+
+        for (const auto& summary : summaries) {
+            if (summary.complete)
+                manifest.update(summary.file_name, summary.entry);
+        }
+
+        manifest.save();
+        r.close();
+    }
+
+    std::ofstream(dir / pcap_manifest::FILE_NAME, std::ios::app) << "corrupt,line\n";
+
+    pcap_manifest manifest(dir.string());
+    REQUIRE(manifest.size() == 1);
+
+    const auto* entry = manifest.find(pcap0);
+    REQUIRE(entry != nullptr);
+    CHECK(entry->pkt_count == 10);
+    CHECK(entry->link_types == std::vector<pcap_link_type> { pcap_link_type::eth });
+    CHECK(entry->overlaps(1646581842, 1646581843));
+    CHECK_FALSE(entry->overlaps(0, 1646581842));
+    CHECK_FALSE(entry->overlaps(timestamp::sec(entry->last_ts) + 1, 1LL << 40));
+    CHECK(manifest.find(pcap1) == nullptr);
+
+    // the link types of a file with an entry are not read from the file
+    manifest.update(pcap0, { 0, 0, { pcap_link_type::raw }, 10, entry->first_ts, entry->last_ts });
+    CHECK(pcap_file_reader({ pcap0 }, pcap_file_reader::backend::libpcap, false, &manifest)
+        .datalink_type() == pcap_link_type::raw);
+
+    // entries of modified files are ignored
+    std::ofstream(pcap0, std::ios::app) << "x";
+    CHECK(manifest.find(pcap0) == nullptr);
+
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,194 @@
+
+#include <catch.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "lib/pcap_format.h"
+#include "lib/pcap_record_walker.h"
+#include "lib/pcap_util.h"
+
+// builds pcapng blocks in either byte order
+struct pcapng_builder {
+
+    bool big_endian = false;
+    std::vector<unsigned char> buf;
+
+    void u8(std::uint8_t v) {
+        buf.push_back(v);
+    }
+
+    void u16(std::uint16_t v) {
+        for (unsigned i = 0; i < 2; i++)
+            u8((std::uint8_t) (v >> (big_endian ? 8 * (1 - i) : 8 * i)));
+    }
+
+    void u32(std::uint32_t v) {
+        for (unsigned i = 0; i < 4; i++)
+            u8((std::uint8_t) (v >> (big_endian ? 8 * (3 - i) : 8 * i)));
+    }
+
+    void block(std::uint32_t type, const std::vector<unsigned char>& body) {
+
+        auto len = (std::uint32_t) (12 + ((body.size() + 3) & ~3u));
+
+        u32(type);
+        u32(len);
+        buf.insert(buf.end(), body.begin(), body.end());
+        buf.resize(buf.size() + ((4 - body.size() % 4) % 4), 0);
+        u32(len);
+    }
+
+    // encodes a block body with the byte order of the section
+    std::vector<unsigned char> body(const std::vector<std::uint32_t>& words,
+                                    const std::vector<unsigned char>& data = {}) {
+
+        pcapng_builder b;
+        b.big_endian = big_endian;
+
+        for (auto w : words)
+            b.u32(w);
+
+        b.buf.insert(b.buf.end(), data.begin(), data.end());
+        return b.buf;
+    }
+
+    void shb() {
+        u32(pcapng_format::BLOCK_SHB);
+        u32(28);
+        u32(pcapng_format::BYTE_ORDER_MAGIC);
+        u16(1);
+        u16(0);
+        u32(0xffffffff);
+        u32(0xffffffff);
+        u32(28);
+    }
+
+    void idb(pcap_link_type link_type, std::int8_t tsresol = -1) {
+
+        pcapng_builder b;
+        b.big_endian = big_endian;
+        b.u16((std::uint16_t) link_type);
+        b.u16(0);
+        b.u32(0);
+
+        if (tsresol >= 0) {
+            b.u16(pcapng_format::OPT_IF_TSRESOL);
+            b.u16(1);
+            b.buf.insert(b.buf.end(), { (unsigned char) tsresol, 0, 0, 0 });
+            b.u32(0);
+        }
+
+        block(pcapng_format::BLOCK_IDB, b.buf);
+    }
+
+    void epb(std::uint32_t interface, std::uint64_t ts, const std::vector<unsigned char>& data) {
+        block(pcapng_format::BLOCK_EPB, body({ interface, (std::uint32_t) (ts >> 32),
+            (std::uint32_t) ts, (std::uint32_t) data.size(), (std::uint32_t) data.size() + 100 },
+            data));
+    }
+};
+
+static std::vector<pcap_pkt> walk(const std::vector<unsigned char>& file, std::size_t chunk_len,
+                                  std::vector<std::vector<unsigned char>>& data) {
+
+    pcap_record_walker walker;
+    std::vector<pcap_pkt> pkts;
+    pcap_pkt pkt;
+
+    walker.begin();
+
+    for (std::size_t offset = 0; offset < file.size(); offset += chunk_len) {
+
+        walker.feed(file.data() + offset, std::min(chunk_len, file.size() - offset));
+
+        // packet data only needs to survive until the walker runs out of data once more
+        while (walker.next(pkt)) {
+            data.emplace_back(pkt.buf, pkt.buf + pkt.cap_len);
+            pkts.push_back(pkt);
+        }
+    }
+
+    return pkts;
+}
+
+TEST_CASE("pcap_record_walker: pcapng blocks, interfaces, and sections",
+          "[pcap][pcap_record_walker]") {
+
+    pcapng_builder b;
+
+    // big endian section with an ethernet interface in microseconds and a raw interface in
+    // nanoseconds, followed by a little endian section with a single ethernet interface
+    b.big_endian = true;
+    b.shb();
+    b.idb(pcap_link_type::eth);
+    b.idb(pcap_link_type::raw, 9);
+    b.epb(0, 10000005, { 1, 2, 3 });
+    b.block(5, b.body({ 0, 0, 0 })); // interface statistics, skipped
+    b.epb(1, 20123456789, { 4, 5, 6, 7, 8 });
+    b.block(pcapng_format::BLOCK_SPB, b.body({ 2 }, { 9, 10 }));
+
+    b.big_endian = false;
+    b.shb();
+    b.idb(pcap_link_type::eth);
+    b.epb(0, 30000001, std::vector<unsigned char>(3000, 11));
+
+    for (std::size_t chunk_len : { b.buf.size(), (std::size_t) 1, (std::size_t) 7,
+                                   (std::size_t) 64 }) {
+
+        INFO("chunk_len: " << chunk_len);
+
+        std::vector<std::vector<unsigned char>> data;
+        auto pkts = walk(b.buf, chunk_len, data);
+
+        REQUIRE(pkts.size() == 4);
+
+        CHECK(pkts[0].ts == timestamp::from_sec(10, 5000));
+        CHECK(pkts[0].link_type == pcap_link_type::eth);
+        CHECK(pkts[0].cap_len == 3);
+        CHECK(pkts[0].frame_len == 103);
+        CHECK(data[0] == std::vector<unsigned char> { 1, 2, 3 });
+
+        CHECK(pkts[1].ts == timestamp::from_sec(20, 123456789));
+        CHECK(pkts[1].link_type == pcap_link_type::raw);
+        CHECK(data[1] == std::vector<unsigned char> { 4, 5, 6, 7, 8 });
+
+        CHECK(pkts[2].ts == 0);
+        CHECK(pkts[2].link_type == pcap_link_type::eth);
+        CHECK(pkts[2].frame_len == 2);
+        CHECK(data[2] == std::vector<unsigned char> { 9, 10 });
+
+        CHECK(pkts[3].ts == timestamp::from_sec(30, 1000));
+        CHECK(pkts[3].cap_len == 3000);
+        CHECK(data[3] == std::vector<unsigned char>(3000, 11));
+    }
+
+    auto link_types = pcap_record_walker::peek_link_types(b.buf.data(), b.buf.size());
+    CHECK(link_types == std::vector<pcap_link_type> { pcap_link_type::eth, pcap_link_type::raw });
+}
+
+TEST_CASE("pcap_record_walker: rejects corrupt pcapng files", "[pcap][pcap_record_walker]") {
+
+    std::vector<std::vector<unsigned char>> data;
+
+    SECTION("packet for undeclared interface") {
+        pcapng_builder b;
+        b.shb();
+        b.idb(pcap_link_type::eth);
+        b.epb(1, 0, { 1 });
+        CHECK_THROWS(walk(b.buf, b.buf.size(), data));
+    }
+
+    SECTION("block length not a multiple of 4") {
+        pcapng_builder b;
+        b.shb();
+        b.u32(pcapng_format::BLOCK_IDB);
+        b.u32(21);
+        b.buf.resize(b.buf.size() + 13);
+        CHECK_THROWS(walk(b.buf, b.buf.size(), data));
+    }
+
+    SECTION("neither pcap nor pcapng") {
+        std::vector<unsigned char> buf(64, 0);
+        CHECK_THROWS(pcap_record_walker::peek_link_types(buf.data(), buf.size()));
+    }
+}
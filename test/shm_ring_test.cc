@@ -0,0 +1,156 @@
+#include <catch.h>
+#include <cstdint>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include "lib/shm_ring.h"
+#include "lib/zoom_events.h"
+
+struct test_record {
+    std::uint64_t seq;
+    std::uint64_t words[7];
+};
+
+static test_record make_record(std::uint64_t seq) {
+
+    test_record r = {};
+    r.seq = seq;
+
+    for (auto& w : r.words)
+        w = seq * 31 + 7;
+
+    return r;
+}
+
+TEST_CASE("shm_ring: readers see the records published after they attached", "[shm_ring]") {
+
+    shm_ring_writer writer("zoom_shm_ring_test", sizeof(test_record), 8);
+    CHECK(writer.name() == "/zoom_shm_ring_test");
+    CHECK(writer.slot_len() == sizeof(test_record));
+    CHECK(writer.slot_count() == 8);
+
+    writer.publish(make_record(0));
+
+    shm_ring_reader reader("zoom_shm_ring_test");
+    shm_ring_reader other("/zoom_shm_ring_test");
+    CHECK(reader.slot_len() == sizeof(test_record));
+    CHECK(reader.slot_count() == 8);
+    CHECK(reader.seq() == 1);
+
+    test_record r = {};
+    CHECK_FALSE(reader.next(r));
+
+    for (std::uint64_t i = 1; i < 4; i++)
+        writer.publish(make_record(i));
+
+    CHECK(writer.head() == 4);
+
+    for (std::uint64_t i = 1; i < 4; i++) {
+        REQUIRE(reader.next(r));
+        CHECK(r.seq == i);
+        CHECK(r.words[6] == i * 31 + 7);
+    }
+
+    CHECK_FALSE(reader.next(r));
+    CHECK(reader.lost() == 0);
+
+    // the readers are independent
+    REQUIRE(other.next(r));
+    CHECK(r.seq == 1);
+
+    other.rewind();
+    REQUIRE(other.next(r));
+    CHECK(r.seq == 0);
+
+    // shorter records are padded with 0
+    std::uint64_t seq = 4;
+    writer.publish(&seq, sizeof(seq));
+    REQUIRE(reader.next(r));
+    CHECK(r.seq == 4);
+    CHECK(r.words[0] == 0);
+
+    std::uint32_t small = 0;
+    CHECK_THROWS_AS(reader.next(small), std::logic_error);
+    CHECK_THROWS_AS(writer.publish(&r, sizeof(r) + 1), std::logic_error);
+}
+
+TEST_CASE("shm_ring: readers skip and count the records overwritten", "[shm_ring]") {
+
+    shm_ring_writer writer("zoom_shm_ring_test", sizeof(test_record), 4);
+    shm_ring_reader reader("zoom_shm_ring_test");
+
+    for (std::uint64_t i = 0; i < 10; i++)
+        writer.publish(make_record(i));
+
+    test_record r = {};
+
+    for (std::uint64_t i = 6; i < 10; i++) {
+        REQUIRE(reader.next(r));
+        CHECK(r.seq == i);
+    }
+
+    CHECK_FALSE(reader.next(r));
+    CHECK(reader.lost() == 6);
+}
+
+TEST_CASE("shm_ring: readers copy consistent records while the writer publishes",
+          "[shm_ring]") {
+
+    const std::uint64_t n = 200000;
+    shm_ring_writer writer("zoom_shm_ring_test", sizeof(test_record), 16);
+    shm_ring_reader reader("zoom_shm_ring_test");
+    std::uint64_t read = 0, last = 0;
+    bool consistent = true, ordered = true;
+
+    std::thread t([&]() {
+
+        test_record r = {};
+
+        while (reader.seq() < n) {
+
+            if (!reader.next(r))
+                continue;
+
+            for (auto w : r.words)
+                consistent &= w == r.seq * 31 + 7;
+
+            ordered &= read == 0 || r.seq > last;
+            last = r.seq;
+            read++;
+        }
+    });
+
+    for (std::uint64_t i = 0; i < n; i++)
+        writer.publish(make_record(i));
+
+    t.join();
+
+    CHECK(consistent);
+    CHECK(ordered);
+    CHECK(read > 0);
+    CHECK(read + reader.lost() == n);
+}
+
+TEST_CASE("shm_ring: readers reject objects that are not rings", "[shm_ring]") {
+
+    CHECK_THROWS_AS(shm_ring_reader("zoom_shm_ring_test_none"), std::system_error);
+
+    {
+        shm_ring_writer writer("zoom_shm_ring_test", sizeof(zoom::event));
+        CHECK(writer.slot_count() == shm_ring::DEFAULT_SLOT_COUNT);
+
+        shm_ring_reader reader("zoom_shm_ring_test");
+        zoom::event e;
+        e.stats = zoom::stats_event{};
+        e.stats.pkts = 42;
+        writer.publish(e);
+
+        zoom::event read;
+        REQUIRE(reader.next(read));
+        CHECK(read.type() == zoom::event_type::stats);
+        CHECK(read.stats.pkts == 42);
+    }
+
+    // the writer removes the ring
+    CHECK_THROWS_AS(shm_ring_reader("zoom_shm_ring_test"), std::system_error);
+}
@@ -1,6 +1,7 @@
 
 #include <catch.h>
 #include "lib/net.h"
+#include "lib/pcap_util.h"
 #include "lib/zoom_flow_tracker.h"
 
 TEST_CASE("zoom::flow_tracker", "[zoom][flow_tracker]") {
@@ -18,8 +19,8 @@ TEST_CASE("zoom::flow_tracker", "[zoom][flow_tracker]") {
         };
 
         zoom::flow_tracker t;
-        CHECK_FALSE(t.track(non_zoom_tcp_flow, {1, 0}, 100));
-        CHECK_FALSE(t.track(non_zoom_udp_flow, {2, 0}, 100));
+        CHECK_FALSE(t.track(non_zoom_tcp_flow, timestamp::from_sec(1), 100));
+        CHECK_FALSE(t.track(non_zoom_udp_flow, timestamp::from_sec(2), 100));
         CHECK(t.count_zoom_flows_detected() == 0);
         CHECK(t.count_total_pkts_processed() == 2);
         CHECK(t.count_zoom_pkts_detected() == 0);
@@ -39,7 +40,7 @@ TEST_CASE("zoom::flow_tracker", "[zoom][flow_tracker]") {
 
         zoom::flow_tracker t;
 
-        auto f1 = t.track(zoom_tcp_flow, {1, 0}, 100);
+        auto f1 = t.track(zoom_tcp_flow, timestamp::from_sec(1), 100);
         CHECK(f1);
         CHECK(f1->id == 0);
         CHECK(f1->type == zoom::flow_tracker::flow_type::tcp);
@@ -47,7 +48,7 @@ TEST_CASE("zoom::flow_tracker", "[zoom][flow_tracker]") {
         CHECK(t.count_total_pkts_processed() == 1);
         CHECK(t.count_zoom_pkts_detected() == 1);
 
-        auto f2 = t.track(zoom_udp_srv_flow, {2, 0}, 100);
+        auto f2 = t.track(zoom_udp_srv_flow, timestamp::from_sec(2), 100);
         CHECK(f2);
         CHECK(f2->id == 1);
         CHECK(f2->type == zoom::flow_tracker::flow_type::udp_srv);
@@ -55,7 +56,7 @@ TEST_CASE("zoom::flow_tracker", "[zoom][flow_tracker]") {
         CHECK(t.count_total_pkts_processed() == 2);
         CHECK(t.count_zoom_pkts_detected() == 2);
 
-        auto f11 = t.track(zoom_tcp_flow, {2, 0}, 100);
+        auto f11 = t.track(zoom_tcp_flow, timestamp::from_sec(2), 100);
         CHECK(f11);
         CHECK(f11->id == 0);
         CHECK(f11->type == zoom::flow_tracker::flow_type::tcp);
@@ -63,7 +64,7 @@ TEST_CASE("zoom::flow_tracker", "[zoom][flow_tracker]") {
         CHECK(t.count_total_pkts_processed() == 3);
         CHECK(t.count_zoom_pkts_detected() == 3);
 
-        auto f21 = t.track(zoom_udp_srv_flow, {3, 0}, 100);
+        auto f21 = t.track(zoom_udp_srv_flow, timestamp::from_sec(3), 100);
         CHECK(f21);
         CHECK(f21->id == 1);
         CHECK(f21->type == zoom::flow_tracker::flow_type::udp_srv);
@@ -117,7 +118,7 @@ TEST_CASE("zoom::flow_tracker", "[zoom][flow_tracker]") {
         const unsigned STUN_EXPIRATION = 10;
         zoom::flow_tracker t(STUN_EXPIRATION);
 
-        auto f11 = t.track(zoom_stun_flow, {1, 0}, 100);
+        auto f11 = t.track(zoom_stun_flow, timestamp::from_sec(1), 100);
         CHECK(f11);
         CHECK(f11->id == 0);
         CHECK(f11->type == zoom::flow_tracker::flow_type::udp_stun);
@@ -125,7 +126,7 @@ TEST_CASE("zoom::flow_tracker", "[zoom][flow_tracker]") {
         CHECK(t.count_total_pkts_processed() == 1);
         CHECK(t.count_zoom_pkts_detected() == 1);
 
-        auto f12 = t.track(zoom_stun_flow, {2, 0}, 100);
+        auto f12 = t.track(zoom_stun_flow, timestamp::from_sec(2), 100);
         CHECK(f12);
         CHECK(f12->id == 0);
         CHECK(f12->type == zoom::flow_tracker::flow_type::udp_stun);
@@ -133,7 +134,7 @@ TEST_CASE("zoom::flow_tracker", "[zoom][flow_tracker]") {
         CHECK(t.count_total_pkts_processed() == 2);
         CHECK(t.count_zoom_pkts_detected() == 2);
 
-        auto f21 = t.track(zoom_p2p_flow, {2 + STUN_EXPIRATION - 1, 0}, 100);
+        auto f21 = t.track(zoom_p2p_flow, timestamp::from_sec(2 + STUN_EXPIRATION - 1), 100);
         CHECK(f21);
         CHECK(f21->id == 1);
         CHECK(f21->type == zoom::flow_tracker::flow_type::udp_p2p);
@@ -145,25 +146,145 @@ TEST_CASE("zoom::flow_tracker", "[zoom][flow_tracker]") {
 
             INFO(t.count_zoom_flows_detected());
 
-            auto f31 = t.track(zoom_stun_flow2, {1, 0}, 100);
+            auto f31 = t.track(zoom_stun_flow2, timestamp::from_sec(1), 100);
             CHECK(f31);
             CHECK(f31->id == 2);
             CHECK(f31->type == zoom::flow_tracker::flow_type::udp_stun);
 
-            CHECK_FALSE(t.track(p2p_flow_with_previous_ip_port, {1 + STUN_EXPIRATION + 1, 0}, 100));
+            CHECK_FALSE(t.track(p2p_flow_with_previous_ip_port,
+                timestamp::from_sec(1 + STUN_EXPIRATION + 1), 100));
         }
 
         SECTION("does not track flows with only port or ip from previous stun") {
-            CHECK_FALSE(t.track(non_zoom_flow_with_stun_port, {5, 0}, 100));
-            CHECK_FALSE(t.track(non_zoom_flow_with_stun_ip, {5, 0}, 100));
+            CHECK_FALSE(t.track(non_zoom_flow_with_stun_port, timestamp::from_sec(5), 100));
+            CHECK_FALSE(t.track(non_zoom_flow_with_stun_ip, timestamp::from_sec(5), 100));
         }
 
         SECTION("does not track non-UDP flows with previous STUN packet to ip+port seen") {
-            CHECK_FALSE(t.track(non_zoom_tcp_flow_with_stun_ip_port, {5, 0}, 100));
+            CHECK_FALSE(t.track(non_zoom_tcp_flow_with_stun_ip_port, timestamp::from_sec(5), 100));
         }
 
         SECTION("does not track non-zoom STUN flows") {
-            CHECK_FALSE(t.track(non_zoom_stun_flow, {5, 0}, 100));
+            CHECK_FALSE(t.track(non_zoom_stun_flow, timestamp::from_sec(5), 100));
         }
     }
 }
+
+TEST_CASE("zoom::flow_tracker: track_batch is equivalent to track", "[zoom][flow_tracker]") {
+
+    std::vector<zoom::flow_tracker::pkt_info> pkts = {
+        { { net::ipv4::str_to_addr("10.0.0.6"), net::ipv4::str_to_addr("209.9.215.34"),
+            12433, 3478, 17 }, timestamp::from_sec(1), 100 },
+        { { net::ipv4::str_to_addr("98.52.6.140"), net::ipv4::str_to_addr("84.202.2.49"),
+            24242, 8801, 6 }, timestamp::from_sec(1, 5000), 200 },
+        { { net::ipv4::str_to_addr("10.0.0.6"), net::ipv4::str_to_addr("10.0.0.7"),
+            12433, 40200, 17 }, timestamp::from_sec(2), 300 },
+        { { net::ipv4::str_to_addr("13.52.6.140"), net::ipv4::str_to_addr("10.0.0.5"),
+            8805, 10293, 17 }, timestamp::from_sec(2, 10000), 400 },
+        { { net::ipv4::str_to_addr("10.0.0.6"), net::ipv4::str_to_addr("10.0.0.7"),
+            12433, 40200, 17 }, timestamp::from_sec(3), 500 }
+    };
+
+    // buckets are only looked up ahead in large flow tables
+    for (unsigned flows : { 0u, (unsigned) zoom::flow_tracker::BATCH_LOOKUP_MIN_FLOWS }) {
+
+        INFO("flows tracked before: " << flows);
+
+        zoom::flow_tracker single, batched;
+        std::vector<std::optional<zoom::flow_tracker::flow_stats>> results(pkts.size());
+
+        for (unsigned i = 0; i < flows; i++) {
+            net::ipv4_5tuple srv { net::ipv4::str_to_addr("13.52.6.140"), 0x0a010000 + i, 8801,
+                                   40000, 17 };
+            single.track(srv, 0, 100);
+            batched.track(srv, 0, 100);
+        }
+
+        batched.track_batch(pkts.data(), results.data(), pkts.size());
+
+        for (std::size_t i = 0; i < pkts.size(); i++) {
+
+            auto expected = single.track(pkts[i].ip_5t, pkts[i].ts, pkts[i].bytes);
+
+            CHECK(results[i].has_value() == expected.has_value());
+
+            if (expected) {
+                CHECK(results[i]->id == expected->id);
+                CHECK(results[i]->type == expected->type);
+                CHECK(results[i]->pkts == expected->pkts);
+            }
+        }
+
+        CHECK_FALSE(results[1]);
+        CHECK(results[4]->type == zoom::flow_tracker::flow_type::udp_p2p);
+        CHECK(results[4]->pkts == 2);
+        CHECK(batched.count_zoom_flows_detected() == single.count_zoom_flows_detected());
+        CHECK(batched.count_total_pkts_processed() == flows + 5);
+        CHECK(batched.count_zoom_pkts_detected() == single.count_zoom_pkts_detected());
+    }
+}
+
+TEST_CASE("zoom::flow_tracker: merging trackers of consecutive packets", "[zoom][flow_tracker]") {
+
+    auto stun = net::ipv4_5tuple { net::ipv4::str_to_addr("10.0.0.6"),
+        net::ipv4::str_to_addr("209.9.215.34"), 12433, 3478, 17 };
+    auto p2p = net::ipv4_5tuple { net::ipv4::str_to_addr("10.0.0.6"),
+        net::ipv4::str_to_addr("10.0.0.7"), 12433, 40200, 17 };
+    auto srv = net::ipv4_5tuple { net::ipv4::str_to_addr("13.52.6.140"),
+        net::ipv4::str_to_addr("10.0.0.5"), 8805, 10293, 17 };
+    auto other = net::ipv4_5tuple { net::ipv4::str_to_addr("98.52.6.140"),
+        net::ipv4::str_to_addr("84.202.2.49"), 24242, 8801, 17 };
+
+    std::vector<zoom::flow_tracker::pkt_info> pkts = {
+        { srv, timestamp::from_sec(1), 100 }, { other, timestamp::from_sec(1, 5000), 200 },
+        { stun, timestamp::from_sec(2), 300 }, { srv, timestamp::from_sec(2, 10000), 400 },
+        { p2p, timestamp::from_sec(3), 500 }, { stun, timestamp::from_sec(4), 600 },
+        { p2p, timestamp::from_sec(5), 700 }, { other, timestamp::from_sec(6), 800 },
+        { srv, timestamp::from_sec(7), 900 }
+    };
+
+    zoom::flow_tracker all;
+
+    for (const auto& pkt : pkts)
+        all.track(pkt.ip_5t, pkt.ts, pkt.bytes);
+
+    for (std::size_t split = 0; split <= pkts.size(); split++) {
+
+        INFO("split: " << split);
+
+        zoom::flow_tracker first, second(300, true);
+
+        for (std::size_t i = 0; i < pkts.size(); i++)
+            (i < split ? first : second).track(pkts[i].ip_5t, pkts[i].ts, pkts[i].bytes);
+
+        // P2P packets are missed without the STUN packets before them (3, 4, 6) and the continued
+        // STUN flow announces the P2P peer once more on its own (5)
+        bool mergeable = split < 3 || split > 6;
+        CHECK(first.can_merge(second) == mergeable);
+
+        if (mergeable) {
+            first.merge(second);
+        } else {
+            for (std::size_t i = split; i < pkts.size(); i++)
+                first.track(pkts[i].ip_5t, pkts[i].ts, pkts[i].bytes);
+        }
+
+        CHECK(first.count_zoom_flows_detected() == all.count_zoom_flows_detected());
+        CHECK(first.count_total_pkts_processed() == all.count_total_pkts_processed());
+        CHECK(first.count_zoom_pkts_detected() == all.count_zoom_pkts_detected());
+        CHECK(first.count_zoom_bytes_detected() == all.count_zoom_bytes_detected());
+        REQUIRE(first.flows().size() == all.flows().size());
+
+        for (const auto& [ip_5t, stats] : all.flows()) {
+            const auto& merged_stats = first.flows().at(ip_5t);
+            CHECK(merged_stats.id == stats.id);
+            CHECK(merged_stats.type == stats.type);
+            CHECK(merged_stats.pkts == stats.pkts);
+            CHECK(merged_stats.bytes == stats.bytes);
+            CHECK(merged_stats.start_ts == stats.start_ts);
+            CHECK(merged_stats.last_ts == stats.last_ts);
+        }
+    }
+
+    CHECK_THROWS(all.can_merge(zoom::flow_tracker()));
+}
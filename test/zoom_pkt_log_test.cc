@@ -0,0 +1,132 @@
+#include <catch.h>
+#include <filesystem>
+#include <sstream>
+#include <vector>
+#include "lib/async_writer.h"
+#include "lib/simple_binary_reader.h"
+#include "lib/zoom.h"
+#include "lib/zoom_pkt_log.h"
+
+#include "test_packets.h"
+
+//! returns packets of two streams, interleaved
+static std::vector<zoom::pkt> test_pkts() {
+
+    auto video = zoom::parse_zoom_pkt_buf(test::zoom_srv_video_buf, net::eth::HDR_LEN, false);
+    auto audio = zoom::parse_zoom_pkt_buf(test::zoom_p2p_audio_buf, net::eth::HDR_LEN, true);
+    std::vector<zoom::pkt> pkts;
+
+    for (unsigned i = 0; i < 10; i++) {
+
+        zoom::pkt p(i % 3 == 2 ? audio : video, timestamp::from_sec(1000 + i, i * 1000),
+                    i % 3 == 2);
+        p.proto.rtp.seq += i;
+        p.proto.rtp.ts += i * 3000;
+        pkts.push_back(p);
+    }
+
+    return pkts;
+}
+
+static std::string to_csv(const std::vector<zoom::pkt>& pkts) {
+
+    std::stringstream ss;
+
+    {
+        csv_writer csv(ss);
+
+        for (const auto& p : pkts)
+            zoom::write_pkt_log_csv(csv, zoom::pkt_log_stream::from_pkt(p),
+                                    zoom::pkt_log_pkt::from_pkt(p, 0));
+    }
+
+    return ss.str();
+}
+
+TEST_CASE("zoom::pkt_log_writer: writes each stream once, before its first packet",
+          "[zoom][pkt_log]") {
+
+    auto file_name = (std::filesystem::temp_directory_path() / "zoom_test_pkts.zpl").string();
+    auto pkts = test_pkts();
+
+    {
+        async_writer writer;
+        zoom::pkt_log_writer log;
+        log.open(file_name, &writer);
+        CHECK(log.is_open());
+
+        for (const auto& p : pkts)
+            log.write(p);
+
+        log.close();
+        writer.drain();
+
+        CHECK_FALSE(log.is_open());
+        CHECK(log.pkt_count() == 10);
+        CHECK(log.stream_count() == 2);
+    }
+
+    CHECK(std::filesystem::file_size(file_name) == 12 * sizeof(zoom::pkt_log_record));
+
+    {
+        simple_binary_reader<zoom::pkt_log_record> reader(file_name);
+        zoom::pkt_log_record r;
+        std::vector<bool> is_stream;
+
+        while (reader.next(r))
+            is_stream.push_back(r.is_stream());
+
+        CHECK(is_stream == std::vector<bool> { true, false, false, true, false, false, false,
+                                                false, false, false, false, false });
+    }
+
+    SECTION("reads the packets with their streams") {
+
+        zoom::pkt_log_reader reader(file_name);
+        zoom::pkt_log_pkt p;
+        std::stringstream ss;
+
+        {
+            csv_writer csv(ss);
+
+            while (reader.next(p)) {
+
+                const auto& pkt = pkts[reader.pkt_count() - 1];
+                CHECK(reader.stream(p) == zoom::pkt_log_stream::from_pkt(pkt));
+                CHECK(p.ts == pkt.ts);
+                CHECK(p.rtp_seq == pkt.proto.rtp.seq);
+                CHECK(p.rtp_ts == pkt.proto.rtp.ts);
+
+                zoom::write_pkt_log_csv(csv, reader.stream(p), p);
+            }
+        }
+
+        CHECK(reader.pkt_count() == 10);
+        CHECK(reader.stream_count() == 2);
+        CHECK(ss.str() == to_csv(pkts));
+    }
+
+    std::filesystem::remove(file_name);
+}
+
+TEST_CASE("zoom::pkt_log_reader: rejects packets of unknown streams", "[zoom][pkt_log]") {
+
+    auto file_name = (std::filesystem::temp_directory_path() / "zoom_test_bad.zpl").string();
+
+    {
+        simple_binary_writer<zoom::pkt_log_record> writer(file_name);
+        zoom::pkt_log_record r;
+        r.pkt.stream = 1;
+        writer.write(r);
+    }
+
+    zoom::pkt_log_reader reader(file_name);
+    zoom::pkt_log_pkt p;
+    CHECK_THROWS_AS(reader.next(p), std::runtime_error);
+
+    CHECK(zoom::pkt_log_writer::is_pkt_log_file_name("pkts.zpl"));
+    CHECK_FALSE(zoom::pkt_log_writer::is_pkt_log_file_name("pkts.csv"));
+    CHECK_FALSE(zoom::pkt_log_writer::is_pkt_log_file_name(".zpl"));
+
+    std::filesystem::remove(file_name);
+}
@@ -1,5 +1,6 @@
 
 #include <catch.h>
+#include <filesystem>
 #include "lib/net.h"
 #include "lib/zoom.h"
 #include "lib/pcap_util.h"
@@ -13,8 +14,7 @@ TEST_CASE("zoom::pkt: is initialized with empty fields", "[zoom][pkt]") {
 
     zoom::pkt p;
 
-    CHECK(p.ts.s == 0);
-    CHECK(p.ts.us == 0);
+    CHECK(p.ts == 0);
 
     CHECK(p.flags.p2p == 0);
     CHECK(p.flags.srv == 0);
@@ -51,8 +51,8 @@ TEST_CASE("zoom::pkt: is initialized with empty fields", "[zoom][pkt]") {
 
 TEST_CASE("zoom::pkt: can be initialized from rtp headers", "[zoom][pkt]") {
 
-    auto h = zoom::parse_zoom_pkt_buf(test::zoom_srv_video_buf, true, false);
-    zoom::pkt p(h, {1, 2}, false);
+    auto h = zoom::parse_zoom_pkt_buf(test::zoom_srv_video_buf, net::eth::HDR_LEN, false);
+    zoom::pkt p(h, timestamp::from_sec(1, 2000), false);
 
     CHECK(p.flags.p2p == 0);
     CHECK(p.flags.srv == 1);
@@ -69,8 +69,8 @@ TEST_CASE("zoom::pkt: can be initialized from rtp headers", "[zoom][pkt]") {
 
 TEST_CASE("zoom::pkt: can be initialized from rtcp headers", "[zoom][pkt]") {
 
-    auto h = zoom::parse_zoom_pkt_buf(test::zoom_srv_rtcp_buf, true, false);
-    zoom::pkt p(h, {1, 2}, false);
+    auto h = zoom::parse_zoom_pkt_buf(test::zoom_srv_rtcp_buf, net::eth::HDR_LEN, false);
+    zoom::pkt p(h, timestamp::from_sec(1, 2000), false);
 
     CHECK(p.flags.p2p == 0);
     CHECK(p.flags.srv == 1);
@@ -89,8 +89,8 @@ TEST_CASE("zoom::pkt: can be initialized from rtcp headers", "[zoom][pkt]") {
 
 TEST_CASE("zoom::pkt: can be initialized from rtp buffers with short format", "[zoom][pkt]") {
 
-    auto h = zoom::parse_zoom_pkt_buf(test::zoom_srv_video_short_buf, true, false);
-    zoom::pkt p(h, {1, 2}, false);
+    auto h = zoom::parse_zoom_pkt_buf(test::zoom_srv_video_short_buf, net::eth::HDR_LEN, false);
+    zoom::pkt p(h, timestamp::from_sec(1, 2000), false);
 
     CHECK(p.flags.p2p == 0);
     CHECK(p.flags.srv == 1);
@@ -112,11 +112,10 @@ TEST_CASE("zoom::pkt: can be initialized with a pcap packet ", "[zoom][pkt]") {
 
     pcap_reader.next(pcap_pkt);
 
-    auto hdr = zoom::parse_zoom_pkt_buf(pcap_pkt.buf, true, true);
+    auto hdr = zoom::parse_zoom_pkt_buf(pcap_pkt.buf, net::eth::HDR_LEN, true);
     zoom::pkt zoom_pkt(hdr, pcap_pkt.ts, true);
 
-    CHECK(zoom_pkt.ts.s == 1632344358);
-    CHECK(zoom_pkt.ts.us == 611365);
+    CHECK(zoom_pkt.ts == timestamp::from_sec(1632344358, 611365000));
     CHECK(zoom_pkt.flags.p2p == 1);
     CHECK(zoom_pkt.flags.srv == 0);
     CHECK(zoom_pkt.flags.to_srv == 0);
@@ -155,7 +154,7 @@ TEST_CASE("zoom::pkt: can be written to and read from a file", "[zoom][pkt]") {
 
     while (pcap_reader.next(pcap_pkt)) {
 
-        auto hdr = zoom::parse_zoom_pkt_buf(pcap_pkt.buf, true, true);
+        auto hdr = zoom::parse_zoom_pkt_buf(pcap_pkt.buf, net::eth::HDR_LEN, true);
         zoom::pkt zpkt(hdr, pcap_pkt.ts, true);
         zpkt_writer.write(zpkt);
     }
@@ -174,8 +173,7 @@ TEST_CASE("zoom::pkt: can be written to and read from a file", "[zoom][pkt]") {
         read_count++;
 
         if (read_count == 1) {
-            CHECK(zoom_pkt.ts.s == 1632344358);
-            CHECK(zoom_pkt.ts.us == 611365);
+            CHECK(zoom_pkt.ts == timestamp::from_sec(1632344358, 611365000));
             CHECK(zoom_pkt.flags.p2p == 1);
             CHECK(zoom_pkt.flags.srv == 0);
             CHECK(zoom_pkt.flags.to_srv == 0);
@@ -209,3 +207,43 @@ TEST_CASE("zoom::pkt: can be written to and read from a file", "[zoom][pkt]") {
 
     CHECK(read_count == 64);
 }
+
+TEST_CASE("zoom::pkt: files written with rotation hold every packet once", "[zoom][pkt]") {
+
+    auto file_name = (std::filesystem::temp_directory_path() / "zoom_test_rotation.zpkt").string();
+
+    file_rotation rotation;
+    rotation.max_bytes = 10 * sizeof(zoom::pkt) + 1;
+
+    simple_binary_writer<zoom::pkt> zpkt_writer(file_name, rotation);
+
+    for (unsigned i = 0; i < 25; i++) {
+        zoom::pkt zpkt;
+        zpkt.ts = i;
+        zpkt_writer.write(zpkt);
+    }
+
+    zpkt_writer.close();
+    CHECK(zpkt_writer.count() == 25);
+    REQUIRE(zpkt_writer.file_count() == 3);
+
+    unsigned i = 0;
+
+    for (unsigned seq = 0; seq < 3; seq++) {
+
+        auto seq_file_name = file_rotation::file_name(file_name, seq);
+        simple_binary_reader<zoom::pkt> zpkt_reader(seq_file_name);
+        zoom::pkt zpkt;
+
+        CHECK(zpkt_reader.size() == (seq < 2 ? 10 : 5));
+
+        while (zpkt_reader.next(zpkt)) {
+            CHECK(zpkt.ts == i++);
+        }
+
+        zpkt_reader.close();
+        std::filesystem::remove(seq_file_name);
+    }
+
+    CHECK(i == 25);
+}
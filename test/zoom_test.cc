@@ -1,12 +1,15 @@
 #include <catch.h>
+#include <cstring>
+#include <vector>
 #include "lib/net.h"
+#include "lib/pcap_file_reader.h"
 #include "lib/zoom.h"
 
 #include "test_packets.h"
 
 TEST_CASE("zoom::parse_zoom_pkt_buf: parses a srv-based video packet", "[zoom][parse]") {
 
-    auto hdr = zoom::parse_zoom_pkt_buf(test::zoom_srv_video_buf, true, false);
+    auto hdr = zoom::parse_zoom_pkt_buf(test::zoom_srv_video_buf, net::eth::HDR_LEN, false);
 
     CHECK(hdr.ip != nullptr);
     CHECK(hdr.udp != nullptr);
@@ -26,7 +29,7 @@ TEST_CASE("zoom::parse_zoom_pkt_buf: parses a srv-based video packet", "[zoom][p
 
 TEST_CASE("zoom::parse_zoom_pkt_buf: parses a p2p audio packet", "[zoom][parse]") {
 
-    auto hdr = zoom::parse_zoom_pkt_buf(test::zoom_p2p_audio_buf, true, true);
+    auto hdr = zoom::parse_zoom_pkt_buf(test::zoom_p2p_audio_buf, net::eth::HDR_LEN, true);
 
     CHECK(hdr.ip != nullptr);
     CHECK(hdr.udp != nullptr);
@@ -45,7 +48,7 @@ TEST_CASE("zoom::parse_zoom_pkt_buf: parses a p2p audio packet", "[zoom][parse]"
 
 TEST_CASE("zoom::parse_zoom_pkt_buf: parses a p2p screen share packet", "[zoom][parse]") {
 
-    auto hdr = zoom::parse_zoom_pkt_buf(test::zoom_p2p_screenshare_buf, true, true);
+    auto hdr = zoom::parse_zoom_pkt_buf(test::zoom_p2p_screenshare_buf, net::eth::HDR_LEN, true);
 
     CHECK(hdr.ip != nullptr);
     CHECK(hdr.udp != nullptr);
@@ -64,7 +67,7 @@ TEST_CASE("zoom::parse_zoom_pkt_buf: parses a p2p screen share packet", "[zoom][
 
 TEST_CASE("zoom::parse_zoom_pkt_buf: parses a srv-based screen share packet", "[zoom][parse]") {
 
-    auto hdr = zoom::parse_zoom_pkt_buf(test::zoom_srv_screenshare_buf, true, false);
+    auto hdr = zoom::parse_zoom_pkt_buf(test::zoom_srv_screenshare_buf, net::eth::HDR_LEN, false);
 
     CHECK(hdr.ip != nullptr);
     CHECK(hdr.udp != nullptr);
@@ -83,7 +86,7 @@ TEST_CASE("zoom::parse_zoom_pkt_buf: parses a srv-based screen share packet", "[
 
 TEST_CASE("zoom::parse_zoom_pkt_buf: parses a srv-based RTCP packet", "[zoom][parse]") {
 
-    auto hdr = zoom::parse_zoom_pkt_buf(test::zoom_srv_rtcp_buf, true, false);
+    auto hdr = zoom::parse_zoom_pkt_buf(test::zoom_srv_rtcp_buf, net::eth::HDR_LEN, false);
 
     CHECK(hdr.ip != nullptr);
     CHECK(hdr.udp != nullptr);
@@ -109,7 +112,7 @@ TEST_CASE("zoom::parse_zoom_pkt_buf: parses a srv-based RTCP packet", "[zoom][pa
 
 TEST_CASE("zoom::parse_zoom_pkt_buf: parses a P2P RTCP packet", "[zoom][parse]") {
 
-    auto hdr = zoom::parse_zoom_pkt_buf(test::zoom_p2p_rtcp_buf, true, true);
+    auto hdr = zoom::parse_zoom_pkt_buf(test::zoom_p2p_rtcp_buf, net::eth::HDR_LEN, true);
 
     CHECK(hdr.ip != nullptr);
     CHECK(hdr.udp != nullptr);
@@ -132,3 +135,126 @@ TEST_CASE("zoom::parse_zoom_pkt_buf: parses a P2P RTCP packet", "[zoom][parse]")
     CHECK(hdr.rtcp->msg.sr.sender_pkt_count == ntohl(4854));
     CHECK(hdr.rtcp->msg.sr.sender_byte_count == ntohl(663624));
 }
+
+TEST_CASE("zoom::parse_zoom_pkt_buf: parses truncated packets", "[zoom][parse]") {
+
+    const auto* buf = test::zoom_srv_video_buf;
+    const auto full = zoom::parse_zoom_pkt_buf(buf, net::eth::HDR_LEN, false,
+                                               sizeof(test::zoom_srv_video_buf));
+    const auto rtp_offset = full.rtp_rtcp_offset;
+
+    REQUIRE(full.rtp != nullptr);
+    CHECK_FALSE(full.truncated);
+    CHECK_FALSE(full.rtp_ext_truncated);
+    CHECK(full.rtp_ext1[0] == 0x50);
+
+    // every prefix is read within its cap_len bytes only
+    for (unsigned cap_len = 0; cap_len <= sizeof(test::zoom_srv_video_buf); cap_len++) {
+
+        std::vector<unsigned char> snapped(buf, buf + cap_len);
+        auto hdr = zoom::parse_zoom_pkt_buf(snapped.data(), net::eth::HDR_LEN, false, cap_len);
+
+        CHECK((hdr.ip != nullptr) == (cap_len >= net::eth::HDR_LEN + net::ipv4::HDR_LEN));
+        CHECK((hdr.udp != nullptr) == (cap_len >= full.udp_pl_offset));
+        CHECK((hdr.zoom_inner != nullptr) == (cap_len > full.udp_pl_offset + zoom::SRV_HDR_LEN));
+        CHECK((hdr.rtp != nullptr) == (cap_len >= rtp_offset + rtp::HDR_LEN));
+        CHECK(hdr.truncated == (cap_len < rtp_offset + rtp::HDR_LEN));
+
+        // the extension of type 1 is either found or counted as truncated
+        if (hdr.rtp) {
+            CHECK(hdr.rtp_ext_truncated == (hdr.rtp_ext1[0] != 0x50));
+        }
+    }
+
+    // the UDP header's length is kept
+    auto hdr = zoom::parse_zoom_pkt_buf(buf, net::eth::HDR_LEN, false, rtp_offset + rtp::HDR_LEN);
+    CHECK(hdr.rtp_ext_truncated);
+    CHECK(zoom::pkt(hdr, 0, false).udp_pl_len == zoom::pkt(full, 0, false).udp_pl_len);
+}
+
+TEST_CASE("zoom::parse_zoom_pkt_buf: packets cut off at hdr_end parse to the same headers",
+          "[zoom][parse]") {
+
+    auto check = [](const unsigned char* buf, unsigned cap_len, bool is_p2p) {
+
+        auto full = zoom::parse_zoom_pkt_buf(buf, net::eth::HDR_LEN, is_p2p, cap_len);
+
+        if (!full.rtp && !full.rtcp) {
+            CHECK(full.hdr_end == 0);
+            return false;
+        }
+
+        REQUIRE(full.hdr_end > full.rtp_rtcp_offset);
+        REQUIRE(full.hdr_end <= cap_len);
+
+        std::vector<unsigned char> cut(buf, buf + full.hdr_end);
+        auto hdr = zoom::parse_zoom_pkt_buf(cut.data(), net::eth::HDR_LEN, is_p2p, full.hdr_end);
+
+        CHECK_FALSE(hdr.truncated);
+        CHECK_FALSE(hdr.rtp_ext_truncated);
+        CHECK(hdr.hdr_end == full.hdr_end);
+
+        zoom::pkt a(full, 0, is_p2p), b(hdr, 0, is_p2p);
+        CHECK(b.udp_pl_len == a.udp_pl_len);
+        CHECK(b.zoom_media_type == a.zoom_media_type);
+        CHECK(b.pkts_in_frame == a.pkts_in_frame);
+        CHECK(b.flags.rtp == a.flags.rtp);
+        CHECK(b.flags.rtcp == a.flags.rtcp);
+        CHECK(std::memcmp(b.rtp_ext1, a.rtp_ext1, sizeof(a.rtp_ext1)) == 0);
+
+        if (a.flags.rtp) {
+            CHECK(b.proto.rtp.ssrc == a.proto.rtp.ssrc);
+            CHECK(b.proto.rtp.seq == a.proto.rtp.seq);
+            CHECK(b.proto.rtp.ts == a.proto.rtp.ts);
+        } else {
+            CHECK(b.proto.rtcp.ssrc == a.proto.rtcp.ssrc);
+            CHECK(b.proto.rtcp.rtp_ts == a.proto.rtcp.rtp_ts);
+        }
+
+        return true;
+    };
+
+    // with header extension
+    CHECK(check(test::zoom_srv_video_buf, sizeof(test::zoom_srv_video_buf), false));
+
+    pcap_file_reader r("data/zoom_test.pcap");
+    pcap_pkt pkt;
+    unsigned rtp_rtcp_pkts = 0;
+
+    while (r.next(pkt)) {
+        rtp_rtcp_pkts += check(pkt.buf, pkt.cap_len, true);
+    }
+
+    CHECK(rtp_rtcp_pkts > 0);
+    r.close();
+}
+
+TEST_CASE("zoom::parse_zoom_pkt_buf: reads extension lengths of 256 words and more",
+          "[zoom][parse]") {
+
+    const auto rtp_offset = zoom::parse_zoom_pkt_buf(test::zoom_srv_video_buf,
+                                                     net::eth::HDR_LEN, false).rtp_rtcp_offset;
+    const auto ext_offset = rtp_offset + rtp::HDR_LEN;
+    const unsigned ext_len = 0x0101 * 4, len = ext_offset + 4 + ext_len + 100;
+
+    // the video packet with an extension of 0x0101 words, whose element of type 1 is renamed
+    std::vector<unsigned char> buf(test::zoom_srv_video_buf,
+                                   test::zoom_srv_video_buf + sizeof(test::zoom_srv_video_buf));
+    buf.resize(len);
+    buf[net::eth::HDR_LEN + 2] = (unsigned char) ((len - net::eth::HDR_LEN) >> 8);
+    buf[net::eth::HDR_LEN + 3] = (unsigned char) (len - net::eth::HDR_LEN);
+    buf[ext_offset + 2] = 0x01;
+    buf[ext_offset + 3] = 0x01;
+    buf[ext_offset + 4] = 0x22;
+
+    auto hdr = zoom::parse_zoom_pkt_buf(buf.data(), net::eth::HDR_LEN, false, len);
+    REQUIRE(hdr.rtp != nullptr);
+    CHECK(hdr.hdr_end == ext_offset + 4 + ext_len);
+    CHECK_FALSE(hdr.rtp_ext_truncated);
+
+    // snapped within the extension, but beyond 0x0100 + 0x01 * 4 bytes into it
+    hdr = zoom::parse_zoom_pkt_buf(buf.data(), net::eth::HDR_LEN, false, ext_offset + 0x0200);
+    REQUIRE(hdr.rtp != nullptr);
+    CHECK(hdr.rtp_ext_truncated);
+    CHECK(hdr.hdr_end == ext_offset + 0x0200);
+}